@@ -0,0 +1,34 @@
+version=6.5.0
+soversion=6
+prefix=/usr/local
+libdir=/usr/local/lib
+bindir=/usr/local/bin
+datadir=/usr/local/share
+mandir=/usr/local/share/man
+extra_versioning=false
+melt_noversion=false
+targetos=Linux
+MMX_FLAGS=-DUSE_MMX
+SSE_FLAGS=-DUSE_SSE
+SSE2_FLAGS=-DUSE_SSE2
+DEBUG_FLAGS=-g
+LARGE_FILE=-D_FILE_OFFSET_BITS=64 -D_LARGEFILE_SOURCE
+ARCH_X86_64=1
+CFLAGS+=-DARCH_X86_64
+OPTIMISATIONS=-O2 -pipe
+OPTIMISATIONS+=-fno-tree-dominator-opts
+OPTIMISATIONS+=-fno-tree-pre
+CFLAGS+=-Wall -DPIC $(TARGETARCH) $(TARGETCPU) $(OPTIMISATIONS) $(MMX_FLAGS) $(SSE_FLAGS) $(SSE2_FLAGS) $(DEBUG_FLAGS) $(LARGE_FILE)
+CXXFLAGS+=-Wall -DPIC $(TARGETARCH) $(TARGETCPU) $(OPTIMISATIONS) $(MMX_FLAGS) $(SSE_FLAGS) $(SSE2_FLAGS) $(DEBUG_FLAGS) $(LARGE_FILE)
+OPTIMISATIONS+=-ffast-math
+CFLAGS+=-fPIC -pthread
+SHFLAGS=-shared
+LIBDL=-ldl
+RDYNAMIC=-rdynamic
+LDFLAGS+=-Wl,--no-undefined -Wl,--as-needed
+LIBSUF=.so
+moduledir=/usr/local/lib/mlt
+mltdatadir=/usr/local/share/mlt
+unversionedmoduledir=/usr/local/lib/mlt
+unversionedmltdatadir=/usr/local/share/mlt
+meltname=melt
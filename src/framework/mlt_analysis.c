@@ -0,0 +1,778 @@
+/**
+ * \file mlt_analysis.c
+ * \brief shared analysis pass and binary sidecar for analysis results
+ * \see mlt_analysis_s
+ *
+ * Copyright (C) 2017 Meltytech, LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "mlt_analysis.h"
+#include "mlt_factory.h"
+#include "mlt_producer.h"
+#include "mlt_consumer.h"
+#include "mlt_filter.h"
+#include "mlt_frame.h"
+#include "mlt_profile.h"
+#include "mlt_log.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
+#define ANALYSIS_MAGIC "MLTANA01"
+#define ANALYSIS_NAME_SIZE 48
+#define ANALYSIS_FLAGS_SIZE( count ) ( ( ( count ) + 7 ) & ~7 )
+
+/** The header of a sidecar file.
+ *
+ * The header is followed by a table with an entry for each track, and
+ * the data of each track is a byte per position that flags whether the
+ * position has a record, padded to 8 bytes, followed by the records.
+ */
+
+typedef struct
+{
+	char magic[8];
+	int32_t track_count;
+	int32_t reserved;
+	int64_t length;      /**< the size of the file */
+}
+analysis_header;
+
+/** An entry of the track table of a sidecar file. */
+
+typedef struct
+{
+	char name[ ANALYSIS_NAME_SIZE ];
+	int32_t record_size;
+	int32_t reserved;
+	int64_t first;       /**< the position of the first record */
+	int64_t count;       /**< the number of positions from first */
+	int64_t offset;      /**< the offset of the data in the file */
+}
+analysis_entry;
+
+/** \brief private state of a track of analysis results */
+
+typedef struct
+{
+	char name[ ANALYSIS_NAME_SIZE ];
+	int record_size;
+	mlt_position first;
+	mlt_position count;
+	mlt_position size;   /**< the number of positions allocated or 0 if mapped */
+	uint8_t *valid;
+	uint8_t *records;
+}
+analysis_track;
+
+/** \brief Analysis class
+ *
+ * An analysis holds the results of analyzers as tracks of fixed-size
+ * records indexed by frame position. It is built in memory during an
+ * analysis pass and saved to a sidecar file, which is memory mapped when
+ * the results are applied.
+ */
+
+struct mlt_analysis_s
+{
+	pthread_mutex_t mutex;
+	analysis_track *tracks;
+	int track_count;
+	void *map;           /**< the loaded file or NULL */
+	size_t map_size;
+};
+
+/** Create an empty analysis.
+ *
+ * \public \memberof mlt_analysis_s
+ * \return a new analysis
+ */
+
+mlt_analysis mlt_analysis_new( )
+{
+	mlt_analysis self = calloc( 1, sizeof( struct mlt_analysis_s ) );
+	if ( self )
+		pthread_mutex_init( &self->mutex, NULL );
+	return self;
+}
+
+static analysis_track *find_track( mlt_analysis self, const char *name )
+{
+	int i;
+	for ( i = 0; i < self->track_count; i++ )
+		if ( !strncmp( self->tracks[i].name, name, ANALYSIS_NAME_SIZE - 1 ) )
+			return &self->tracks[i];
+	return NULL;
+}
+
+/** Load an analysis from a sidecar file.
+ *
+ * The file is memory mapped, so the records are read on demand.
+ * \public \memberof mlt_analysis_s
+ * \param filename the name of a sidecar file
+ * \return the analysis or NULL if the file does not exist or is invalid
+ */
+
+mlt_analysis mlt_analysis_load( const char *filename )
+{
+	analysis_header *header = NULL;
+	struct stat st;
+	FILE *f;
+	int i;
+
+	if ( !filename || stat( filename, &st ) || st.st_size < sizeof( analysis_header ) || !( f = fopen( filename, "rb" ) ) )
+		return NULL;
+#ifdef _WIN32
+	header = malloc( st.st_size );
+	if ( header && fread( header, st.st_size, 1, f ) != 1 )
+	{
+		free( header );
+		header = NULL;
+	}
+#else
+	header = mmap( NULL, st.st_size, PROT_READ, MAP_SHARED, fileno( f ), 0 );
+	if ( header == MAP_FAILED )
+		header = NULL;
+#endif
+	fclose( f );
+	if ( !header )
+		return NULL;
+
+	mlt_analysis self = mlt_analysis_new();
+	self->map = header;
+	self->map_size = st.st_size;
+
+	int error = memcmp( header->magic, ANALYSIS_MAGIC, sizeof( header->magic ) ) || header->length != st.st_size
+		|| header->track_count < 0
+		|| sizeof( analysis_header ) + header->track_count * sizeof( analysis_entry ) > st.st_size;
+	if ( !error )
+	{
+		analysis_entry *entries = ( analysis_entry* )( header + 1 );
+		self->tracks = calloc( header->track_count, sizeof( analysis_track ) );
+		for ( i = 0; i < header->track_count && !error; i++ )
+		{
+			analysis_entry *entry = &entries[i];
+			analysis_track *track = &self->tracks[ self->track_count++ ];
+			error = entry->record_size <= 0 || entry->count < 0 || entry->offset < 0
+				|| entry->offset + ANALYSIS_FLAGS_SIZE( entry->count ) + entry->count * entry->record_size > st.st_size;
+			memcpy( track->name, entry->name, ANALYSIS_NAME_SIZE );
+			track->name[ ANALYSIS_NAME_SIZE - 1 ] = '\0';
+			track->record_size = entry->record_size;
+			track->first = entry->first;
+			track->count = entry->count;
+			track->valid = ( uint8_t* )header + entry->offset;
+			track->records = track->valid + ANALYSIS_FLAGS_SIZE( entry->count );
+		}
+	}
+	if ( error )
+	{
+		mlt_log_warning( NULL, "[analysis] invalid sidecar %s\n", filename );
+		mlt_analysis_close( self );
+		self = NULL;
+	}
+	return self;
+}
+
+/** Save an analysis to a sidecar file.
+ *
+ * The file is written to a temporary file first so that concurrent readers
+ * never see a partial file.
+ * \public \memberof mlt_analysis_s
+ * \param self an analysis
+ * \param filename the name of the sidecar file
+ * \return true if there was an error
+ */
+
+int mlt_analysis_save( mlt_analysis self, const char *filename )
+{
+	analysis_header header;
+	int error = 1;
+	int i;
+
+	if ( !self || !filename )
+		return error;
+
+	pthread_mutex_lock( &self->mutex );
+	analysis_entry *entries = calloc( self->track_count + 1, sizeof( analysis_entry ) );
+	int64_t offset = sizeof( header ) + self->track_count * sizeof( analysis_entry );
+	for ( i = 0; i < self->track_count; i++ )
+	{
+		analysis_track *track = &self->tracks[i];
+		memcpy( entries[i].name, track->name, ANALYSIS_NAME_SIZE );
+		entries[i].record_size = track->record_size;
+		entries[i].first = track->first;
+		entries[i].count = track->count;
+		entries[i].offset = offset;
+		offset += ANALYSIS_FLAGS_SIZE( track->count ) + track->count * track->record_size;
+	}
+	memcpy( header.magic, ANALYSIS_MAGIC, sizeof( header.magic ) );
+	header.track_count = self->track_count;
+	header.reserved = 0;
+	header.length = offset;
+
+	size_t n = strlen( filename ) + 5;
+	char *temp = malloc( n );
+	snprintf( temp, n, "%s.tmp", filename );
+	FILE *f = fopen( temp, "wb" );
+	if ( f )
+	{
+		static const uint8_t padding[8] = { 0 };
+		error = fwrite( &header, sizeof( header ), 1, f ) != 1
+			|| ( self->track_count && fwrite( entries, sizeof( analysis_entry ), self->track_count, f ) != self->track_count );
+		for ( i = 0; i < self->track_count && !error; i++ )
+		{
+			analysis_track *track = &self->tracks[i];
+			int pad = ANALYSIS_FLAGS_SIZE( track->count ) - track->count;
+			error = track->count && ( fwrite( track->valid, track->count, 1, f ) != 1
+				|| ( pad && fwrite( padding, pad, 1, f ) != 1 )
+				|| fwrite( track->records, track->count * track->record_size, 1, f ) != 1 );
+		}
+		error = fclose( f ) || error;
+		if ( !error )
+			error = rename( temp, filename );
+		if ( error )
+			remove( temp );
+	}
+	pthread_mutex_unlock( &self->mutex );
+	if ( error )
+		mlt_log_warning( NULL, "[analysis] failed to save sidecar %s\n", filename );
+	free( entries );
+	free( temp );
+	return error;
+}
+
+/** Store a record.
+ *
+ * All of the records of a track have the same size. This may be called
+ * from any thread.
+ * \public \memberof mlt_analysis_s
+ * \param self an analysis
+ * \param name the name of the track, which is created if needed
+ * \param position the frame position of the record
+ * \param data the record
+ * \param size the size of the record in bytes
+ * \return true if there was an error
+ */
+
+int mlt_analysis_put( mlt_analysis self, const char *name, mlt_position position, const void *data, int size )
+{
+	int error = 1;
+
+	if ( !self || !name || !data || size <= 0 || position < 0 || self->map )
+		return error;
+
+	pthread_mutex_lock( &self->mutex );
+	analysis_track *track = find_track( self, name );
+	if ( !track )
+	{
+		self->tracks = realloc( self->tracks, ( self->track_count + 1 ) * sizeof( analysis_track ) );
+		track = &self->tracks[ self->track_count++ ];
+		memset( track, 0, sizeof( analysis_track ) );
+		strncpy( track->name, name, ANALYSIS_NAME_SIZE - 1 );
+		track->record_size = size;
+		track->first = position;
+	}
+	if ( track->record_size == size )
+	{
+		// Grow the track to include the position, keeping the records indexed from first.
+		mlt_position first = MIN( track->first, position );
+		mlt_position count = MAX( track->first + track->count, position + 1 ) - first;
+		if ( count > track->size || first < track->first )
+		{
+			mlt_position allocated = MAX( count, track->size * 2 );
+			mlt_position shift = track->first - first;
+			uint8_t *valid = calloc( allocated, 1 );
+			uint8_t *records = calloc( allocated, size );
+			if ( track->count )
+			{
+				memcpy( valid + shift, track->valid, track->count );
+				memcpy( records + shift * size, track->records, track->count * size );
+			}
+			free( track->valid );
+			free( track->records );
+			track->valid = valid;
+			track->records = records;
+			track->size = allocated;
+			track->first = first;
+		}
+		track->count = count;
+		track->valid[ position - first ] = 1;
+		memcpy( track->records + ( position - first ) * size, data, size );
+		error = 0;
+	}
+	pthread_mutex_unlock( &self->mutex );
+	return error;
+}
+
+/** Get a record.
+ *
+ * The record is copied because a concurrent mlt_analysis_put() may move it.
+ * \public \memberof mlt_analysis_s
+ * \param self an analysis
+ * \param name the name of the track
+ * \param position the frame position of the record
+ * \param[out] data a buffer for the record
+ * \param size the size of \p data in bytes, of which no more than the size of the record is copied
+ * \return the size of the record in bytes or 0 if there is none at the position
+ */
+
+int mlt_analysis_get( mlt_analysis self, const char *name, mlt_position position, void *data, int size )
+{
+	int result = 0;
+
+	if ( !self || !name )
+		return result;
+
+	pthread_mutex_lock( &self->mutex );
+	analysis_track *track = find_track( self, name );
+	if ( track && position >= track->first && position < track->first + track->count
+		 && track->valid[ position - track->first ] )
+	{
+		result = track->record_size;
+		if ( data && size > 0 )
+			memcpy( data, track->records + ( position - track->first ) * track->record_size, MIN( size, result ) );
+	}
+	pthread_mutex_unlock( &self->mutex );
+	return result;
+}
+
+/** Destroy an analysis.
+ *
+ * \public \memberof mlt_analysis_s
+ * \param self an analysis
+ */
+
+void mlt_analysis_close( mlt_analysis self )
+{
+	int i;
+
+	if ( !self )
+		return;
+	if ( self->map )
+	{
+#ifdef _WIN32
+		free( self->map );
+#else
+		munmap( self->map, self->map_size );
+#endif
+	}
+	else
+	{
+		for ( i = 0; i < self->track_count; i++ )
+		{
+			free( self->tracks[i].valid );
+			free( self->tracks[i].records );
+		}
+	}
+	free( self->tracks );
+	pthread_mutex_destroy( &self->mutex );
+	free( self );
+}
+
+/** \brief private state of a chunk of an analysis pass */
+
+typedef struct
+{
+	mlt_producer producer;
+	mlt_analysis analysis;
+	mlt_position in;
+	mlt_position out;
+	int width;
+	int height;
+	int frequency;
+	int channels;
+	double fps;
+}
+analysis_chunk;
+
+/** Pull the frames of a chunk through the analyzers.
+ *
+ * \private \memberof mlt_analysis_s
+ * \param arg a chunk
+ */
+
+static void *analyze_chunk( void *arg )
+{
+	analysis_chunk *chunk = arg;
+	mlt_position position;
+
+	for ( position = chunk->in; position < chunk->out; position++ )
+	{
+		mlt_frame frame = NULL;
+		mlt_producer_seek( chunk->producer, position );
+		if ( mlt_service_get_frame( MLT_PRODUCER_SERVICE( chunk->producer ), &frame, 0 ) || !frame )
+			break;
+
+		// Analyzers find where to put their records on the frame.
+		mlt_properties_set_data( MLT_FRAME_PROPERTIES( frame ), "analysis", chunk->analysis, 0, NULL, NULL );
+		if ( !mlt_frame_is_test_card( frame ) )
+		{
+			mlt_image_format format = mlt_image_yuv422;
+			int width = chunk->width;
+			int height = chunk->height;
+			uint8_t *image = NULL;
+			mlt_frame_get_image( frame, &image, &format, &width, &height, 0 );
+		}
+		if ( !mlt_frame_is_test_audio( frame ) )
+		{
+			mlt_audio_format format = mlt_audio_f32le;
+			int frequency = chunk->frequency;
+			int channels = chunk->channels;
+			int samples = mlt_sample_calculator( chunk->fps, frequency, position );
+			void *audio = NULL;
+			mlt_frame_get_audio( frame, &audio, &format, &frequency, &channels, &samples );
+		}
+		mlt_frame_close( frame );
+	}
+	return NULL;
+}
+
+/** Copy a producer with its filters through XML.
+ *
+ * \private \memberof mlt_analysis_s
+ * \return the XML or NULL; the caller must free it
+ */
+
+static char *serialize_producer( mlt_producer producer )
+{
+	mlt_properties properties = MLT_PRODUCER_PROPERTIES( producer );
+	mlt_profile profile = mlt_service_profile( MLT_PRODUCER_SERVICE( producer ) );
+	mlt_consumer consumer = mlt_factory_consumer( profile, "xml", "string" );
+	char *title = mlt_properties_get( properties, "title" );
+	char *root = mlt_properties_get( properties, "root" );
+	char *xml = NULL;
+
+	if ( !consumer )
+		return NULL;
+
+	// The XML consumer sets these, so restore them.
+	title = title ? strdup( title ) : NULL;
+	root = root ? strdup( root ) : NULL;
+	mlt_properties_set_int( MLT_CONSUMER_PROPERTIES( consumer ), "no_meta", 1 );
+	mlt_consumer_connect( consumer, MLT_PRODUCER_SERVICE( producer ) );
+	mlt_consumer_start( consumer );
+	xml = mlt_properties_get( MLT_CONSUMER_PROPERTIES( consumer ), "string" );
+	xml = xml ? strdup( xml ) : NULL;
+	mlt_consumer_close( consumer );
+	mlt_properties_set( properties, "title", title );
+	mlt_properties_set( properties, "root", root );
+	free( title );
+	free( root );
+	return xml;
+}
+
+/** Run the filters attached to a producer as analyzers in one pass.
+ *
+ * Every frame between the in and out points of the producer is decoded
+ * once and its image and audio are pulled through all of the attached
+ * filters. The image has the size of the profile. The audio has the
+ * frequency and channels of the first filter that sets the properties
+ * "analysis_frequency" and "analysis_channels", or else 48000 Hz and 2
+ * channels. Filters that support it store their results with
+ * mlt_analysis_filter_put() into the track named by their
+ * "analysis_track" property, which defaults to the service name and index.
+ * When every attached filter is stateless (see mlt_service_threading) the
+ * producer is copied for each thread and the copies analyze contiguous
+ * chunks in parallel. A filter whose result depends on every frame of the
+ * range, such as loudness, sets the property "_analysis_whole" to keep the
+ * pass sequential; it may still parallelize its own analysis. Finally, the
+ * results are saved to a sidecar file and its name is set to the
+ * "analysis" property of the filters, from which mlt_analysis_filter_get()
+ * maps them when the results are applied.
+ *
+ * \public \memberof mlt_analysis_s
+ * \param producer a producer with analysis filters attached
+ * \param filename the name of the sidecar file
+ * \param threads the maximum number of threads to use
+ * \return true if there was an error
+ */
+
+int mlt_analysis_run( mlt_producer producer, const char *filename, int threads )
+{
+	mlt_service service = MLT_PRODUCER_SERVICE( producer );
+	mlt_profile profile = mlt_service_profile( service );
+	mlt_position length = mlt_producer_get_playtime( producer );
+	mlt_position position = mlt_producer_position( producer );
+	int count = mlt_service_filter_count( service );
+	int stateless = 1;
+	int frequency = 0;
+	int channels = 0;
+	int error = 0;
+	int i;
+
+	if ( !profile || !filename || length <= 0 )
+		return 1;
+
+	for ( i = 0; i < count; i++ )
+	{
+		mlt_filter filter = mlt_service_filter( service, i );
+		mlt_properties properties = MLT_FILTER_PROPERTIES( filter );
+		if ( !mlt_properties_get( properties, "analysis_track" ) )
+		{
+			char name[ ANALYSIS_NAME_SIZE ];
+			snprintf( name, sizeof( name ), "%s.%d", mlt_properties_get( properties, "mlt_service" ), i );
+			mlt_properties_set( properties, "analysis_track", name );
+		}
+		if ( !frequency )
+			frequency = mlt_properties_get_int( properties, "analysis_frequency" );
+		if ( !channels )
+			channels = mlt_properties_get_int( properties, "analysis_channels" );
+		stateless = stateless && mlt_service_threading( MLT_FILTER_SERVICE( filter ) ) == mlt_threading_stateless
+			&& !mlt_properties_get_int( properties, "_analysis_whole" );
+	}
+
+	mlt_analysis analysis = mlt_analysis_new();
+	threads = stateless ? MIN( threads, length / 2 ) : 1;
+	threads = MAX( threads, 1 );
+	analysis_chunk *chunks = calloc( threads, sizeof( analysis_chunk ) );
+	for ( i = 0; i < threads; i++ )
+	{
+		chunks[i].analysis = analysis;
+		chunks[i].in = length * i / threads;
+		chunks[i].out = length * ( i + 1 ) / threads;
+		chunks[i].width = profile->width;
+		chunks[i].height = profile->height;
+		chunks[i].frequency = frequency > 0 ? frequency : 48000;
+		chunks[i].channels = channels > 0 ? channels : 2;
+		chunks[i].fps = mlt_profile_fps( profile );
+	}
+
+	if ( threads > 1 )
+	{
+		char *xml = serialize_producer( producer );
+		pthread_t *thread_ids = calloc( threads, sizeof( pthread_t ) );
+		int *started = calloc( threads, sizeof( int ) );
+
+		error = !xml;
+		for ( i = 0; i < threads && !error; i++ )
+		{
+			chunks[i].producer = mlt_factory_producer( profile, "xml-string", xml );
+			error = !chunks[i].producer;
+		}
+		free( xml );
+		for ( i = 0; i < threads && !error; i++ )
+			started[i] = !pthread_create( &thread_ids[i], NULL, analyze_chunk, &chunks[i] );
+		for ( i = 0; i < threads; i++ )
+		{
+			if ( started[i] )
+				pthread_join( thread_ids[i], NULL );
+			else
+				error = 1;
+			mlt_producer_close( chunks[i].producer );
+		}
+		free( thread_ids );
+		free( started );
+	}
+	else
+	{
+		chunks[0].producer = producer;
+		analyze_chunk( &chunks[0] );
+		mlt_producer_seek( producer, position );
+	}
+	free( chunks );
+
+	if ( !error )
+		error = mlt_analysis_save( analysis, filename );
+	mlt_analysis_close( analysis );
+
+	if ( !error )
+	{
+		for ( i = 0; i < count; i++ )
+		{
+			mlt_properties properties = MLT_FILTER_PROPERTIES( mlt_service_filter( service, i ) );
+			mlt_properties_set_data( properties, "_analysis", NULL, 0, NULL, NULL );
+			mlt_properties_set( properties, "analysis", filename );
+		}
+	}
+	return error;
+}
+
+/** Store a record of a filter during an analysis pass.
+ *
+ * \public \memberof mlt_analysis_s
+ * \param filter the analyzing filter
+ * \param frame the frame being analyzed
+ * \param position the frame position of the record
+ * \param data the record
+ * \param size the size of the record in bytes
+ * \return true if the frame is not part of an analysis pass
+ */
+
+int mlt_analysis_filter_put( mlt_filter filter, mlt_frame frame, mlt_position position, const void *data, int size )
+{
+	mlt_analysis analysis = mlt_properties_get_data( MLT_FRAME_PROPERTIES( frame ), "analysis", NULL );
+	const char *track = mlt_properties_get( MLT_FILTER_PROPERTIES( filter ), "analysis_track" );
+	return !analysis || !track || mlt_analysis_put( analysis, track, position, data, size );
+}
+
+/** Get a record of a filter from its sidecar file.
+ *
+ * The sidecar named by the filter's "analysis" property is mapped on first
+ * use and kept with the filter. This locks the service of the filter, so
+ * the caller must not hold that lock.
+ *
+ * \public \memberof mlt_analysis_s
+ * \param filter the filter that stored the record
+ * \param position the frame position of the record
+ * \param[out] data a buffer for the record
+ * \param size the size of \p data in bytes
+ * \return the size of the record in bytes or 0 if there is none
+ */
+
+int mlt_analysis_filter_get( mlt_filter filter, mlt_position position, void *data, int size )
+{
+	mlt_properties properties = MLT_FILTER_PROPERTIES( filter );
+	const char *filename = mlt_properties_get( properties, "analysis" );
+	const char *track = mlt_properties_get( properties, "analysis_track" );
+	mlt_analysis analysis;
+	int result;
+
+	if ( !filename || !track || !strcmp( filename, "" ) )
+		return 0;
+
+	// The analysis is replaced when "analysis" changes, so read it under the lock.
+	mlt_service_lock( MLT_FILTER_SERVICE( filter ) );
+	analysis = mlt_properties_get_data( properties, "_analysis", NULL );
+	if ( !mlt_properties_get( properties, "_analysis_file" )
+		 || strcmp( filename, mlt_properties_get( properties, "_analysis_file" ) ) )
+	{
+		analysis = mlt_analysis_load( filename );
+		mlt_properties_set_data( properties, "_analysis", analysis, 0, ( mlt_destructor )mlt_analysis_close, NULL );
+		mlt_properties_set( properties, "_analysis_file", filename );
+	}
+	result = mlt_analysis_get( analysis, track, position, data, size );
+	mlt_service_unlock( MLT_FILTER_SERVICE( filter ) );
+
+	return result;
+}
+
+/** Combine a minimum, maximum and RMS triplet into a running one.
+ *
+ * The RMS is accumulated as a sum of squares in \p sum.
+ */
+
+static inline void combine_peak( int16_t *out, double *sum, const int16_t *in, int first )
+{
+	if ( first || in[0] < out[0] )
+		out[0] = in[0];
+	if ( first || in[1] > out[1] )
+		out[1] = in[1];
+	*sum += (double) in[2] * in[2];
+}
+
+/** Get the audio peaks of a span of frames from a peaks sidecar.
+ *
+ * A peaks sidecar is written by the peaks consumer. The track "peaks" has
+ * a record per frame with the minimum, maximum and RMS of each channel in
+ * each of a number of buckets of the frame as int16_t triplets ordered by
+ * bucket and then channel. The track "peaks.info" has a record at position
+ * 0 of four int32_t: channels, buckets per frame, frequency, and the number
+ * of coarser levels. Level n is the track "peaks.<16^n>", which has a
+ * record for every 16^n frames, at the position divided by 16^n, with 16
+ * buckets in the same layout.
+ *
+ * The span is split into \p count buckets, and each bucket is combined
+ * from the coarsest level that is still finer than it, so the cost does
+ * not depend on the length of the span.
+ *
+ * \public \memberof mlt_analysis_s
+ * \param self an analysis
+ * \param position the frame position at which the span starts
+ * \param frames the number of frames in the span
+ * \param count the number of buckets to get
+ * \param channels the number of channels in \p peaks
+ * \param[out] peaks count * channels triplets of minimum, maximum and RMS
+ * \return the number of channels in the sidecar or 0 if it has no peaks
+ */
+
+int mlt_analysis_get_peaks( mlt_analysis self, double position, double frames, int count, int channels, int16_t *peaks )
+{
+	int32_t info[4];
+	int i, c;
+
+	if ( mlt_analysis_get( self, "peaks.info", 0, info, sizeof( info ) ) != sizeof( info ) || info[0] <= 0 || info[1] <= 0 )
+		return 0;
+	if ( count <= 0 || frames <= 0.0 || !peaks )
+		return info[0];
+	memset( peaks, 0, count * channels * 3 * sizeof( int16_t ) );
+
+	// Choose the coarsest level whose buckets are no wider than the requested ones.
+	int level = 0;
+	int per_record = info[1];
+	double span = 1.0 / info[1];
+	while ( level < info[3] && ( level ? span * 16.0 : 1.0 ) <= frames / count )
+	{
+		span = level ? span * 16.0 : 1.0;
+		per_record = 16;
+		level ++;
+	}
+	char track[ ANALYSIS_NAME_SIZE ];
+	if ( level )
+		snprintf( track, sizeof( track ), "peaks.%d", 1 << ( 4 * level ) );
+	else
+		strcpy( track, "peaks" );
+
+	int record_size = MAX( info[1], 16 ) * info[0] * 3 * sizeof( int16_t );
+	int16_t *record = malloc( record_size );
+	int has_record = 0;
+	int64_t record_index = -1;
+	double *sums = calloc( channels, sizeof( double ) );
+	if ( !sums || !record )
+	{
+		free( sums );
+		free( record );
+		return 0;
+	}
+
+	for ( i = 0; i < count; i++ )
+	{
+		int64_t first = floor( ( position + frames * i / count ) / span );
+		int64_t last = ceil( ( position + frames * ( i + 1 ) / count ) / span );
+		int16_t *out = peaks + i * channels * 3;
+		int n = 0;
+		int64_t g;
+
+		memset( sums, 0, channels * sizeof( double ) );
+		for ( g = MAX( first, 0 ); g < MAX( last, first + 1 ); g++ )
+		{
+			if ( g / per_record != record_index )
+			{
+				record_index = g / per_record;
+				has_record = mlt_analysis_get( self, track, record_index, record, record_size ) > 0;
+			}
+			if ( !has_record )
+				continue;
+			const int16_t *in = record + ( g % per_record ) * info[0] * 3;
+			for ( c = 0; c < MIN( channels, info[0] ); c++ )
+				combine_peak( out + c * 3, &sums[c], in + c * 3, n == 0 );
+			n ++;
+		}
+		for ( c = 0; n && c < MIN( channels, info[0] ); c++ )
+			out[ c * 3 + 2 ] = lrint( sqrt( sums[c] / n ) );
+	}
+	free( sums );
+	free( record );
+	return info[0];
+}
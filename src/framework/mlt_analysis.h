@@ -0,0 +1,39 @@
+/**
+ * \file mlt_analysis.h
+ * \brief shared analysis pass and binary sidecar for analysis results
+ * \see mlt_analysis_s
+ *
+ * Copyright (C) 2017 Meltytech, LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef MLT_ANALYSIS_H
+#define MLT_ANALYSIS_H
+
+#include "mlt_types.h"
+
+extern mlt_analysis mlt_analysis_new( );
+extern mlt_analysis mlt_analysis_load( const char *filename );
+extern int mlt_analysis_save( mlt_analysis self, const char *filename );
+extern int mlt_analysis_put( mlt_analysis self, const char *track, mlt_position position, const void *data, int size );
+extern int mlt_analysis_get( mlt_analysis self, const char *track, mlt_position position, void *data, int size );
+extern void mlt_analysis_close( mlt_analysis self );
+extern int mlt_analysis_run( mlt_producer producer, const char *filename, int threads );
+extern int mlt_analysis_filter_put( mlt_filter filter, mlt_frame frame, mlt_position position, const void *data, int size );
+extern int mlt_analysis_filter_get( mlt_filter filter, mlt_position position, void *data, int size );
+extern int mlt_analysis_get_peaks( mlt_analysis self, double position, double frames, int count, int channels, int16_t *peaks );
+
+#endif
@@ -27,6 +27,7 @@
 #include "mlt_frame.h"
 
 #include <stdlib.h>
+#include <string.h>
 #include <pthread.h>
 
 /** the maximum number of data objects to cache per line */
@@ -83,6 +84,8 @@ struct mlt_cache_s
 	int count;             /**< the number of items currently in the cache */
 	int size;              /**< the maximum number of items permitted in the cache <= \p MAX_CACHE_SIZE */
 	int is_frames;         /**< indicates if this cache is used to cache frames */
+	int64_t max_bytes;     /**< the maximum total size of the cached data, or 0 for no limit */
+	int64_t bytes;         /**< the total size of the data currently in the cache */
 	void* *current;        /**< pointer to the current array of pointers */
 	void* A[ MAX_CACHE_SIZE ];
 	void* B[ MAX_CACHE_SIZE ];
@@ -168,6 +171,23 @@ static void cache_object_close( mlt_cache cache, void *object, void* data )
 	}
 }
 
+/** Get the size of the data cached for an object.
+ *
+ * \private \memberof mlt_cache_s
+ * \param cache a cache object
+ * \param object the object that identifies the cached data
+ * \return the size given to mlt_cache_put or 0 if not cached
+ */
+
+static int cache_object_size( mlt_cache cache, void *object )
+{
+	char key[19];
+
+	sprintf( key, "%p", object );
+	mlt_cache_item item = mlt_properties_get_data( cache->active, key, NULL );
+	return item && item->data ? item->size : 0;
+}
+
 /** Close a cache item.
  *
  * Release a reference and call the destructor on the data object when all
@@ -223,6 +243,23 @@ void mlt_cache_set_size( mlt_cache cache, int size )
 		cache->size = size;
 }
 
+/** Set the maximum total size of the cached data.
+ *
+ * When the sizes given to mlt_cache_put add up to more than \p bytes, the least
+ * recently used items are released until the total fits again. The most recent
+ * item is always kept. This does not apply to frame caches.
+ * \public \memberof mlt_cache_s
+ * \param cache the cache to adjust
+ * \param bytes the new limit in bytes, or 0 for no limit
+ */
+
+void mlt_cache_set_max_bytes( mlt_cache cache, int64_t bytes )
+{
+	pthread_mutex_lock( &cache->mutex );
+	cache->max_bytes = bytes > 0 ? bytes : 0;
+	pthread_mutex_unlock( &cache->mutex );
+}
+
 /** Get the numer of possible cache items.
  *
  * \public \memberof mlt_cache_s
@@ -280,6 +317,7 @@ void mlt_cache_purge( mlt_cache cache, void *object )
 
 			if ( o == object )
 			{
+				cache->bytes -= cache_object_size( cache, o );
 				cache_object_close( cache, o, NULL );
 			}
 			else
@@ -369,6 +407,7 @@ void mlt_cache_put( mlt_cache cache, void *object, void* data, int size, mlt_des
 	if ( hit )
 	{
 		// release the old data
+		cache->bytes -= cache_object_size( cache, *hit );
 		cache_object_close( cache, *hit, NULL );
 		// the MRU end gets the updated data
 		hit = &alt[ cache->count - 1 ];
@@ -381,6 +420,7 @@ void mlt_cache_put( mlt_cache cache, void *object, void* data, int size, mlt_des
 	else
 	{
 		// release the entry at the LRU end
+		cache->bytes -= cache_object_size( cache, cache->current[0] );
 		cache_object_close( cache, cache->current[0], NULL );
 
 		// The MRU end gets the new item
@@ -423,10 +463,25 @@ void mlt_cache_put( mlt_cache cache, void *object, void* data, int size, mlt_des
 		item->size = size;
 		item->destructor = destructor;
 		item->refcount = 1;
+		cache->bytes += size;
 	}
 	
 	// swap the current array
 	cache->current = alt;
+
+	// release entries at the LRU end while over the size limit
+	if ( cache->max_bytes > 0 && cache->bytes > cache->max_bytes && cache->count > 1 )
+	{
+		int i = 0;
+		while ( cache->bytes > cache->max_bytes && i < cache->count - 1 )
+		{
+			cache->bytes -= cache_object_size( cache, cache->current[i] );
+			cache_object_close( cache, cache->current[i], NULL );
+			i++;
+		}
+		memmove( cache->current, cache->current + i, ( cache->count - i ) * sizeof( void* ) );
+		cache->count -= i;
+	}
 	pthread_mutex_unlock( &cache->mutex );
 }
 
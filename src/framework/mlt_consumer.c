@@ -30,7 +30,11 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <unistd.h>
 #include <sys/time.h>
+#ifdef _WIN32
+#include <windows.h>
+#endif
 
 /** Define this if you want an automatic deinterlace (if necessary) when the
  * consumer's producer is not running at normal speed.
@@ -41,6 +45,27 @@
  */
 pthread_mutex_t mlt_sdl_mutex = PTHREAD_MUTEX_INITIALIZER;
 
+/** \brief a bounded queue of frames between one producer and one consumer thread
+ *
+ * The read ahead thread pushes and the thread that calls mlt_consumer_rt_frame
+ * pops without taking a lock. A side only parks on queue_cond when the ring is
+ * full or empty, and the other side only takes queue_mutex to wake it when a
+ * thread is parked.
+ */
+
+typedef struct
+{
+	mlt_frame *frames;
+	int64_t *times;              /**< the time each frame was pushed in microseconds */
+	unsigned int *purges;        /**< the purge count when each frame was requested */
+	unsigned int size;
+	volatile unsigned int head;  /**< the number of frames popped, only written by the consumer */
+	volatile unsigned int tail;  /**< the number of frames pushed, only written by the producer */
+	volatile unsigned int purge; /**< the number of purges, frames from before the last are dropped */
+	volatile int waiting;        /**< the number of threads parked on queue_cond */
+}
+frame_ring;
+
 /** \brief private members of mlt_consumer */
 
 typedef struct
@@ -51,6 +76,7 @@ typedef struct
 	mlt_image_format image_format;
 	mlt_audio_format audio_format;
 	mlt_deque queue;
+	frame_ring ring;    /**< the queue of the read ahead thread when real_time is 1 or -1 */
 	void *ahead_thread;
 	pthread_mutex_t queue_mutex;
 	pthread_cond_t queue_cond;
@@ -75,6 +101,28 @@ typedef struct
 	int process_head;
 	int started;
 	pthread_t *threads; /**< used to deallocate all threads */
+	int audio_worker;   /**< whether a dedicated thread processes the audio */
+	int audio_head;     /**< the number of frames at the front of the queue with audio processed */
+	int worker_count;   /**< used to number the worker threads */
+
+	/* additional fields for self-tuning the workers when real_time is auto */
+	int auto_threads;   /**< the number of workers that may process or 0 if not auto */
+	int auto_buffer;    /**< the depth of the work queue */
+	int auto_direction; /**< the direction of the last change of the number of workers */
+	int auto_hold;      /**< the number of windows to wait before probing again */
+	double auto_fps;    /**< the throughput of the previous window */
+	struct timeval auto_time; /**< the start of the current window */
+	int auto_frames;    /**< the number of frames played out in the current window */
+	int64_t auto_render_time; /**< the sum of image processing times in the current window */
+	int auto_rendered;  /**< the number of images processed in the current window */
+
+	/* additional fields for the latency of the read ahead queue */
+	int64_t latency_total; /**< the sum of the times frames spent in the queue */
+	int64_t latency_max;
+	int latency_count;
+	int *depths;        /**< the number of frames popped at each depth of the queue */
+	int64_t stats_time; /**< when the queue statistics were last published */
+	volatile int64_t taken_time; /**< when the consumer last took a frame from the read ahead queue */
 }
 consumer_private;
 
@@ -571,6 +619,8 @@ int mlt_consumer_start( mlt_consumer self )
 
 	mlt_properties_set_int( properties, "frame_duration", frame_duration );
 	mlt_properties_set_int( properties, "drop_count", 0 );
+	mlt_properties_set_int( properties, "degrade_count", 0 );
+	mlt_properties_set_int( properties, "deadline_missed", 0 );
 
 	// Check and run an ante command
 	if ( mlt_properties_get( properties, "ante" ) )
@@ -579,9 +629,22 @@ int mlt_consumer_start( mlt_consumer self )
 
 	// Set the real_time preference
 	priv->real_time = mlt_properties_get_int( properties, "real_time" );
+	priv->auto_threads = 0;
+	if ( mlt_properties_get( properties, "real_time" ) && !strcmp( mlt_properties_get( properties, "real_time" ), "auto" ) )
+	{
+		// Use a worker for every CPU without frame dropping, but start with
+		// only a couple of them processing.
+#ifdef _WIN32
+		int cpus = GetActiveProcessorCount( ALL_PROCESSOR_GROUPS );
+#else
+		int cpus = sysconf( _SC_NPROCESSORS_ONLN );
+#endif
+		priv->real_time = cpus > 2 ? -cpus : -2;
+		priv->auto_threads = 2;
+	}
 
 	// For worker threads implementation, buffer must be at least # threads
-	if ( abs( priv->real_time ) > 1 && mlt_properties_get_int( properties, "buffer" ) <= abs( priv->real_time ) )
+	if ( abs( priv->real_time ) > 1 && !priv->auto_threads && mlt_properties_get_int( properties, "buffer" ) <= abs( priv->real_time ) )
 		mlt_properties_set_int( properties, "_buffer", abs( priv->real_time ) + 1 );
 
 	priv->preroll = 1;
@@ -741,6 +804,328 @@ static inline long time_difference( struct timeval *time1 )
 	return time1->tv_sec * 1000000 + time1->tv_usec - time2.tv_sec * 1000000 - time2.tv_usec;
 }
 
+/** Get the time of day in microseconds.
+ *
+ * \private \memberof mlt_consumer_s
+ * \return the current time
+ */
+
+static inline int64_t time_now( )
+{
+	struct timeval now;
+	gettimeofday( &now, NULL );
+	return (int64_t) now.tv_sec * 1000000 + now.tv_usec;
+}
+
+/** Allocate the read ahead queue.
+ *
+ * \private \memberof mlt_consumer_s
+ * \param ring a frame ring
+ * \param size the maximum number of frames
+ * \return true if there was an error
+ */
+
+static int ring_init( frame_ring *ring, unsigned int size )
+{
+	memset( ring, 0, sizeof( *ring ) );
+	ring->size = size > 0 ? size : 1;
+	ring->frames = calloc( ring->size, sizeof( mlt_frame ) );
+	ring->times = calloc( ring->size, sizeof( int64_t ) );
+	ring->purges = calloc( ring->size, sizeof( unsigned int ) );
+	return !ring->frames || !ring->times || !ring->purges;
+}
+
+/** Close the frames left in the read ahead queue and free it.
+ *
+ * Neither the producer nor the consumer may be using the ring.
+ *
+ * \private \memberof mlt_consumer_s
+ * \param ring a frame ring
+ */
+
+static void ring_close( frame_ring *ring )
+{
+	while ( ring->frames && ring->head != ring->tail )
+		mlt_frame_close( ring->frames[ ring->head++ % ring->size ] );
+	free( ring->frames );
+	free( ring->times );
+	free( ring->purges );
+	memset( ring, 0, sizeof( *ring ) );
+}
+
+/** Get the number of frames in the read ahead queue.
+ *
+ * \private \memberof mlt_consumer_s
+ * \param ring a frame ring
+ * \return the number of frames
+ */
+
+static inline unsigned int ring_count( frame_ring *ring )
+{
+	return ring->tail - ring->head;
+}
+
+/** Wake a thread parked on the read ahead queue, if any.
+ *
+ * The barrier orders the update of the head or tail before the check of
+ * waiting, which a parking thread increments before it checks the ring.
+ *
+ * \private \memberof mlt_consumer_s
+ * \param priv the private members of a consumer
+ */
+
+static inline void ring_wake( consumer_private *priv )
+{
+	__sync_synchronize();
+	if ( priv->ring.waiting )
+	{
+		pthread_mutex_lock( &priv->queue_mutex );
+		pthread_cond_broadcast( &priv->queue_cond );
+		pthread_mutex_unlock( &priv->queue_mutex );
+	}
+}
+
+/** Add a frame to the read ahead queue, waiting while it is full.
+ *
+ * Only the read ahead thread may call this.
+ *
+ * \private \memberof mlt_consumer_s
+ * \param priv the private members of a consumer
+ * \param frame a frame
+ * \param purge the purge count from before the frame was requested
+ * \return true if the consumer stopped and the frame was not added
+ */
+
+static int ring_push( consumer_private *priv, mlt_frame frame, unsigned int purge )
+{
+	frame_ring *ring = &priv->ring;
+
+	if ( ring_count( ring ) >= ring->size )
+	{
+		pthread_mutex_lock( &priv->queue_mutex );
+		__sync_fetch_and_add( &ring->waiting, 1 );
+		while ( priv->ahead && ring_count( ring ) >= ring->size )
+			pthread_cond_wait( &priv->queue_cond, &priv->queue_mutex );
+		__sync_fetch_and_sub( &ring->waiting, 1 );
+		pthread_mutex_unlock( &priv->queue_mutex );
+	}
+	if ( !priv->ahead )
+		return 1;
+
+	unsigned int index = ring->tail % ring->size;
+	ring->frames[ index ] = frame;
+	ring->times[ index ] = time_now();
+	ring->purges[ index ] = purge;
+	__sync_synchronize();
+	ring->tail ++;
+	ring_wake( priv );
+	return 0;
+}
+
+/** Remove the frame at the front of the read ahead queue.
+ *
+ * This waits until the queue holds at least \p count frames and drops the
+ * frames that were requested before the last purge. Only the thread that
+ * calls mlt_consumer_rt_frame may call this.
+ *
+ * \private \memberof mlt_consumer_s
+ * \param priv the private members of a consumer
+ * \param count the number of frames to wait for
+ * \param[out] latency the time the frame spent in the queue in microseconds
+ * \param[out] depth the number of frames left in the queue
+ * \return a frame, which may be NULL if the read ahead thread got none, or
+ * NULL if the consumer stopped
+ */
+
+static mlt_frame ring_pop( consumer_private *priv, unsigned int count, int64_t *latency, unsigned int *depth )
+{
+	frame_ring *ring = &priv->ring;
+	mlt_frame frame = NULL;
+	int popped = 0;
+
+	count = MAX( MIN( count, ring->size ), 1 );
+	while ( !popped )
+	{
+		if ( ring_count( ring ) < count )
+		{
+			pthread_mutex_lock( &priv->queue_mutex );
+			__sync_fetch_and_add( &ring->waiting, 1 );
+			while ( priv->ahead && ring_count( ring ) < count )
+				pthread_cond_wait( &priv->queue_cond, &priv->queue_mutex );
+			__sync_fetch_and_sub( &ring->waiting, 1 );
+			pthread_mutex_unlock( &priv->queue_mutex );
+		}
+		if ( !priv->ahead || ring_count( ring ) == 0 )
+			break;
+
+		__sync_synchronize();
+		unsigned int index = ring->head % ring->size;
+		frame = ring->frames[ index ];
+		*latency = time_now() - ring->times[ index ];
+		*depth = ring_count( ring ) - 1;
+		popped = ring->purges[ index ] == ring->purge;
+		if ( !popped )
+		{
+			mlt_frame_close( frame );
+			frame = NULL;
+		}
+		__sync_synchronize();
+		ring->head ++;
+		ring_wake( priv );
+	}
+	return frame;
+}
+
+/** Publish the statistics of the read ahead queue.
+ *
+ * This updates the queue_latency, queue_latency_max, and queue_depths
+ * properties of the consumer.
+ *
+ * \private \memberof mlt_consumer_s
+ * \param self a consumer
+ */
+
+static void publish_queue_stats( mlt_consumer self )
+{
+	consumer_private *priv = self->local;
+	mlt_properties properties = MLT_CONSUMER_PROPERTIES( self );
+	unsigned int i;
+
+	if ( priv->latency_count == 0 )
+		return;
+	if ( priv->depths )
+	{
+		char *text = malloc( priv->ring.size * 12 );
+		int length = 0;
+
+		for ( i = 0; text && i < priv->ring.size; i++ )
+			length += sprintf( text + length, i ? " %d" : "%d", priv->depths[i] );
+		if ( text )
+			mlt_properties_set( properties, "queue_depths", text );
+		free( text );
+	}
+	mlt_properties_set_double( properties, "queue_latency", priv->latency_total / 1000.0 / priv->latency_count );
+	mlt_properties_set_double( properties, "queue_latency_max", priv->latency_max / 1000.0 );
+	priv->stats_time = time_now();
+}
+
+/** Record the time a frame spent in the read ahead queue.
+ *
+ * The counters are published at most once per second and when the read
+ * ahead thread stops.
+ *
+ * \private \memberof mlt_consumer_s
+ * \param self a consumer
+ * \param latency the time in microseconds
+ * \param depth the number of frames in the queue when it was removed
+ * \param now the current time in microseconds
+ */
+
+static void update_queue_stats( mlt_consumer self, int64_t latency, unsigned int depth, int64_t now )
+{
+	consumer_private *priv = self->local;
+
+	priv->latency_total += latency;
+	priv->latency_max = MAX( priv->latency_max, latency );
+	priv->latency_count ++;
+	if ( priv->depths )
+		priv->depths[ MIN( depth, priv->ring.size - 1 ) ] ++;
+	if ( now - priv->stats_time >= 1000000 )
+		publish_queue_stats( self );
+}
+
+/** How the read ahead thread renders a frame. */
+
+typedef enum
+{
+	schedule_render,  /**< render the image as requested */
+	schedule_degrade, /**< render the image faster at a lower quality */
+	schedule_drop     /**< do not render the image */
+}
+frame_schedule;
+
+/** The weight of the latest render time in the estimated cost of a segment. */
+#define SCHEDULE_WEIGHT 0.2
+
+/** Get the name of the segment of the graph that a frame comes from.
+ *
+ * Frames from the same producer usually cost about the same to render, so
+ * the costs are estimated per producer.
+ *
+ * \private \memberof mlt_consumer_s
+ * \param frame a frame
+ * \param[out] key the name of the segment
+ * \param size the size of \p key
+ */
+
+static void schedule_segment( mlt_frame frame, char *key, size_t size )
+{
+	mlt_producer producer = mlt_frame_get_original_producer( frame );
+	snprintf( key, size, "%p", producer ? (void*) mlt_producer_cut_parent( producer ) : NULL );
+}
+
+/** Choose how to render a frame so that it is ready before it is shown.
+ *
+ * The frame is needed one frame duration after the frames ahead of it in
+ * the queue have been taken by the consumer. If the estimated cost of its segment does not fit in that time, it
+ * is degraded when the estimated cost of a degraded render fits, or else it
+ * is dropped. Until a degraded render has been measured, it is assumed to
+ * cost half as much.
+ *
+ * \private \memberof mlt_consumer_s
+ * \param costs the estimated costs in microseconds by segment
+ * \param key the segment of the frame
+ * \param deadline the time in microseconds until the frame is shown
+ * \return how to render the frame
+ */
+
+static frame_schedule schedule_frame( mlt_properties costs, const char *key, int64_t deadline )
+{
+	char degraded_key[ 64 ];
+	double cost = mlt_properties_get_double( costs, key );
+
+	if ( cost <= deadline )
+		return schedule_render;
+	snprintf( degraded_key, sizeof( degraded_key ), "%s.degraded", key );
+	double degraded = mlt_properties_get_double( costs, degraded_key );
+	if ( degraded <= 0.0 )
+		degraded = cost / 2.0;
+	return degraded <= deadline ? schedule_degrade : schedule_drop;
+}
+
+/** Update the estimated cost of rendering a segment.
+ *
+ * The estimate is an exponentially weighted moving average. A sudden spike,
+ * such as opening a file, is limited to four times the estimate so that it
+ * does not cause a run of dropped frames.
+ *
+ * \private \memberof mlt_consumer_s
+ * \param costs the estimated costs in microseconds by segment
+ * \param key the segment of the frame
+ * \param degraded whether the frame was degraded
+ * \param time the time in microseconds that rendering took
+ * \return the new estimate
+ */
+
+static double schedule_update( mlt_properties costs, const char *key, int degraded, int64_t time )
+{
+	char degraded_key[ 64 ];
+	double cost;
+
+	if ( degraded )
+	{
+		snprintf( degraded_key, sizeof( degraded_key ), "%s.degraded", key );
+		key = degraded_key;
+	}
+	cost = mlt_properties_get_double( costs, key );
+	if ( cost > 0.0 )
+		cost += SCHEDULE_WEIGHT * ( MIN( time, cost * 4.0 ) - cost );
+	else
+		cost = time;
+	mlt_properties_set_double( costs, key, cost );
+	return cost;
+}
+
 /** The thread procedure for asynchronously pulling frames through the service
  * network connected to a consumer.
  *
@@ -780,14 +1165,11 @@ static void *consumer_read_ahead_thread( void *arg )
 	mlt_frame frame = NULL;
 	uint8_t *image = NULL;
 
-	// Time structures
-	struct timeval ante;
-
-	// Average time for get_frame and get_image
-	int count = 0;
+	// The estimated cost of rendering each segment of the graph
+	mlt_properties costs = mlt_properties_new( );
+	char segment[ 32 ];
+	double render_cost = 0;
 	int skipped = 0;
-	int64_t time_process = 0;
-	int skip_next = 0;
 	mlt_position pos = 0;
 	mlt_position start_pos = 0;
 	mlt_position last_pos = 0;
@@ -803,6 +1185,7 @@ static void *consumer_read_ahead_thread( void *arg )
 	mlt_events_fire( properties, "consumer-thread-started", NULL );
 
 	// Get the first frame
+	unsigned int purge = priv->ring.purge;
 	frame = mlt_consumer_get_frame( self );
 
 	if ( frame )
@@ -826,30 +1209,17 @@ static void *consumer_read_ahead_thread( void *arg )
 		last_pos = start_pos = pos = mlt_frame_get_position( frame );
 	}
 
-	// Get the starting time (can ignore the times above)
-	gettimeofday( &ante, NULL );
-
 	// Continue to read ahead
 	while ( priv->ahead )
 	{
 		// Put the current frame into the queue
-		pthread_mutex_lock( &priv->queue_mutex );
-		while( priv->ahead && mlt_deque_count( priv->queue ) >= buffer )
-			pthread_cond_wait( &priv->queue_cond, &priv->queue_mutex );
-		if ( priv->is_purge )
-		{
+		if ( ring_push( priv, frame, purge ) )
 			mlt_frame_close( frame );
-			priv->is_purge = 0;
-		}
-		else
-		{
-			mlt_deque_push_back( priv->queue, frame );
-		}
-		pthread_cond_broadcast( &priv->queue_cond );
-		pthread_mutex_unlock( &priv->queue_mutex );
+		frame = NULL;
 
 		mlt_log_timings_begin();
 		// Get the next frame
+		purge = priv->ring.purge;
 		frame = mlt_consumer_get_frame( self );
 		mlt_log_timings_end( NULL, "mlt_consumer_get_frame" );
 
@@ -861,9 +1231,6 @@ static void *consumer_read_ahead_thread( void *arg )
 		// WebVfx uses this to setup a consumer-stopping event handler.
 		mlt_properties_set_data( MLT_FRAME_PROPERTIES( frame ), "consumer", self, 0, NULL, NULL );
 
-		// Increment the counter used for averaging processing cost
-		count ++;
-
 		// Always process audio
 		if ( !audio_off )
 		{
@@ -881,9 +1248,52 @@ static void *consumer_read_ahead_thread( void *arg )
 			start_pos = pos;
 		}
 
-		// If skip flag not set or frame-dropping disabled
-		if ( !skip_next || priv->real_time == -1 )
+		// Determine if we started, resumed, or seeked
+		if ( pos != last_pos + 1 )
+		{
+			start_pos = pos;
+
+			// Forget the estimates of segments that may have left the graph
+			if ( mlt_properties_count( costs ) > 0 )
+			{
+				mlt_properties_close( costs );
+				costs = mlt_properties_new( );
+			}
+		}
+		last_pos = pos;
+
+		// Only drop with frame-dropping enabled and not in the first 20% of
+		// buffer at start, resume, or seek
+		frame_schedule schedule = schedule_render;
+		schedule_segment( frame, segment, sizeof( segment ) );
+		if ( priv->real_time == 1 && !video_off && frame_duration > 0 && pos - start_pos > buffer / 5 + 1 )
+		{
+			// The frames in the queue are taken first, one per frame duration
+			// after the last one taken.
+			int64_t deadline = (int64_t) ( ring_count( &priv->ring ) + 1 ) * frame_duration;
+			if ( priv->taken_time > 0 )
+				deadline += priv->taken_time - time_now();
+			schedule = schedule_frame( costs, segment, deadline );
+			if ( schedule == schedule_drop && skipped > drop_max )
+			{
+				mlt_log_verbose( self, "too many frames dropped - forcing next frame\n" );
+				schedule = schedule_degrade;
+			}
+			if ( schedule != schedule_render )
+				mlt_log_debug( self, "%s frame " MLT_POSITION_FMT " cost %.0f deadline %"PRId64" usec\n",
+					schedule == schedule_drop ? "dropping" : "degrading", pos, mlt_properties_get_double( costs, segment ), deadline );
+		}
+
+		if ( schedule != schedule_drop )
 		{
+			if ( schedule == schedule_degrade )
+			{
+				// Use the fastest scaling and skip deinterlacing
+				mlt_properties_set( MLT_FRAME_PROPERTIES( frame ), "rescale.interp", "nearest" );
+				mlt_properties_set_int( MLT_FRAME_PROPERTIES( frame ), "consumer_deinterlace", 0 );
+				mlt_properties_set_int( properties, "degrade_count", mlt_properties_get_int( properties, "degrade_count" ) + 1 );
+			}
+
 			if ( !video_off )
 			{
 				// Reset width/height - could have been changed by previous mlt_frame_get_image
@@ -892,9 +1302,16 @@ static void *consumer_read_ahead_thread( void *arg )
 
 				// Get the image
 				mlt_events_fire( MLT_CONSUMER_PROPERTIES( self ), "consumer-frame-render", frame, NULL );
+				int64_t cost = time_now();
 				mlt_log_timings_begin();
 				mlt_frame_get_image( frame, &image, &priv->image_format, &width, &height, 0 );
 				mlt_log_timings_end( NULL, "mlt_frame_get_image" );
+				cost = time_now() - cost;
+
+				// Update the estimates of the cost
+				schedule_update( costs, segment, schedule == schedule_degrade, cost );
+				render_cost = render_cost > 0 ? render_cost + SCHEDULE_WEIGHT * ( cost - render_cost ) : cost;
+				mlt_properties_set_double( properties, "render_cost", render_cost / 1000.0 );
 			}
 
 			// Indicate the rendered image is available.
@@ -907,74 +1324,12 @@ static void *consumer_read_ahead_thread( void *arg )
 		{
 			// Increment the number of consecutively-skipped frames
 			skipped++;
-
-			// If too many (1 sec) consecutively-skipped frames
-			if ( skipped > drop_max )
-			{
-				// Reset cost tracker
-				time_process = 0;
-				count = 1;
-				mlt_log_verbose( self, "too many frames dropped - forcing next frame\n" );
-			}
-		}
-
-		// Get the time to process this frame
-		int64_t time_current = time_difference( &ante );
-
-		// If the current time is not suddenly some large amount
-		if ( time_current < time_process / count * 20 || !time_process || count < 5 )
-		{
-			// Accumulate the cost for processing this frame
-			time_process += time_current;
-		}
-		else
-		{
-			mlt_log_debug( self, "current %"PRId64" threshold %"PRId64" count %d\n",
-				time_current, (int64_t) (time_process / count * 20), count );
-			// Ignore the cost of this frame's time
-			count--;
-		}
-
-		// Determine if we started, resumed, or seeked
-		if ( pos != last_pos + 1 )
-			start_pos = pos;
-		last_pos = pos;
-
-		// Do not skip the first 20% of buffer at start, resume, or seek
-		if ( pos - start_pos <= buffer / 5 + 1 )
-		{
-			// Reset cost tracker
-			time_process = 0;
-			count = 1;
-		}
-
-		// Reset skip flag
-		skip_next = 0;
-
-		// Only consider skipping if the buffer level is low (or really small)
-		if ( mlt_deque_count( priv->queue ) <= buffer / 5 + 1 && count > 1 )
-		{
-			// Skip next frame if average cost exceeds frame duration.
-			if ( time_process / count > frame_duration )
-				skip_next = 1;
-			if ( skip_next )
-				mlt_log_debug( self, "avg usec %"PRId64" (%"PRId64"/%d) duration %d\n",
-					time_process/count, time_process, count, frame_duration);
 		}
 	}
 
-	// Remove the last frame
+	// Remove the last frame, the queue is closed when the thread is joined
 	mlt_frame_close( frame );
-
-	// Wipe the queue
-	pthread_mutex_lock( &priv->queue_mutex );
-	while ( mlt_deque_count( priv->queue ) )
-		mlt_frame_close( mlt_deque_pop_back( priv->queue ) );
-
-	// Close the queue
-	mlt_deque_close( priv->queue );
-	priv->queue = NULL;
-	pthread_mutex_unlock( &priv->queue_mutex );
+	mlt_properties_close( costs );
 
 	mlt_events_fire( MLT_CONSUMER_PROPERTIES(self), "consumer-thread-stopped", NULL );
 
@@ -1001,11 +1356,79 @@ static inline int first_unprocessed_frame( mlt_consumer self )
 {
 	consumer_private *priv = self->local;
 	int index = priv->real_time <= 0 ? 0 : priv->process_head;
-	while ( index < mlt_deque_count( priv->queue ) && MLT_FRAME( mlt_deque_peek( priv->queue, index ) )->is_processing )
+	int count = priv->audio_worker ? priv->audio_head : mlt_deque_count( priv->queue );
+	while ( index < count && MLT_FRAME( mlt_deque_peek( priv->queue, index ) )->is_processing )
 		index++;
 	return index;
 }
 
+/** Get the number of frames in the work queue that are ready for image processing.
+ *
+ * When there is an audio worker, a frame becomes ready after its audio is
+ * processed so that the image and audio of one frame are never processed
+ * concurrently.
+ * \private \memberof mlt_consumer_s
+ * \param self a consumer
+ * \return a count of frames from the front of the queue
+ */
+
+static inline int ready_frame_count( mlt_consumer self )
+{
+	consumer_private *priv = self->local;
+	return priv->audio_worker ? priv->audio_head : mlt_deque_count( priv->queue );
+}
+
+/** The audio worker thread procedure for parallel processing frames.
+ *
+ * Audio filters depend upon the continuity of samples, so a single thread
+ * processes the audio of the frames in the order of the queue while the
+ * other worker threads process the images of the frames ahead of it.
+ * \private \memberof mlt_consumer_s
+ * \param arg a consumer
+ */
+
+static void *consumer_audio_worker_thread( void *arg )
+{
+	mlt_consumer self = arg;
+	consumer_private *priv = self->local;
+	mlt_frame frame = NULL;
+	void *audio = NULL;
+	int samples = 0;
+
+	while ( priv->ahead )
+	{
+		// Get the next frame without audio processed
+		pthread_mutex_lock( &priv->queue_mutex );
+		while ( priv->ahead && priv->audio_head >= mlt_deque_count( priv->queue ) )
+			pthread_cond_wait( &priv->queue_cond, &priv->queue_mutex );
+		frame = priv->ahead ? mlt_deque_peek( priv->queue, priv->audio_head ) : NULL;
+		if ( frame )
+			mlt_properties_inc_ref( MLT_FRAME_PROPERTIES( frame ) );
+		pthread_mutex_unlock( &priv->queue_mutex );
+
+		if ( frame == NULL )
+			continue;
+
+		samples = mlt_sample_calculator( priv->fps, priv->frequency, priv->aud_counter++ );
+		mlt_frame_get_audio( frame, &audio, &priv->audio_format, &priv->frequency, &priv->channels, &samples );
+
+		// Advance unless the frame was purged meanwhile
+		pthread_mutex_lock( &priv->queue_mutex );
+		if ( mlt_deque_peek( priv->queue, priv->audio_head ) == frame )
+			priv->audio_head++;
+		pthread_cond_broadcast( &priv->queue_cond );
+		pthread_mutex_unlock( &priv->queue_mutex );
+		mlt_frame_close( frame );
+
+		// Tell a waiting consumer thread that the audio is done.
+		pthread_mutex_lock( &priv->done_mutex );
+		pthread_cond_broadcast( &priv->done_cond );
+		pthread_mutex_unlock( &priv->done_mutex );
+	}
+
+	return NULL;
+}
+
 /** The worker thread procedure for parallel processing frames.
  *
  * \private \memberof mlt_consumer_s
@@ -1034,10 +1457,16 @@ static void *consumer_worker_thread( void *arg )
 	// General frame variable
 	mlt_frame frame = NULL;
 	uint8_t *image = NULL;
+	struct timeval render_time;
 
 	if ( preview_off && preview_format != 0 )
 		format = preview_format;
 
+	// Number the worker so that only the first auto_threads of them process
+	pthread_mutex_lock( &priv->queue_mutex );
+	int id = priv->worker_count++;
+	pthread_mutex_unlock( &priv->queue_mutex );
+
 	mlt_events_fire( properties, "consumer-thread-started", NULL );
 
 	// Continue to read ahead
@@ -1046,7 +1475,7 @@ static void *consumer_worker_thread( void *arg )
 		// Get the next unprocessed frame from the work queue
 		pthread_mutex_lock( &priv->queue_mutex );
 		int index = first_unprocessed_frame( self );
-		while ( priv->ahead && index >= mlt_deque_count( priv->queue ) )
+		while ( priv->ahead && ( index >= ready_frame_count( self ) || ( priv->auto_threads && id >= priv->auto_threads ) ) )
 		{
 			mlt_log_debug( MLT_CONSUMER_SERVICE(self), "waiting in worker index = %d queue count = %d\n",
 				index, mlt_deque_count( priv->queue ) );
@@ -1085,6 +1514,7 @@ static void *consumer_worker_thread( void *arg )
 			width = mlt_properties_get_int( properties, "width" );
 			height = mlt_properties_get_int( properties, "height" );
 			mlt_events_fire( MLT_CONSUMER_PROPERTIES( self ), "consumer-frame-render", frame, NULL );
+			gettimeofday( &render_time, NULL );
 			mlt_frame_get_image( frame, &image, &format, &width, &height, 0 );
 		}
 		mlt_properties_set_int( MLT_FRAME_PROPERTIES( frame ), "rendered", 1 );
@@ -1092,6 +1522,11 @@ static void *consumer_worker_thread( void *arg )
 
 		// Tell a waiting thread (non-realtime main consumer thread) that we are done.
 		pthread_mutex_lock( &priv->done_mutex );
+		if ( priv->auto_threads && !video_off )
+		{
+			priv->auto_render_time += time_difference( &render_time );
+			priv->auto_rendered++;
+		}
 		pthread_cond_broadcast( &priv->done_cond );
 		pthread_mutex_unlock( &priv->done_mutex );
 	}
@@ -1112,12 +1547,23 @@ static void consumer_read_ahead_start( mlt_consumer self )
 	if ( priv->started )
 		return;
 
+	// Create the frame queue
+	if ( ring_init( &priv->ring, mlt_properties_get_int( MLT_CONSUMER_PROPERTIES( self ), "buffer" ) + 1 ) )
+	{
+		mlt_log_error( MLT_CONSUMER_SERVICE( self ), "failed to allocate the read ahead queue\n" );
+		ring_close( &priv->ring );
+		return;
+	}
+	priv->depths = calloc( priv->ring.size, sizeof( int ) );
+	priv->latency_total = 0;
+	priv->latency_max = 0;
+	priv->latency_count = 0;
+	priv->taken_time = 0;
+	priv->stats_time = 0;
+
 	// We're running now
 	priv->ahead = 1;
 
-	// Create the frame queue
-	priv->queue = mlt_deque_init( );
-
 	// Create the queue mutex
 	pthread_mutex_init( &priv->queue_mutex, NULL );
 
@@ -1144,7 +1590,7 @@ static void consumer_work_start( mlt_consumer self )
 	if ( priv->started )
 		return;
 
-	thread = calloc( 1, sizeof( pthread_t ) * n );
+	thread = calloc( 1, sizeof( pthread_t ) * ( n + 1 ) );
 
 	// We're running now
 	priv->ahead = 1;
@@ -1159,6 +1605,24 @@ static void consumer_work_start( mlt_consumer self )
 	// before the frame is played out.
 	priv->process_head = 0;
 
+	// Audio is processed in order on its own thread unless it is turned off.
+	priv->audio_worker = !mlt_properties_get_int( MLT_CONSUMER_PROPERTIES( self ), "audio_off" );
+	priv->audio_head = 0;
+	priv->worker_count = 0;
+
+	// Begin self-tuning with the first window.
+	if ( priv->auto_threads )
+	{
+		priv->auto_buffer = 2 * priv->auto_threads + 2;
+		priv->auto_direction = 1;
+		priv->auto_hold = 0;
+		priv->auto_fps = 0;
+		priv->auto_frames = 0;
+		priv->auto_render_time = 0;
+		priv->auto_rendered = 0;
+		gettimeofday( &priv->auto_time, NULL );
+	}
+
 	// Create the queues
 	priv->queue = mlt_deque_init();
 	priv->worker_threads = mlt_deque_init();
@@ -1204,6 +1668,13 @@ static void consumer_work_start( mlt_consumer self )
 			thread++;
 		}
 	}
+	if ( priv->audio_worker )
+	{
+		if ( pthread_create( thread, NULL, consumer_audio_worker_thread, self ) == 0 )
+			mlt_deque_push_back( priv->worker_threads, thread );
+		else
+			priv->audio_worker = 0;
+	}
 	priv->started = 1;
 }
 
@@ -1244,6 +1715,12 @@ static void consumer_read_ahead_stop( mlt_consumer self )
 		// Join the thread
 		mlt_thread_join( self );
 
+		// Close the frame queue
+		publish_queue_stats( self );
+		ring_close( &priv->ring );
+		free( priv->depths );
+		priv->depths = NULL;
+
 		// Destroy the frame queue mutex
 		pthread_mutex_destroy( &priv->queue_mutex );
 
@@ -1276,7 +1753,12 @@ static void consumer_work_stop( mlt_consumer self )
 		mlt_events_fire( MLT_CONSUMER_PROPERTIES(self), "consumer-stopping", NULL );
 
 		// Broadcast to the queue condition in case it's waiting
+		// and wipe the queue so that no worker waits for a frame
+		// that will not be processed.
 		pthread_mutex_lock( &priv->queue_mutex );
+		while ( mlt_deque_count( priv->queue ) )
+			mlt_frame_close( mlt_deque_pop_back( priv->queue ) );
+		priv->audio_head = 0;
 		pthread_cond_broadcast( &priv->queue_cond );
 		pthread_mutex_unlock( &priv->queue_mutex );
 
@@ -1341,23 +1823,28 @@ void mlt_consumer_purge( mlt_consumer self )
 		if ( self->purge )
 			self->purge( self );
 
-		if ( priv->started && priv->real_time )
-			pthread_mutex_lock( &priv->queue_mutex );
-
-		while ( priv->started && mlt_deque_count( priv->queue ) )
-			mlt_frame_close( mlt_deque_pop_back( priv->queue ) );
-
-		if ( priv->started && priv->real_time )
+		if ( priv->started && abs( priv->real_time ) == 1 )
+		{
+			// The frames requested before this are dropped as they leave the queue.
+			__sync_fetch_and_add( &priv->ring.purge, 1 );
+		}
+		else if ( priv->started && priv->real_time )
 		{
+			pthread_mutex_lock( &priv->queue_mutex );
+			while ( mlt_deque_count( priv->queue ) )
+				mlt_frame_close( mlt_deque_pop_back( priv->queue ) );
+			priv->audio_head = 0;
 			priv->is_purge = 1;
 			pthread_cond_broadcast( &priv->queue_cond );
 			pthread_mutex_unlock( &priv->queue_mutex );
-			if ( abs( priv->real_time ) > 1 )
-			{
-				pthread_mutex_lock( &priv->done_mutex );
-				pthread_cond_broadcast( &priv->done_cond );
-				pthread_mutex_unlock( &priv->done_mutex );
-			}
+
+			pthread_mutex_lock( &priv->done_mutex );
+			pthread_cond_broadcast( &priv->done_cond );
+			pthread_mutex_unlock( &priv->done_mutex );
+		}
+		else
+		{
+			priv->audio_head = 0;
 		}
 
 		pthread_mutex_lock( &priv->put_mutex );
@@ -1370,6 +1857,101 @@ void mlt_consumer_purge( mlt_consumer self )
 	}
 }
 
+/** Adjust the number of workers and the depth of the work queue.
+ *
+ * This is called for each frame played out when real_time is auto. Every
+ * window of about half a second, it compares the throughput with the
+ * previous window. With a target frame rate (auto_fps), the number of
+ * workers follows the average image processing time. Otherwise it climbs
+ * in the direction that improved the throughput and backs off when more
+ * workers no longer help. The queue holds two frames per worker but not
+ * more than fit within auto_memory.
+ *
+ * \private \memberof mlt_consumer_s
+ * \param self a consumer
+ * \param properties the consumer's properties
+ */
+
+static void consumer_auto_tune( mlt_consumer self, mlt_properties properties )
+{
+	consumer_private *priv = self->local;
+	int max_threads = abs( priv->real_time );
+	int threads = priv->auto_threads;
+	struct timeval now = priv->auto_time;
+
+	gettimeofday( &now, NULL );
+	long elapsed = ( now.tv_sec - priv->auto_time.tv_sec ) * 1000000 + now.tv_usec - priv->auto_time.tv_usec;
+	if ( ++priv->auto_frames < 2 * threads || elapsed < 500000 )
+		return;
+
+	double fps = priv->auto_frames * 1000000.0 / elapsed;
+	pthread_mutex_lock( &priv->done_mutex );
+	double render_time = priv->auto_rendered ? (double) priv->auto_render_time / priv->auto_rendered : 0;
+	priv->auto_render_time = 0;
+	priv->auto_rendered = 0;
+	pthread_mutex_unlock( &priv->done_mutex );
+
+	double target = mlt_properties_get_double( properties, "auto_fps" );
+	if ( target > 0 )
+	{
+		// Provide enough workers to process at the target rate with some slack.
+		int needed = render_time * target * 1.25 / 1000000.0 + 0.999;
+		if ( needed > threads )
+			threads++;
+		else if ( needed < threads )
+			threads--;
+	}
+	else if ( priv->auto_hold > 0 )
+	{
+		priv->auto_hold--;
+	}
+	else if ( fps > priv->auto_fps * 1.03 )
+	{
+		// Keep going the way that helped.
+		threads += priv->auto_direction;
+	}
+	else
+	{
+		// Reverse when it got worse, or give back a worker when it did not help,
+		// and then wait a few windows before probing again.
+		priv->auto_direction = fps < priv->auto_fps * 0.97 ? -priv->auto_direction : -1;
+		threads += priv->auto_direction;
+		priv->auto_hold = 4;
+	}
+	threads = CLAMP( threads, 1, max_threads );
+
+	// Bound the frames in flight by the memory budget.
+	int buffer = 2 * threads + 2;
+	int budget = mlt_properties_get_int( properties, "auto_memory" );
+	if ( budget > 0 )
+	{
+		int width = mlt_properties_get_int( properties, "width" );
+		int height = mlt_properties_get_int( properties, "height" );
+		int64_t frame_size = mlt_image_format_size( priv->image_format, width, height, NULL )
+			+ (int64_t) priv->channels * priv->frequency / ( priv->fps > 0 ? priv->fps : 25 ) * sizeof( float );
+		int limit = (int64_t) budget * 1024 * 1024 / ( frame_size > 0 ? frame_size : 1 );
+		buffer = MIN( buffer, limit );
+		buffer = MAX( buffer, threads + 1 );
+	}
+
+	if ( threads != priv->auto_threads || buffer != priv->auto_buffer )
+		mlt_log_verbose( MLT_CONSUMER_SERVICE( self ), "auto threads %d buffer %d at %.1f fps render %.1f ms\n",
+			threads, buffer, fps, render_time / 1000.0 );
+
+	pthread_mutex_lock( &priv->queue_mutex );
+	priv->auto_threads = threads;
+	priv->auto_buffer = buffer;
+	pthread_cond_broadcast( &priv->queue_cond );
+	pthread_mutex_unlock( &priv->queue_mutex );
+
+	mlt_properties_set_int( properties, "auto_threads", threads );
+	mlt_properties_set_int( properties, "auto_buffer", buffer );
+
+	priv->auto_fps = fps;
+	priv->auto_frames = 0;
+	priv->auto_time = now;
+}
+
 /** Use multiple worker threads and a work queue.
  */
 
@@ -1387,6 +1969,9 @@ static mlt_frame worker_get_frame( mlt_consumer self, mlt_properties properties
 	// This is a heuristic to determine a suitable minimum buffer size for the number of threads.
 	int headroom = 2 + threads * threads;
 	buffer = buffer < headroom ? headroom : buffer;
+	// Unless it is tuned at runtime.
+	if ( priv->auto_threads )
+		buffer = priv->ahead ? priv->auto_buffer : 2 * priv->auto_threads + 2;
 
 	// Start worker threads if not already started.
 	if ( ! priv->ahead )
@@ -1402,18 +1987,20 @@ static mlt_frame worker_get_frame( mlt_consumer self, mlt_properties properties
 		int i = buffer;
 		while ( priv->ahead && i-- )
 		{
+			mlt_service_threading_begin( );
 			frame = mlt_consumer_get_frame( self );
+			mlt_service_threading_end( );
 			if ( frame )
 			{
 				// Process the audio
-				if ( !audio_off )
+				if ( !audio_off && !priv->audio_worker )
 				{
 					samples = mlt_sample_calculator( priv->fps, priv->frequency, priv->aud_counter++ );
 					mlt_frame_get_audio( frame, &audio, &priv->audio_format, &priv->frequency, &priv->channels, &samples );
 				}
 				pthread_mutex_lock( &priv->queue_mutex );
 				mlt_deque_push_back( priv->queue, frame );
-				pthread_cond_signal( &priv->queue_cond );
+				pthread_cond_broadcast( &priv->queue_cond );
 				pthread_mutex_unlock( &priv->queue_mutex );
 			}
 		}
@@ -1434,18 +2021,21 @@ static mlt_frame worker_get_frame( mlt_consumer self, mlt_properties properties
 	// Feed the work queue
 	while ( priv->ahead && mlt_deque_count( priv->queue ) < buffer )
 	{
+		// Services honour their threading contracts for frames made here
+		mlt_service_threading_begin( );
 		frame = mlt_consumer_get_frame( self );
+		mlt_service_threading_end( );
 		if ( frame )
 		{
 			// Process the audio
-			if ( !audio_off )
+			if ( !audio_off && !priv->audio_worker )
 			{
 				samples = mlt_sample_calculator( priv->fps, priv->frequency, priv->aud_counter++ );
 				mlt_frame_get_audio( frame, &audio, &priv->audio_format, &priv->frequency, &priv->channels, &samples );
 			}
 			pthread_mutex_lock( &priv->queue_mutex );
 			mlt_deque_push_back( priv->queue, frame );
-			pthread_cond_signal( &priv->queue_cond );
+			pthread_cond_broadcast( &priv->queue_cond );
 			pthread_mutex_unlock( &priv->queue_mutex );
 		}
 	}
@@ -1459,15 +2049,29 @@ static mlt_frame worker_get_frame( mlt_consumer self, mlt_properties properties
 		pthread_mutex_unlock( &priv->done_mutex );
 	}
 
+	// Audio is never dropped, so wait for it even in realtime.
+	if ( priv->audio_worker )
+	{
+		pthread_mutex_lock( &priv->done_mutex );
+		while ( priv->ahead && !priv->is_purge && priv->audio_head == 0 )
+			pthread_cond_wait( &priv->done_cond, &priv->done_mutex );
+		pthread_mutex_unlock( &priv->done_mutex );
+	}
+
 	// Get the frame from the queue.
 	pthread_mutex_lock( &priv->queue_mutex );
 	frame = mlt_deque_pop_front( priv->queue );
+	if ( frame && priv->audio_head > 0 )
+		priv->audio_head--;
 	pthread_mutex_unlock( &priv->queue_mutex );
 	if ( ! frame ) {
 		priv->is_purge = 0;
 		return frame;
 	}
 
+	if ( priv->auto_threads )
+		consumer_auto_tune( self, properties );
+
 	// Adapt the worker process head to the runtime conditions.
 	if ( priv->real_time > 0 )
 	{
@@ -1518,6 +2122,9 @@ static mlt_frame worker_get_frame( mlt_consumer self, mlt_properties properties
 			int dropped = mlt_properties_get_int( properties, "drop_count" );
 			mlt_properties_set_int( properties, "drop_count", ++dropped );
 			mlt_log_verbose( MLT_CONSUMER_SERVICE(self), "dropped video frame %d\n", dropped );
+
+			// Do not let the following frames wait for this one.
+			mlt_service_threading_release( frame );
 		}
 	}
 	if ( priv->is_purge ) {
@@ -1571,14 +2178,21 @@ mlt_frame mlt_consumer_rt_frame( mlt_consumer self )
 		}
 
 		// Get frame from queue
-		pthread_mutex_lock( &priv->queue_mutex );
+		int64_t latency = 0;
+		unsigned int depth = 0;
+		int late = size == 1 && ring_count( &priv->ring ) == 0;
 		mlt_log_timings_begin();
-		while( priv->ahead && mlt_deque_count( priv->queue ) < size )
-			pthread_cond_wait( &priv->queue_cond, &priv->queue_mutex );
-		frame = mlt_deque_pop_front( priv->queue );
+		frame = ring_pop( priv, size, &latency, &depth );
 		mlt_log_timings_end( NULL, "wait_for_frame_queue" );
-		pthread_cond_broadcast( &priv->queue_cond );
-		pthread_mutex_unlock( &priv->queue_mutex );
+		if ( frame )
+		{
+			priv->taken_time = time_now();
+			update_queue_stats( self, latency, depth, priv->taken_time );
+		}
+
+		// The frame was not ready when it was due
+		if ( frame && late )
+			mlt_properties_set_int( properties, "deadline_missed", mlt_properties_get_int( properties, "deadline_missed" ) + 1 );
 		if ( priv->real_time == 1 && frame &&
 			 !mlt_properties_get_int( MLT_FRAME_PROPERTIES(frame), "rendered" ) )
 		{
@@ -1695,6 +2309,22 @@ int mlt_consumer_is_stopped( mlt_consumer self )
 	return 0;
 }
 
+/** Get the real_time mode of the consumer.
+ *
+ * This is the value of the real_time property when the consumer was last
+ * started, with "auto" resolved to the negative number of threads. Consumer
+ * implementations should use it from their threads instead of reading the
+ * property, which keeps the value set by the application.
+ * \public \memberof mlt_consumer_s
+ * \param self a consumer
+ * \return the real_time mode
+ */
+
+int mlt_consumer_real_time( mlt_consumer self )
+{
+	return ( ( consumer_private* ) self->local )->real_time;
+}
+
 /** Close and destroy the consumer.
  *
  * \public \memberof mlt_consumer_s
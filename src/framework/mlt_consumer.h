@@ -45,6 +45,27 @@
  * \properties \em channels the number of audio channels to use, defaults to 2
  * \properties \em real_time the asynchronous behavior: 1 (default) for asynchronous
  * with frame dropping, -1 for asynchronous without frame dropping, 0 to disable (synchronous)
+ * Values greater than 1 or less than -1 use that many threads to render images with one more
+ * thread that processes the audio in frame order ahead of them.
+ * Services that are not stateless (see mlt_service_threading) process those images one at a time,
+ * and so do the services upstream of them.
+ * Use "auto" to render without frame dropping on up to one thread per CPU while adjusting the
+ * number of active threads and the depth of the queue at runtime. The property keeps the value
+ * set by the application; use mlt_consumer_real_time() to get the resolved mode.
+ * \properties \em auto_fps with real_time auto, a frame rate to reach with as few threads as
+ * possible instead of maximizing the throughput
+ * \properties \em auto_memory with real_time auto, the maximum size in MiB of the frames
+ * queued ahead of the output
+ * \properties \em auto_threads with real_time auto, the number of active threads (read only)
+ * \properties \em auto_buffer with real_time auto, the depth of the queue (read only)
+ * \properties \em queue_latency with real_time 1 or -1, the average time in milliseconds
+ * that frames wait in the read ahead queue (read only). This and the next two are updated
+ * about once per second and when the consumer stops.
+ * \properties \em queue_latency_max with real_time 1 or -1, the longest time in milliseconds
+ * that a frame waited in the read ahead queue (read only)
+ * \properties \em queue_depths with real_time 1 or -1, a histogram of the number of frames
+ * left in the read ahead queue as each frame is taken, as a space separated list of counts
+ * from 0 to buffer (read only)
  * \properties \em test_card the name of a resource to use as the test card, defaults to
  * environment variable MLT_TEST_CARD. If undefined, the hard-coded default test card is
  * white silence. A test card is what appears when nothing is produced.
@@ -80,6 +101,12 @@
  * \properties \em audio_off set non-zero to disable audio processing
  * \properties \em video_off set non-zero to disable video processing
  * \properties \em drop_count the number of video frames not rendered since starting consumer
+ * \properties \em degrade_count with real_time 1, the number of frames rendered with the nearest
+ * scaler and without deinterlacing to meet their deadline (read only)
+ * \properties \em deadline_missed with real_time 1 or -1, the number of frames that were not
+ * ready when the consumer asked for them (read only)
+ * \properties \em render_cost with real_time 1 or -1, the moving average of the time in
+ * milliseconds to render an image (read only)
  */
 
 struct mlt_consumer_s
@@ -142,5 +169,6 @@ extern int mlt_consumer_is_stopped( mlt_consumer self );
 extern void mlt_consumer_stopped( mlt_consumer self );
 extern void mlt_consumer_close( mlt_consumer );
 extern mlt_position mlt_consumer_position( mlt_consumer );
+extern int mlt_consumer_real_time( mlt_consumer self );
 
 #endif
@@ -322,7 +322,11 @@ mlt_frame mlt_filter_process( mlt_filter self, mlt_frame frame )
 		mlt_properties_set_data( MLT_FRAME_PROPERTIES(frame), name, self, 0,
 			(mlt_destructor) mlt_filter_close, NULL );
 
-		return self->process( self, frame );
+		int depth = mlt_deque_count( MLT_FRAME_IMAGE_STACK( frame ) );
+		mlt_frame result = self->process( self, frame );
+		if ( result == frame )
+			mlt_service_threading_guard( MLT_FILTER_SERVICE( self ), frame, depth );
+		return result;
 	}
 }
 
@@ -25,6 +25,7 @@
 #include "mlt_factory.h"
 #include "mlt_profile.h"
 #include "mlt_log.h"
+#include "mlt_slices.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -584,6 +585,194 @@ static int generate_test_image( mlt_properties properties, uint8_t **buffer,  ml
 }
 
 
+/** The look-up tables queued on a frame by point operations.
+ */
+
+typedef struct
+{
+	mlt_image_format format;
+	uint8_t lut[3][256];
+}
+frame_lut;
+
+struct frame_lut_desc
+{
+	frame_lut *lut;
+	uint8_t *image;
+	int width;
+	int height;
+};
+
+static int apply_lut_slice( int id, int idx, int jobs, void *cookie )
+{
+	struct frame_lut_desc *desc = ( struct frame_lut_desc* ) cookie;
+	const uint8_t *a = desc->lut->lut[0];
+	const uint8_t *b = desc->lut->lut[1];
+	const uint8_t *c = desc->lut->lut[2];
+	int start = desc->height * idx / jobs;
+	int end = desc->height * ( idx + 1 ) / jobs;
+	int bpp = desc->lut->format == mlt_image_yuv422 ? 2 : desc->lut->format == mlt_image_rgb24 ? 3 : 4;
+	int stride = desc->width * bpp;
+	int y, x;
+
+	for ( y = start; y < end; y++ )
+	{
+		uint8_t *p = desc->image + y * stride;
+
+		switch ( desc->lut->format )
+		{
+		case mlt_image_yuv422:
+			// Chroma alternates between U and V from the start of every row
+			for ( x = 0; x + 1 < desc->width; x += 2, p += 4 )
+			{
+				p[0] = a[ p[0] ];
+				p[1] = b[ p[1] ];
+				p[2] = a[ p[2] ];
+				p[3] = c[ p[3] ];
+			}
+			if ( x < desc->width )
+			{
+				p[0] = a[ p[0] ];
+				p[1] = b[ p[1] ];
+			}
+			break;
+		case mlt_image_rgb24:
+		case mlt_image_rgb24a:
+			for ( x = 0; x < desc->width; x++, p += bpp )
+			{
+				p[0] = a[ p[0] ];
+				p[1] = b[ p[1] ];
+				p[2] = c[ p[2] ];
+			}
+			break;
+		default:
+			break;
+		}
+	}
+	return 0;
+}
+
+/** Apply the queued look-up tables to an image in a single pass.
+ *
+ * \private \memberof mlt_frame_s
+ * \param self a frame
+ * \param image the image of the frame
+ * \param width the horizontal size in pixels
+ * \param height the vertical size in pixels
+ */
+
+static void apply_lut( mlt_frame self, uint8_t *image, int width, int height )
+{
+	mlt_properties properties = MLT_FRAME_PROPERTIES( self );
+	frame_lut *lut = mlt_properties_get_data( properties, "_lut", NULL );
+
+	if ( lut && image )
+	{
+		struct frame_lut_desc desc = { lut, image, width, height };
+		int jobs = height / 64;
+		int identity = 1;
+		int i;
+
+		for ( i = 0; identity && i < 256; i++ )
+			identity = lut->lut[0][i] == i && lut->lut[1][i] == i && lut->lut[2][i] == i;
+		if ( !identity )
+		{
+			jobs = jobs < mlt_slices_count_normal() ? jobs : mlt_slices_count_normal();
+			if ( jobs > 1 )
+				mlt_slices_run_normal( jobs, apply_lut_slice, &desc );
+			else
+				apply_lut_slice( 0, 0, 1, &desc );
+		}
+	}
+	mlt_properties_set_data( properties, "_lut", NULL, 0, NULL, NULL );
+}
+
+/** Get the image of a frame for a point operation.
+ *
+ * This is the same as mlt_frame_get_image() with \p writable set, except that
+ * the look-up tables queued by the services below are left on the frame when
+ * the image comes back in the requested format. The caller is expected to
+ * queue its own table with mlt_frame_add_lut() and not otherwise touch the
+ * pixels. Then a chain of point operations costs one pass over the image,
+ * which is made when the image is next got without this function.
+ *
+ * \public \memberof mlt_frame_s
+ * \param self a frame
+ * \param[out] buffer an image buffer
+ * \param[in,out] format the image format
+ * \param[in,out] width the horizontal size in pixels
+ * \param[in,out] height the vertical size in pixels
+ * \return true if error
+ */
+
+int mlt_frame_get_image_lut( mlt_frame self, uint8_t **buffer, mlt_image_format *format, int *width, int *height )
+{
+	mlt_properties_set_int( MLT_FRAME_PROPERTIES( self ), "_lut_defer", 1 );
+	return mlt_frame_get_image( self, buffer, format, width, height, 1 );
+}
+
+/** Queue a per channel look-up table for the image of a frame.
+ *
+ * The table is combined with any table already queued, so that the image is
+ * only visited once. The channels are Y, U and V for mlt_image_yuv422 and R, G
+ * and B for mlt_image_rgb24 and mlt_image_rgb24a, where alpha is left as it is.
+ *
+ * \public \memberof mlt_frame_s
+ * \param self a frame
+ * \param format the format of the image the table is for, which must be the current one
+ * \param lut 3 tables of 256 values, one after the other
+ * \return true if the format is not supported or not the format of the image
+ */
+
+int mlt_frame_add_lut( mlt_frame self, mlt_image_format format, const uint8_t *lut )
+{
+	mlt_properties properties = MLT_FRAME_PROPERTIES( self );
+	frame_lut *queued = mlt_properties_get_data( properties, "_lut", NULL );
+	int c, i;
+
+	if ( ( format != mlt_image_yuv422 && format != mlt_image_rgb24 && format != mlt_image_rgb24a ) ||
+		 format != mlt_properties_get_int( properties, "format" ) )
+		return 1;
+
+	if ( queued && queued->format != format )
+	{
+		apply_lut( self, mlt_properties_get_data( properties, "image", NULL ),
+			mlt_properties_get_int( properties, "width" ), mlt_properties_get_int( properties, "height" ) );
+		queued = NULL;
+	}
+	if ( queued )
+	{
+		for ( c = 0; c < 3; c++ )
+			for ( i = 0; i < 256; i++ )
+				queued->lut[c][i] = lut[ c * 256 + queued->lut[c][i] ];
+	}
+	else
+	{
+		queued = malloc( sizeof( *queued ) );
+		queued->format = format;
+		memcpy( queued->lut, lut, sizeof( queued->lut ) );
+		mlt_properties_set_data( properties, "_lut", queued, 0, free, NULL );
+	}
+	return 0;
+}
+
+/** Apply the look-up tables queued on a frame now.
+ *
+ * Normally this happens within mlt_frame_get_image(). Use this before working
+ * on the "image" property of a frame directly.
+ *
+ * \public \memberof mlt_frame_s
+ * \param self a frame
+ */
+
+void mlt_frame_apply_lut( mlt_frame self )
+{
+	mlt_properties properties = MLT_FRAME_PROPERTIES( self );
+	if ( mlt_properties_get_data( properties, "_lut", NULL ) )
+		apply_lut( self, mlt_properties_get_data( properties, "image", NULL ),
+			mlt_properties_get_int( properties, "width" ), mlt_properties_get_int( properties, "height" ) );
+}
+
 /** Get the image associated to the frame.
  *
  * You should express the desired format, width, and height as inputs. As long
@@ -610,6 +799,10 @@ int mlt_frame_get_image( mlt_frame self, uint8_t **buffer, mlt_image_format *for
 	mlt_get_image get_image = mlt_frame_pop_get_image( self );
 	mlt_image_format requested_format = *format;
 	int error = 0;
+	int defer = mlt_properties_get_int( properties, "_lut_defer" );
+
+	if ( defer )
+		mlt_properties_set_int( properties, "_lut_defer", 0 );
 
 	if ( get_image )
 	{
@@ -619,6 +812,9 @@ int mlt_frame_get_image( mlt_frame self, uint8_t **buffer, mlt_image_format *for
 		{
 			mlt_properties_set_int( properties, "width", *width );
 			mlt_properties_set_int( properties, "height", *height );
+			// Queued look-up tables are only kept for a point operation that gets its format
+			if ( !defer || ( requested_format != mlt_image_none && requested_format != *format ) )
+				apply_lut( self, *buffer, *width, *height );
 			if ( self->convert_image && requested_format != mlt_image_none )
 				self->convert_image( self, buffer, format, requested_format );
 			mlt_properties_set_int( properties, "format", *format );
@@ -634,6 +830,8 @@ int mlt_frame_get_image( mlt_frame self, uint8_t **buffer, mlt_image_format *for
 		*buffer = mlt_properties_get_data( properties, "image", NULL );
 		*width = mlt_properties_get_int( properties, "width" );
 		*height = mlt_properties_get_int( properties, "height" );
+		if ( !defer || ( requested_format != mlt_image_none && requested_format != *format ) )
+			apply_lut( self, *buffer, *width, *height );
 		if ( self->convert_image && *buffer && requested_format != mlt_image_none )
 		{
 			self->convert_image( self, buffer, format, requested_format );
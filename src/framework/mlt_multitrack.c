@@ -616,6 +616,13 @@ static int producer_get_frame( mlt_producer parent, mlt_frame_ptr frame, int ind
 		mlt_properties_set_double( properties, "_speed", speed );
 		mlt_frame_set_position( *frame, position );
 		mlt_properties_set_int( properties, "hide", hide );
+
+		// Pass the track gain for the tractor's audio bus
+		const char *gain = mlt_properties_get( MLT_PRODUCER_PROPERTIES( mlt_producer_cut_parent( producer ) ), "gain" );
+		if ( gain )
+			mlt_properties_set( properties, "audio.gain", gain );
+		if ( mlt_properties_get_int( producer_properties, "_mix_audio" ) )
+			mlt_properties_set_int( properties, "_mix_audio", 1 );
 	}
 	else
 	{
@@ -42,6 +42,10 @@ typedef struct mlt_track_s *mlt_track;
  *
  * \extends mlt_producer_s
  * \properties \em log_id not currently used, but sets it to "mulitrack"
+ *
+ * The producer of each track may carry these properties:
+ * \properties \em hide a bitmask to hide the track from video (1) and/or audio (2)
+ * \properties \em gain the factor by which a tractor with \em mix_audio scales the audio of the track
  */
 
 struct mlt_multitrack_s
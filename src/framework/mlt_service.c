@@ -594,6 +594,8 @@ int mlt_service_get_frame( mlt_service self, mlt_frame_ptr frame, int index )
 
 		if ( result == 0 )
 		{
+			if ( mlt_service_identify( self ) == producer_type && !mlt_producer_is_cut( MLT_PRODUCER( self ) ) )
+				mlt_service_threading_guard( self, *frame, 0 );
 			mlt_properties_inc_ref( properties );
 			properties = MLT_FRAME_PROPERTIES( *frame );
 			
@@ -605,15 +607,16 @@ int mlt_service_get_frame( mlt_service self, mlt_frame_ptr frame, int index )
 			mlt_service_apply_filters( self, *frame, 1 );
 			mlt_deque_push_back( MLT_FRAME_SERVICE_STACK( *frame ), self );
 			
-			if ( mlt_service_identify( self ) == producer_type &&
-			     mlt_properties_get_int( MLT_SERVICE_PROPERTIES( self ), "_need_previous_next" ) )
+			int distance = mlt_service_identify( self ) == producer_type ?
+				mlt_properties_get_int( MLT_SERVICE_PROPERTIES( self ), "_need_previous_next" ) : 0;
+			if ( distance > 0 )
 			{
 				// Save the new position from self->get_frame
 				mlt_position new_position = mlt_producer_position( MLT_PRODUCER( self ) );
 				
 				// Get the preceding frame, unfiltered
 				mlt_frame previous_frame;
-				mlt_producer_seek( MLT_PRODUCER(self), position - 1 );
+				mlt_producer_seek( MLT_PRODUCER(self), position - distance );
 				result = self->get_frame( self, &previous_frame, index );
 				if ( !result )
 					mlt_properties_set_data( properties, "previous frame",
@@ -621,7 +624,7 @@ int mlt_service_get_frame( mlt_service self, mlt_frame_ptr frame, int index )
 
 				// Get the following frame, unfiltered
 				mlt_frame next_frame;
-				mlt_producer_seek( MLT_PRODUCER(self), position + 1 );
+				mlt_producer_seek( MLT_PRODUCER(self), position + distance );
 				result = self->get_frame( self, &next_frame, index );
 				if ( !result )
 				{
@@ -1018,3 +1021,306 @@ int mlt_service_cache_get_size( mlt_service self, const char *name )
 	else
 		return 0;
 }
+
+/** Get the threading contract of a service.
+ *
+ * An application may set the property "threading" to one of "stateless",
+ * "single", or "ordered" to override the contract declared by the "threading"
+ * key of the service's metadata. A service without metadata may declare it by
+ * setting the property "_threading" when it is constructed.
+ *
+ * \public \memberof mlt_service_s
+ * \param self a service
+ * \return the threading contract
+ */
+
+mlt_threading mlt_service_threading( mlt_service self )
+{
+	mlt_properties properties = MLT_SERVICE_PROPERTIES( self );
+	const char *value = mlt_properties_get( properties, "threading" );
+
+	if ( !value )
+		value = mlt_properties_get( properties, "_threading" );
+	if ( !value )
+	{
+		// Look it up in the metadata once and remember it
+		const char *type = mlt_properties_get( properties, "mlt_type" );
+		const char *id = mlt_properties_get( properties, "mlt_service" );
+		mlt_service_type service_type = invalid_type;
+		mlt_properties metadata = NULL;
+
+		if ( type && strstr( type, "producer" ) )
+			service_type = producer_type;
+		else if ( type && strstr( type, "filter" ) )
+			service_type = filter_type;
+		else if ( type && strstr( type, "transition" ) )
+			service_type = transition_type;
+		if ( service_type != invalid_type && id && mlt_factory_repository() )
+			metadata = mlt_repository_metadata( mlt_factory_repository(), service_type, id );
+		value = metadata ? mlt_properties_get( metadata, "threading" ) : NULL;
+		mlt_properties_set( properties, "_threading", value ? value : "stateless" );
+		value = mlt_properties_get( properties, "_threading" );
+	}
+
+	if ( !strcmp( value, "ordered" ) )
+		return mlt_threading_ordered;
+	else if ( !strcmp( value, "single" ) )
+		return mlt_threading_single;
+	return mlt_threading_stateless;
+}
+
+/** \brief private state to serialize the frames of a service
+ *
+ * Frames take tickets in the order in which they are made, and a frame may
+ * only process its image with the service when its ticket is served. Using
+ * the same order for all services prevents a deadlock between them, so a
+ * single-instance service is serialized in frame order as well.
+ */
+
+typedef struct
+{
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	int refs;
+	int next;          /**< the next ticket to issue */
+	int serving;       /**< the ticket that may process */
+	int busy;          /**< whether a frame is processing */
+	int *abandoned;    /**< tickets of frames closed before they were served */
+	int abandoned_count;
+	int abandoned_size;
+}
+threading_guard;
+
+/** \brief private ticket of a frame for a threading_guard */
+
+typedef struct
+{
+	threading_guard *guard;
+	int ticket;
+	int done;
+}
+threading_ticket;
+
+static pthread_key_t threading_key;
+static pthread_once_t threading_once = PTHREAD_ONCE_INIT;
+
+static void threading_key_init( void )
+{
+	pthread_key_create( &threading_key, NULL );
+}
+
+/** Release a reference to a guard.
+ *
+ * \private \memberof mlt_service_s
+ * \param guard a threading guard
+ */
+
+static void threading_guard_close( threading_guard *guard )
+{
+	pthread_mutex_lock( &guard->mutex );
+	int refs = -- guard->refs;
+	pthread_mutex_unlock( &guard->mutex );
+	if ( refs == 0 )
+	{
+		pthread_mutex_destroy( &guard->mutex );
+		pthread_cond_destroy( &guard->cond );
+		free( guard->abandoned );
+		free( guard );
+	}
+}
+
+/** Serve the next ticket, skipping any that were abandoned.
+ *
+ * The guard must be locked.
+ * \private \memberof mlt_service_s
+ * \param guard a threading guard
+ */
+
+static void threading_guard_advance( threading_guard *guard )
+{
+	int i = 0;
+
+	guard->serving ++;
+	while ( i < guard->abandoned_count )
+	{
+		if ( guard->abandoned[i] == guard->serving )
+		{
+			guard->abandoned[i] = guard->abandoned[ -- guard->abandoned_count ];
+			guard->serving ++;
+			i = 0;
+		}
+		else
+		{
+			i ++;
+		}
+	}
+	pthread_cond_broadcast( &guard->cond );
+}
+
+/** Give up the turn of a ticket that has not been served.
+ *
+ * \private \memberof mlt_service_s
+ * \param ticket a threading ticket
+ */
+
+static void threading_ticket_release( threading_ticket *ticket )
+{
+	threading_guard *guard = ticket->guard;
+
+	pthread_mutex_lock( &guard->mutex );
+	if ( !ticket->done )
+	{
+		ticket->done = 1;
+		if ( ticket->ticket == guard->serving )
+		{
+			threading_guard_advance( guard );
+		}
+		else
+		{
+			if ( guard->abandoned_count == guard->abandoned_size )
+			{
+				guard->abandoned_size += 16;
+				guard->abandoned = realloc( guard->abandoned, guard->abandoned_size * sizeof( int ) );
+			}
+			guard->abandoned[ guard->abandoned_count ++ ] = ticket->ticket;
+		}
+	}
+	pthread_mutex_unlock( &guard->mutex );
+}
+
+static void threading_ticket_close( threading_ticket *ticket )
+{
+	threading_ticket_release( ticket );
+	threading_guard_close( ticket->guard );
+	free( ticket );
+}
+
+static int threading_get_image( mlt_frame frame, uint8_t **image, mlt_image_format *format, int *width, int *height, int writable )
+{
+	threading_ticket *ticket = mlt_frame_pop_service( frame );
+	threading_guard *guard = ticket->guard;
+
+	// A released ticket has lost its turn, but it still excludes the others
+	pthread_mutex_lock( &guard->mutex );
+	int released = ticket->done;
+	while ( guard->busy || ( !released && guard->serving != ticket->ticket ) )
+		pthread_cond_wait( &guard->cond, &guard->mutex );
+	guard->busy = 1;
+	pthread_mutex_unlock( &guard->mutex );
+
+	int error = mlt_frame_get_image( frame, image, format, width, height, writable );
+
+	pthread_mutex_lock( &guard->mutex );
+	guard->busy = 0;
+	if ( released )
+	{
+		pthread_cond_broadcast( &guard->cond );
+	}
+	else
+	{
+		ticket->done = 1;
+		threading_guard_advance( guard );
+	}
+	pthread_mutex_unlock( &guard->mutex );
+
+	return error;
+}
+
+/** Indicate that the calling thread is making frames for parallel rendering.
+ *
+ * This enables mlt_service_threading_guard() on the calling thread.
+ * \public \memberof mlt_service_s
+ */
+
+void mlt_service_threading_begin( )
+{
+	pthread_once( &threading_once, threading_key_init );
+	pthread_setspecific( threading_key, &threading_key );
+}
+
+/** Indicate that the calling thread is done making frames for parallel rendering.
+ *
+ * \public \memberof mlt_service_s
+ */
+
+void mlt_service_threading_end( )
+{
+	pthread_once( &threading_once, threading_key_init );
+	pthread_setspecific( threading_key, NULL );
+}
+
+/** Honour the threading contract of a service for a frame.
+ *
+ * This is called by the framework after a service has pushed its image
+ * processing onto a frame. If the calling thread is making frames for
+ * parallel rendering and the service is not stateless, it wraps the
+ * processing so that the frames are processed by the service one at a time
+ * in the order they were made.
+ *
+ * Because a service gets its input image from within its own processing, the
+ * services upstream of it are serialized along with it. Only the services
+ * downstream of it, and those on other branches of the graph, still process
+ * frames concurrently. Audio is not guarded: the consumer already gets the
+ * audio of its frames one at a time in frame order.
+ *
+ * \public \memberof mlt_service_s
+ * \param self a service
+ * \param frame a frame
+ * \param depth the size of the image stack of the frame before the service processed it
+ */
+
+void mlt_service_threading_guard( mlt_service self, mlt_frame frame, int depth )
+{
+	pthread_once( &threading_once, threading_key_init );
+	if ( !self || !frame || !pthread_getspecific( threading_key )
+		 || mlt_deque_count( MLT_FRAME_IMAGE_STACK( frame ) ) <= depth
+		 || mlt_service_threading( self ) == mlt_threading_stateless )
+		return;
+
+	mlt_properties properties = MLT_SERVICE_PROPERTIES( self );
+	threading_guard *guard = mlt_properties_get_data( properties, "_threading_guard", NULL );
+	if ( !guard )
+	{
+		guard = calloc( 1, sizeof( threading_guard ) );
+		pthread_mutex_init( &guard->mutex, NULL );
+		pthread_cond_init( &guard->cond, NULL );
+		guard->refs = 1;
+		mlt_properties_set_data( properties, "_threading_guard", guard, 0, ( mlt_destructor )threading_guard_close, NULL );
+	}
+
+	threading_ticket *ticket = calloc( 1, sizeof( threading_ticket ) );
+	char key[64];
+	pthread_mutex_lock( &guard->mutex );
+	ticket->guard = guard;
+	ticket->ticket = guard->next ++;
+	guard->refs ++;
+	pthread_mutex_unlock( &guard->mutex );
+
+	snprintf( key, sizeof( key ), "_threading_ticket.%p.%d", ( void* )guard, ticket->ticket );
+	mlt_properties_set_data( MLT_FRAME_PROPERTIES( frame ), key, ticket, 0, ( mlt_destructor )threading_ticket_close, NULL );
+	mlt_frame_push_service( frame, ticket );
+	mlt_frame_push_get_image( frame, threading_get_image );
+}
+
+/** Give up the turns of a frame that will not be rendered.
+ *
+ * A consumer that drops a frame calls this so that the frames after it do
+ * not wait for it. If the frame is rendered after all, it is processed by
+ * each service exclusively but out of order.
+ *
+ * \public \memberof mlt_service_s
+ * \param frame a frame
+ */
+
+void mlt_service_threading_release( mlt_frame frame )
+{
+	mlt_properties properties = MLT_FRAME_PROPERTIES( frame );
+	int i, n = mlt_properties_count( properties );
+
+	for ( i = 0; i < n; i++ )
+	{
+		char *name = mlt_properties_get_name( properties, i );
+		if ( name && !strncmp( name, "_threading_ticket.", 18 ) )
+			threading_ticket_release( mlt_properties_get_data_at( properties, i, NULL ) );
+	}
+}
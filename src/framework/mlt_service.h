@@ -50,8 +50,9 @@
  * See modules/core/filter_region.c and modules/core/filter_watermark.c for examples.
  * \properties \em _profile stores the mlt_profile for a service
  * \properties \em _unique_id is a unique identifier
- * \properties \em _need_previous_next boolean that instructs producers to get
- * preceding and following frames inside of \p mlt_service_get_frame
+ * \properties \em _need_previous_next instructs producers to get preceding and
+ * following frames inside of \p mlt_service_get_frame; a value greater than 1
+ * is the distance in frames to them
  */
 
 struct mlt_service_s
@@ -105,6 +106,11 @@ extern mlt_cache_item mlt_service_cache_get( mlt_service self, const char *name
 extern void mlt_service_cache_set_size( mlt_service self, const char *name, int size );
 extern int mlt_service_cache_get_size( mlt_service self, const char *name );
 extern void mlt_service_cache_purge( mlt_service self );
+extern mlt_threading mlt_service_threading( mlt_service self );
+extern void mlt_service_threading_begin( );
+extern void mlt_service_threading_end( );
+extern void mlt_service_threading_guard( mlt_service self, mlt_frame frame, int depth );
+extern void mlt_service_threading_release( mlt_frame frame );
 
 #endif
 
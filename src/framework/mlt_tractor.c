@@ -423,6 +423,82 @@ static int producer_get_audio( mlt_frame self, void **buffer, mlt_audio_format *
 	return 0;
 }
 
+/** Sum the audio of all the tracks in one pass.
+ *
+ * This is used instead of producer_get_audio() when the tractor property
+ * mix_audio is set. Each track is scaled by its "gain" property, which the
+ * multitrack puts on the frame as "audio.gain", and tracks hidden from audio
+ * are excluded when the frame is built. Audio transitions do not process
+ * these frames, so each track is summed exactly once.
+ * \private \memberof mlt_tractor_s
+ */
+
+static int producer_get_audio_bus( mlt_frame self, void **buffer, mlt_audio_format *format, int *frequency, int *channels, int *samples )
+{
+	mlt_properties properties = MLT_FRAME_PROPERTIES( self );
+	mlt_deque inputs = mlt_properties_get_data( properties, "_mix_audio", NULL );
+	int count = mlt_deque_count( inputs );
+	float *out = NULL;
+	int size = 0;
+	int i, j, k;
+
+	for ( i = 0; i < count; i ++ )
+	{
+		mlt_frame frame = mlt_deque_peek( inputs, i );
+		mlt_properties frame_properties = MLT_FRAME_PROPERTIES( frame );
+		mlt_audio_format in_format = mlt_audio_float;
+		int in_frequency = *frequency;
+		int in_channels = *channels;
+		int in_samples = *samples;
+		float *in = NULL;
+		float gain = 1.0;
+
+		if ( mlt_properties_get( frame_properties, "audio.gain" ) )
+			gain = mlt_properties_get_double( frame_properties, "audio.gain" );
+		mlt_properties_set( frame_properties, "producer_consumer_fps", mlt_properties_get( properties, "producer_consumer_fps" ) );
+		mlt_frame_get_audio( frame, (void**) &in, &in_format, &in_frequency, &in_channels, &in_samples );
+
+		// The first track determines the layout of the bus
+		if ( !out )
+		{
+			*frequency = in_frequency;
+			*channels = in_channels;
+			*samples = in_samples;
+			size = mlt_audio_format_size( mlt_audio_float, *samples, *channels );
+			out = mlt_pool_alloc( size );
+			if ( !out )
+				return 1;
+			memset( out, 0, size );
+		}
+
+		if ( mlt_properties_get_int( frame_properties, "silent_audio" ) )
+		{
+			mlt_properties_set_int( frame_properties, "silent_audio", 0 );
+			continue;
+		}
+		if ( !in || in_format != mlt_audio_float || gain == 0.0 )
+			continue;
+
+		// Accumulate into the bus
+		int n = in_samples < *samples ? in_samples : *samples;
+		for ( j = 0; j < *channels && j < in_channels; j ++ )
+		{
+			float *dest = out + j * *samples;
+			const float *src = in + j * in_samples;
+			for ( k = 0; k < n; k ++ )
+				dest[ k ] += gain * src[ k ];
+		}
+	}
+
+	*format = mlt_audio_float;
+	*buffer = out;
+	mlt_frame_set_audio( self, out, *format, size, mlt_pool_release );
+	mlt_properties_set_int( properties, "audio_frequency", *frequency );
+	mlt_properties_set_int( properties, "audio_channels", *channels );
+	mlt_properties_set_int( properties, "audio_samples", *samples );
+	return 0;
+}
+
 static void destroy_data_queue( void *arg )
 {
 	if ( arg != NULL )
@@ -479,6 +555,12 @@ static int producer_get_frame( mlt_producer parent, mlt_frame_ptr frame, int tra
 			// The output frame will hold the 'global' data feeds (ie: those which are targetted for the final frame)
 			mlt_deque data_queue = mlt_deque_init( );
 
+			// Determine whether to sum the audio of all tracks instead of taking the top one
+			mlt_deque audio_inputs = mlt_properties_get_int( properties, "mix_audio" ) ? mlt_deque_init( ) : NULL;
+
+			// Audio transitions are bypassed for the frames of a bus so no track is mixed twice
+			mlt_properties_set_int( MLT_MULTITRACK_PROPERTIES( multitrack ), "_mix_audio", audio_inputs != NULL );
+
 			// Used to garbage collect all frames
 			char label[64];
 
@@ -586,7 +668,11 @@ static int producer_get_frame( mlt_producer parent, mlt_frame_ptr frame, int tra
 				if ( !done && !mlt_frame_is_test_audio( temp ) && !( mlt_properties_get_int( temp_properties, "hide" ) & 2 ) )
 				{
 					// Order of frame creation is starting to get problematic
-					if ( audio != NULL )
+					if ( audio_inputs != NULL )
+					{
+						mlt_deque_push_back( audio_inputs, temp );
+					}
+					else if ( audio != NULL )
 					{
 						mlt_deque_push_front( MLT_FRAME_AUDIO_STACK( temp ), producer_get_audio );
 						mlt_deque_push_front( MLT_FRAME_AUDIO_STACK( temp ), audio );
@@ -610,11 +696,21 @@ static int producer_get_frame( mlt_producer parent, mlt_frame_ptr frame, int tra
 			}
 
 			// Now stack callbacks
-			if ( audio != NULL )
+			if ( audio != NULL && audio_inputs != NULL )
+			{
+				mlt_properties_set_data( frame_properties, "_mix_audio", audio_inputs, 0, ( mlt_destructor )mlt_deque_close, NULL );
+				audio_inputs = NULL;
+				mlt_frame_push_audio( *frame, producer_get_audio_bus );
+			}
+			else if ( audio != NULL )
 			{
 				mlt_frame_push_audio( *frame, audio );
 				mlt_frame_push_audio( *frame, producer_get_audio );
 			}
+			else if ( audio_inputs != NULL )
+			{
+				mlt_deque_close( audio_inputs );
+			}
 
 			if ( video != NULL )
 			{
@@ -37,6 +37,8 @@
  * \properties \em global_feed a flag to indicate whether this tractor feeds to the consumer or stops here
  * \properties \em global_queue is something for the data_feed functionality in the core module
  * \properties \em data_queue is something for the data_feed functionality in the core module
+ * \properties \em mix_audio a flag to sum the audio of all tracks, each scaled by the track "gain", instead of taking the top track;
+ * audio transitions are bypassed while it is set
  */
 
 struct mlt_tractor_s
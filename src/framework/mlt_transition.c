@@ -318,9 +318,17 @@ double mlt_transition_get_progress_delta( mlt_transition self, mlt_frame frame )
 mlt_frame mlt_transition_process( mlt_transition self, mlt_frame a_frame, mlt_frame b_frame )
 {
 	if ( self->process == NULL )
+	{
 		return a_frame;
+	}
 	else
-		return self->process( self, a_frame, b_frame );
+	{
+		int depth = mlt_deque_count( MLT_FRAME_IMAGE_STACK( a_frame ) );
+		mlt_frame result = self->process( self, a_frame, b_frame );
+		if ( result == a_frame )
+			mlt_service_threading_guard( MLT_TRANSITION_SERVICE( self ), a_frame, depth );
+		return result;
+	}
 }
 
 static int get_image_a( mlt_frame a_frame, uint8_t **image, mlt_image_format *format, int *width, int *height, int writable )
@@ -486,6 +494,10 @@ static int transition_get_frame( mlt_service service, mlt_frame_ptr frame, int i
 			active = position >= in && ( out == 0 || position <= out );
 		}
 
+		// The tractor sums the audio of all tracks itself when it has an audio bus
+		if ( active && type == 2 && mlt_properties_get_int( MLT_FRAME_PROPERTIES( self->frames[ b_frame ] ), "_mix_audio" ) )
+			active = 0;
+
 		// Finally, process the a and b frames
 		if ( active && !mlt_properties_get_int( MLT_TRANSITION_PROPERTIES( self ), "disable" ) )
 		{
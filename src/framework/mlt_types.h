@@ -115,6 +115,16 @@ typedef enum
 }
 mlt_service_type;
 
+/** The threading contract of a service for frame-parallel rendering */
+
+typedef enum
+{
+	mlt_threading_stateless = 0, /**< frames may be processed concurrently and in any order */
+	mlt_threading_single,        /**< frames must be processed one at a time */
+	mlt_threading_ordered        /**< frames must be processed one at a time in the order they were made */
+}
+mlt_threading;
+
 /* I don't want to break anyone's applications without warning. -Zach */
 #ifdef DOUBLE_MLT_POSITION
 #define MLT_POSITION_FMT "%f"
@@ -170,6 +180,7 @@ typedef struct mlt_cache_s *mlt_cache;                  /**< pointer to Cache ob
 typedef struct mlt_cache_item_s *mlt_cache_item;        /**< pointer to CacheItem object */
 typedef struct mlt_animation_s *mlt_animation;          /**< pointer to Property Animation object */
 typedef struct mlt_slices_s *mlt_slices;                /**< pointer to Sliced processing context object */
+typedef struct mlt_analysis_s *mlt_analysis;            /**< pointer to Analysis object */
 
 typedef void ( *mlt_destructor )( void * );             /**< pointer to destructor function */
 typedef char *( *mlt_serialiser )( void *, int length );/**< pointer to serialization function */
@@ -38,6 +38,7 @@
 #include "MltProfile.h"
 #include "MltProperties.h"
 #include "MltPushConsumer.h"
+#include "MltRenderer.h"
 #include "MltRepository.h"
 #include "MltService.h"
 #include "MltTokeniser.h"
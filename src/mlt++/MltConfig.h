@@ -35,4 +35,8 @@
     #endif
 #endif
 
+#if __cplusplus >= 201103L || ( defined( _MSC_VER ) && _MSC_VER >= 1900 )
+    #define MLTPP_CXX11
+#endif
+
 #endif
@@ -44,6 +44,17 @@ namespace Mlt
 			Consumer( Consumer &consumer );
 			Consumer( mlt_consumer consumer );
 			virtual ~Consumer( );
+#ifdef MLTPP_CXX11
+			Consumer &operator=( const Consumer &consumer )
+			{
+				mlt_consumer other = const_cast< Consumer & >( consumer ).get_consumer( );
+				mlt_properties_inc_ref( mlt_consumer_properties( other ) );
+				Service::operator=( consumer );
+				mlt_consumer_close( instance );
+				instance = other;
+				return *this;
+			}
+#endif
 			virtual mlt_consumer get_consumer( );
 			mlt_service get_service( );
 			virtual int connect( Service &service );
@@ -41,6 +41,18 @@ namespace Mlt
 			Field( mlt_field field );
 			Field( Field &field );
 			virtual ~Field( );
+#ifdef MLTPP_CXX11
+			Field &operator=( const Field &field )
+			{
+				mlt_field other = const_cast< Field & >( field ).get_field( );
+				if ( other )
+					mlt_properties_inc_ref( mlt_field_properties( other ) );
+				Service::operator=( field );
+				mlt_field_close( instance );
+				instance = other;
+				return *this;
+			}
+#endif
 			mlt_field get_field( );
 			mlt_service get_service( );
 			int plant_filter( Filter &filter, int track = 0 );
@@ -43,6 +43,17 @@ namespace Mlt
 			Filter( Filter &filter );
 			Filter( mlt_filter filter );
 			virtual ~Filter( );
+#ifdef MLTPP_CXX11
+			Filter &operator=( const Filter &filter )
+			{
+				mlt_filter other = const_cast< Filter & >( filter ).get_filter( );
+				mlt_properties_inc_ref( mlt_filter_properties( other ) );
+				Service::operator=( filter );
+				mlt_filter_close( instance );
+				instance = other;
+				return *this;
+			}
+#endif
 			virtual mlt_filter get_filter( );
 			mlt_service get_service( );
 			int connect( Service &service, int index = 0 );
@@ -38,6 +38,7 @@ namespace Mlt
 	{
 		private:
 			Service *first;
+			FilteredConsumer &operator=( const FilteredConsumer & );
 		public:
 			FilteredConsumer( Profile& profile, const char *id, const char *arg = NULL );
 			FilteredConsumer( Consumer &consumer );
@@ -38,6 +38,7 @@ namespace Mlt
 	{
 		private:
 			Service *last;
+			FilteredProducer &operator=( const FilteredProducer & );
 		public:
 			FilteredProducer( Profile& profile, const char *id, const char *arg = NULL );
 			virtual ~FilteredProducer( );
@@ -24,27 +24,31 @@ using namespace Mlt;
 
 Frame::Frame() :
 	Mlt::Properties( (mlt_properties)NULL ),
-	instance( NULL )
+	instance( NULL ),
+	borrowed_( false )
 {
 }
 
 Frame::Frame( mlt_frame frame ) :
 	Mlt::Properties( (mlt_properties)NULL ),
-	instance( frame )
+	instance( frame ),
+	borrowed_( false )
 {
 	inc_ref( );
 }
 
 Frame::Frame( Frame &frame ) :
 	Mlt::Properties( (mlt_properties)NULL ),
-	instance( frame.instance )
+	instance( frame.instance ),
+	borrowed_( false )
 {
 	inc_ref( );
 }
 
 Frame::Frame( const Frame &frame ) :
 	Mlt::Properties( (mlt_properties)NULL ),
-	instance( frame.instance )
+	instance( frame.instance ),
+	borrowed_( false )
 {
 	inc_ref( );
 }
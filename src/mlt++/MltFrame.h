@@ -36,6 +36,9 @@ namespace Mlt
 	{
 		private:
 			mlt_frame instance;
+			bool borrowed_;
+			friend class FrameView;
+			friend class Service;
 		public:
 			Frame();
 			Frame( mlt_frame frame );
@@ -43,6 +46,33 @@ namespace Mlt
 			Frame( const Frame &frame );
 			virtual ~Frame( );
 			Frame& operator=( const Frame &frame );
+#ifdef MLTPP_CXX11
+			Frame( Frame &&frame ) noexcept :
+				Properties( false ),
+				instance( frame.instance ),
+				borrowed_( false )
+			{
+				// A view does not own its handle, so share it instead.
+				if ( frame.borrowed_ )
+					mlt_properties_inc_ref( MLT_FRAME_PROPERTIES( instance ) );
+				else
+					frame.instance = NULL;
+			}
+			Frame& operator=( Frame &&frame ) noexcept
+			{
+				if ( this != &frame )
+				{
+					mlt_frame other = frame.instance;
+					if ( frame.borrowed_ )
+						mlt_properties_inc_ref( MLT_FRAME_PROPERTIES( other ) );
+					else
+						frame.instance = NULL;
+					mlt_frame_close( instance );
+					instance = other;
+				}
+				return *this;
+			}
+#endif
 			virtual mlt_frame get_frame( );
 			mlt_properties get_properties( );
 			uint8_t *get_image( mlt_image_format &format, int &w, int &h, int writable = 0 );
@@ -55,6 +85,31 @@ namespace Mlt
 			int set_image( uint8_t *image, int size, mlt_destructor destroy );
 			int set_alpha( uint8_t *alpha, int size, mlt_destructor destroy );
 	};
+
+	/** A Frame that borrows a handle without adding a reference.
+	 *
+	 * This wraps the frame passed to an event listener or a callback without
+	 * an allocation or a reference count update. The handle must outlive the
+	 * view. A view cannot be copied, but constructing or assigning a Frame
+	 * from it, by copy or by move, takes a reference as usual.
+	 */
+
+	class FrameView : public Frame
+	{
+		private:
+			FrameView( const FrameView & );
+			FrameView &operator=( const FrameView & );
+		public:
+			explicit FrameView( mlt_frame frame )
+			{
+				Frame::instance = frame;
+				Frame::borrowed_ = true;
+			}
+			~FrameView( )
+			{
+				Frame::instance = NULL;
+			}
+	};
 }
 
 #endif
@@ -41,6 +41,17 @@ namespace Mlt
 			Multitrack( Service &multitrack );
 			Multitrack( Multitrack &multitrack );
 			virtual ~Multitrack( );
+#ifdef MLTPP_CXX11
+			Multitrack &operator=( const Multitrack &multitrack )
+			{
+				mlt_multitrack other = const_cast< Multitrack & >( multitrack ).get_multitrack( );
+				mlt_properties_inc_ref( mlt_multitrack_properties( other ) );
+				Producer::operator=( multitrack );
+				mlt_multitrack_close( instance );
+				instance = other;
+				return *this;
+			}
+#endif
 			mlt_multitrack get_multitrack( );
 			mlt_producer get_producer( );
 			int connect( Producer &producer, int index );
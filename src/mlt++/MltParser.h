@@ -41,6 +41,7 @@ namespace Mlt
 	{
 		private:
 			mlt_parser parser;
+			Parser &operator=( const Parser & );
 		public:
 			Parser( );
 			~Parser( );
@@ -66,6 +66,17 @@ namespace Mlt
 			Playlist( Playlist &playlist );
 			Playlist( mlt_playlist playlist );
 			virtual ~Playlist( );
+#ifdef MLTPP_CXX11
+			Playlist &operator=( const Playlist &playlist )
+			{
+				mlt_playlist other = const_cast< Playlist & >( playlist ).get_playlist( );
+				mlt_properties_inc_ref( mlt_playlist_properties( other ) );
+				Producer::operator=( playlist );
+				mlt_playlist_close( instance );
+				instance = other;
+				return *this;
+			}
+#endif
 			virtual mlt_playlist get_playlist( );
 			mlt_producer get_producer( );
 			int count( );
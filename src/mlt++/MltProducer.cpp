@@ -27,13 +27,15 @@ using namespace Mlt;
 
 Producer::Producer( ) :
 	instance( NULL ),
-	parent_( NULL )
+	parent_( NULL ),
+	borrowed_( false )
 {
 }
 
 Producer::Producer( Profile& profile, const char *id, const char *service ) :
 	instance( NULL ),
-	parent_( NULL )
+	parent_( NULL ),
+	borrowed_( false )
 {
 	if ( id != NULL && service != NULL )
 		instance = mlt_factory_producer( profile.get_profile(), id, service );
@@ -43,7 +45,8 @@ Producer::Producer( Profile& profile, const char *id, const char *service ) :
 
 Producer::Producer( Service &producer ) :
 	instance( NULL ),
-	parent_( NULL )
+	parent_( NULL ),
+	borrowed_( false )
 {
 	mlt_service_type type = producer.type( );
 	if ( type == producer_type || type == playlist_type || 
@@ -56,7 +59,8 @@ Producer::Producer( Service &producer ) :
 
 Producer::Producer( mlt_producer producer ) :
 	instance( producer ),
-	parent_( NULL )
+	parent_( NULL ),
+	borrowed_( false )
 {
 	inc_ref( );
 }
@@ -64,14 +68,16 @@ Producer::Producer( mlt_producer producer ) :
 Producer::Producer( Producer &producer ) :
 	Mlt::Service( producer ),
 	instance( producer.get_producer( ) ),
-	parent_( NULL )
+	parent_( NULL ),
+	borrowed_( false )
 {
 	inc_ref( );
 }
 
 Producer::Producer( Producer *producer ) :
 	instance( producer != NULL ? producer->get_producer( ) : NULL ),
-	parent_( NULL )
+	parent_( NULL ),
+	borrowed_( false )
 {
 	if ( is_valid( ) )
 		inc_ref( );
@@ -231,3 +237,8 @@ int Producer::clear( )
 {
 	return mlt_producer_clear( get_producer( ) );
 }
+
+int Producer::run_analysis( const char *filename, int threads )
+{
+	return mlt_analysis_run( get_producer( ), filename, threads );
+}
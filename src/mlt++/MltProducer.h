@@ -39,6 +39,8 @@ namespace Mlt
 		private:
 			mlt_producer instance;
 			Producer *parent_;
+			bool borrowed_;
+			friend class ProducerView;
 		public:
 			Producer( );
 			Producer( Profile& profile, const char *id, const char *service = NULL );
@@ -47,6 +49,60 @@ namespace Mlt
 			Producer( Producer &producer );
 			Producer( Producer *producer );
 			virtual ~Producer( );
+#ifdef MLTPP_CXX11
+			Producer( Producer &&producer ) noexcept :
+				instance( producer.instance ),
+				parent_( producer.parent_ ),
+				borrowed_( false )
+			{
+				// A subclass keeps its handle elsewhere and a view does not
+				// own its handle, so share those instead.
+				if ( instance && !producer.borrowed_ )
+				{
+					producer.instance = NULL;
+					producer.parent_ = NULL;
+				}
+				else
+				{
+					parent_ = NULL;
+					mlt_properties_inc_ref( mlt_producer_properties( instance = producer.get_producer( ) ) );
+				}
+			}
+			Producer &operator=( Producer &&producer ) noexcept
+			{
+				if ( this != &producer )
+				{
+					mlt_producer other = producer.instance;
+					Producer *parent = NULL;
+					if ( other && !producer.borrowed_ )
+					{
+						parent = producer.parent_;
+						producer.instance = NULL;
+						producer.parent_ = NULL;
+					}
+					else
+					{
+						mlt_properties_inc_ref( mlt_producer_properties( other = producer.get_producer( ) ) );
+					}
+					delete parent_;
+					parent_ = parent;
+					mlt_producer_close( instance );
+					instance = other;
+				}
+				return *this;
+			}
+			Producer &operator=( const Producer &producer )
+			{
+				mlt_producer other = const_cast< Producer & >( producer ).get_producer( );
+				mlt_properties_inc_ref( mlt_producer_properties( other ) );
+				Service::operator=( producer );
+				delete parent_;
+				parent_ = NULL;
+				mlt_producer_close( instance );
+				instance = other;
+				return *this;
+			}
+#endif
 			virtual mlt_producer get_producer( );
 			Producer &parent( );
 			mlt_producer get_parent( );
@@ -73,6 +129,33 @@ namespace Mlt
 			bool runs_into( Producer &that );
 			void optimise( );
 			int clear( );
+			int run_analysis( const char *filename, int threads = 1 );
+	};
+
+	/** A Producer that borrows a handle without adding a reference.
+	 *
+	 * This wraps a producer owned by someone else, such as a clip returned by
+	 * mlt_playlist_get_clip() or the producer of an event, without an
+	 * allocation or a reference count update. The handle must outlive the
+	 * view. A view cannot be copied, but constructing or assigning a
+	 * Producer from it, by copy or by move, takes a reference as usual.
+	 */
+
+	class ProducerView : public Producer
+	{
+		private:
+			ProducerView( const ProducerView & );
+			ProducerView &operator=( const ProducerView & );
+		public:
+			explicit ProducerView( mlt_producer producer )
+			{
+				Producer::instance = producer;
+				Producer::borrowed_ = true;
+			}
+			~ProducerView( )
+			{
+				Producer::instance = NULL;
+			}
 	};
 }
 
@@ -46,6 +46,39 @@ namespace Mlt
 			Properties( void *properties );
 			Properties( const char *file );
 			virtual ~Properties( );
+#ifdef MLTPP_CXX11
+			Properties( Properties &&properties ) noexcept :
+				instance( properties.instance )
+			{
+				// A subclass keeps its handle elsewhere, so share that instead.
+				if ( instance )
+					properties.instance = NULL;
+				else
+					mlt_properties_inc_ref( instance = properties.get_properties( ) );
+			}
+			Properties &operator=( Properties &&properties ) noexcept
+			{
+				if ( this != &properties )
+				{
+					mlt_properties other = properties.instance;
+					if ( other )
+						properties.instance = NULL;
+					else
+						mlt_properties_inc_ref( other = properties.get_properties( ) );
+					mlt_properties_close( instance );
+					instance = other;
+				}
+				return *this;
+			}
+			Properties &operator=( const Properties &properties )
+			{
+				mlt_properties other = const_cast< Properties & >( properties ).get_properties( );
+				mlt_properties_inc_ref( other );
+				mlt_properties_close( instance );
+				instance = other;
+				return *this;
+			}
+#endif
 			virtual mlt_properties get_properties( );
 			int inc_ref( );
 			int dec_ref( );
@@ -36,6 +36,7 @@ namespace Mlt
 	{
 		private:
 			PushPrivate *m_private;
+			PushConsumer &operator=( const PushConsumer & );
 		public:
 			PushConsumer( Profile& profile, const char *id , const char *service = NULL );
 			virtual ~PushConsumer( );
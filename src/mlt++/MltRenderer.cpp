@@ -0,0 +1,579 @@
+/**
+ * MltRenderer.cpp - MLT Wrapper
+ * Copyright (C) 2017 Meltytech, LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "MltRenderer.h"
+#include "MltFrame.h"
+#include "MltProducer.h"
+using namespace Mlt;
+
+namespace Mlt
+{
+	struct RendererJob
+	{
+		int ticket;
+		int position;
+		mlt_frame frame;
+	};
+
+	struct RendererList
+	{
+		RendererJob *items;
+		int count;
+		int size;
+	};
+
+	struct RendererWorker
+	{
+		RendererPrivate *owner;
+		mlt_producer producer;
+		pthread_t thread;
+		int started;
+		int ticket;
+		int position;
+	};
+
+	class RendererPrivate
+	{
+		public:
+			pthread_mutex_t mutex;
+			pthread_cond_t work_cond;
+			pthread_cond_t done_cond;
+			mlt_profile profile;
+			RendererWorker *workers;
+			int count;
+			RendererList jobs;
+			RendererList results;
+			int next_ticket;
+			int stop;
+			int width;
+			int height;
+			mlt_image_format format;
+			char *interpolation;
+			int deinterlace;
+			int video;
+			int audio;
+			int frequency;
+			int channels;
+			renderer_callback callback;
+			void *callback_data;
+
+			RendererPrivate( ) :
+				profile( NULL ),
+				workers( NULL ),
+				count( 0 ),
+				next_ticket( 0 ),
+				stop( 0 ),
+				width( 0 ),
+				height( 0 ),
+				format( mlt_image_yuv422 ),
+				interpolation( NULL ),
+				deinterlace( 1 ),
+				video( 1 ),
+				audio( 0 ),
+				frequency( 48000 ),
+				channels( 2 ),
+				callback( NULL ),
+				callback_data( NULL )
+			{
+				memset( &jobs, 0, sizeof( jobs ) );
+				memset( &results, 0, sizeof( results ) );
+				pthread_mutex_init( &mutex, NULL );
+				pthread_cond_init( &work_cond, NULL );
+				pthread_cond_init( &done_cond, NULL );
+			}
+
+			~RendererPrivate( )
+			{
+				free( jobs.items );
+				free( results.items );
+				free( interpolation );
+				pthread_cond_destroy( &done_cond );
+				pthread_cond_destroy( &work_cond );
+				pthread_mutex_destroy( &mutex );
+			}
+
+			int reserve( RendererList *list, int more )
+			{
+				if ( list->count + more > list->size )
+				{
+					int size = MAX( list->size * 2, list->count + more );
+					RendererJob *items = ( RendererJob * )realloc( list->items, size * sizeof( RendererJob ) );
+					if ( !items )
+						return 1;
+					list->items = items;
+					list->size = size;
+				}
+				return 0;
+			}
+
+			int find( RendererList *list, int ticket )
+			{
+				for ( int i = 0; i < list->count; i++ )
+					if ( list->items[ i ].ticket == ticket )
+						return i;
+				return -1;
+			}
+
+			void clear_results( )
+			{
+				for ( int i = 0; i < results.count; i++ )
+					mlt_frame_close( results.items[ i ].frame );
+				results.count = 0;
+			}
+
+			// Pick the pending job closest after the last position of the
+			// worker, so that each copy of the producer mostly reads forward.
+			int take_job( RendererWorker *worker )
+			{
+				int forward = -1;
+				int first = -1;
+				for ( int i = 0; i < jobs.count; i++ )
+				{
+					int position = jobs.items[ i ].position;
+					if ( position >= worker->position && ( forward < 0 || position < jobs.items[ forward ].position ) )
+						forward = i;
+					if ( first < 0 || position < jobs.items[ first ].position )
+						first = i;
+				}
+				int best = forward >= 0 ? forward : first;
+				if ( best >= 0 )
+				{
+					worker->ticket = jobs.items[ best ].ticket;
+					worker->position = jobs.items[ best ].position;
+					jobs.items[ best ] = jobs.items[ --jobs.count ];
+				}
+				return best >= 0;
+			}
+
+			bool is_outstanding( int ticket )
+			{
+				if ( find( &jobs, ticket ) >= 0 )
+					return true;
+				for ( int i = 0; i < count; i++ )
+					if ( workers[ i ].ticket == ticket )
+						return true;
+				return false;
+			}
+
+			int busy( )
+			{
+				int result = jobs.count;
+				for ( int i = 0; i < count; i++ )
+					result += workers[ i ].ticket >= 0;
+				return result;
+			}
+	};
+}
+
+/** Copy a producer with its filters through XML.
+ */
+
+static char *serialize_producer( mlt_producer producer )
+{
+	mlt_properties properties = MLT_PRODUCER_PROPERTIES( producer );
+	mlt_profile profile = mlt_service_profile( MLT_PRODUCER_SERVICE( producer ) );
+	mlt_consumer consumer = mlt_factory_consumer( profile, "xml", "string" );
+	char *title = mlt_properties_get( properties, "title" );
+	char *root = mlt_properties_get( properties, "root" );
+	char *xml = NULL;
+
+	if ( !consumer )
+		return NULL;
+
+	// The XML consumer sets these, so restore them.
+	title = title ? strdup( title ) : NULL;
+	root = root ? strdup( root ) : NULL;
+	mlt_properties_set_int( MLT_CONSUMER_PROPERTIES( consumer ), "no_meta", 1 );
+	mlt_consumer_connect( consumer, MLT_PRODUCER_SERVICE( producer ) );
+	mlt_consumer_start( consumer );
+	xml = mlt_properties_get( MLT_CONSUMER_PROPERTIES( consumer ), "string" );
+	xml = xml ? strdup( xml ) : NULL;
+	mlt_consumer_close( consumer );
+	mlt_properties_set( properties, "title", title );
+	mlt_properties_set( properties, "root", root );
+	free( title );
+	free( root );
+	return xml;
+}
+
+static void render_frame( RendererPrivate *self, RendererWorker *worker, mlt_frame *result )
+{
+	pthread_mutex_lock( &self->mutex );
+	mlt_image_format format = self->format;
+	int width = self->width > 0 ? self->width : self->profile->width;
+	int height = self->height > 0 ? self->height : self->profile->height;
+	char *interpolation = self->interpolation ? strdup( self->interpolation ) : NULL;
+	int deinterlace = self->deinterlace;
+	int video = self->video;
+	int audio = self->audio;
+	int frequency = self->frequency;
+	int channels = self->channels;
+	pthread_mutex_unlock( &self->mutex );
+
+	mlt_frame frame = NULL;
+	mlt_producer_seek( worker->producer, worker->position );
+	if ( mlt_service_get_frame( MLT_PRODUCER_SERVICE( worker->producer ), &frame, 0 ) || !frame )
+	{
+		free( interpolation );
+		*result = NULL;
+		return;
+	}
+
+	mlt_properties properties = MLT_FRAME_PROPERTIES( frame );
+	mlt_properties_set_int( properties, "consumer_deinterlace", deinterlace );
+	if ( interpolation )
+		mlt_properties_set( properties, "rescale.interp", interpolation );
+	if ( video )
+	{
+		uint8_t *image = NULL;
+		if ( mlt_frame_get_image( frame, &image, &format, &width, &height, 0 ) )
+			mlt_log_warning( MLT_PRODUCER_SERVICE( worker->producer ), "failed to render image at %d\n", worker->position );
+	}
+	if ( audio )
+	{
+		mlt_audio_format audio_format = mlt_audio_float;
+		int samples = mlt_sample_calculator( mlt_profile_fps( self->profile ), frequency, worker->position );
+		void *buffer = NULL;
+		if ( mlt_frame_get_audio( frame, &buffer, &audio_format, &frequency, &channels, &samples ) )
+			mlt_log_warning( MLT_PRODUCER_SERVICE( worker->producer ), "failed to render audio at %d\n", worker->position );
+	}
+	free( interpolation );
+	*result = frame;
+}
+
+static void *render_thread( void *arg )
+{
+	RendererWorker *worker = ( RendererWorker * )arg;
+	RendererPrivate *self = worker->owner;
+
+	pthread_mutex_lock( &self->mutex );
+	while ( !self->stop )
+	{
+		if ( !self->take_job( worker ) )
+		{
+			pthread_cond_wait( &self->work_cond, &self->mutex );
+			continue;
+		}
+		renderer_callback callback = self->callback;
+		void *callback_data = self->callback_data;
+		pthread_mutex_unlock( &self->mutex );
+
+		mlt_frame frame = NULL;
+		render_frame( self, worker, &frame );
+
+		// The ticket stays outstanding until the callback has returned.
+		if ( frame && callback )
+		{
+			Frame wrapper( frame );
+			callback( callback_data, worker->ticket, worker->position, wrapper );
+			mlt_frame_close( frame );
+			frame = NULL;
+		}
+
+		pthread_mutex_lock( &self->mutex );
+		if ( frame && !self->reserve( &self->results, 1 ) )
+		{
+			RendererJob *done = &self->results.items[ self->results.count++ ];
+			done->ticket = worker->ticket;
+			done->position = worker->position;
+			done->frame = frame;
+		}
+		else if ( frame )
+		{
+			mlt_frame_close( frame );
+		}
+		worker->ticket = -1;
+		pthread_cond_broadcast( &self->done_cond );
+	}
+	pthread_mutex_unlock( &self->mutex );
+	return NULL;
+}
+
+/** Start the threads that render a producer.
+ *
+ * The producer is copied for every thread, so that rendering never seeks it.
+ * When it cannot be copied (it does not load back from XML) no thread is
+ * started and is_valid() returns false.
+ *
+ * \param producer the producer to render
+ * \param threads the number of threads or 0 for one per CPU
+ */
+
+Renderer::Renderer( Producer &producer, int threads ) :
+	m_private( new RendererPrivate( ) )
+{
+	mlt_producer source = producer.get_producer( );
+	m_private->profile = source ? mlt_service_profile( MLT_PRODUCER_SERVICE( source ) ) : NULL;
+	if ( !m_private->profile )
+		return;
+
+	if ( threads <= 0 )
+		threads = mlt_slices_count_normal( );
+	threads = MAX( threads, 1 );
+	m_private->workers = ( RendererWorker * )calloc( threads, sizeof( RendererWorker ) );
+
+	char *xml = serialize_producer( source );
+	for ( int i = 0; xml && i < threads; i++ )
+	{
+		mlt_producer copy = mlt_factory_producer( m_private->profile, "xml-string", xml );
+		if ( !copy )
+			break;
+		m_private->workers[ m_private->count++ ].producer = copy;
+	}
+	free( xml );
+	if ( m_private->count == 0 )
+		mlt_log_error( MLT_PRODUCER_SERVICE( source ), "renderer could not copy the producer\n" );
+
+	for ( int i = 0; i < m_private->count; i++ )
+	{
+		RendererWorker *worker = &m_private->workers[ i ];
+		worker->owner = m_private;
+		worker->ticket = -1;
+		worker->started = !pthread_create( &worker->thread, NULL, render_thread, worker );
+	}
+}
+
+Renderer::~Renderer( )
+{
+	cancel( );
+	pthread_mutex_lock( &m_private->mutex );
+	m_private->stop = 1;
+	pthread_cond_broadcast( &m_private->work_cond );
+	pthread_mutex_unlock( &m_private->mutex );
+	for ( int i = 0; i < m_private->count; i++ )
+	{
+		if ( m_private->workers[ i ].started )
+			pthread_join( m_private->workers[ i ].thread, NULL );
+		mlt_producer_close( m_private->workers[ i ].producer );
+	}
+	free( m_private->workers );
+	delete m_private;
+}
+
+/** Determine if every thread has a copy of the producer and is running.
+ */
+
+bool Renderer::is_valid( )
+{
+	for ( int i = 0; i < m_private->count; i++ )
+		if ( !m_private->workers[ i ].started )
+			return false;
+	return m_private->count > 0;
+}
+
+int Renderer::threads( )
+{
+	return m_private->count;
+}
+
+/** Set the size of the images, which defaults to that of the profile.
+ */
+
+void Renderer::set_size( int width, int height )
+{
+	pthread_mutex_lock( &m_private->mutex );
+	m_private->width = width;
+	m_private->height = height;
+	pthread_mutex_unlock( &m_private->mutex );
+}
+
+void Renderer::set_format( mlt_image_format format )
+{
+	pthread_mutex_lock( &m_private->mutex );
+	m_private->format = format;
+	pthread_mutex_unlock( &m_private->mutex );
+}
+
+/** Set the "rescale.interp" of the frames, such as "nearest" for speed.
+ */
+
+void Renderer::set_interpolation( const char *interpolation )
+{
+	pthread_mutex_lock( &m_private->mutex );
+	free( m_private->interpolation );
+	m_private->interpolation = interpolation ? strdup( interpolation ) : NULL;
+	pthread_mutex_unlock( &m_private->mutex );
+}
+
+void Renderer::set_deinterlace( bool deinterlace )
+{
+	pthread_mutex_lock( &m_private->mutex );
+	m_private->deinterlace = deinterlace;
+	pthread_mutex_unlock( &m_private->mutex );
+}
+
+void Renderer::set_video( bool video )
+{
+	pthread_mutex_lock( &m_private->mutex );
+	m_private->video = video;
+	pthread_mutex_unlock( &m_private->mutex );
+}
+
+/** Also render the audio of each frame as float samples.
+ */
+
+void Renderer::set_audio( bool audio, int frequency, int channels )
+{
+	pthread_mutex_lock( &m_private->mutex );
+	m_private->audio = audio;
+	m_private->frequency = frequency;
+	m_private->channels = channels;
+	pthread_mutex_unlock( &m_private->mutex );
+}
+
+/** Pass the frames to a callback instead of keeping them for get().
+ *
+ * The callback runs on the rendering threads and applies to the frames
+ * that are rendered after it is set.
+ */
+
+void Renderer::set_callback( renderer_callback callback, void *data )
+{
+	pthread_mutex_lock( &m_private->mutex );
+	m_private->callback = callback;
+	m_private->callback_data = data;
+	pthread_mutex_unlock( &m_private->mutex );
+}
+
+/** Queue a position for rendering.
+ *
+ * \return the ticket of the frame
+ */
+
+int Renderer::render( int position )
+{
+	return render( &position, 1 );
+}
+
+/** Queue positions for rendering.
+ *
+ * Consecutive tickets are given to the positions in the order of the array.
+ *
+ * \return the ticket of the first position or -1 on error
+ */
+
+int Renderer::render( const int *positions, int count )
+{
+	if ( !is_valid( ) || !positions || count <= 0 )
+		return -1;
+
+	pthread_mutex_lock( &m_private->mutex );
+	if ( m_private->reserve( &m_private->jobs, count ) )
+	{
+		pthread_mutex_unlock( &m_private->mutex );
+		return -1;
+	}
+	int ticket = m_private->next_ticket;
+	for ( int i = 0; i < count; i++ )
+	{
+		RendererJob *job = &m_private->jobs.items[ m_private->jobs.count++ ];
+		job->ticket = m_private->next_ticket++;
+		job->position = positions[ i ];
+		job->frame = NULL;
+	}
+	pthread_cond_broadcast( &m_private->work_cond );
+	pthread_mutex_unlock( &m_private->mutex );
+	return ticket;
+}
+
+/** Determine if the frame of a ticket can be collected without waiting.
+ */
+
+bool Renderer::is_ready( int ticket )
+{
+	pthread_mutex_lock( &m_private->mutex );
+	bool result = m_private->find( &m_private->results, ticket ) >= 0;
+	pthread_mutex_unlock( &m_private->mutex );
+	return result;
+}
+
+/** Collect the frame of a ticket, waiting for it if needed.
+ *
+ * This must not be called from the callback.
+ * \return the frame, which the caller must delete, or NULL if the ticket was
+ * cancelled, already collected, given to the callback or failed to render
+ */
+
+Frame *Renderer::get( int ticket )
+{
+	Frame *result = NULL;
+	pthread_mutex_lock( &m_private->mutex );
+	while ( true )
+	{
+		int index = m_private->find( &m_private->results, ticket );
+		if ( index >= 0 )
+		{
+			RendererList *results = &m_private->results;
+			mlt_frame frame = results->items[ index ].frame;
+			results->items[ index ] = results->items[ --results->count ];
+			result = new Frame( frame );
+			mlt_frame_close( frame );
+			break;
+		}
+		if ( !m_private->is_outstanding( ticket ) )
+			break;
+		pthread_cond_wait( &m_private->done_cond, &m_private->mutex );
+	}
+	pthread_mutex_unlock( &m_private->mutex );
+	return result;
+}
+
+/** Get the number of positions that are queued or being rendered.
+ */
+
+int Renderer::pending( )
+{
+	pthread_mutex_lock( &m_private->mutex );
+	int result = m_private->busy( );
+	pthread_mutex_unlock( &m_private->mutex );
+	return result;
+}
+
+/** Wait until every queued position has been rendered.
+ *
+ * This must not be called from the callback.
+ */
+
+void Renderer::wait( )
+{
+	pthread_mutex_lock( &m_private->mutex );
+	while ( m_private->busy( ) )
+		pthread_cond_wait( &m_private->done_cond, &m_private->mutex );
+	pthread_mutex_unlock( &m_private->mutex );
+}
+
+/** Drop the queued positions and the uncollected frames.
+ *
+ * Frames that are being rendered are finished first, so this must not be
+ * called from the callback.
+ */
+
+void Renderer::cancel( )
+{
+	pthread_mutex_lock( &m_private->mutex );
+	m_private->jobs.count = 0;
+	while ( m_private->busy( ) )
+		pthread_cond_wait( &m_private->done_cond, &m_private->mutex );
+	m_private->clear_results( );
+	pthread_cond_broadcast( &m_private->done_cond );
+	pthread_mutex_unlock( &m_private->mutex );
+}
@@ -0,0 +1,78 @@
+/**
+ * MltRenderer.h - MLT Wrapper
+ * Copyright (C) 2017 Meltytech, LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef MLTPP_RENDERER_H
+#define MLTPP_RENDERER_H
+
+#include "MltConfig.h"
+
+#include <framework/mlt.h>
+
+namespace Mlt
+{
+	class Frame;
+	class Producer;
+	class RendererPrivate;
+
+	/** Called on a worker thread for each rendered frame.
+	 *
+	 * The frame is only valid during the call; copy it to keep it. The
+	 * ticket stays outstanding while the callback runs, so calling get(),
+	 * wait() or cancel() of the renderer from the callback deadlocks.
+	 */
+	typedef void ( *renderer_callback )( void *data, int ticket, int position, Frame &frame );
+
+	/** Render frames of a producer at arbitrary positions on a pool of threads.
+	 *
+	 * Each thread renders from its own copy of the producer, so the producer
+	 * given to the constructor is never seeked. Every requested position gets
+	 * a ticket; the rendered frame is either passed to the callback or kept
+	 * until it is collected with get(). The frames carry their image (and
+	 * audio, if enabled) already converted and scaled, so calling get_image()
+	 * on them with the same format returns at once.
+	 */
+	class MLTPP_DECLSPEC Renderer
+	{
+		private:
+			RendererPrivate *m_private;
+			Renderer( const Renderer & );
+			Renderer &operator=( const Renderer & );
+		public:
+			Renderer( Producer &producer, int threads = 0 );
+			virtual ~Renderer( );
+			bool is_valid( );
+			int threads( );
+			void set_size( int width, int height );
+			void set_format( mlt_image_format format );
+			void set_interpolation( const char *interpolation );
+			void set_deinterlace( bool deinterlace );
+			void set_video( bool video );
+			void set_audio( bool audio, int frequency = 48000, int channels = 2 );
+			void set_callback( renderer_callback callback, void *data = NULL );
+			int render( int position );
+			int render( const int *positions, int count );
+			bool is_ready( int ticket );
+			Frame *get( int ticket );
+			int pending( );
+			void wait( );
+			void cancel( );
+	};
+}
+
+#endif
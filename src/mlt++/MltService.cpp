@@ -118,6 +118,22 @@ Frame *Service::get_frame( int index )
 	return result;
 }
 
+/** Get a frame into an existing Frame, replacing its previous frame.
+ *
+ * Unlike the other get_frame() this neither allocates a wrapper nor
+ * updates the reference count of the new frame. The Frame must not be a
+ * FrameView.
+ */
+
+int Service::get_frame( Frame &frame, int index )
+{
+	mlt_frame result = NULL;
+	int error = mlt_service_get_frame( get_service( ), &result, index );
+	mlt_frame_close( frame.instance );
+	frame.instance = result;
+	return error;
+}
+
 mlt_service_type Service::type( )
 {
 	return mlt_service_identify( get_service( ) );
@@ -44,6 +44,39 @@ namespace Mlt
 			Service( Service &service );
 			Service( mlt_service service );
 			virtual ~Service( );
+#ifdef MLTPP_CXX11
+			Service( Service &&service ) noexcept :
+				Properties( false ),
+				instance( service.instance )
+			{
+				if ( instance )
+					service.instance = NULL;
+				else
+					mlt_properties_inc_ref( mlt_service_properties( instance = service.get_service( ) ) );
+			}
+			Service &operator=( Service &&service ) noexcept
+			{
+				if ( this != &service )
+				{
+					mlt_service other = service.instance;
+					if ( other )
+						service.instance = NULL;
+					else
+						mlt_properties_inc_ref( mlt_service_properties( other = service.get_service( ) ) );
+					mlt_service_close( instance );
+					instance = other;
+				}
+				return *this;
+			}
+			Service &operator=( const Service &service )
+			{
+				mlt_service other = const_cast< Service & >( service ).get_service( );
+				mlt_properties_inc_ref( mlt_service_properties( other ) );
+				mlt_service_close( instance );
+				instance = other;
+				return *this;
+			}
+#endif
 			virtual mlt_service get_service( );
 			void lock( );
 			void unlock( );
@@ -57,6 +90,7 @@ namespace Mlt
 			Profile *profile( );
 			mlt_profile get_profile( );
 			Frame *get_frame( int index = 0 );
+			int get_frame( Frame &frame, int index = 0 );
 			mlt_service_type type( );
 			int attach( Filter &filter );
 			int detach( Filter &filter );
@@ -48,6 +48,17 @@ namespace Mlt
 			Tractor( Tractor &tractor );
 			Tractor( Profile& profile, char *id, char *arg = NULL );
 			virtual ~Tractor( );
+#ifdef MLTPP_CXX11
+			Tractor &operator=( const Tractor &tractor )
+			{
+				mlt_tractor other = const_cast< Tractor & >( tractor ).get_tractor( );
+				mlt_properties_inc_ref( mlt_tractor_properties( other ) );
+				Producer::operator=( tractor );
+				mlt_tractor_close( instance );
+				instance = other;
+				return *this;
+			}
+#endif
 			virtual mlt_tractor get_tractor( );
 			mlt_producer get_producer( );
 			Multitrack *multitrack( );
@@ -42,6 +42,17 @@ namespace Mlt
 			Transition( Transition &transition );
 			Transition( mlt_transition transition );
 			virtual ~Transition( );
+#ifdef MLTPP_CXX11
+			Transition &operator=( const Transition &transition )
+			{
+				mlt_transition other = const_cast< Transition & >( transition ).get_transition( );
+				mlt_properties_inc_ref( mlt_transition_properties( other ) );
+				Service::operator=( transition );
+				mlt_transition_close( instance );
+				instance = other;
+				return *this;
+			}
+#endif
 			virtual mlt_transition get_transition( );
 			mlt_service get_service( );
 			void set_in_and_out( int in, int out );
@@ -0,0 +1,4 @@
+soversion=3
+LIBSUF=.so
+CXXFLAGS+=-Wall -W -Wwrite-strings -Wcast-qual -Wpointer-arith -Wcast-align -Wredundant-decls -fPIC -DPIC
+LIBFLAGS=-shared
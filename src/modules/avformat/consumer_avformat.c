@@ -1107,7 +1107,7 @@ static void *consumer_thread( void *arg )
 	int terminated = 0;
 
 	// Determine if feed is slow (for realtime stuff)
-	int real_time_output = mlt_properties_get_int( properties, "real_time" );
+	int real_time_output = mlt_consumer_real_time( consumer );
 
 	// Time structures
 	struct timeval ante;
@@ -30,6 +30,7 @@ extern mlt_filter filter_avdeinterlace_init( void *arg );
 extern mlt_filter filter_avresample_init( char *arg );
 extern mlt_filter filter_swscale_init( mlt_profile profile, char *arg );
 extern mlt_producer producer_avformat_init( mlt_profile profile, const char *service, char *file );
+extern mlt_producer producer_avformat_probe_init( mlt_profile profile, const char *list );
 extern mlt_filter filter_avfilter_init( mlt_profile, mlt_service_type, const char*, char* );
 
 // ffmpeg Header files
@@ -110,6 +111,8 @@ static void *create_service( mlt_profile profile, mlt_service_type type, const c
 {
 	avformat_init( );
 #ifdef CODECS
+	if ( !strcmp( id, "avformat-probe" ) )
+		return producer_avformat_probe_init( profile, arg );
 	if ( !strncmp( id, "avformat", 8 ) )
 	{
 		if ( type == producer_type )
@@ -402,6 +405,7 @@ MLT_REPOSITORY
 	MLT_REGISTER( consumer_type, "avformat", create_service );
 	MLT_REGISTER( producer_type, "avformat", create_service );
 	MLT_REGISTER( producer_type, "avformat-novalidate", create_service );
+	MLT_REGISTER( producer_type, "avformat-probe", create_service );
 	MLT_REGISTER_METADATA( consumer_type, "avformat", avformat_metadata, NULL );
 	MLT_REGISTER_METADATA( producer_type, "avformat", avformat_metadata, NULL );
 #endif
@@ -0,0 +1,250 @@
+/*
+ * probe_cache.c -- persistent media probe cache for the avformat producer
+ * Copyright (C) 2017 Meltytech, LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "probe_cache.h"
+
+#include <framework/mlt_log.h>
+#include <framework/mlt_factory.h>
+#include <framework/mlt_producer.h>
+#include <framework/mlt_slices.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <limits.h>
+
+/** Get the cache directory or NULL if the cache is disabled.
+*/
+
+const char *probe_cache_directory( )
+{
+	const char *directory = getenv( "MLT_AVFORMAT_PROBE_CACHE" );
+	return directory && strcmp( directory, "" ) ? directory : NULL;
+}
+
+static char *entry_filename( const char *resource, const char *suffix )
+{
+	const char *directory = probe_cache_directory();
+	unsigned long long hash = 0xcbf29ce484222325ULL;
+	const char *s = resource;
+
+	if ( !directory || !resource )
+		return NULL;
+
+	// FNV-1a
+	while ( *s )
+	{
+		hash ^= ( unsigned char ) *s++;
+		hash *= 0x100000001b3ULL;
+	}
+	size_t n = strlen( directory ) + strlen( suffix ) + 30;
+	char *filename = malloc( n );
+	snprintf( filename, n, "%s/%016llx.yml%s", directory, hash, suffix );
+	return filename;
+}
+
+/** Set the identity of a cache entry.
+ *
+ * An entry is only valid for the same path, size and modification time,
+ * and for the same frame rate because the durations are computed in frames.
+ * \return true if the resource is not a local file
+ */
+
+static int set_identity( mlt_properties entry, const char *resource, mlt_profile profile )
+{
+	struct stat st;
+	if ( stat( resource, &st ) || !S_ISREG( st.st_mode ) )
+		return 1;
+	mlt_properties_set( entry, "identity.resource", resource );
+	mlt_properties_set_int64( entry, "identity.size", st.st_size );
+	mlt_properties_set_int64( entry, "identity.mtime", st.st_mtime );
+	mlt_properties_set_int( entry, "identity.frame_rate_num", profile->frame_rate_num );
+	mlt_properties_set_int( entry, "identity.frame_rate_den", profile->frame_rate_den );
+	return 0;
+}
+
+static int identity_matches( mlt_properties entry, mlt_properties expected )
+{
+	static const char *names[] = { "identity.resource", "identity.size", "identity.mtime",
+		"identity.frame_rate_num", "identity.frame_rate_den", NULL };
+	int i;
+	for ( i = 0; names[i]; i++ )
+	{
+		const char *a = mlt_properties_get( entry, names[i] );
+		const char *b = mlt_properties_get( expected, names[i] );
+		if ( !a || !b || strcmp( a, b ) )
+			return 0;
+	}
+	return 1;
+}
+
+/** Load the cached probe results of a resource.
+ *
+ * \return the properties, which the caller must close, or NULL on a miss
+ */
+
+mlt_properties probe_cache_load( const char *resource, mlt_profile profile )
+{
+	char *filename = entry_filename( resource, "" );
+	mlt_properties entry = NULL;
+
+	if ( filename && !access( filename, R_OK ) )
+	{
+		mlt_properties expected = mlt_properties_new();
+		if ( !set_identity( expected, resource, profile ) )
+		{
+			entry = mlt_properties_parse_yaml( filename );
+			if ( entry && !identity_matches( entry, expected ) )
+			{
+				mlt_log_debug( NULL, "[producer avformat] stale probe cache entry %s\n", filename );
+				mlt_properties_close( entry );
+				entry = NULL;
+			}
+		}
+		mlt_properties_close( expected );
+	}
+	free( filename );
+	return entry;
+}
+
+/** Save the probe results of a resource.
+ *
+ * The entry is written to a temporary file first so that concurrent readers
+ * never see a partial entry.
+ * \return true if there was an error
+ */
+
+int probe_cache_save( const char *resource, mlt_profile profile, mlt_properties entry )
+{
+	char *filename = entry_filename( resource, "" );
+	char *temp = entry_filename( resource, ".tmp" );
+	int error = 1;
+
+	if ( filename && !set_identity( entry, resource, profile ) )
+	{
+		char *yaml = mlt_properties_serialise_yaml( entry );
+		FILE *f = fopen( temp, "w" );
+		if ( yaml && f )
+		{
+			error = fputs( yaml, f ) < 0;
+			error = fclose( f ) || error;
+			f = NULL;
+			if ( !error )
+				error = rename( temp, filename );
+			if ( error )
+				remove( temp );
+		}
+		if ( f )
+			fclose( f );
+		if ( error )
+			mlt_log_warning( NULL, "[producer avformat] failed to save probe cache entry %s\n", filename );
+		free( yaml );
+	}
+	free( filename );
+	free( temp );
+	return error;
+}
+
+/** Add a result found after opening, such as the first time stamp, to an existing entry.
+*/
+
+int probe_cache_update( const char *resource, mlt_profile profile, const char *name, const char *value )
+{
+	mlt_properties entry = probe_cache_load( resource, profile );
+	int error = 1;
+	if ( entry )
+	{
+		mlt_properties_set( entry, name, value );
+		error = probe_cache_save( resource, profile, entry );
+		mlt_properties_close( entry );
+	}
+	return error;
+}
+
+static int warm_probe_job( int id, int idx, int jobs, void *cookie )
+{
+	mlt_properties list = cookie;
+	mlt_profile profile = mlt_properties_get_data( list, "_profile", NULL );
+	int count = mlt_properties_count( list ) - 1;
+	int i;
+
+	for ( i = idx; i < count; i += jobs )
+	{
+		mlt_producer producer = mlt_factory_producer( profile, "avformat", mlt_properties_get_value( list, i + 1 ) );
+		mlt_producer_close( producer );
+	}
+	return 0;
+}
+
+/** Create the avformat-probe producer, which fills the probe cache.
+ *
+ * Every file named in a text file, one per line, is opened with the avformat
+ * producer, which saves its probe results. The files are probed in parallel
+ * because probing is mostly latency bound on network storage. The producer
+ * that is returned only reports the number of files in "probe_count".
+ * \param list the name of the text file
+ * \return the producer or NULL if the cache is disabled or the list cannot be read
+ */
+
+mlt_producer producer_avformat_probe_init( mlt_profile profile, const char *list )
+{
+	mlt_properties resources = NULL;
+	mlt_producer producer = NULL;
+	FILE *f = NULL;
+	char line[ PATH_MAX + 2 ];
+	int count = 0;
+
+	if ( !probe_cache_directory() )
+	{
+		mlt_log_warning( NULL, "[producer avformat-probe] MLT_AVFORMAT_PROBE_CACHE is not set\n" );
+		return NULL;
+	}
+	if ( !list || !( f = fopen( list, "r" ) ) )
+	{
+		mlt_log_warning( NULL, "[producer avformat-probe] unable to read %s\n", list ? list : "" );
+		return NULL;
+	}
+
+	resources = mlt_properties_new();
+	mlt_properties_set_data( resources, "_profile", profile, 0, NULL, NULL );
+	while ( fgets( line, sizeof( line ), f ) )
+	{
+		char key[20];
+		line[ strcspn( line, "\r\n" ) ] = '\0';
+		if ( !strcmp( line, "" ) )
+			continue;
+		snprintf( key, sizeof(key), "%d", count++ );
+		mlt_properties_set( resources, key, line );
+	}
+	fclose( f );
+	if ( count )
+		mlt_slices_run_normal( count < mlt_slices_count_normal() ? count : 0, warm_probe_job, resources );
+	mlt_properties_close( resources );
+
+	producer = mlt_producer_new( profile );
+	if ( producer )
+	{
+		mlt_properties_set( MLT_PRODUCER_PROPERTIES( producer ), "resource", list );
+		mlt_properties_set_int( MLT_PRODUCER_PROPERTIES( producer ), "probe_count", count );
+	}
+	return producer;
+}
@@ -0,0 +1,32 @@
+/*
+ * probe_cache.h -- persistent media probe cache for the avformat producer
+ * Copyright (C) 2017 Meltytech, LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef PROBE_CACHE_H
+#define PROBE_CACHE_H
+
+#include <framework/mlt_properties.h>
+#include <framework/mlt_profile.h>
+
+extern const char *probe_cache_directory( );
+extern mlt_properties probe_cache_load( const char *resource, mlt_profile profile );
+extern int probe_cache_save( const char *resource, mlt_profile profile, mlt_properties entry );
+extern int probe_cache_update( const char *resource, mlt_profile profile, const char *name, const char *value );
+extern mlt_producer producer_avformat_probe_init( mlt_profile profile, const char *list );
+
+#endif
@@ -27,6 +27,9 @@
 #include <framework/mlt_cache.h>
 #include <framework/mlt_slices.h>
 
+#include "seek_index.h"
+#include "probe_cache.h"
+
 // ffmpeg Header files
 #include <libavformat/avformat.h>
 #include <libswscale/swscale.h>
@@ -136,6 +139,7 @@ struct producer_avformat_s
 #endif
 	int autorotate;
 	int is_audio_synchronizing;
+	seek_index seek_index;
 };
 typedef struct producer_avformat_s *producer_avformat;
 
@@ -152,6 +156,8 @@ static int video_codec_init( producer_avformat self, int index, mlt_properties p
 static void get_audio_streams_info( producer_avformat self );
 static mlt_audio_format pick_audio_format( int sample_fmt );
 static int pick_av_pixel_format( int *pix_fmt );
+static int load_probe_cache( producer_avformat self, mlt_profile profile );
+static void save_probe_cache( producer_avformat self, mlt_profile profile );
 
 #ifdef VDPAU
 #include "vdpau.c"
@@ -197,16 +203,21 @@ mlt_producer producer_avformat_init( mlt_profile profile, const char *service, c
 
 			if ( strcmp( service, "avformat-novalidate" ) )
 			{
+				// Use the results of a previous probe if available - open later as needed
+				int cached = load_probe_cache( self, profile );
+
 				// Open the file
-				if ( producer_open( self, profile, mlt_properties_get( properties, "resource" ), 1, 1 ) != 0 )
+				if ( !cached && producer_open( self, profile, mlt_properties_get( properties, "resource" ), 1, 1 ) != 0 )
 				{
 					// Clean up
 					mlt_producer_close( producer );
 					producer = NULL;
 					producer_avformat_close( self );
 				}
-				else if ( self->seekable )
+				else if ( !cached && self->seekable )
 				{
+					save_probe_cache( self, profile );
+
 					// Close the file to release resources for large playlists - reopen later as needed
 					if ( self->audio_format )
 						avformat_close_input( &self->audio_format );
@@ -271,6 +282,89 @@ int list_components( char* file )
 	return skip;
 }
 
+/** The names of the producer properties that get_basic_info() and
+ * find_default_streams() set, or prefixes thereof when ending with a dot.
+ */
+
+static const char *probed_properties[] =
+{
+	"meta.", "width", "height", "aspect_ratio", "length", "out", "seekable", "eof", NULL
+};
+
+static int is_probed_property( const char *name )
+{
+	int i;
+	for ( i = 0; probed_properties[i]; i++ )
+	{
+		size_t n = strlen( probed_properties[i] );
+		if ( probed_properties[i][n - 1] == '.' ? !strncmp( name, probed_properties[i], n ) : !strcmp( name, probed_properties[i] ) )
+			return 1;
+	}
+	return 0;
+}
+
+/** Set the properties of a producer from the probe cache instead of probing.
+ *
+ * \return true if there was a cache hit
+ */
+
+static int load_probe_cache( producer_avformat self, mlt_profile profile )
+{
+	mlt_properties properties = MLT_PRODUCER_PROPERTIES( self->parent );
+	mlt_properties entry = probe_cache_load( mlt_properties_get( properties, "resource" ), profile );
+	int i;
+
+	if ( !entry )
+		return 0;
+	for ( i = 0; i < mlt_properties_count( entry ); i++ )
+	{
+		const char *name = mlt_properties_get_name( entry, i );
+		if ( is_probed_property( name ) )
+		{
+			mlt_properties_set( properties, name, mlt_properties_get_value( entry, i ) );
+		}
+		else if ( !strncmp( name, "first_pts.", 10 ) )
+		{
+			// Private copies of the first time stamp per video stream
+			char key[30];
+			snprintf( key, sizeof(key), "_%s", name );
+			mlt_properties_set( properties, key, mlt_properties_get_value( entry, i ) );
+		}
+	}
+	self->audio_index = mlt_properties_get_int( entry, "audio_index" );
+	self->video_index = mlt_properties_get_int( entry, "video_index" );
+	self->seekable = mlt_properties_get_int( entry, "seekable" );
+	mlt_properties_set_int( properties, "_seekable_tested", 1 );
+	mlt_properties_close( entry );
+	mlt_log_debug( MLT_PRODUCER_SERVICE(self->parent), "probe cache hit\n" );
+	return 1;
+}
+
+/** Save the results of probing a local file to the probe cache.
+*/
+
+static void save_probe_cache( producer_avformat self, mlt_profile profile )
+{
+	mlt_properties properties = MLT_PRODUCER_PROPERTIES( self->parent );
+	mlt_properties entry;
+	int i;
+
+	if ( !probe_cache_directory() )
+		return;
+	entry = mlt_properties_new();
+	for ( i = 0; i < mlt_properties_count( properties ); i++ )
+	{
+		const char *name = mlt_properties_get_name( properties, i );
+		const char *value = mlt_properties_get_value( properties, i );
+		if ( value && is_probed_property( name ) )
+			mlt_properties_set( entry, name, value );
+	}
+	mlt_properties_set_int( entry, "audio_index", self->audio_index );
+	mlt_properties_set_int( entry, "video_index", self->video_index );
+	probe_cache_save( mlt_properties_get( properties, "resource" ), profile, entry );
+	mlt_properties_close( entry );
+}
+
 static int first_video_index( producer_avformat self )
 {
 	AVFormatContext *context = self->video_format? self->video_format : self->audio_format;
@@ -646,11 +740,17 @@ static int get_basic_info( producer_avformat self, mlt_profile profile, const ch
 		// protocols can indicate if they support seeking
 		self->seekable = format->pb->seekable;
 	}
-	if ( self->seekable )
+	if ( self->seekable && mlt_properties_get_int( properties, "_seekable_tested" ) )
+	{
+		// Already tested when first opened or by a cached probe
+		self->seekable = mlt_properties_get_int( properties, "seekable" );
+	}
+	else if ( self->seekable )
 	{
 		// Do a more rigourous test of seekable on a disposable context
 		self->seekable = av_seek_frame( format, -1, format->start_time, AVSEEK_FLAG_BACKWARD ) >= 0;
 		mlt_properties_set_int( properties, "seekable", self->seekable );
+		mlt_properties_set_int( properties, "_seekable_tested", 1 );
 		self->dummy_context = format;
 		self->video_format = NULL;
 		avformat_open_input( &self->video_format, filename, NULL, NULL );
@@ -964,9 +1064,19 @@ static void find_first_pts( producer_avformat self, int video_index )
 {
 	// find initial PTS
 	AVFormatContext *context = self->video_format? self->video_format : self->audio_format;
+	mlt_properties properties = MLT_PRODUCER_PROPERTIES( self->parent );
 	int ret = 0;
 	int toscan = 500;
 	AVPacket pkt;
+	char key[30];
+
+	// Use the result of a previous scan if available
+	snprintf( key, sizeof(key), "_first_pts.%d", video_index );
+	if ( mlt_properties_get( properties, key ) )
+	{
+		self->first_pts = mlt_properties_get_int64( properties, key );
+		return;
+	}
 
 	av_init_packet( &pkt );
 	while ( ret >= 0 && toscan-- > 0 )
@@ -994,6 +1104,102 @@ static void find_first_pts( producer_avformat self, int video_index )
 		av_free_packet( &pkt );
 	}
 	av_seek_frame( context, -1, 0, AVSEEK_FLAG_BACKWARD );
+
+	mlt_properties_set_int64( properties, key, self->first_pts );
+	if ( self->seekable && probe_cache_directory() )
+		probe_cache_update( mlt_properties_get( properties, "resource" ),
+			mlt_service_profile( MLT_PRODUCER_SERVICE( self->parent ) ), key + 1, mlt_properties_get( properties, key ) );
+}
+
+/** Scan the video stream to build the keyframe index.
+*/
+
+static seek_index build_seek_index( producer_avformat self, AVFormatContext *context )
+{
+	seek_index index = seek_index_init();
+	int packets = 0;
+	AVPacket pkt;
+
+	av_init_packet( &pkt );
+	while ( av_read_frame( context, &pkt ) >= 0 )
+	{
+		if ( pkt.stream_index == self->video_index )
+		{
+			int64_t pts = pkt.pts != AV_NOPTS_VALUE ? pkt.pts : pkt.dts;
+			++packets;
+			if ( pts != AV_NOPTS_VALUE )
+				seek_index_append( index, pts, pkt.pos, pkt.flags & AV_PKT_FLAG_KEY );
+		}
+		av_free_packet( &pkt );
+	}
+	av_seek_frame( context, -1, 0, AVSEEK_FLAG_BACKWARD );
+	seek_index_finish( index );
+
+	// An index with too many holes is worse than none.
+	if ( !index->key_count || index->frame_count < packets * 9 / 10 )
+	{
+		mlt_log_verbose( MLT_PRODUCER_SERVICE(self->parent), "unable to index %d of %d video packets\n",
+			packets - index->frame_count, packets );
+		seek_index_close( index );
+		index = NULL;
+	}
+	return index;
+}
+
+/** Get the keyframe index, loading or building it as needed.
+ *
+ * The index is kept on the producer so it survives the closing of
+ * this producer_avformat by the service cache.
+ */
+
+static seek_index get_seek_index( producer_avformat self, AVFormatContext *context )
+{
+	mlt_properties properties = MLT_PRODUCER_PROPERTIES( self->parent );
+
+	if ( !self->seek_index && mlt_properties_get_int( properties, "seek_index" )
+		 && !mlt_properties_get_int( properties, "_seek_index_failed" ) )
+	{
+		const char *resource = mlt_properties_get( properties, "resource" );
+		const char *directory = mlt_properties_get( properties, "seek_index.directory" );
+		if ( !directory )
+			directory = getenv( "MLT_AVFORMAT_INDEX_DIR" );
+		char *filename = seek_index_filename( directory, resource, self->video_index );
+
+		self->seek_index = mlt_properties_get_data( properties, "_seek_index", NULL );
+		if ( !self->seek_index )
+		{
+			self->seek_index = seek_index_load( filename, resource );
+			if ( !self->seek_index )
+			{
+				self->seek_index = build_seek_index( self, context );
+				if ( self->seek_index )
+					seek_index_save( self->seek_index, filename, resource );
+				else
+					mlt_properties_set_int( properties, "_seek_index_failed", 1 );
+			}
+			if ( self->seek_index )
+				mlt_properties_set_data( properties, "_seek_index", self->seek_index, 0, (mlt_destructor) seek_index_close, NULL );
+		}
+		free( filename );
+	}
+	return self->seek_index;
+}
+
+/** Seek to a keyframe using the index.
+*/
+
+static void seek_video_indexed( producer_avformat self, AVFormatContext *context, const seek_index_key *key )
+{
+	// Like ffplay, prefer byte seeking for formats with discontinuous time stamps.
+	int by_bytes = key->pos >= 0 && context->iformat
+		&& ( context->iformat->flags & AVFMT_TS_DISCONT )
+		&& !( context->iformat->flags & AVFMT_NO_BYTE_SEEK )
+		&& strcmp( context->iformat->name, "ogg" );
+
+	mlt_log_debug( MLT_PRODUCER_SERVICE(self->parent), "seeking keyframe pts %"PRId64" pos %"PRId64"\n",
+		key->pts, key->pos );
+	if ( !by_bytes || av_seek_frame( context, self->video_index, key->pos, AVSEEK_FLAG_BYTE ) < 0 )
+		av_seek_frame( context, self->video_index, key->pts, AVSEEK_FLAG_BACKWARD );
 }
 
 static int seek_video( producer_avformat self, mlt_position position,
@@ -1026,11 +1232,32 @@ static int seek_video( producer_avformat self, mlt_position position,
 		if ( self->last_position == POSITION_INITIAL )
 			find_first_pts( self, self->video_index );
 
+		seek_index index = get_seek_index( self, context );
+		const seek_index_key *key = NULL;
+		if ( index )
+		{
+			key = seek_index_keyframe( index, seek_index_frame_pts( index, req_position ), preseek );
+
+			// Reading forward is cheaper unless there is a keyframe in between.
+			if ( position > self->video_expected && self->last_position >= 0 )
+				seek_threshold = key->pts > seek_index_frame_pts( index, self->last_position ) ? 1 : INT_MAX;
+		}
+
 		if ( self->video_frame && position + 1 == self->video_expected )
 		{
 			// We're paused - use last image
 			paused = 1;
 		}
+		else if ( self->seekable && key && ( position < self->video_expected || position - self->video_expected >= seek_threshold || self->last_position < 0 ) )
+		{
+			// Seek directly to the keyframe preceding the requested frame
+			codec_context->skip_loop_filter = AVDISCARD_NONREF;
+			seek_video_indexed( self, context, key );
+			avcodec_flush_buffers( codec_context );
+			self->current_position = POSITION_INVALID;
+			self->last_position = POSITION_INVALID;
+			av_freep( &self->video_frame );
+		}
 		else if ( self->seekable && ( position < self->video_expected || position - self->video_expected >= seek_threshold || self->last_position < 0 ) )
 		{
 			// Calculate the timestamp for the requested frame
@@ -1773,11 +2000,16 @@ static int producer_get_image( mlt_frame frame, uint8_t **buffer, mlt_image_form
 				{
 					if ( !self->seekable && self->first_pts == AV_NOPTS_VALUE )
 						self->first_pts = pts;
-					if ( self->first_pts != AV_NOPTS_VALUE )
-						pts -= self->first_pts;
-					else if ( context->start_time != AV_NOPTS_VALUE )
-						pts -= context->start_time;
-					int_position = ( int64_t )( ( av_q2d( self->video_time_base ) * pts + delay ) * source_fps + 0.5 );
+					if ( self->seek_index && !delay )
+						int_position = seek_index_pts_frame( self->seek_index, pts );
+					else
+					{
+						if ( self->first_pts != AV_NOPTS_VALUE )
+							pts -= self->first_pts;
+						else if ( context->start_time != AV_NOPTS_VALUE )
+							pts -= context->start_time;
+						int_position = ( int64_t )( ( av_q2d( self->video_time_base ) * pts + delay ) * source_fps + 0.5 );
+					}
 					if ( int_position == self->last_position )
 						int_position = self->last_position + 1;
 				}
@@ -1836,7 +2068,11 @@ static int producer_get_image( mlt_frame frame, uint8_t **buffer, mlt_image_form
 					// Get position of reordered frame
 					int_position = self->video_frame->reordered_opaque;
 					pts = best_pts( self, self->video_frame->pkt_pts, self->video_frame->pkt_dts );
-					if ( pts != AV_NOPTS_VALUE )
+					if ( pts != AV_NOPTS_VALUE && self->seek_index && !delay )
+					{
+						int_position = seek_index_pts_frame( self->seek_index, pts );
+					}
+					else if ( pts != AV_NOPTS_VALUE )
 					{
 						if ( self->first_pts != AV_NOPTS_VALUE )
 							pts -= self->first_pts;
@@ -0,0 +1,278 @@
+/*
+ * seek_index.c -- persistent keyframe index for the avformat producer
+ * Copyright (C) 2017 Meltytech, LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "seek_index.h"
+
+#include <framework/mlt_log.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#define SEEK_INDEX_MAGIC "MLTSIDX1"
+
+/** The header of an index file.
+ *
+ * The identity of the indexed file is its path, size and modification time.
+ */
+
+struct seek_index_header
+{
+	char magic[8];
+	int64_t size;
+	int64_t mtime;
+	int32_t frame_count;
+	int32_t key_count;
+	int32_t resource_length;
+	int32_t reserved;
+};
+
+seek_index seek_index_init( )
+{
+	return calloc( 1, sizeof( struct seek_index_s ) );
+}
+
+void seek_index_append( seek_index self, int64_t pts, int64_t pos, int is_key )
+{
+	if ( self->frame_count == self->frame_size )
+	{
+		self->frame_size = self->frame_size ? self->frame_size * 2 : 4096;
+		self->frames = realloc( self->frames, self->frame_size * sizeof( int64_t ) );
+	}
+	self->frames[ self->frame_count ++ ] = pts;
+	if ( is_key )
+	{
+		if ( self->key_count == self->key_size )
+		{
+			self->key_size = self->key_size ? self->key_size * 2 : 256;
+			self->keys = realloc( self->keys, self->key_size * sizeof( seek_index_key ) );
+		}
+		self->keys[ self->key_count ].pts = pts;
+		self->keys[ self->key_count ++ ].pos = pos;
+	}
+}
+
+static int compare_pts( const void *a, const void *b )
+{
+	int64_t x = *( const int64_t* )a;
+	int64_t y = *( const int64_t* )b;
+	return x < y ? -1 : x > y;
+}
+
+static int compare_keys( const void *a, const void *b )
+{
+	return compare_pts( &( ( const seek_index_key* )a )->pts, &( ( const seek_index_key* )b )->pts );
+}
+
+/** Sort the packets from decode order into presentation order.
+*/
+
+void seek_index_finish( seek_index self )
+{
+	qsort( self->frames, self->frame_count, sizeof( int64_t ), compare_pts );
+	qsort( self->keys, self->key_count, sizeof( seek_index_key ), compare_keys );
+}
+
+/** Get the time stamp of a frame number or the last one if beyond the end.
+*/
+
+int64_t seek_index_frame_pts( seek_index self, int64_t frame )
+{
+	if ( frame < 0 )
+		frame = 0;
+	if ( frame >= self->frame_count )
+		frame = self->frame_count - 1;
+	return self->frames[ frame ];
+}
+
+/** Get the frame number of the first frame whose time stamp is not less than pts.
+*/
+
+int64_t seek_index_pts_frame( seek_index self, int64_t pts )
+{
+	int lo = 0, hi = self->frame_count;
+	while ( lo < hi )
+	{
+		int mid = ( lo + hi ) / 2;
+		if ( self->frames[ mid ] < pts )
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+/** Find the last keyframe at or before pts.
+ *
+ * \param previous the number of additional keyframes to step back, which
+ * is needed for open GOPs where leading frames reference the previous GOP
+ * \return the keyframe or NULL if the index has no keyframes
+ */
+
+const seek_index_key *seek_index_keyframe( seek_index self, int64_t pts, int previous )
+{
+	int lo = 0, hi = self->key_count;
+	if ( !self->key_count )
+		return NULL;
+	while ( lo < hi )
+	{
+		int mid = ( lo + hi ) / 2;
+		if ( self->keys[ mid ].pts <= pts )
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	lo -= 1 + previous;
+	return &self->keys[ lo < 0 ? 0 : lo ];
+}
+
+static uint64_t hash_string( const char *s, uint64_t hash )
+{
+	// FNV-1a
+	while ( *s )
+	{
+		hash ^= ( unsigned char ) *s++;
+		hash *= 0x100000001b3ULL;
+	}
+	return hash;
+}
+
+/** Get the name of the index file for a resource within the cache directory.
+ *
+ * The caller must free the result.
+ */
+
+char *seek_index_filename( const char *directory, const char *resource, int stream )
+{
+	if ( !directory || !resource )
+		return NULL;
+	size_t n = strlen( directory ) + 30;
+	char *filename = malloc( n );
+	snprintf( filename, n, "%s/%016llx.%d.idx", directory,
+		( unsigned long long ) hash_string( resource, 0xcbf29ce484222325ULL ), stream );
+	return filename;
+}
+
+static int stat_resource( const char *resource, struct seek_index_header *header )
+{
+	struct stat st;
+	if ( stat( resource, &st ) )
+		return 1;
+	header->size = st.st_size;
+	header->mtime = st.st_mtime;
+	return 0;
+}
+
+/** Load the index of resource from filename.
+ *
+ * \return the index or NULL if there is none or it is out of date
+ */
+
+seek_index seek_index_load( const char *filename, const char *resource )
+{
+	struct seek_index_header header, expected;
+	seek_index self = NULL;
+	FILE *f;
+
+	if ( !filename || stat_resource( resource, &expected ) || !( f = fopen( filename, "rb" ) ) )
+		return NULL;
+
+	if ( fread( &header, sizeof( header ), 1, f ) == 1
+		 && !memcmp( header.magic, SEEK_INDEX_MAGIC, sizeof( header.magic ) )
+		 && header.size == expected.size && header.mtime == expected.mtime
+		 && header.resource_length == ( int32_t ) strlen( resource )
+		 && header.frame_count > 0 && header.key_count > 0 )
+	{
+		char *stored = calloc( 1, header.resource_length + 1 );
+		if ( fread( stored, header.resource_length, 1, f ) == 1 && !strcmp( stored, resource ) )
+		{
+			self = seek_index_init();
+			self->frame_count = self->frame_size = header.frame_count;
+			self->key_count = self->key_size = header.key_count;
+			self->frames = malloc( self->frame_size * sizeof( int64_t ) );
+			self->keys = malloc( self->key_size * sizeof( seek_index_key ) );
+			if ( fread( self->frames, sizeof( int64_t ), self->frame_count, f ) != self->frame_count ||
+				 fread( self->keys, sizeof( seek_index_key ), self->key_count, f ) != self->key_count )
+			{
+				seek_index_close( self );
+				self = NULL;
+			}
+		}
+		free( stored );
+	}
+	fclose( f );
+	if ( !self )
+		mlt_log_debug( NULL, "[producer avformat] no valid seek index %s\n", filename );
+	return self;
+}
+
+/** Save the index of resource to filename.
+ *
+ * The index is written to a temporary file first so that concurrent readers
+ * never see a partial index.
+ * \return true if there was an error
+ */
+
+int seek_index_save( seek_index self, const char *filename, const char *resource )
+{
+	struct seek_index_header header;
+	int error = 1;
+
+	if ( !filename || !self->frame_count || stat_resource( resource, &header ) )
+		return error;
+
+	memcpy( header.magic, SEEK_INDEX_MAGIC, sizeof( header.magic ) );
+	header.frame_count = self->frame_count;
+	header.key_count = self->key_count;
+	header.resource_length = strlen( resource );
+	header.reserved = 0;
+
+	size_t n = strlen( filename ) + 5;
+	char *temp = malloc( n );
+	snprintf( temp, n, "%s.tmp", filename );
+	FILE *f = fopen( temp, "wb" );
+	if ( f )
+	{
+		error = fwrite( &header, sizeof( header ), 1, f ) != 1
+			|| fwrite( resource, header.resource_length, 1, f ) != 1
+			|| fwrite( self->frames, sizeof( int64_t ), self->frame_count, f ) != self->frame_count
+			|| fwrite( self->keys, sizeof( seek_index_key ), self->key_count, f ) != self->key_count;
+		error = fclose( f ) || error;
+		if ( !error )
+			error = rename( temp, filename );
+		if ( error )
+			remove( temp );
+	}
+	if ( error )
+		mlt_log_warning( NULL, "[producer avformat] failed to save seek index %s\n", filename );
+	free( temp );
+	return error;
+}
+
+void seek_index_close( seek_index self )
+{
+	if ( self )
+	{
+		free( self->frames );
+		free( self->keys );
+		free( self );
+	}
+}
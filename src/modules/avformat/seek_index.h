@@ -0,0 +1,65 @@
+/*
+ * seek_index.h -- persistent keyframe index for the avformat producer
+ * Copyright (C) 2017 Meltytech, LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef SEEK_INDEX_H
+#define SEEK_INDEX_H
+
+#include <stdint.h>
+
+/** A keyframe entry of the index.
+*/
+
+typedef struct
+{
+	int64_t pts;     /**< the presentation time stamp in stream time base units */
+	int64_t pos;     /**< the byte offset of the packet in the file or -1 */
+}
+seek_index_key;
+
+/** The index of one video stream.
+ *
+ * The frames array holds the presentation time stamp of every video packet
+ * in presentation order, which provides the mapping of a frame number to a
+ * time stamp and back. The keys array holds the keyframes in presentation
+ * order.
+ */
+
+typedef struct seek_index_s
+{
+	int64_t *frames;
+	int frame_count;
+	int frame_size;
+	seek_index_key *keys;
+	int key_count;
+	int key_size;
+}
+*seek_index;
+
+extern seek_index seek_index_init( );
+extern void seek_index_append( seek_index self, int64_t pts, int64_t pos, int is_key );
+extern void seek_index_finish( seek_index self );
+extern int64_t seek_index_frame_pts( seek_index self, int64_t frame );
+extern int64_t seek_index_pts_frame( seek_index self, int64_t pts );
+extern const seek_index_key *seek_index_keyframe( seek_index self, int64_t pts, int previous );
+extern char *seek_index_filename( const char *directory, const char *resource, int stream );
+extern seek_index seek_index_load( const char *filename, const char *resource );
+extern int seek_index_save( seek_index self, const char *filename, const char *resource );
+extern void seek_index_close( seek_index self );
+
+#endif
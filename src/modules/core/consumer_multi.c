@@ -20,6 +20,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
 #include <pthread.h>
 #include <sys/time.h>
 
@@ -342,106 +343,317 @@ static void foreach_consumer_update( mlt_consumer consumer )
 	} while ( nested );
 }
 
-static void foreach_consumer_put( mlt_consumer consumer, mlt_frame frame )
+static void put_nested( mlt_consumer consumer, mlt_consumer nested, mlt_frame frame, int deeply )
 {
 	mlt_properties properties = MLT_CONSUMER_PROPERTIES( consumer );
+	mlt_properties nested_props = MLT_CONSUMER_PROPERTIES(nested);
+	double self_fps = mlt_properties_get_double( properties, "fps" );
+	double nested_fps = mlt_properties_get_double( nested_props, "fps" );
+	mlt_position nested_pos = mlt_properties_get_position( nested_props, "_multi_position" );
+	mlt_position self_pos = mlt_frame_get_position( frame );
+	double self_time = self_pos / self_fps;
+	double nested_time = nested_pos / nested_fps;
+
+	// get the audio for the current frame
+	uint8_t *buffer = NULL;
+	mlt_audio_format format = mlt_audio_s16;
+	int channels = mlt_properties_get_int( properties, "channels" );
+	int frequency = mlt_properties_get_int( properties, "frequency" );
+	int current_samples = mlt_sample_calculator( self_fps, frequency, self_pos );
+	mlt_frame_get_audio( frame, (void**) &buffer, &format, &frequency, &channels, &current_samples );
+	int current_size = mlt_audio_format_size( format, current_samples, channels );
+
+	// get any leftover audio
+	int prev_size = 0;
+	uint8_t *prev_buffer = mlt_properties_get_data( nested_props, "_multi_audio", &prev_size );
+	uint8_t *new_buffer = NULL;
+	if ( prev_size > 0 )
+	{
+		new_buffer = mlt_pool_alloc( prev_size + current_size );
+		memcpy( new_buffer, prev_buffer, prev_size );
+		memcpy( new_buffer + prev_size, buffer, current_size );
+		buffer = new_buffer;
+	}
+	current_size += prev_size;
+	current_samples += mlt_properties_get_int( nested_props, "_multi_samples" );
+
+	while ( nested_time <= self_time )
+	{
+		// put ideal number of samples into cloned frame
+		mlt_frame clone_frame = mlt_frame_clone( frame, deeply );
+		mlt_properties clone_props = MLT_FRAME_PROPERTIES( clone_frame );
+		int nested_samples = mlt_sample_calculator( nested_fps, frequency, nested_pos );
+		// -10 is an optimization to avoid tiny amounts of leftover samples
+		nested_samples = nested_samples > current_samples - 10 ? current_samples : nested_samples;
+		int nested_size = mlt_audio_format_size( format, nested_samples, channels );
+		if ( nested_size > 0 )
+		{
+			prev_buffer = mlt_pool_alloc( nested_size );
+			memcpy( prev_buffer, buffer, nested_size );
+		}
+		else
+		{
+			prev_buffer = NULL;
+			nested_size = 0;
+		}
+		mlt_frame_set_audio( clone_frame, prev_buffer, format, nested_size, mlt_pool_release );
+		mlt_properties_set_int( clone_props, "audio_samples", nested_samples );
+		mlt_properties_set_int( clone_props, "audio_frequency", frequency );
+		mlt_properties_set_int( clone_props, "audio_channels", channels );
+
+		// chomp the audio
+		current_samples -= nested_samples;
+		current_size -= nested_size;
+		buffer += nested_size;
+
+		// Fix some things
+		mlt_properties_set_int( clone_props, "meta.media.width",
+			mlt_properties_get_int( MLT_FRAME_PROPERTIES(frame), "width" ) );
+		mlt_properties_set_int( clone_props, "meta.media.height",
+			mlt_properties_get_int( MLT_FRAME_PROPERTIES(frame), "height" ) );
+
+		// send frame to nested consumer
+		mlt_consumer_put_frame( nested, clone_frame );
+		mlt_properties_set_position( nested_props, "_multi_position", ++nested_pos );
+		nested_time = nested_pos / nested_fps;
+	}
+
+	// save any remaining audio
+	if ( current_size > 0 )
+	{
+		prev_buffer = mlt_pool_alloc( current_size );
+		memcpy( prev_buffer, buffer, current_size );
+	}
+	else
+	{
+		prev_buffer = NULL;
+		current_size = 0;
+	}
+	mlt_pool_release( new_buffer );
+	mlt_properties_set_data( nested_props, "_multi_audio", prev_buffer, current_size, mlt_pool_release, NULL );
+	mlt_properties_set_int( nested_props, "_multi_samples", current_samples );
+}
+
+/** A job for scaling a YUV 4:2:2 image on slices.
+*/
+
+typedef struct
+{
+	uint8_t *src;
+	int src_width;
+	int src_height;
+	uint8_t *dst;
+	int dst_width;
+	int dst_height;
+} scale_desc;
+
+static inline int sample_position( int i, int src_size, int dst_size )
+{
+	// The source coordinate of the centre of destination sample i in 16.16 fixed point
+	int64_t p = ( ( int64_t )( 2 * i + 1 ) * src_size << 15 ) / dst_size - 32768;
+	return p < 0 ? 0 : ( int )p;
+}
+
+static inline uint8_t interpolate( const uint8_t *row0, const uint8_t *row1, int x0, int x1, int wx, int wy )
+{
+	int top = row0[x0] * ( 256 - wx ) + row0[x1] * wx;
+	int bottom = row1[x0] * ( 256 - wx ) + row1[x1] * wx;
+	return ( top * ( 256 - wy ) + bottom * wy + 32768 ) >> 16;
+}
+
+static int scale_slice( int id, int index, int jobs, void *cookie )
+{
+	scale_desc *desc = cookie;
+	int start = desc->dst_height * index / jobs;
+	int end = desc->dst_height * ( index + 1 ) / jobs;
+	int stride = desc->src_width * 2;
+	int chroma_src = desc->src_width / 2;
+	int chroma_dst = desc->dst_width / 2;
+	int x, y;
+
+	for ( y = start; y < end; y ++ )
+	{
+		int fy = sample_position( y, desc->src_height, desc->dst_height );
+		int y0 = MIN( fy >> 16, desc->src_height - 1 );
+		int y1 = MIN( y0 + 1, desc->src_height - 1 );
+		int wy = ( fy >> 8 ) & 0xff;
+		const uint8_t *row0 = desc->src + y0 * stride;
+		const uint8_t *row1 = desc->src + y1 * stride;
+		uint8_t *out = desc->dst + y * desc->dst_width * 2;
+
+		for ( x = 0; x < desc->dst_width; x ++ )
+		{
+			int fx = sample_position( x, desc->src_width, desc->dst_width );
+			int x0 = MIN( fx >> 16, desc->src_width - 1 );
+			int x1 = MIN( x0 + 1, desc->src_width - 1 );
+			out[ 2 * x ] = interpolate( row0, row1, 2 * x0, 2 * x1, ( fx >> 8 ) & 0xff, wy );
+		}
+		for ( x = 0; x < chroma_dst; x ++ )
+		{
+			int fx = sample_position( x, chroma_src, chroma_dst );
+			int x0 = MIN( fx >> 16, chroma_src - 1 );
+			int x1 = MIN( x0 + 1, chroma_src - 1 );
+			int wx = ( fx >> 8 ) & 0xff;
+			out[ 4 * x + 1 ] = interpolate( row0, row1, 4 * x0 + 1, 4 * x1 + 1, wx, wy );
+			out[ 4 * x + 3 ] = interpolate( row0, row1, 4 * x0 + 3, 4 * x1 + 3, wx, wy );
+		}
+	}
+	return 0;
+}
+
+typedef struct
+{
+	mlt_consumer consumer;
+	mlt_profile profile;
+	int width;
+	int height;
+	uint8_t *image;
+} rendition;
+
+static int compare_renditions( const void *a, const void *b )
+{
+	const rendition *x = a;
+	const rendition *y = b;
+	return y->width * y->height - x->width * x->height;
+}
+
+/** Render once and fan out to the nested consumers as a ladder of renditions.
+ *
+ * The image is fetched once at the resolution of this consumer, and each
+ * nested consumer receives a copy scaled down on slices from the smallest
+ * rendition already made that is at least as large. The audio is fetched
+ * once as float and shared by reference. Nested consumers with a different
+ * frame rate or display aspect ratio, or a larger size, are fed as usual.
+ * \return true if the frame was not handled
+ */
+
+static int put_ladder( mlt_consumer consumer, mlt_frame frame )
+{
+	mlt_properties properties = MLT_CONSUMER_PROPERTIES( consumer );
+	mlt_profile profile = mlt_service_profile( MLT_CONSUMER_SERVICE( consumer ) );
+	mlt_image_format format = mlt_image_yuv422;
+	int width = profile->width;
+	int height = profile->height;
+	uint8_t *image = NULL;
 	mlt_consumer nested = NULL;
+	rendition *renditions;
 	char key[30];
-	int index = 0;
+	int count = 0;
+	int i, j, n = 0;
+
+	if ( !mlt_properties_get_int( MLT_FRAME_PROPERTIES( frame ), "rendered" )
+		 || mlt_frame_get_image( frame, &image, &format, &width, &height, 0 )
+		 || format != mlt_image_yuv422 || !image )
+		return 1;
 
 	do {
-		snprintf( key, sizeof(key), "%d.consumer", index++ );
+		snprintf( key, sizeof(key), "%d.consumer", count );
 		nested = mlt_properties_get_data( properties, key, NULL );
-		if ( nested )
+	} while ( nested && ++count );
+	renditions = calloc( count, sizeof( rendition ) );
+
+	// Feed the nested consumers that cannot share first since they convert the audio
+	for ( i = 0; i < count; i ++ )
+	{
+		snprintf( key, sizeof(key), "%d.consumer", i );
+		nested = mlt_properties_get_data( properties, key, NULL );
+		mlt_profile nested_profile = mlt_service_profile( MLT_CONSUMER_SERVICE( nested ) );
+		if ( nested_profile->frame_rate_num * profile->frame_rate_den != profile->frame_rate_num * nested_profile->frame_rate_den
+			 || fabs( mlt_profile_dar( nested_profile ) - mlt_profile_dar( profile ) ) > 0.01
+			 || nested_profile->width > width || nested_profile->height > height
+			 || mlt_properties_get_int( MLT_CONSUMER_PROPERTIES( nested ), "_multi_samples" ) )
 		{
-			mlt_properties nested_props = MLT_CONSUMER_PROPERTIES(nested);
-			double self_fps = mlt_properties_get_double( properties, "fps" );
-			double nested_fps = mlt_properties_get_double( nested_props, "fps" );
-			mlt_position nested_pos = mlt_properties_get_position( nested_props, "_multi_position" );
-			mlt_position self_pos = mlt_frame_get_position( frame );
-			double self_time = self_pos / self_fps;
-			double nested_time = nested_pos / nested_fps;
-
-			// get the audio for the current frame
-			uint8_t *buffer = NULL;
-			mlt_audio_format format = mlt_audio_s16;
-			int channels = mlt_properties_get_int( properties, "channels" );
-			int frequency = mlt_properties_get_int( properties, "frequency" );
-			int current_samples = mlt_sample_calculator( self_fps, frequency, self_pos );
-			mlt_frame_get_audio( frame, (void**) &buffer, &format, &frequency, &channels, &current_samples );
-			int current_size = mlt_audio_format_size( format, current_samples, channels );
-
-			// get any leftover audio
-			int prev_size = 0;
-			uint8_t *prev_buffer = mlt_properties_get_data( nested_props, "_multi_audio", &prev_size );
-			uint8_t *new_buffer = NULL;
-			if ( prev_size > 0 )
-			{
-				new_buffer = mlt_pool_alloc( prev_size + current_size );
-				memcpy( new_buffer, prev_buffer, prev_size );
-				memcpy( new_buffer + prev_size, buffer, current_size );
-				buffer = new_buffer;
-			}
-			current_size += prev_size;
-			current_samples += mlt_properties_get_int( nested_props, "_multi_samples" );
+			put_nested( consumer, nested, frame, 1 );
+		}
+		else
+		{
+			renditions[n].consumer = nested;
+			renditions[n].profile = nested_profile;
+			renditions[n].width = nested_profile->width & ~1;
+			renditions[n].height = nested_profile->height;
+			n ++;
+		}
+	}
 
-			while ( nested_time <= self_time )
-			{
-				// put ideal number of samples into cloned frame
-				int deeply = index > 1 ? 1 : 0;
-				mlt_frame clone_frame = mlt_frame_clone( frame, deeply );
-				mlt_properties clone_props = MLT_FRAME_PROPERTIES( clone_frame );
-				int nested_samples = mlt_sample_calculator( nested_fps, frequency, nested_pos );
-				// -10 is an optimization to avoid tiny amounts of leftover samples
-				nested_samples = nested_samples > current_samples - 10 ? current_samples : nested_samples;
-				int nested_size = mlt_audio_format_size( format, nested_samples, channels );
-				if ( nested_size > 0 )
-				{
-					prev_buffer = mlt_pool_alloc( nested_size );
-					memcpy( prev_buffer, buffer, nested_size );
-				}
-				else
-				{
-					prev_buffer = NULL;
-					nested_size = 0;
-				}
-				mlt_frame_set_audio( clone_frame, prev_buffer, format, nested_size, mlt_pool_release );
-				mlt_properties_set_int( clone_props, "audio_samples", nested_samples );
-				mlt_properties_set_int( clone_props, "audio_frequency", frequency );
-				mlt_properties_set_int( clone_props, "audio_channels", channels );
-
-				// chomp the audio
-				current_samples -= nested_samples;
-				current_size -= nested_size;
-				buffer += nested_size;
-
-				// Fix some things
-				mlt_properties_set_int( clone_props, "meta.media.width",
-					mlt_properties_get_int( MLT_FRAME_PROPERTIES(frame), "width" ) );
-				mlt_properties_set_int( clone_props, "meta.media.height",
-					mlt_properties_get_int( MLT_FRAME_PROPERTIES(frame), "height" ) );
-
-				// send frame to nested consumer
-				mlt_consumer_put_frame( nested, clone_frame );
-				mlt_properties_set_position( nested_props, "_multi_position", ++nested_pos );
-				nested_time = nested_pos / nested_fps;
-			}
+	if ( n )
+	{
+		void *audio = NULL;
+		mlt_audio_format audio_format = mlt_audio_float;
+		int channels = mlt_properties_get_int( properties, "channels" );
+		int frequency = mlt_properties_get_int( properties, "frequency" );
+		int samples = mlt_sample_calculator( mlt_properties_get_double( properties, "fps" ), frequency, mlt_frame_get_position( frame ) );
+		mlt_frame_get_audio( frame, &audio, &audio_format, &frequency, &channels, &samples );
+	}
 
-			// save any remaining audio
-			if ( current_size > 0 )
-			{
-				prev_buffer = mlt_pool_alloc( current_size );
-				memcpy( prev_buffer, buffer, current_size );
-			}
-			else
+	// Make all of the scaled images before handing any of them off
+	qsort( renditions, n, sizeof( rendition ), compare_renditions );
+	for ( i = 0; i < n; i ++ )
+	{
+		rendition *r = &renditions[i];
+		scale_desc desc = { image, width, height, NULL, r->width, r->height };
+
+		// The first rendition at full size shares the image of the frame
+		if ( i == 0 && r->width == width && r->height == height )
+			continue;
+		for ( j = 0; j < i; j ++ )
+		{
+			if ( renditions[j].image && renditions[j].width >= r->width && renditions[j].height >= r->height )
 			{
-				prev_buffer = NULL;
-				current_size = 0;
+				desc.src = renditions[j].image;
+				desc.src_width = renditions[j].width;
+				desc.src_height = renditions[j].height;
 			}
-			mlt_pool_release( new_buffer );
-			mlt_properties_set_data( nested_props, "_multi_audio", prev_buffer, current_size, mlt_pool_release, NULL );
-			mlt_properties_set_int( nested_props, "_multi_samples", current_samples );
 		}
+		r->image = desc.dst = mlt_pool_alloc( mlt_image_format_size( format, r->width, r->height, NULL ) );
+		if ( desc.src_width == r->width && desc.src_height == r->height )
+			memcpy( desc.dst, desc.src, r->width * r->height * 2 );
+		else
+			mlt_slices_run_normal( 0, scale_slice, &desc );
+	}
+
+	for ( i = 0; i < n; i ++ )
+	{
+		rendition *r = &renditions[i];
+		mlt_properties nested_props = MLT_CONSUMER_PROPERTIES( r->consumer );
+		mlt_frame clone_frame = mlt_frame_clone( frame, 0 );
+		mlt_properties clone_props = MLT_FRAME_PROPERTIES( clone_frame );
+
+		if ( r->image )
+		{
+			mlt_frame_set_image( clone_frame, r->image, mlt_image_format_size( format, r->width, r->height, NULL ), mlt_pool_release );
+			mlt_frame_set_alpha( clone_frame, NULL, 0, NULL );
+			mlt_properties_set_int( clone_props, "width", r->width );
+			mlt_properties_set_int( clone_props, "height", r->height );
+			mlt_properties_set_int( clone_props, "format", format );
+			mlt_properties_set_double( clone_props, "aspect_ratio", mlt_profile_sar( r->profile ) );
+		}
+		mlt_properties_set_int( clone_props, "meta.media.width", r->width );
+		mlt_properties_set_int( clone_props, "meta.media.height", r->height );
+
+		mlt_consumer_put_frame( r->consumer, clone_frame );
+		mlt_properties_set_position( nested_props, "_multi_position",
+			mlt_properties_get_position( nested_props, "_multi_position" ) + 1 );
+	}
+	free( renditions );
+
+	return 0;
+}
+
+static void foreach_consumer_put( mlt_consumer consumer, mlt_frame frame )
+{
+	mlt_properties properties = MLT_CONSUMER_PROPERTIES( consumer );
+	mlt_consumer nested = NULL;
+	char key[30];
+	int index = 0;
+
+	if ( mlt_properties_get_int( properties, "ladder" ) && !put_ladder( consumer, frame ) )
+		return;
+
+	do {
+		snprintf( key, sizeof(key), "%d.consumer", index++ );
+		nested = mlt_properties_get_data( properties, key, NULL );
+		if ( nested )
+			put_nested( consumer, nested, frame, index > 1 );
 	} while ( nested );
 }
 
@@ -0,0 +1,253 @@
+/*
+ * consumer_peaks.c -- write the audio peaks of each frame to a sidecar
+ * Copyright (C) 2017 Meltytech, LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <framework/mlt_consumer.h>
+#include <framework/mlt_frame.h>
+#include <framework/mlt_analysis.h>
+#include <framework/mlt_log.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+
+typedef struct consumer_peaks_s *consumer_peaks;
+
+struct consumer_peaks_s
+{
+	struct mlt_consumer_s parent;
+	pthread_t thread;
+	int running;
+	int joined;
+	mlt_analysis analysis;
+	int16_t *record;
+	int buckets;
+	int channels;
+	int frequency;
+	mlt_position last;   /**< the last position with peaks or -1 */
+};
+
+static int consumer_start( mlt_consumer consumer );
+static int consumer_stop( mlt_consumer consumer );
+static int consumer_is_stopped( mlt_consumer consumer );
+static void *consumer_thread( void *arg );
+static void consumer_close( mlt_consumer consumer );
+
+mlt_consumer consumer_peaks_init( mlt_profile profile, mlt_service_type type, const char *id, char *arg )
+{
+	consumer_peaks self = calloc( 1, sizeof( struct consumer_peaks_s ) );
+	if ( self && !mlt_consumer_init( &self->parent, self, profile ) )
+	{
+		mlt_consumer consumer = &self->parent;
+		mlt_properties properties = MLT_CONSUMER_PROPERTIES( consumer );
+
+		mlt_properties_set( properties, "target", arg ? arg : "peaks.mlt" );
+		mlt_properties_set_int( properties, "buckets", 16 );
+		mlt_properties_set_int( properties, "real_time", -1 );
+		mlt_properties_set_int( properties, "terminate_on_pause", 1 );
+		self->joined = 1;
+
+		consumer->close = consumer_close;
+		consumer->start = consumer_start;
+		consumer->stop = consumer_stop;
+		consumer->is_stopped = consumer_is_stopped;
+		return consumer;
+	}
+	free( self );
+	return NULL;
+}
+
+static int consumer_start( mlt_consumer consumer )
+{
+	consumer_peaks self = consumer->child;
+
+	if ( !self->running )
+	{
+		mlt_properties properties = MLT_CONSUMER_PROPERTIES( consumer );
+
+		consumer_stop( consumer );
+		self->buckets = CLAMP( mlt_properties_get_int( properties, "buckets" ), 1, 1024 );
+		self->channels = MAX( mlt_properties_get_int( properties, "channels" ), 1 );
+		self->frequency = MAX( mlt_properties_get_int( properties, "frequency" ), 1 );
+		free( self->record );
+		self->record = malloc( self->buckets * self->channels * 3 * sizeof( int16_t ) );
+		self->analysis = self->record ? mlt_analysis_new() : NULL;
+		self->last = -1;
+		if ( !self->analysis )
+			return 1;
+		self->running = 1;
+		self->joined = 0;
+		pthread_create( &self->thread, NULL, consumer_thread, self );
+	}
+	return 0;
+}
+
+static int consumer_stop( mlt_consumer consumer )
+{
+	consumer_peaks self = consumer->child;
+
+	if ( !self->joined )
+	{
+		self->running = 0;
+		self->joined = 1;
+		pthread_join( self->thread, NULL );
+	}
+	return 0;
+}
+
+static int consumer_is_stopped( mlt_consumer consumer )
+{
+	consumer_peaks self = consumer->child;
+	return !self->running;
+}
+
+static inline int16_t to_s16( float sample )
+{
+	return lrintf( CLAMP( sample, -1.0f, 1.0f ) * 32767.0f );
+}
+
+/** Store the minimum, maximum and RMS of each bucket of the audio of a frame.
+ *
+ * A record holds int16_t triplets of minimum, maximum and RMS ordered by
+ * bucket and then channel.
+ */
+
+static void add_peaks( consumer_peaks self, mlt_frame frame, mlt_position position )
+{
+	mlt_properties properties = MLT_CONSUMER_PROPERTIES( &self->parent );
+	mlt_audio_format format = mlt_audio_float;
+	int frequency = self->frequency;
+	int channels = self->channels;
+	int samples = mlt_sample_calculator( mlt_properties_get_double( properties, "fps" ), frequency, position );
+	float *audio = NULL;
+	int16_t *out = self->record;
+	int b, c, i;
+
+	if ( mlt_frame_get_audio( frame, (void**) &audio, &format, &frequency, &channels, &samples ) || !audio
+		 || format != mlt_audio_float || samples <= 0 )
+		return;
+
+	for ( b = 0; b < self->buckets; b++ )
+	{
+		int start = samples * b / self->buckets;
+		int end = samples * ( b + 1 ) / self->buckets;
+		for ( c = 0; c < self->channels; c++ )
+		{
+			float lo = 0.0f, hi = 0.0f;
+			double sum = 0.0;
+			if ( c < channels && end > start )
+			{
+				const float *p = audio + c * samples;
+				lo = hi = p[ start ];
+				for ( i = start; i < end; i++ )
+				{
+					lo = MIN( lo, p[i] );
+					hi = MAX( hi, p[i] );
+					sum += p[i] * p[i];
+				}
+				sum /= end - start;
+			}
+			*out++ = to_s16( lo );
+			*out++ = to_s16( hi );
+			*out++ = to_s16( sqrt( sum ) );
+		}
+	}
+	mlt_analysis_put( self->analysis, "peaks", position, self->record, self->buckets * self->channels * 3 * sizeof( int16_t ) );
+	self->last = MAX( self->last, position );
+}
+
+/** Add the layout of the records and the coarser levels of peaks.
+ *
+ * Each level has a record of 16 buckets for every 16^n frames, combined
+ * from the level below, so that a waveform of any span can be drawn from
+ * a bounded number of buckets. Levels are added until one record covers
+ * all of the frames.
+ */
+
+static void add_levels( consumer_peaks self )
+{
+	int32_t info[4] = { self->channels, self->buckets, self->frequency, 0 };
+	int16_t *record = malloc( 16 * self->channels * 3 * sizeof( int16_t ) );
+	mlt_position frames = 1;
+	mlt_position i;
+
+	mlt_analysis_put( self->analysis, "peaks.info", 0, info, sizeof( info ) );
+	while ( record && frames <= self->last && info[3] < 6 )
+	{
+		char track[ 32 ];
+		frames *= 16;
+		snprintf( track, sizeof( track ), "peaks.%d", frames );
+		for ( i = 0; i <= self->last / frames; i++ )
+		{
+			mlt_analysis_get_peaks( self->analysis, i * frames, frames, 16, self->channels, record );
+			mlt_analysis_put( self->analysis, track, i, record, 16 * self->channels * 3 * sizeof( int16_t ) );
+		}
+		info[3] ++;
+		mlt_analysis_put( self->analysis, "peaks.info", 0, info, sizeof( info ) );
+	}
+	free( record );
+}
+
+static void *consumer_thread( void *arg )
+{
+	consumer_peaks self = arg;
+	mlt_consumer consumer = &self->parent;
+	mlt_properties properties = MLT_CONSUMER_PROPERTIES( consumer );
+	int terminate_on_pause = mlt_properties_get_int( properties, "terminate_on_pause" );
+	int terminated = 0;
+
+	while ( !terminated && self->running )
+	{
+		mlt_frame frame = mlt_consumer_rt_frame( consumer );
+
+		if ( terminate_on_pause && frame )
+			terminated = mlt_properties_get_double( MLT_FRAME_PROPERTIES( frame ), "_speed" ) == 0.0;
+
+		if ( frame )
+		{
+			mlt_position position = mlt_frame_get_position( frame );
+			if ( !terminated && position >= 0 )
+				add_peaks( self, frame, position );
+			mlt_events_fire( properties, "consumer-frame-show", frame, NULL );
+			mlt_frame_close( frame );
+		}
+	}
+
+	add_levels( self );
+	if ( mlt_analysis_save( self->analysis, mlt_properties_get( properties, "target" ) ) )
+		mlt_log_error( MLT_CONSUMER_SERVICE( consumer ), "failed to write %s\n", mlt_properties_get( properties, "target" ) );
+	mlt_analysis_close( self->analysis );
+	self->analysis = NULL;
+
+	self->running = 0;
+	mlt_consumer_stopped( consumer );
+
+	return NULL;
+}
+
+static void consumer_close( mlt_consumer consumer )
+{
+	consumer_peaks self = consumer->child;
+
+	mlt_consumer_stop( consumer );
+	mlt_consumer_close( consumer );
+	free( self->record );
+	free( self );
+}
@@ -0,0 +1,294 @@
+/*
+ * consumer_sprites.c -- write thumbnails into sprite sheets
+ * Copyright (C) 2017 Meltytech, LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <framework/mlt_consumer.h>
+#include <framework/mlt_frame.h>
+#include <framework/mlt_log.h>
+#include <framework/mlt_profile.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <pthread.h>
+
+typedef struct consumer_sprites_s *consumer_sprites;
+
+struct consumer_sprites_s
+{
+	struct mlt_consumer_s parent;
+	pthread_t thread;
+	int running;
+	int joined;
+	uint8_t *sheet;      /**< the RGB image of the sheet being filled */
+	int sheet_index;     /**< the number of the sheet being filled or -1 */
+	int tiles;           /**< the number of tiles used on the sheet */
+	int tile_width;
+	int tile_height;
+	int columns;
+	int rows;
+};
+
+static int consumer_start( mlt_consumer consumer );
+static int consumer_stop( mlt_consumer consumer );
+static int consumer_is_stopped( mlt_consumer consumer );
+static void *consumer_thread( void *arg );
+static void consumer_close( mlt_consumer consumer );
+
+mlt_consumer consumer_sprites_init( mlt_profile profile, mlt_service_type type, const char *id, char *arg )
+{
+	consumer_sprites self = calloc( 1, sizeof( struct consumer_sprites_s ) );
+	if ( self && !mlt_consumer_init( &self->parent, self, profile ) )
+	{
+		mlt_consumer consumer = &self->parent;
+		mlt_properties properties = MLT_CONSUMER_PROPERTIES( consumer );
+
+		mlt_properties_set( properties, "target", arg ? arg : "sprites-%04d.ppm" );
+		mlt_properties_set_int( properties, "interval", 0 );
+		mlt_properties_set_int( properties, "columns", 10 );
+		mlt_properties_set_int( properties, "rows", 10 );
+		mlt_properties_set_int( properties, "tile_height", 90 );
+		mlt_properties_set_int( properties, "deinterlace", 1 );
+		mlt_properties_set_int( properties, "real_time", -1 );
+		mlt_properties_set_int( properties, "terminate_on_pause", 1 );
+		self->joined = 1;
+		self->sheet_index = -1;
+
+		consumer->close = consumer_close;
+		consumer->start = consumer_start;
+		consumer->stop = consumer_stop;
+		consumer->is_stopped = consumer_is_stopped;
+		return consumer;
+	}
+	free( self );
+	return NULL;
+}
+
+static int consumer_start( mlt_consumer consumer )
+{
+	consumer_sprites self = consumer->child;
+
+	if ( !self->running )
+	{
+		mlt_properties properties = MLT_CONSUMER_PROPERTIES( consumer );
+		mlt_profile profile = mlt_service_profile( MLT_CONSUMER_SERVICE( consumer ) );
+
+		consumer_stop( consumer );
+		self->tile_height = MAX( mlt_properties_get_int( properties, "tile_height" ), 2 );
+		self->tile_width = mlt_properties_get_int( properties, "tile_width" );
+		if ( self->tile_width <= 0 )
+			self->tile_width = lrint( self->tile_height * mlt_profile_dar( profile ) );
+		self->tile_width = MAX( self->tile_width & ~1, 2 );
+		self->columns = MAX( mlt_properties_get_int( properties, "columns" ), 1 );
+		self->rows = MAX( mlt_properties_get_int( properties, "rows" ), 1 );
+		self->sheet_index = -1;
+		self->tiles = 0;
+		free( self->sheet );
+		self->sheet = malloc( self->columns * self->tile_width * self->rows * self->tile_height * 3 );
+		if ( !self->sheet )
+			return 1;
+		mlt_properties_set_int( properties, "sheets", 0 );
+		self->running = 1;
+		self->joined = 0;
+		pthread_create( &self->thread, NULL, consumer_thread, self );
+	}
+	return 0;
+}
+
+static int consumer_stop( mlt_consumer consumer )
+{
+	consumer_sprites self = consumer->child;
+
+	if ( !self->joined )
+	{
+		self->running = 0;
+		self->joined = 1;
+		pthread_join( self->thread, NULL );
+	}
+	return 0;
+}
+
+static int consumer_is_stopped( mlt_consumer consumer )
+{
+	consumer_sprites self = consumer->child;
+	return !self->running;
+}
+
+/** Determine if a target can be used as the printf format of a sheet number.
+ *
+ * Only a single %d, optionally with a zero padded width such as %04d, is
+ * accepted; %% is a literal percent sign.
+ */
+
+static int is_sheet_format( const char *target )
+{
+	int conversions = 0;
+
+	while ( ( target = strchr( target, '%' ) ) )
+	{
+		target++;
+		if ( *target == '%' )
+		{
+			target++;
+			continue;
+		}
+		if ( *target == '0' )
+			while ( isdigit( (unsigned char) *target ) )
+				target++;
+		if ( *target != 'd' )
+			return 0;
+		target++;
+		conversions++;
+	}
+	return conversions == 1;
+}
+
+/** Get the file name of a sheet.
+ *
+ * The target is used as a printf format for the number of the sheet when it
+ * has exactly one integer conversion. Otherwise the number is inserted
+ * before the extension.
+ */
+
+static void sheet_filename( const char *target, int index, char *filename, size_t size )
+{
+	if ( is_sheet_format( target ) )
+	{
+		snprintf( filename, size, target, index );
+	}
+	else
+	{
+		const char *extension = strrchr( target, '.' );
+		int length = extension ? extension - target : strlen( target );
+		snprintf( filename, size, "%.*s-%04d%s", length, target, index, extension ? extension : "" );
+	}
+}
+
+/** Write the current sheet as a binary PPM image, omitting unused rows.
+ */
+
+static void write_sheet( consumer_sprites self )
+{
+	mlt_properties properties = MLT_CONSUMER_PROPERTIES( &self->parent );
+	int width = self->columns * self->tile_width;
+	int height = ( self->tiles + self->columns - 1 ) / self->columns * self->tile_height;
+	char filename[ PATH_MAX ];
+	FILE *file;
+
+	if ( self->sheet_index < 0 || self->tiles == 0 )
+		return;
+
+	sheet_filename( mlt_properties_get( properties, "target" ), self->sheet_index, filename, sizeof( filename ) );
+	file = mlt_fopen( filename, "wb" );
+	if ( file )
+	{
+		fprintf( file, "P6\n%d %d\n255\n", width, height );
+		if ( fwrite( self->sheet, width * 3, height, file ) != height )
+			mlt_log_error( MLT_CONSUMER_SERVICE( &self->parent ), "failed to write %s\n", filename );
+		fclose( file );
+		mlt_properties_set_int( properties, "sheets", mlt_properties_get_int( properties, "sheets" ) + 1 );
+	}
+	else
+	{
+		mlt_log_error( MLT_CONSUMER_SERVICE( &self->parent ), "failed to open %s\n", filename );
+	}
+}
+
+/** Put the image of a frame onto its tile, starting a new sheet as needed.
+ */
+
+static void add_tile( consumer_sprites self, mlt_frame frame, int index )
+{
+	int per_sheet = self->columns * self->rows;
+	int sheet = index / per_sheet;
+	int tile = index % per_sheet;
+	int stride = self->columns * self->tile_width * 3;
+	mlt_image_format format = mlt_image_rgb24;
+	int width = self->tile_width;
+	int height = self->tile_height;
+	uint8_t *image = NULL;
+	uint8_t *dst;
+	int y;
+
+	if ( sheet != self->sheet_index )
+	{
+		write_sheet( self );
+		memset( self->sheet, 0, stride * self->rows * self->tile_height );
+		self->sheet_index = sheet;
+		self->tiles = 0;
+	}
+
+	if ( mlt_frame_get_image( frame, &image, &format, &width, &height, 0 ) || !image || format != mlt_image_rgb24 )
+		return;
+
+	// Clip an image that was not scaled to the size of a tile
+	dst = self->sheet + ( tile / self->columns ) * self->tile_height * stride + ( tile % self->columns ) * self->tile_width * 3;
+	for ( y = 0; y < MIN( height, self->tile_height ); y++ )
+		memcpy( dst + y * stride, image + y * width * 3, MIN( width, self->tile_width ) * 3 );
+	self->tiles = MAX( self->tiles, tile + 1 );
+}
+
+static void *consumer_thread( void *arg )
+{
+	consumer_sprites self = arg;
+	mlt_consumer consumer = &self->parent;
+	mlt_properties properties = MLT_CONSUMER_PROPERTIES( consumer );
+	int terminate_on_pause = mlt_properties_get_int( properties, "terminate_on_pause" );
+	int interval = mlt_properties_get_int( properties, "interval" );
+	int terminated = 0;
+
+	// Default to a thumbnail per second
+	if ( interval <= 0 )
+		interval = MAX( lrint( mlt_properties_get_double( properties, "fps" ) ), 1 );
+
+	while ( !terminated && self->running )
+	{
+		mlt_frame frame = mlt_consumer_rt_frame( consumer );
+
+		if ( terminate_on_pause && frame )
+			terminated = mlt_properties_get_double( MLT_FRAME_PROPERTIES( frame ), "_speed" ) == 0.0;
+
+		if ( frame )
+		{
+			mlt_position position = mlt_frame_get_position( frame );
+			if ( !terminated && position >= 0 && position % interval == 0 )
+				add_tile( self, frame, position / interval );
+			mlt_events_fire( properties, "consumer-frame-show", frame, NULL );
+			mlt_frame_close( frame );
+		}
+	}
+	write_sheet( self );
+	self->sheet_index = -1;
+
+	self->running = 0;
+	mlt_consumer_stopped( consumer );
+
+	return NULL;
+}
+
+static void consumer_close( mlt_consumer consumer )
+{
+	consumer_sprites self = consumer->child;
+
+	mlt_consumer_stop( consumer );
+	mlt_consumer_close( consumer );
+	free( self->sheet );
+	free( self );
+}
@@ -19,20 +19,111 @@
 
 #include <framework/mlt_filter.h>
 #include <framework/mlt_frame.h>
+#include <framework/mlt_analysis.h>
+#include <framework/mlt_log.h>
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+/** Get the peaks of a frame from the sidecar named by the peaks property.
+ *
+ * The sidecar is mapped on first use and may be replaced by another thread
+ * when the property changes, so the peaks are copied while holding the
+ * service lock.
+ * \return count * channels triplets of minimum, maximum and RMS in a pool
+ * buffer or NULL if there is no sidecar with peaks
+ */
+
+static int16_t *get_peaks( mlt_filter filter, mlt_frame frame, int count, int *channels )
+{
+	mlt_properties properties = MLT_FILTER_PROPERTIES( filter );
+	const char *filename = mlt_properties_get( properties, "peaks" );
+	double window = mlt_properties_get_double( properties, "window" );
+	int16_t *peaks = NULL;
+	mlt_analysis analysis;
+
+	*channels = 0;
+	if ( !filename || !strcmp( filename, "" ) || count <= 0 )
+		return NULL;
+	if ( window <= 0.0 )
+		window = 1.0;
+
+	mlt_service_lock( MLT_FILTER_SERVICE( filter ) );
+	analysis = mlt_properties_get_data( properties, "_peaks", NULL );
+	if ( !mlt_properties_get( properties, "_peaks_file" )
+		 || strcmp( filename, mlt_properties_get( properties, "_peaks_file" ) ) )
+	{
+		analysis = mlt_analysis_load( filename );
+		if ( !analysis )
+			mlt_log_warning( MLT_FILTER_SERVICE( filter ), "failed to load peaks %s\n", filename );
+		mlt_properties_set_data( properties, "_peaks", analysis, 0, ( mlt_destructor )mlt_analysis_close, NULL );
+		mlt_properties_set( properties, "_peaks_file", filename );
+	}
+	if ( analysis )
+		*channels = mlt_analysis_get_peaks( analysis, 0, 0, 0, 0, NULL );
+	if ( *channels > 0 )
+		peaks = mlt_pool_alloc( count * *channels * 3 * sizeof( int16_t ) );
+	if ( peaks )
+		mlt_analysis_get_peaks( analysis, mlt_frame_original_position( frame ), window, count, *channels, peaks );
+	mlt_service_unlock( MLT_FILTER_SERVICE( filter ) );
+
+	return peaks;
+}
+
+/** Draw a waveform from the peaks of a sidecar without getting the audio.
+ *
+ * Each column spans window / width frames. The range between minimum and
+ * maximum is drawn in gray with the RMS around the center in white, with
+ * the channels stacked from the top.
+ */
+
+static uint8_t *draw_peaks( mlt_frame frame, const int16_t *peaks, int channels, int w, int h )
+{
+	uint8_t *bitmap;
+	int x, c, y;
+
+	if ( h < channels )
+		return NULL;
+	bitmap = mlt_pool_alloc( w * h );
+	if ( !bitmap )
+		return NULL;
+	memset( bitmap, 0, w * h );
+	mlt_properties_set_data( MLT_FRAME_PROPERTIES( frame ), "waveform", bitmap, w * h, ( mlt_destructor )mlt_pool_release, NULL );
+
+	for ( c = 0; c < channels; c++ )
+	{
+		int top = h * c / channels;
+		int half = ( h * ( c + 1 ) / channels - top ) / 2;
+		int center = top + half;
+		for ( x = 0; x < w; x++ )
+		{
+			const int16_t *p = peaks + ( x * channels + c ) * 3;
+			int high = center - half * p[1] / 32768;
+			int low = MIN( center - half * p[0] / 32768, center + half - 1 );
+			int rms = half * p[2] / 32768;
+			for ( y = high; y <= low; y++ )
+				bitmap[ y * w + x ] = y >= center - rms && y <= center + rms ? 0xFF : 0x80;
+		}
+	}
+	return bitmap;
+}
 
 /** Do it :-).
 */
 
 static int filter_get_image( mlt_frame frame, uint8_t **image, mlt_image_format *format, int *width, int *height, int writable )
 {
+	mlt_filter filter = mlt_frame_pop_service( frame );
+	int channels = 0;
+	int16_t *peaks = get_peaks( filter, frame, *width, &channels );
 	int size = *width * *height * 2;
 	*format = mlt_image_yuv422;
 	*image = mlt_pool_alloc( size );
 	mlt_frame_set_image( frame, *image, size, mlt_pool_release );
-	uint8_t *wave = mlt_frame_get_waveform( frame, *width, *height );
+	uint8_t *wave = peaks ? draw_peaks( frame, peaks, channels, *width, *height )
+		: mlt_frame_get_waveform( frame, *width, *height );
+	mlt_pool_release( peaks );
 	if ( wave )
 	{
 		uint8_t *p = *image;
@@ -53,6 +144,7 @@ static int filter_get_image( mlt_frame frame, uint8_t **image, mlt_image_format
 
 static mlt_frame filter_process( mlt_filter filter, mlt_frame frame )
 {
+	mlt_frame_push_service( frame, filter );
 	mlt_frame_push_get_image( frame, filter_get_image );
 	return frame;
 }
@@ -64,7 +156,10 @@ mlt_filter filter_audiowave_init( mlt_profile profile, mlt_service_type type, co
 {
 	mlt_filter filter = mlt_filter_new( );
 	if ( filter != NULL )
+	{
 		filter->process = filter_process;
+		mlt_properties_set_int( MLT_FILTER_PROPERTIES( filter ), "window", 1 );
+	}
 	return filter;
 }
 
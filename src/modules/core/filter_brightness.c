@@ -60,8 +60,9 @@ static int filter_get_image( mlt_frame frame, uint8_t **image, mlt_image_format
 	if ( level != 1.0 )
 		*format = mlt_image_yuv422;
 
-	// Get the image
-	int error = mlt_frame_get_image( frame, image, format, width, height, 1 );
+	// Get the image, leaving the luma and chroma scaling to be combined with other point operations
+	int error = level != 1.0 ? mlt_frame_get_image_lut( frame, image, format, width, height )
+		: mlt_frame_get_image( frame, image, format, width, height, 1 );
 
 	// Only process if we have no error.
 	if ( error == 0 )
@@ -69,17 +70,17 @@ static int filter_get_image( mlt_frame frame, uint8_t **image, mlt_image_format
 		// Only process if level is something other than 1
 		if ( level != 1.0 && *format == mlt_image_yuv422 )
 		{
-			int i = *width * *height + 1;
-			uint8_t *p = *image;
+			uint8_t lut[3][256];
 			int32_t m = level * ( 1 << 16 );
 			int32_t n = 128 * ( ( 1 << 16 ) - m );
+			int i;
 
-			while ( --i )
+			for ( i = 0; i < 256; i++ )
 			{
-				p[0] = CLAMP( (p[0] * m) >> 16, 16, 235 );
-				p[1] = CLAMP( (p[1] * m + n) >> 16, 16, 240 );
-				p += 2;
+				lut[0][i] = CLAMP( (i * m) >> 16, 16, 235 );
+				lut[1][i] = lut[2][i] = CLAMP( (i * m + n) >> 16, 16, 240 );
 			}
+			mlt_frame_add_lut( frame, *format, lut[0] );
 		}
 
 		// Process the alpha channel if requested.
@@ -0,0 +1,729 @@
+/*
+ * filter_diskcache.c -- cache rendered frames on disk
+ * Copyright (C) 2017 Meltytech, LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <framework/mlt.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <utime.h>
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
+#define DISKCACHE_MAGIC "MLTDC001"
+#define DISKCACHE_HEADER_SIZE 64
+
+/** The header of a cached frame file.
+ *
+ * The payload follows at DISKCACHE_HEADER_SIZE bytes: the image, the alpha
+ * channel and a list of NUL-separated name and value pairs for an image, or
+ * the samples for audio.
+ */
+
+typedef union
+{
+	struct
+	{
+		char magic[8];
+		int64_t length;
+		int32_t format;
+		int32_t width;
+		int32_t height;
+		int32_t image_size;
+		int32_t alpha_size;
+		int32_t properties_size;
+		int32_t frequency;
+		int32_t channels;
+		int32_t samples;
+		int32_t audio_size;
+	} h;
+	char pad[ DISKCACHE_HEADER_SIZE ];
+}
+diskcache_header;
+
+typedef struct
+{
+	uint64_t key;
+	int dirty;
+	mlt_properties listeners;
+	mlt_properties watched;
+	int64_t bytes;
+} private_data;
+
+/** The frame properties that describe the cached image.
+*/
+
+static const char *image_properties[] =
+{
+	"progressive",
+	"top_field_first",
+	"aspect_ratio",
+	"colorspace",
+	"color_trc",
+	"full_luma",
+	NULL
+};
+
+static uint64_t hash_string( uint64_t hash, const char *s )
+{
+	// FNV-1a
+	while ( *s )
+	{
+		hash ^= ( unsigned char ) *s++;
+		hash *= 0x100000001b3ULL;
+	}
+	return hash;
+}
+
+/** Determine if a property can affect rendering.
+ *
+ * Private properties and those in the namespace of an application, such as
+ * "shotcut:hash" or "kdenlive:id", are written often and only hold state or
+ * annotations, so they are not part of the key.
+ */
+
+static int is_key_property( const char *name )
+{
+	return name && name[0] != '_' && !strchr( name, ':' );
+}
+
+static uint64_t hash_properties( uint64_t hash, mlt_properties properties )
+{
+	int i, count = mlt_properties_count( properties );
+	for ( i = 0; i < count; i ++ )
+	{
+		const char *name = mlt_properties_get_name( properties, i );
+		const char *value = mlt_properties_get_value( properties, i );
+		if ( is_key_property( name ) && value )
+		{
+			hash = hash_string( hash, name );
+			hash = hash_string( hash, "=" );
+			hash = hash_string( hash, value );
+			hash = hash_string( hash, "\n" );
+		}
+	}
+	return hash;
+}
+
+static void on_filter_changed( mlt_properties owner, mlt_filter filter, char *name )
+{
+	if ( !strcmp( name, "service" ) )
+		( ( private_data* )filter->child )->dirty = 1;
+}
+
+/** A service that contributes to the key.
+*/
+
+typedef struct
+{
+	mlt_filter filter;
+	mlt_service service;
+	uint64_t filters;
+	uint64_t properties;
+} watch_data;
+
+static uint64_t hash_filters( mlt_service service )
+{
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	int i;
+	for ( i = 0; i < mlt_service_filter_count( service ); i ++ )
+	{
+		hash ^= ( uint64_t )( intptr_t )mlt_service_filter( service, i );
+		hash *= 0x100000001b3ULL;
+	}
+	return hash;
+}
+
+static void on_property_changed( mlt_properties owner, watch_data *watch, char *name )
+{
+	// Only invalidate the key when a property that is part of it has a new value.
+	if ( is_key_property( name ) )
+	{
+		uint64_t hash = hash_properties( 0xcbf29ce484222325ULL, MLT_SERVICE_PROPERTIES( watch->service ) );
+		if ( hash != watch->properties )
+		{
+			watch->properties = hash;
+			( ( private_data* )watch->filter->child )->dirty = 1;
+		}
+	}
+}
+
+static void on_service_changed( mlt_properties owner, watch_data *watch )
+{
+	// This is also fired for every property change of an attached filter
+	if ( hash_filters( watch->service ) != watch->filters )
+		( ( private_data* )watch->filter->child )->dirty = 1;
+}
+
+/** Listen for changes to a service that contributes to the key.
+*/
+
+static void watch_service( mlt_filter filter, mlt_service service )
+{
+	private_data *pdata = filter->child;
+	mlt_properties properties = MLT_SERVICE_PROPERTIES( service );
+	watch_data *watch;
+	char key[ 64 ];
+
+	snprintf( key, sizeof( key ), "%p", ( void* )service );
+	if ( mlt_properties_get_data( pdata->watched, key, NULL ) )
+		return;
+	watch = calloc( 1, sizeof( *watch ) );
+	watch->filter = filter;
+	watch->service = service;
+	watch->filters = hash_filters( service );
+	watch->properties = hash_properties( 0xcbf29ce484222325ULL, properties );
+	mlt_properties_set_data( pdata->watched, key, watch, 0, free, NULL );
+
+	// Keep the events valid after their owner closes so they can be closed here
+	mlt_event event = mlt_events_listen( properties, watch, "property-changed", ( mlt_listener )on_property_changed );
+	mlt_event_inc_ref( event );
+	snprintf( key, sizeof( key ), "%p property", ( void* )service );
+	mlt_properties_set_data( pdata->listeners, key, event, 0, ( mlt_destructor )mlt_event_close, NULL );
+	event = mlt_events_listen( properties, watch, "service-changed", ( mlt_listener )on_service_changed );
+	mlt_event_inc_ref( event );
+	snprintf( key, sizeof( key ), "%p service", ( void* )service );
+	mlt_properties_set_data( pdata->listeners, key, event, 0, ( mlt_destructor )mlt_event_close, NULL );
+}
+
+/** Hash a service and everything upstream of it.
+ *
+ * Each service hashed is watched for changes that invalidate the key.
+ * \param stop the diskcache filter, at which to stop hashing the filters of the service it is attached to
+ */
+
+static uint64_t hash_service( uint64_t hash, mlt_service service, mlt_filter stop )
+{
+	int i;
+
+	if ( !service )
+		return hash;
+
+	hash = hash_properties( hash, MLT_SERVICE_PROPERTIES( service ) );
+	watch_service( stop, service );
+
+	for ( i = 0; i < mlt_service_filter_count( service ); i ++ )
+	{
+		mlt_filter filter = mlt_service_filter( service, i );
+		if ( filter == stop )
+			break;
+		hash = hash_properties( hash, MLT_FILTER_PROPERTIES( filter ) );
+		watch_service( stop, MLT_FILTER_SERVICE( filter ) );
+	}
+
+	switch ( mlt_service_identify( service ) )
+	{
+		case playlist_type:
+		{
+			mlt_playlist playlist = MLT_PLAYLIST( service );
+			for ( i = 0; i < mlt_playlist_count( playlist ); i ++ )
+			{
+				mlt_producer clip = mlt_playlist_get_clip( playlist, i );
+				hash = hash_service( hash, MLT_PRODUCER_SERVICE( clip ), stop );
+			}
+			break;
+		}
+		case multitrack_type:
+		{
+			mlt_multitrack multitrack = MLT_MULTITRACK( service );
+			for ( i = 0; i < mlt_multitrack_count( multitrack ); i ++ )
+				hash = hash_service( hash, MLT_PRODUCER_SERVICE( mlt_multitrack_track( multitrack, i ) ), stop );
+			break;
+		}
+		case producer_type:
+			if ( mlt_producer_is_cut( MLT_PRODUCER( service ) ) )
+				hash = hash_service( hash, MLT_PRODUCER_SERVICE( mlt_producer_cut_parent( MLT_PRODUCER( service ) ) ), stop );
+			break;
+		case tractor_type:
+		case filter_type:
+		case transition_type:
+			// Follow the chain of connected services
+			hash = hash_service( hash, mlt_service_producer( service ), stop );
+			break;
+		default:
+			break;
+	}
+
+	return hash;
+}
+
+/** Get the key of the upstream service graph.
+ *
+ * The graph is only hashed again after a change to one of its services has
+ * been signalled; the profile is cheap to hash and is not signalled.
+ */
+
+static uint64_t graph_key( mlt_filter filter )
+{
+	private_data *pdata = filter->child;
+	mlt_properties properties = MLT_FILTER_PROPERTIES( filter );
+	mlt_profile profile = mlt_service_profile( MLT_FILTER_SERVICE( filter ) );
+	uint64_t hash;
+
+	mlt_service_lock( MLT_FILTER_SERVICE( filter ) );
+	if ( pdata->dirty )
+	{
+		mlt_service service = mlt_properties_get_data( properties, "service", NULL );
+
+		// Clear the flag first so that a change during hashing is not lost
+		pdata->dirty = 0;
+		mlt_properties_close( pdata->listeners );
+		mlt_properties_close( pdata->watched );
+		pdata->listeners = mlt_properties_new( );
+		pdata->watched = mlt_properties_new( );
+		if ( !service )
+			service = mlt_service_producer( MLT_FILTER_SERVICE( filter ) );
+		pdata->key = hash_service( 0xcbf29ce484222325ULL, service, filter );
+	}
+	hash = pdata->key;
+	mlt_service_unlock( MLT_FILTER_SERVICE( filter ) );
+
+	if ( profile )
+	{
+		char profile_key[ 64 ];
+		snprintf( profile_key, sizeof( profile_key ), "%d/%d %d", profile->frame_rate_num, profile->frame_rate_den, profile->colorspace );
+		hash = hash_string( hash, profile_key );
+	}
+
+	return hash;
+}
+
+static char *cache_filename( mlt_properties unique, const char *suffix )
+{
+	const char *directory = mlt_properties_get( unique, "directory" );
+	const char *key = mlt_properties_get( unique, "key" );
+	size_t n = strlen( directory ) + strlen( key ) + strlen( suffix ) + 3;
+	char *filename = malloc( n );
+	snprintf( filename, n, "%s/%s.%s", directory, key, suffix );
+	return filename;
+}
+
+/** Release a payload obtained from map_file().
+*/
+
+static void unmap_file( void *data )
+{
+	char *base = ( char* )data - DISKCACHE_HEADER_SIZE;
+#ifdef _WIN32
+	free( base );
+#else
+	munmap( base, ( ( diskcache_header* )base )->h.length );
+#endif
+}
+
+/** Map a cached frame file into memory.
+ *
+ * The mapping is private so that downstream services may write into it.
+ * \return the header or NULL if the file does not exist or is invalid
+ */
+
+static diskcache_header *map_file( const char *filename )
+{
+	diskcache_header *header = NULL;
+	struct stat st;
+	FILE *f;
+
+	if ( stat( filename, &st ) || st.st_size < DISKCACHE_HEADER_SIZE || !( f = fopen( filename, "rb" ) ) )
+		return NULL;
+#ifdef _WIN32
+	header = malloc( st.st_size );
+	if ( header && fread( header, st.st_size, 1, f ) != 1 )
+	{
+		free( header );
+		header = NULL;
+	}
+#else
+	header = mmap( NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fileno( f ), 0 );
+	if ( header == MAP_FAILED )
+		header = NULL;
+#endif
+	fclose( f );
+
+	if ( header && ( memcmp( header->h.magic, DISKCACHE_MAGIC, sizeof( header->h.magic ) ) || header->h.length != st.st_size ) )
+	{
+#ifdef _WIN32
+		free( header );
+#else
+		munmap( header, st.st_size );
+#endif
+		header = NULL;
+	}
+	return header;
+}
+
+/** Write a cached frame file.
+ *
+ * The file is written under a temporary name first so that concurrent
+ * readers never see a partial frame.
+ * \return true on error
+ */
+
+static int write_file( const char *filename, diskcache_header *header, const void *data[], const int sizes[], int count )
+{
+	size_t n = strlen( filename ) + 32;
+	char *temp = malloc( n );
+	int error = 1;
+	int i;
+
+	snprintf( temp, n, "%s.%p.tmp", filename, ( void* )header );
+	FILE *f = fopen( temp, "wb" );
+	if ( f )
+	{
+		memcpy( header->h.magic, DISKCACHE_MAGIC, sizeof( header->h.magic ) );
+		header->h.length = DISKCACHE_HEADER_SIZE;
+		for ( i = 0; i < count; i ++ )
+			header->h.length += sizes[i];
+		error = fwrite( header, DISKCACHE_HEADER_SIZE, 1, f ) != 1;
+		for ( i = 0; !error && i < count; i ++ )
+			error = sizes[i] && fwrite( data[i], sizes[i], 1, f ) != 1;
+		error = fclose( f ) || error;
+		if ( !error )
+			error = rename( temp, filename );
+		if ( error )
+			remove( temp );
+	}
+	if ( error )
+		mlt_log_warning( NULL, "[filter diskcache] failed to write %s\n", filename );
+	free( temp );
+	return error;
+}
+
+typedef struct
+{
+	const char *name;
+	time_t mtime;
+	int64_t size;
+} cache_file;
+
+static int compare_mtime( const void *a, const void *b )
+{
+	const cache_file *x = a, *y = b;
+	return x->mtime < y->mtime ? -1 : x->mtime > y->mtime;
+}
+
+/** Delete the least recently used files of the cache directory.
+ *
+ * The size of the directory is measured when first needed and whenever it
+ * exceeds max_bytes, and files are then deleted in the order of their
+ * modification time, which a hit refreshes, until the directory is below
+ * three quarters of max_bytes.
+ */
+
+static void evict_files( mlt_filter filter, const char *directory, int64_t max_bytes )
+{
+	private_data *pdata = filter->child;
+	mlt_properties names = mlt_properties_new( );
+	cache_file *files;
+	int64_t total = 0;
+	int i, count;
+
+	mlt_properties_dir_list( names, directory, "*.image", 0 );
+	mlt_properties_dir_list( names, directory, "*.audio", 0 );
+	count = mlt_properties_count( names );
+	files = calloc( count + 1, sizeof( *files ) );
+	for ( i = 0; i < count; i ++ )
+	{
+		struct stat st;
+		files[i].name = mlt_properties_get_value( names, i );
+		if ( !stat( files[i].name, &st ) )
+		{
+			files[i].mtime = st.st_mtime;
+			files[i].size = st.st_size;
+			total += st.st_size;
+		}
+	}
+	if ( total > max_bytes )
+	{
+		qsort( files, count, sizeof( *files ), compare_mtime );
+		for ( i = 0; i < count && total > max_bytes * 3 / 4; i ++ )
+		{
+			if ( files[i].size && !remove( files[i].name ) )
+				total -= files[i].size;
+		}
+		mlt_log_verbose( MLT_FILTER_SERVICE( filter ), "evicted %d files, %"PRId64" bytes remain\n", i, total );
+	}
+	pdata->bytes = total;
+	free( files );
+	mlt_properties_close( names );
+}
+
+/** Account for a file added to the cache and enforce max_bytes.
+*/
+
+static void add_file( mlt_filter filter, const char *directory, int64_t size )
+{
+	private_data *pdata = filter->child;
+	int64_t max_bytes = mlt_properties_get_int64( MLT_FILTER_PROPERTIES( filter ), "max_bytes" );
+
+	if ( max_bytes > 0 )
+	{
+		mlt_service_lock( MLT_FILTER_SERVICE( filter ) );
+		if ( pdata->bytes < 0 || ( pdata->bytes += size ) > max_bytes )
+			evict_files( filter, directory, max_bytes );
+		mlt_service_unlock( MLT_FILTER_SERVICE( filter ) );
+	}
+}
+
+/** Mark a cached file as recently used.
+*/
+
+static void touch_file( mlt_filter filter, const char *filename )
+{
+	if ( mlt_properties_get_int64( MLT_FILTER_PROPERTIES( filter ), "max_bytes" ) > 0 )
+		utime( filename, NULL );
+}
+
+static int filter_get_image( mlt_frame frame, uint8_t **image, mlt_image_format *format, int *width, int *height, int writable )
+{
+	mlt_properties properties = MLT_FRAME_PROPERTIES( frame );
+	mlt_properties unique = mlt_frame_pop_service( frame );
+	mlt_filter filter = mlt_properties_get_data( unique, "filter", NULL );
+	char suffix[ 64 ];
+	int error;
+
+	snprintf( suffix, sizeof( suffix ), "%dx%d.%d.image", *width, *height, *format );
+	char *filename = cache_filename( unique, suffix );
+	diskcache_header *header = map_file( filename );
+
+	if ( header )
+	{
+		uint8_t *data = ( uint8_t* )header + DISKCACHE_HEADER_SIZE;
+		const char *p = ( const char* )data + header->h.image_size + header->h.alpha_size;
+		const char *end = p + header->h.properties_size;
+
+		mlt_log_debug( NULL, "[filter diskcache] hit %s\n", filename );
+		touch_file( filter, filename );
+		*format = header->h.format;
+		*width = header->h.width;
+		*height = header->h.height;
+		*image = data;
+		mlt_frame_set_image( frame, data, header->h.image_size, unmap_file );
+		if ( header->h.alpha_size )
+		{
+			uint8_t *alpha = mlt_pool_alloc( header->h.alpha_size );
+			memcpy( alpha, data + header->h.image_size, header->h.alpha_size );
+			mlt_frame_set_alpha( frame, alpha, header->h.alpha_size, mlt_pool_release );
+		}
+		while ( p < end )
+		{
+			const char *value = p + strlen( p ) + 1;
+			mlt_properties_set( properties, p, value );
+			p = value + strlen( value ) + 1;
+		}
+		error = 0;
+	}
+	else
+	{
+		error = mlt_frame_get_image( frame, image, format, width, height, writable );
+		if ( !error && *image && *format != mlt_image_glsl && *format != mlt_image_glsl_texture && *format != mlt_image_opengl )
+		{
+			diskcache_header out;
+			mlt_properties names = mlt_properties_new( );
+			const void *data[3];
+			int sizes[3];
+			int i, n = 0;
+
+			memset( &out, 0, sizeof( out ) );
+			out.h.format = *format;
+			out.h.width = *width;
+			out.h.height = *height;
+			out.h.image_size = mlt_image_format_size( *format, *width, *height, NULL );
+			out.h.alpha_size = mlt_frame_get_alpha( frame ) ? *width * *height : 0;
+
+			// Collect the properties that describe the image
+			for ( i = 0; i < mlt_properties_count( properties ); i ++ )
+			{
+				const char *name = mlt_properties_get_name( properties, i );
+				const char *value = mlt_properties_get_value( properties, i );
+				int j, keep = name && value && !strncmp( name, "meta.", 5 );
+				for ( j = 0; !keep && name && value && image_properties[j]; j ++ )
+					keep = !strcmp( name, image_properties[j] );
+				if ( keep )
+				{
+					mlt_properties_set( names, name, value );
+					n += strlen( name ) + strlen( value ) + 2;
+				}
+			}
+			char *buffer = malloc( n + 1 );
+			char *p = buffer;
+			for ( i = 0; i < mlt_properties_count( names ); i ++ )
+			{
+				p += sprintf( p, "%s", mlt_properties_get_name( names, i ) ) + 1;
+				p += sprintf( p, "%s", mlt_properties_get_value( names, i ) ) + 1;
+			}
+			out.h.properties_size = n;
+
+			data[0] = *image;
+			sizes[0] = out.h.image_size;
+			data[1] = mlt_frame_get_alpha( frame );
+			sizes[1] = out.h.alpha_size;
+			data[2] = buffer;
+			sizes[2] = n;
+			if ( !write_file( filename, &out, data, sizes, 3 ) )
+				add_file( filter, mlt_properties_get( unique, "directory" ), out.h.length );
+
+			free( buffer );
+			mlt_properties_close( names );
+		}
+	}
+	free( filename );
+
+	return error;
+}
+
+static int filter_get_audio( mlt_frame frame, void **buffer, mlt_audio_format *format, int *frequency, int *channels, int *samples )
+{
+	mlt_properties unique = mlt_frame_pop_audio( frame );
+	mlt_filter filter = mlt_properties_get_data( unique, "filter", NULL );
+	char suffix[ 64 ];
+	int error;
+
+	snprintf( suffix, sizeof( suffix ), "%d.%d.%d.%d.audio", *frequency, *channels, *samples, *format );
+	char *filename = cache_filename( unique, suffix );
+	diskcache_header *header = map_file( filename );
+
+	if ( header )
+	{
+		mlt_log_debug( NULL, "[filter diskcache] hit %s\n", filename );
+		touch_file( filter, filename );
+		*format = header->h.format;
+		*frequency = header->h.frequency;
+		*channels = header->h.channels;
+		*samples = header->h.samples;
+		*buffer = ( char* )header + DISKCACHE_HEADER_SIZE;
+		mlt_frame_set_audio( frame, *buffer, *format, header->h.audio_size, unmap_file );
+		error = 0;
+	}
+	else
+	{
+		error = mlt_frame_get_audio( frame, buffer, format, frequency, channels, samples );
+		if ( !error && *buffer && *format != mlt_audio_none )
+		{
+			diskcache_header out;
+			const void *data[1] = { *buffer };
+			int sizes[1];
+
+			memset( &out, 0, sizeof( out ) );
+			out.h.format = *format;
+			out.h.frequency = *frequency;
+			out.h.channels = *channels;
+			out.h.samples = *samples;
+			out.h.audio_size = sizes[0] = mlt_audio_format_size( *format, *samples, *channels );
+			if ( !write_file( filename, &out, data, sizes, 1 ) )
+				add_file( filter, mlt_properties_get( unique, "directory" ), out.h.length );
+		}
+	}
+	free( filename );
+
+	return error;
+}
+
+static mlt_frame filter_process( mlt_filter filter, mlt_frame frame )
+{
+	mlt_properties properties = MLT_FILTER_PROPERTIES( filter );
+	const char *directory = mlt_properties_get( properties, "directory" );
+	int image = mlt_properties_get_int( properties, "image" ) && !mlt_frame_is_test_card( frame );
+	int audio = mlt_properties_get_int( properties, "audio" ) && !mlt_frame_is_test_audio( frame );
+
+	// Audio depends on the playback direction and speed
+	if ( mlt_properties_get( MLT_FRAME_PROPERTIES( frame ), "_speed" ) && mlt_properties_get_double( MLT_FRAME_PROPERTIES( frame ), "_speed" ) != 1.0 )
+		audio = 0;
+
+	if ( directory && ( image || audio ) )
+	{
+		mlt_properties unique = mlt_frame_unique_properties( frame, MLT_FILTER_SERVICE( filter ) );
+		char key[ 64 ];
+
+		// Any change upstream yields a new key
+		snprintf( key, sizeof( key ), "%016llx-%d", ( unsigned long long ) graph_key( filter ), mlt_frame_get_position( frame ) );
+		mlt_properties_set( unique, "directory", directory );
+		mlt_properties_set( unique, "key", key );
+		mlt_properties_set_data( unique, "filter", filter, 0, NULL, NULL );
+
+		if ( image )
+		{
+			mlt_frame_push_service( frame, unique );
+			mlt_frame_push_get_image( frame, filter_get_image );
+		}
+		if ( audio )
+		{
+			mlt_frame_push_audio( frame, unique );
+			mlt_frame_push_audio( frame, filter_get_audio );
+		}
+	}
+
+	return frame;
+}
+
+/** Destructor for the filter.
+*/
+
+static void filter_close( mlt_filter filter )
+{
+	private_data *pdata = filter->child;
+
+	if ( pdata )
+	{
+		mlt_properties_close( pdata->listeners );
+		mlt_properties_close( pdata->watched );
+		free( pdata );
+	}
+	filter->child = NULL;
+	filter->close = NULL;
+	filter->parent.close = NULL;
+	mlt_service_close( &filter->parent );
+}
+
+/** Constructor for the filter.
+*/
+
+mlt_filter filter_diskcache_init( mlt_profile profile, mlt_service_type type, const char *id, char *arg )
+{
+	mlt_filter filter = mlt_filter_new( );
+	private_data *pdata = calloc( 1, sizeof( private_data ) );
+	if ( filter != NULL && pdata != NULL )
+	{
+		mlt_properties properties = MLT_FILTER_PROPERTIES( filter );
+		pdata->dirty = 1;
+		pdata->bytes = -1;
+		filter->child = pdata;
+		filter->close = filter_close;
+
+		// Attaching the filter to another service changes the key
+		mlt_events_listen( properties, filter, "property-changed", ( mlt_listener )on_filter_changed );
+		if ( arg )
+			mlt_properties_set( properties, "directory", arg );
+		else
+			mlt_properties_set( properties, "directory", getenv( "MLT_DISKCACHE_DIR" ) );
+		mlt_properties_set_int( properties, "image", 1 );
+		mlt_properties_set_int( properties, "audio", 1 );
+		filter->process = filter_process;
+	}
+	else
+	{
+		mlt_filter_close( filter );
+		filter = NULL;
+		free( pdata );
+	}
+	return filter;
+}
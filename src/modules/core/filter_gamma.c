@@ -35,31 +35,26 @@ static int filter_get_image( mlt_frame frame, uint8_t **image, mlt_image_format
 	mlt_position length = mlt_filter_get_length2( filter, frame );
 
 	*format = mlt_image_yuv422;
-	int error = mlt_frame_get_image( frame, image, format, width, height, 1 );
+	int error = mlt_frame_get_image_lut( frame, image, format, width, height );
 
-	if ( error == 0 )
+	if ( error == 0 && *format == mlt_image_yuv422 )
 	{
 		// Get the gamma value
 		double gamma = mlt_properties_anim_get_double( properties, "gamma", position, length );
 
 		if ( gamma != 1.0 )
 		{
-			uint8_t *p = *image;
-			uint8_t *q = *image + *width * *height * 2;
-
-			// Calculate the look up table
+			// Calculate the look up table for the luma, leaving the chroma as it is
 			double exp = 1 / gamma;
-			uint8_t lookup[ 256 ];
+			uint8_t lookup[ 3 ][ 256 ];
 			int i;
 
 			for( i = 0; i < 256; i ++ )
-				lookup[ i ] = ( uint8_t )( pow( ( double )i / 255.0, exp ) * 255 );
-
-			while ( p != q )
 			{
-				*p = lookup[ *p ];
-				p += 2;
+				lookup[ 0 ][ i ] = ( uint8_t )( pow( ( double )i / 255.0, exp ) * 255 );
+				lookup[ 1 ][ i ] = lookup[ 2 ][ i ] = i;
 			}
+			mlt_frame_add_lut( frame, *format, lookup[ 0 ] );
 		}
 	}
 
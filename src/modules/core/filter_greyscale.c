@@ -29,13 +29,17 @@
 static int filter_get_image( mlt_frame frame, uint8_t **image, mlt_image_format *format, int *width, int *height, int writable )
 {
 	*format = mlt_image_yuv422;
-	int error = mlt_frame_get_image( frame, image, format, width, height, 1 );
-	if ( error == 0 )
+	int error = mlt_frame_get_image_lut( frame, image, format, width, height );
+	if ( error == 0 && *format == mlt_image_yuv422 )
 	{
-		uint8_t *p = *image;
-		uint8_t *q = *image + *width * *height * 2;
-		while ( p ++ != q )
-			*p ++ = 128;
+		uint8_t lut[3][256];
+		int i;
+		for ( i = 0; i < 256; i++ )
+		{
+			lut[0][i] = i;
+			lut[1][i] = lut[2][i] = 128;
+		}
+		mlt_frame_add_lut( frame, *format, lut[0] );
 	}
 	return error;
 }
@@ -37,8 +37,8 @@ static int filter_get_audio( mlt_frame frame, void **buffer, mlt_audio_format *f
 	mlt_properties filter_props = MLT_FILTER_PROPERTIES( filter );
 	mlt_properties frame_props = MLT_FRAME_PROPERTIES( frame );
 
-	// We can only mix interleaved 32-bit float.
-	*format = mlt_audio_f32le;
+	// We can only mix planar 32-bit float.
+	*format = mlt_audio_float;
 	mlt_frame_get_audio( frame, (void**) buffer, format, frequency, channels, samples );
 
 	// Apply silence
@@ -174,8 +174,8 @@ static int filter_get_audio( mlt_frame frame, void **buffer, mlt_audio_format *f
 		{
 			v = 0;
 			for ( in = 0; in < *channels && in < 6; in++ )
-				v += factors[in][out] * src[ i * *channels + in ];
-			dest[ i * *channels + out ] = v;
+				v += factors[in][out] * src[ in * *samples + i ];
+			dest[ out * *samples + i ] = v;
 		}
 		weight += weight_step;
 	}
@@ -21,6 +21,7 @@
 #include <framework/mlt_frame.h>
 #include <framework/mlt_log.h>
 #include <framework/mlt_profile.h>
+#include <framework/mlt_slices.h>
 
 #include <stdio.h>
 #include <string.h>
@@ -109,32 +110,70 @@ static int filter_scale( mlt_frame frame, uint8_t **image, mlt_image_format *for
 	return 0;
 }
 
-static void scale_alpha( mlt_frame frame, int iwidth, int iheight, int owidth, int oheight )
+struct scale_alpha_desc
+{
+	uint8_t *output;
+	uint8_t *input;
+	int *columns;
+	int iwidth;
+	int owidth;
+	int oheight;
+	int oy;
+};
+
+static int scale_alpha_slice( int id, int idx, int jobs, void *cookie )
+{
+	struct scale_alpha_desc *desc = ( struct scale_alpha_desc* ) cookie;
+	int start = desc->oheight * idx / jobs;
+	int end = desc->oheight * ( idx + 1 ) / jobs;
+	int i, j;
+
+	for ( i = start; i < end; i++ )
+	{
+		int y = ( desc->oy >> 1 ) + i * desc->oy;
+		uint8_t *in_line = &desc->input[ ( y >> 16 ) * desc->iwidth ];
+		uint8_t *out_line = desc->output + i * desc->owidth;
+		for ( j = 0; j < desc->owidth; j++ )
+			out_line[ j ] = in_line[ desc->columns[ j ] ];
+	}
+	return 0;
+}
+
+static void scale_alpha( mlt_frame frame, int iwidth, int iheight, int owidth, int oheight, int threads )
 {
 	// Scale the alpha
-	uint8_t *output = NULL;
 	uint8_t *input = mlt_frame_get_alpha( frame );
 
 	if ( input != NULL )
 	{
-		uint8_t *out_line, *in_line;
-		register int i, j, x, y;
-		register int ox = ( iwidth << 16 ) / owidth;
-		register int oy = ( iheight << 16 ) / oheight;
-
-		output = mlt_pool_alloc( owidth * oheight );
-		out_line = output;
-
-   		// Loop for the entirety of our output height.
-		for ( i = 0, y = (oy >> 1); i < oheight; i++, y += oy )
-		{
-			in_line = &input[ (y >> 16) * iwidth ];
-			for ( j = 0, x = (ox >> 1); j < owidth; j++, x += ox )
-				*out_line ++ = in_line[ x >> 16 ];
-		}
+		struct scale_alpha_desc desc;
+		int j, x;
+		int ox = ( iwidth << 16 ) / owidth;
+		int jobs = CLAMP( threads, 0, mlt_slices_count_normal() );
+
+		desc.output = mlt_pool_alloc( owidth * oheight );
+		desc.input = input;
+		desc.iwidth = iwidth;
+		desc.owidth = owidth;
+		desc.oheight = oheight;
+		desc.oy = ( iheight << 16 ) / oheight;
+
+		// The source column is the same on every row
+		desc.columns = mlt_pool_alloc( owidth * sizeof( int ) );
+		for ( j = 0, x = ( ox >> 1 ); j < owidth; j++, x += ox )
+			desc.columns[ j ] = x >> 16;
+
+		if ( jobs == 0 )
+			jobs = mlt_slices_count_normal();
+		jobs = CLAMP( jobs, 1, oheight / 64 );
+		if ( jobs == 1 )
+			scale_alpha_slice( 0, 0, 1, &desc );
+		else
+			mlt_slices_run_normal( jobs, scale_alpha_slice, &desc );
+		mlt_pool_release( desc.columns );
 
 		// Set it back on the frame
-		mlt_frame_set_alpha( frame, output, owidth * oheight, mlt_pool_release );
+		mlt_frame_set_alpha( frame, desc.output, owidth * oheight, mlt_pool_release );
 	}
 }
 
@@ -241,7 +280,7 @@ static int filter_get_image( mlt_frame frame, uint8_t **image, mlt_image_format
 			int alpha_size = 0;
 			mlt_properties_get_data( properties, "alpha", &alpha_size );
 			if ( alpha_size > 0 && alpha_size != ( owidth * oheight ) && alpha_size != ( owidth * ( oheight + 1 ) ) )
-				scale_alpha( frame, iwidth, iheight, owidth, oheight );
+				scale_alpha( frame, iwidth, iheight, owidth, oheight, mlt_properties_get_int( filter_properties, "threads" ) );
 		}
 		else
 		{
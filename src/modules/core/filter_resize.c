@@ -20,59 +20,150 @@
 #include <framework/mlt_filter.h>
 #include <framework/mlt_frame.h>
 #include <framework/mlt_profile.h>
+#include <framework/mlt_slices.h>
 
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 #include <math.h>
 
-static uint8_t *resize_alpha( uint8_t *input, int owidth, int oheight, int iwidth, int iheight, uint8_t alpha_value )
+struct resize_desc
 {
-	uint8_t *output = NULL;
+	uint8_t *output;
+	uint8_t *input;
+	int ostride;
+	int istride;
+	int oheight;
+	int iheight;
+	int offset_x;
+	int offset_y;
+	int bpp;
+	int in_place;
+	uint8_t pad[4];
+};
+
+/** Fill a run of bytes with a repeating pattern of bpp bytes.
+ *
+ * The pattern is doubled with memcpy so that long runs use the wide stores of
+ * the C library instead of a loop over single bytes.
+ */
 
-	if ( input != NULL && ( iwidth != owidth || iheight != oheight ) && ( owidth > 6 && oheight > 6 ) )
-	{
-		uint8_t *out_line;
-		int offset_x = ( owidth - iwidth ) / 2;
-		int offset_y = ( oheight - iheight ) / 2;
-		int iused = iwidth;
+static void fill_pattern( uint8_t *p, int size, const uint8_t *pattern, int bpp )
+{
+	int done = bpp < size ? bpp : size;
 
-		output = mlt_pool_alloc( owidth * oheight );
-		memset( output, alpha_value, owidth * oheight );
+	if ( size <= 0 )
+		return;
+	if ( bpp == 1 )
+	{
+		memset( p, pattern[0], size );
+		return;
+	}
+	memcpy( p, pattern, done );
+	while ( done < size )
+	{
+		int n = done < size - done ? done : size - done;
+		memcpy( p + done, p, n );
+		done += n;
+	}
+}
 
-		offset_x -= offset_x % 2;
+static void resize_rows( struct resize_desc *desc, int start, int end )
+{
+	int y;
 
-		out_line = output + offset_y * owidth;
-		out_line += offset_x;
+	for ( y = start; y < end; y ++ )
+	{
+		uint8_t *out_line = desc->output + y * desc->ostride;
+		int row = y - desc->offset_y;
 
-		// Loop for the entirety of our output height.
-		while ( iheight -- )
+		if ( row < 0 || row >= desc->iheight )
+		{
+			fill_pattern( out_line, desc->ostride, desc->pad, desc->bpp );
+		}
+		else if ( desc->offset_x < 0 )
 		{
-			// We're in the input range for this row.
-			memcpy( out_line, input, iused );
+			// A wider input is cut to the output
+			memcpy( out_line, desc->input + row * desc->istride - desc->offset_x, desc->ostride );
+		}
+		else
+		{
+			fill_pattern( out_line, desc->offset_x, desc->pad, desc->bpp );
+			if ( !desc->in_place )
+				memcpy( out_line + desc->offset_x, desc->input + row * desc->istride, desc->istride );
+			fill_pattern( out_line + desc->offset_x + desc->istride, desc->ostride - desc->offset_x - desc->istride, desc->pad, desc->bpp );
+		}
+	}
+}
 
-			// Move to next input line
-			input += iwidth;
+static int resize_slice( int id, int idx, int jobs, void *cookie )
+{
+	struct resize_desc *desc = ( struct resize_desc* ) cookie;
+	resize_rows( desc, desc->oheight * idx / jobs, desc->oheight * ( idx + 1 ) / jobs );
+	return 0;
+}
 
-			// Move to next output line
-			out_line += owidth;
-		}
+/** Centre the input in the output and fill the borders, writing every output byte once.
+ *
+ * The bands of rows are spread over the slice threads. The output may be the
+ * input buffer itself; the rows are then moved into place from the bottom up
+ * first, because each row lands on input rows that follow it.
+ */
+
+static void resize_pad( struct resize_desc *desc, int threads )
+{
+	int jobs = CLAMP( threads, 0, mlt_slices_count_normal() );
+
+	if ( jobs == 0 )
+		jobs = mlt_slices_count_normal();
+	jobs = CLAMP( jobs, 1, desc->oheight / 64 );
+
+	desc->in_place = desc->output == desc->input;
+	if ( desc->in_place )
+	{
+		int y;
+		for ( y = desc->iheight - 1; y >= 0; y -- )
+			memmove( desc->output + ( desc->offset_y + y ) * desc->ostride + desc->offset_x,
+				desc->input + y * desc->istride, desc->istride );
 	}
 
-	return output;
+	if ( jobs == 1 )
+		resize_rows( desc, 0, desc->oheight );
+	else
+		mlt_slices_run_normal( jobs, resize_slice, desc );
 }
 
-static void resize_image( uint8_t *output, int owidth, int oheight, uint8_t *input, int iwidth, int iheight, int bpp )
+static uint8_t *resize_alpha( uint8_t *output, uint8_t *input, int owidth, int oheight, int iwidth, int iheight, uint8_t alpha_value, int threads )
 {
-	// Calculate strides
-	int istride = iwidth * bpp;
-	int ostride = owidth * bpp;
-	int offset_x = ( owidth - iwidth ) / 2 * bpp;
-	int offset_y = ( oheight - iheight ) / 2;
-	uint8_t *in_line = input;
-	uint8_t *out_line;
-	int size = owidth * oheight;
-	uint8_t *p = output;
+	if ( input != NULL && ( iwidth != owidth || iheight != oheight ) && ( owidth > 6 && oheight > 6 ) )
+	{
+		struct resize_desc desc;
+		int offset_x = ( owidth - iwidth ) / 2;
+
+		offset_x -= offset_x % 2;
+		if ( output == NULL )
+			output = mlt_pool_alloc( owidth * oheight );
+
+		desc.output = output;
+		desc.input = input;
+		desc.ostride = owidth;
+		desc.istride = iwidth;
+		desc.oheight = oheight;
+		desc.iheight = iheight;
+		desc.offset_x = offset_x;
+		desc.offset_y = ( oheight - iheight ) / 2;
+		desc.bpp = 1;
+		desc.pad[0] = alpha_value;
+		resize_pad( &desc, threads );
+		return output;
+	}
+
+	return NULL;
+}
+
+static void resize_image( uint8_t *output, int owidth, int oheight, uint8_t *input, int iwidth, int iheight, int bpp, int threads )
+{
+	struct resize_desc desc;
 
 	// Optimisation point
 	if ( output == NULL || input == NULL || ( owidth <= 6 || oheight <= 6 || iwidth <= 6 || oheight <= 6 ) )
@@ -81,54 +172,47 @@ static void resize_image( uint8_t *output, int owidth, int oheight, uint8_t *inp
 	}
 	else if ( iwidth == owidth && iheight == oheight )
 	{
-		memcpy( output, input, iheight * istride );
+		if ( output != input )
+			memcpy( output, input, iheight * iwidth * bpp );
 		return;
 	}
 
+	desc.output = output;
+	desc.input = input;
+	desc.ostride = owidth * bpp;
+	desc.istride = iwidth * bpp;
+	desc.oheight = oheight;
+	desc.iheight = iheight;
+	desc.offset_x = ( owidth - iwidth ) / 2 * bpp;
+	desc.offset_y = ( oheight - iheight ) / 2;
+	desc.bpp = bpp;
+	memset( desc.pad, 0, sizeof( desc.pad ) );
 	if ( bpp == 2 )
 	{
-		while( size -- )
-		{
-			*p ++ = 16;
-			*p ++ = 128;
-		}
-		offset_x -= offset_x % 4;
+		desc.pad[0] = 16;
+		desc.pad[1] = 128;
+		desc.offset_x -= desc.offset_x % 4;
 	}
 	else
 	{
-		size *= bpp;
-		while ( size-- )
-			*p ++ = 0;
-	}
-
-	out_line = output + offset_y * ostride;
-	out_line += offset_x;
-
-	// Loop for the entirety of our output height.
-	while ( iheight -- )
-	{
-		// We're in the input range for this row.
-		memcpy( out_line, in_line, istride );
-
-		// Move to next input line
-		in_line += istride;
-
-		// Move to next output line
-		out_line += ostride;
+		desc.bpp = 1;
 	}
+	resize_pad( &desc, threads );
 }
 
 /** A padding function for frames - this does not rescale, but simply
 	resizes.
 */
 
-static uint8_t *frame_resize_image( mlt_frame frame, int owidth, int oheight, int bpp )
+static uint8_t *frame_resize_image( mlt_frame frame, mlt_filter filter, int owidth, int oheight, int bpp, int writable )
 {
 	// Get properties
 	mlt_properties properties = MLT_FRAME_PROPERTIES( frame );
+	int threads = mlt_properties_get_int( MLT_FILTER_PROPERTIES( filter ), "threads" );
 
 	// Get the input image, width and height
-	uint8_t *input = mlt_properties_get_data( properties, "image", NULL );
+	int image_size = 0;
+	uint8_t *input = mlt_properties_get_data( properties, "image", &image_size );
 	uint8_t *alpha = mlt_frame_get_alpha( frame );
 	int alpha_size = 0;
 	mlt_properties_get_data( properties, "alpha", &alpha_size );
@@ -140,22 +224,34 @@ static uint8_t *frame_resize_image( mlt_frame frame, int owidth, int oheight, in
 	if ( iwidth < owidth || iheight < oheight )
 	{
 		uint8_t alpha_value = mlt_properties_get_int( properties, "resize_alpha" );
+		int size = owidth * ( oheight + 1 ) * bpp;
+		uint8_t *output = NULL;
+		int has_alpha = alpha && alpha_size >= iwidth * iheight;
+
+		// A writable image whose buffer already holds the output is padded where it is
+		if ( writable && input && image_size >= size && iwidth <= owidth && iheight <= oheight )
+			output = input;
 
 		// Create the output image
-		uint8_t *output = mlt_pool_alloc( owidth * ( oheight + 1 ) * bpp );
+		if ( output == NULL )
+			output = mlt_pool_alloc( size );
 
 		// Call the generic resize
-		resize_image( output, owidth, oheight, input, iwidth, iheight, bpp );
+		resize_image( output, owidth, oheight, input, iwidth, iheight, bpp, threads );
 
 		// Now update the frame
-		mlt_frame_set_image( frame, output, owidth * ( oheight + 1 ) * bpp, mlt_pool_release );
+		if ( output != input )
+			mlt_frame_set_image( frame, output, size, mlt_pool_release );
 
 		// We should resize the alpha too
-		if ( alpha && alpha_size >= iwidth * iheight )
+		if ( has_alpha )
 		{
-			alpha = resize_alpha( alpha, owidth, oheight, iwidth, iheight, alpha_value );
-			if ( alpha )
-				mlt_frame_set_alpha( frame, alpha, owidth * oheight, mlt_pool_release );
+			uint8_t *alpha_output = NULL;
+			if ( writable && alpha_size >= owidth * oheight && iwidth <= owidth && iheight <= oheight )
+				alpha_output = alpha;
+			alpha_output = resize_alpha( alpha_output, alpha, owidth, oheight, iwidth, iheight, alpha_value, threads );
+			if ( alpha_output && alpha_output != alpha )
+				mlt_frame_set_alpha( frame, alpha_output, owidth * oheight, mlt_pool_release );
 		}
 
 		// Return the output
@@ -273,7 +369,7 @@ static int filter_get_image( mlt_frame frame, uint8_t **image, mlt_image_format
 	{
 		int bpp;
 		mlt_image_format_size( *format, owidth, oheight, &bpp );
-		*image = frame_resize_image( frame, *width, *height, bpp );
+		*image = frame_resize_image( frame, filter, *width, *height, bpp, writable );
 	}
 
 	return error;
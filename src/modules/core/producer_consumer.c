@@ -169,8 +169,12 @@ static int get_frame( mlt_producer self, mlt_frame_ptr frame, int index )
 		cx->consumer = mlt_consumer_new( cx->profile );
 		// Do not use _pass_list on real_time so that it defaults to 0 in the absence of
 		// an explicit real_time property.
-		mlt_properties_set_int( MLT_CONSUMER_PROPERTIES( cx->consumer ), "real_time",
-			mlt_properties_get_int( properties, "real_time" ) );
+		// Pass it as a string to preserve "auto".
+		if ( mlt_properties_get( properties, "real_time" ) )
+			mlt_properties_set( MLT_CONSUMER_PROPERTIES( cx->consumer ), "real_time",
+				mlt_properties_get( properties, "real_time" ) );
+		else
+			mlt_properties_set_int( MLT_CONSUMER_PROPERTIES( cx->consumer ), "real_time", 0 );
 		mlt_properties_pass_list( MLT_CONSUMER_PROPERTIES( cx->consumer ), properties,
 			"buffer, prefill, deinterlace_method, rescale" );
 
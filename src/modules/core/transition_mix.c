@@ -28,89 +28,102 @@
 
 #define MAX_CHANNELS (6)
 #define MAX_SAMPLES  (192000/(24000/1001))
-#define SAMPLE_BYTES(samples, channels) ((samples) * (channels) * sizeof(float))
-#define MAX_BYTES    SAMPLE_BYTES( MAX_SAMPLES, MAX_CHANNELS )
+
+/* The buffers are planar: one contiguous run of samples per channel so that
+ * the mixing loops operate on unit-stride float arrays.
+ */
 
 typedef struct transition_mix_s
 {
 	mlt_transition parent;
-	float src_buffer[MAX_SAMPLES *  MAX_CHANNELS];
-	float dest_buffer[MAX_SAMPLES * MAX_CHANNELS];
+	float src_buffer[MAX_CHANNELS][MAX_SAMPLES];
+	float dest_buffer[MAX_CHANNELS][MAX_SAMPLES];
 	int src_buffer_count;
 	int dest_buffer_count;
 } *transition_mix;
 
-static void mix_audio( double weight_start, double weight_end, float *buffer_a,
-	float *buffer_b, int channels_a, int channels_b, int channels_out, int samples )
+static void mix_audio( float weight_start, float weight_end, float *out, const float *buffer_a,
+	const float *buffer_b, int samples )
 {
-	int i, j;
-	double a, b, v;
-
 	// Compute a smooth ramp over start to end
-	double mix = weight_start;
-	double mix_step = ( weight_end - weight_start ) / samples;
+	float mix_step = ( weight_end - weight_start ) / samples;
+	int i;
 
 	for ( i = 0; i < samples; i++ )
 	{
-		for ( j = 0; j < channels_out; j++ )
-		{
-			a = (double) buffer_a[ i * channels_a + j ];
-			b = (double) buffer_b[ i * channels_b + j ];
-			v = mix * b + (1.0 - mix) * a;
-			buffer_a[ i * channels_a + j ] = v;
-		}
-		mix += mix_step;
+		float mix = weight_start + mix_step * i;
+		out[i] = mix * buffer_b[i] + ( 1.0f - mix ) * buffer_a[i];
 	}
 }
 
-static void sum_audio( double weight_start, double weight_end, float *buffer_a,
-	float *buffer_b, int channels_a, int channels_b, int channels_out, int samples )
+static void sum_audio( float weight_start, float weight_end, float *out, const float *buffer_a,
+	const float *buffer_b, int samples )
 {
-	int i, j;
-	double a, b;
-
 	// Compute a smooth ramp over start to end
-	double mix = weight_start;
-	double mix_step = ( weight_end - weight_start ) / samples;
+	float mix_step = ( weight_end - weight_start ) / samples;
+	int i;
 
 	for ( i = 0; i < samples; i++ )
-	{
-		for ( j = 0; j < channels_out; j++ )
-		{
-			a = (double) buffer_a[ i * channels_a + j ];
-			b = (double) buffer_b[ i * channels_b + j ];
-			buffer_a[ i * channels_a + j ] = mix * b + a;
-		}
-		mix += mix_step;
-	}
+		out[i] = ( weight_start + mix_step * i ) * buffer_b[i] + buffer_a[i];
 }
 
 // This filter uses an inline low pass filter to allow mixing without volume hacking.
-static void combine_audio( double weight, float *buffer_a, float *buffer_b,
-	int channels_a, int channels_b, int channels_out, int samples )
+static void combine_audio( double weight, float *out, const float *buffer_a,
+	const float *buffer_b, int samples )
 {
-	int i, j;
+	int i;
 	double Fc = 0.5;
 	double B = exp(-2.0 * M_PI * Fc);
 	double A = 1.0 - B;
-	double a, b, v;
-	double v_prev[MAX_CHANNELS];
-
-	for ( j = 0; j < channels_out; j++ )
-		v_prev[j] = (double) buffer_a[j];
+	double v;
+	double v_prev = (double) buffer_a[0];
 
 	for ( i = 0; i < samples; i++ )
 	{
-		for ( j = 0; j < channels_out; j++ )
-		{
-			a = (double) buffer_a[ i * channels_a + j ];
-			b = (double) buffer_b[ i * channels_b + j ];
-			v = weight * a + b;
-			v_prev[j] = buffer_a[ i * channels_a + j ] = v * A + v_prev[j] * B;
-		}
+		v = weight * (double) buffer_a[i] + (double) buffer_b[i];
+		v_prev = out[i] = v * A + v_prev * B;
 	}
 }
 
+/** Append the planar samples of a frame to a buffer, discarding the oldest samples upon overflow.
+*/
+
+static void buffer_audio( mlt_transition transition, float buffer[MAX_CHANNELS][MAX_SAMPLES],
+	int *count, const float *samples_in, int channels, int samples )
+{
+	int stride = samples;
+	int j;
+
+	// The input is planar with a stride of the full count, but only the
+	// newest samples fit.
+	samples = MIN( samples, MAX_SAMPLES );
+	samples_in += stride - samples;
+	if ( *count + samples > MAX_SAMPLES )
+	{
+		int discard = *count + samples - MAX_SAMPLES;
+		mlt_log_verbose( MLT_TRANSITION_SERVICE(transition), "buffer overflow: buffer_count %d\n", *count );
+		*count -= discard;
+		for ( j = 0; j < channels && j < MAX_CHANNELS; j++ )
+			memmove( buffer[j], &buffer[j][discard], *count * sizeof(float) );
+	}
+	for ( j = 0; j < channels && j < MAX_CHANNELS; j++ )
+		memcpy( &buffer[j][*count], &samples_in[j * stride], samples * sizeof(float) );
+	*count += samples;
+}
+
+/** Remove the samples that were mixed from the front of a buffer.
+*/
+
+static void consume_audio( float buffer[MAX_CHANNELS][MAX_SAMPLES], int *count, int channels, int samples )
+{
+	int j;
+
+	*count -= samples;
+	if ( *count )
+		for ( j = 0; j < channels && j < MAX_CHANNELS; j++ )
+			memmove( buffer[j], &buffer[j][samples], *count * sizeof(float) );
+}
+
 /** Get the audio.
 */
 
@@ -128,13 +141,14 @@ static int transition_get_audio( mlt_frame frame_a, void **buffer, mlt_audio_for
 	mlt_properties b_props = MLT_FRAME_PROPERTIES( frame_b );
 
 	transition_mix self = transition->child;
-	float *buffer_b, *buffer_a;
+	float *buffer_b, *buffer_a, *out;
 	int frequency_b = *frequency, frequency_a = *frequency;
 	int channels_b = *channels, channels_a = *channels;
 	int samples_b = *samples, samples_a = *samples;
+	int j;
 
-	// We can only mix interleaved 32-bit float.
-	*format = mlt_audio_f32le;
+	// We mix planar 32-bit float, which is also what most decoders produce.
+	*format = mlt_audio_float;
 	mlt_frame_get_audio( frame_b, (void**) &buffer_b, format, &frequency_b, &channels_b, &samples_b );
 	mlt_frame_get_audio( frame_a, (void**) &buffer_a, format, &frequency_a, &channels_a, &samples_a );
 
@@ -161,40 +175,19 @@ static int transition_get_audio( mlt_frame frame_a, void **buffer, mlt_audio_for
 	if ( silent )
 		memset( buffer_b, 0, samples_b * channels_b * sizeof( float ) );
 
+	// Buffer the new samples.
+	buffer_audio( transition, self->src_buffer, &self->src_buffer_count, buffer_b, channels_b, samples_b );
+	buffer_audio( transition, self->dest_buffer, &self->dest_buffer_count, buffer_a, channels_a, samples_a );
+
 	// determine number of samples to process
-	*samples = MIN( self->src_buffer_count + samples_b, self->dest_buffer_count + samples_a );
+	*samples = MIN( self->src_buffer_count, self->dest_buffer_count );
 	*channels = MIN( MIN( channels_b, channels_a ), MAX_CHANNELS );
 	*frequency = frequency_a;
 
-	// Prevent src buffer overflow by discarding oldest samples.
-	samples_b = MIN( samples_b, MAX_SAMPLES * MAX_CHANNELS / channels_b );
-	size_t bytes = SAMPLE_BYTES( samples_b, channels_b );
-	if ( SAMPLE_BYTES( self->src_buffer_count + samples_b, channels_b ) > MAX_BYTES ) {
-		mlt_log_verbose( MLT_TRANSITION_SERVICE(transition), "buffer overflow: src_buffer_count %d\n",
-					  self->src_buffer_count );
-		self->src_buffer_count = MAX_SAMPLES * MAX_CHANNELS / channels_b - samples_b;
-		memmove( self->src_buffer, &self->src_buffer[MAX_SAMPLES * MAX_CHANNELS - samples_b * channels_b],
-				 SAMPLE_BYTES( samples_b, channels_b ) );
-	}
-	// Buffer new src samples.
-	memcpy( &self->src_buffer[self->src_buffer_count * channels_b], buffer_b, bytes );
-	self->src_buffer_count += samples_b;
-	buffer_b = self->src_buffer;
-
-	// Prevent dest buffer overflow by discarding oldest samples.
-	samples_a = MIN( samples_a, MAX_SAMPLES * MAX_CHANNELS / channels_a );
-	bytes = SAMPLE_BYTES( samples_a, channels_a );
-	if ( SAMPLE_BYTES( self->dest_buffer_count + samples_a, channels_a ) > MAX_BYTES ) {
-		mlt_log_verbose( MLT_TRANSITION_SERVICE(transition), "buffer overflow: dest_buffer_count %d\n",
-					  self->dest_buffer_count );
-		self->dest_buffer_count = MAX_SAMPLES * MAX_CHANNELS / channels_a - samples_a;
-		memmove( self->dest_buffer, &self->dest_buffer[MAX_SAMPLES * MAX_CHANNELS - samples_a * channels_a],
-				 SAMPLE_BYTES( samples_a, channels_a ) );
-	}
-	// Buffer the new dest samples.
-	memcpy( &self->dest_buffer[self->dest_buffer_count * channels_a], buffer_a, bytes );
-	self->dest_buffer_count += samples_a;
-	buffer_a = self->dest_buffer;
+	// Mix directly into the new frame buffer.
+	size_t bytes = *samples * *channels * sizeof(float);
+	out = mlt_pool_alloc( bytes );
+	*buffer = out;
 
 	// Do the mixing.
 	if ( mlt_properties_get_int( MLT_TRANSITION_PROPERTIES(transition), "sum" ) )
@@ -209,14 +202,16 @@ static int transition_get_audio( mlt_frame frame_a, void **buffer, mlt_audio_for
 			mix_start = 1.0 - mix_start;
 			mix_end = 1.0 - mix_end;
 		}
-		sum_audio( mix_start, mix_end, buffer_a, buffer_b, channels_a, channels_b, *channels, *samples );
+		for ( j = 0; j < *channels; j++ )
+			sum_audio( mix_start, mix_end, &out[j * *samples], self->dest_buffer[j], self->src_buffer[j], *samples );
 	}
 	else if ( mlt_properties_get_int( MLT_TRANSITION_PROPERTIES(transition), "combine" ) )
 	{
 		double weight = 1.0;
 		if ( mlt_properties_get_int( MLT_FRAME_PROPERTIES( frame_a ), "meta.mixdown" ) )
 			weight = 1.0 - mlt_properties_get_double( MLT_FRAME_PROPERTIES( frame_a ), "meta.volume" );
-		combine_audio( weight, buffer_a, buffer_b, channels_a, channels_b, *channels, *samples );
+		for ( j = 0; j < *channels; j++ )
+			combine_audio( weight, &out[j * *samples], self->dest_buffer[j], self->src_buffer[j], *samples );
 	}
 	else
 	{
@@ -230,13 +225,10 @@ static int transition_get_audio( mlt_frame frame_a, void **buffer, mlt_audio_for
 			mix_start = 1.0 - mix_start;
 			mix_end = 1.0 - mix_end;
 		}
-		mix_audio( mix_start, mix_end, buffer_a, buffer_b, channels_a, channels_b, *channels, *samples );
+		for ( j = 0; j < *channels; j++ )
+			mix_audio( mix_start, mix_end, &out[j * *samples], self->dest_buffer[j], self->src_buffer[j], *samples );
 	}
 
-	// Copy the audio into the frame.
-	bytes = SAMPLE_BYTES( *samples, *channels );
-	*buffer = mlt_pool_alloc( bytes );
-	memcpy( *buffer, buffer_a, bytes );
 	mlt_frame_set_audio( frame_a, *buffer, *format, bytes, mlt_pool_release );
 
 	if ( mlt_properties_get_int( b_props, "_speed" ) == 0 )
@@ -259,18 +251,9 @@ static int transition_get_audio( mlt_frame frame_a, void **buffer, mlt_audio_for
 		samples_a = self->dest_buffer_count - samples_a;
 	}
 
-	// Consume the src buffer.
-	self->src_buffer_count -= samples_b;
-	if ( self->src_buffer_count ) {
-		memmove( self->src_buffer, &self->src_buffer[samples_b * channels_b],
-			SAMPLE_BYTES( self->src_buffer_count, channels_b ));
-	}
-	// Consume the dest buffer.
-	self->dest_buffer_count -= samples_a;
-	if ( self->dest_buffer_count ) {
-		memmove( self->dest_buffer, &self->dest_buffer[samples_a * channels_a],
-			SAMPLE_BYTES( self->dest_buffer_count, channels_a ));
-	}
+	// Consume the buffers.
+	consume_audio( self->src_buffer, &self->src_buffer_count, channels_b, samples_b );
+	consume_audio( self->dest_buffer, &self->dest_buffer_count, channels_a, samples_a );
 
 	return error;
 }
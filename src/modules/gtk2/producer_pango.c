@@ -89,6 +89,7 @@ struct producer_pango_s
 	int   wrap_width;
 	int   line_spacing;
 	double aspect_ratio;
+	char *title_key;
 };
 
 static void clean_cached( producer_pango self )
@@ -96,6 +97,77 @@ static void clean_cached( producer_pango self )
 	mlt_service_cache_put( MLT_PRODUCER_SERVICE( &self->parent ), "pango.image", NULL, 0, NULL );
 }
 
+/** Rendered titles are shared by all pango producers, so text that recurs, such as
+ * a repeated subtitle or the same caption on several tracks, is only laid out and
+ * rasterized once. Entries are found by a hash of everything that affects the
+ * raster and keep the full key to rule out collisions. The cache holds at most
+ * TITLE_CACHE_SIZE titles and TITLE_CACHE_BYTES of pixels, and is only used while
+ * holding pango_mutex.
+ */
+
+#define TITLE_CACHE_SIZE (50)
+#define TITLE_CACHE_BYTES (64 * 1024 * 1024)
+
+struct pango_title_s
+{
+	char *key;
+	GdkPixbuf *pixbuf;
+};
+
+static mlt_cache title_cache = NULL;
+
+static void pango_title_destroy( void *p )
+{
+	struct pango_title_s *title = p;
+
+	g_object_unref( title->pixbuf );
+	g_free( title->key );
+	free( title );
+}
+
+static void *title_hash( const char *key )
+{
+	// FNV-1a
+	uint64_t hash = 14695981039346656037ULL;
+	while ( *key )
+		hash = ( hash ^ (unsigned char) *key++ ) * 1099511628211ULL;
+	return (void*) (uintptr_t) ( hash | 1 );
+}
+
+static GdkPixbuf *title_cache_get( const char *key )
+{
+	GdkPixbuf *pixbuf = NULL;
+	mlt_cache_item item = mlt_cache_get( title_cache, title_hash( key ) );
+	struct pango_title_s *title = mlt_cache_item_data( item, NULL );
+
+	if ( title && !strcmp( title->key, key ) )
+		pixbuf = g_object_ref( title->pixbuf );
+	mlt_cache_item_close( item );
+	return pixbuf;
+}
+
+static void title_cache_put( const char *key, GdkPixbuf *pixbuf )
+{
+	struct pango_title_s *title = calloc( 1, sizeof( struct pango_title_s ) );
+
+	if ( title )
+	{
+		title->key = g_strdup( key );
+		title->pixbuf = g_object_ref( pixbuf );
+		int size = gdk_pixbuf_get_rowstride( pixbuf ) * gdk_pixbuf_get_height( pixbuf );
+		mlt_cache_put( title_cache, title_hash( key ), title, size, pango_title_destroy );
+	}
+}
+
+static void title_cache_reset( )
+{
+	if ( title_cache )
+		mlt_cache_close( title_cache );
+	title_cache = mlt_cache_init();
+	mlt_cache_set_size( title_cache, TITLE_CACHE_SIZE );
+	mlt_cache_set_max_bytes( title_cache, TITLE_CACHE_BYTES );
+}
+
 // special color type used by internal pango routines
 typedef struct
 {
@@ -171,6 +243,8 @@ mlt_producer producer_pango_init( const char *filename )
 		pthread_mutex_lock( &pango_mutex );
 		if ( fontmap == NULL )
 			fontmap = (PangoFT2FontMap*) pango_ft2_font_map_new();
+		if ( title_cache == NULL )
+			title_cache_reset();
 		g_type_init();
 		pthread_mutex_unlock( &pango_mutex );
 
@@ -512,11 +586,28 @@ static void refresh_image( mlt_frame frame, int width, int height )
 			}
 		}
 		
-		// Render the title
-		pixbuf = pango_get_pixbuf( markup, text, font, fgcolor, bgcolor, olcolor, pad, align, family,
-			style, weight, stretch, size, outline, rotate,
-			width_crop, width_fit, wrap_type, wrap_width,
+		// Reuse the title if any producer has rendered it, otherwise render it
+		g_free( this->title_key );
+		this->title_key = g_strdup_printf( "%s\x1f%s\x1f%s\x1f%s\x1f%d\x1f%d\x1f%d\x1f%d"
+			"\x1f%02x%02x%02x%02x\x1f%02x%02x%02x%02x\x1f%02x%02x%02x%02x"
+			"\x1f%d\x1f%d\x1f%d\x1f%d\x1f%d\x1f%d\x1f%d\x1f%d\x1f%d\x1f%f",
+			markup ? markup : "", text ? text : "", font ? font : "", family ? family : "",
+			style, weight, stretch, size,
+			fgcolor.r, fgcolor.g, fgcolor.b, fgcolor.a,
+			bgcolor.r, bgcolor.g, bgcolor.b, bgcolor.a,
+			olcolor.r, olcolor.g, olcolor.b, olcolor.a,
+			pad, align, outline, rotate, width_crop, width_fit, wrap_type, wrap_width,
 			line_spacing, aspect_ratio );
+		pixbuf = title_cache_get( this->title_key );
+		if ( pixbuf == NULL )
+		{
+			pixbuf = pango_get_pixbuf( markup, text, font, fgcolor, bgcolor, olcolor, pad, align, family,
+				style, weight, stretch, size, outline, rotate,
+				width_crop, width_fit, wrap_type, wrap_width,
+				line_spacing, aspect_ratio );
+			if ( pixbuf != NULL )
+				title_cache_put( this->title_key, pixbuf );
+		}
 
 		if ( pixbuf != NULL )
 		{
@@ -558,7 +649,15 @@ static void refresh_image( mlt_frame frame, int width, int height )
 // fprintf(stderr,"%s: scaling from %dx%d to %dx%d\n", __FILE__, this->width, this->height, width, height);
 
 		// Note - the original pixbuf is already safe and ready for destruction
-		this->pixbuf = gdk_pixbuf_scale_simple( pixbuf, width, height, interp );
+		char *key = this->title_key ? g_strdup_printf( "%s\x1f%dx%d\x1f%d", this->title_key, width, height, interp ) : NULL;
+		this->pixbuf = key ? title_cache_get( key ) : NULL;
+		if ( this->pixbuf == NULL )
+		{
+			this->pixbuf = gdk_pixbuf_scale_simple( pixbuf, width, height, interp );
+			if ( key && this->pixbuf )
+				title_cache_put( key, this->pixbuf );
+		}
+		g_free( key );
 		clean_cached( this );
 
 		// Store width and height
@@ -761,6 +860,7 @@ static void producer_close( mlt_producer parent )
 	free( this->text );
 	free( this->font );
 	free( this->family );
+	g_free( this->title_key );
 	parent->close = NULL;
 	mlt_producer_close( parent );
 	free( this );
@@ -1148,6 +1248,8 @@ static void on_fontmap_reload()
 	pthread_mutex_lock( &pango_mutex );
 	old_fontmap = fontmap;
 	fontmap = new_fontmap;
+	// Titles rendered with the old fonts are stale.
+	title_cache_reset();
 	pthread_mutex_unlock( &pango_mutex );
 
 	if ( old_fontmap )
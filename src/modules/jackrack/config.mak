@@ -0,0 +1 @@
+GPL=1
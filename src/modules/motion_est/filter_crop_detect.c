@@ -63,6 +63,11 @@ static int filter_get_image( mlt_frame this, uint8_t **image, mlt_image_format *
 	// Producers may start with blank footage, by default we will skip, oh, 5 frames unless overridden
 	int skip = mlt_properties_get_int( properties, "skip");
 
+	// Use the result of an analysis pass if there is one
+	mlt_position position = mlt_frame_get_position( this );
+	float record[4];
+	int has_record = mlt_analysis_filter_get( filter, position, record, sizeof( record ) ) == sizeof( record );
+
 	mlt_service_lock( MLT_FILTER_SERVICE( filter ) );
 
 	// The result
@@ -76,12 +81,22 @@ static int filter_get_image( mlt_frame this, uint8_t **image, mlt_image_format *
 		mlt_properties_set_data( properties, "bounds", bounds, sizeof( struct mlt_geometry_item_s ), free, NULL );
 	}
 
+	if( has_record )
+	{
+		bounds->x = record[0];
+		bounds->y = record[1];
+		bounds->w = record[2];
+		bounds->h = record[3];
+	}
+
 	// For periodic detection (with offset of 'skip')
-	if( frequency == 0 || (int)(mlt_filter_get_position(filter, this)+skip) % frequency  != 0)
+	if( has_record || frequency == 0 || (int)(mlt_filter_get_position(filter, this)+skip) % frequency  != 0)
 	{
 		// Inject in stream 
 		mlt_properties_set_data( MLT_FRAME_PROPERTIES(this), "bounds", bounds, sizeof( struct mlt_geometry_item_s ), NULL, NULL );
 
+		mlt_service_unlock( MLT_FILTER_SERVICE( filter ) );
+
 		return 0;
 	}
 	
@@ -193,8 +208,13 @@ static int filter_get_image( mlt_frame this, uint8_t **image, mlt_image_format *
 	/* inject into frame */
 	mlt_properties_set_data( MLT_FRAME_PROPERTIES(this), "bounds", bounds, sizeof( struct mlt_geometry_item_s ), NULL, NULL );
 
+	float rect[4] = { bounds->x, bounds->y, bounds->w, bounds->h };
+
 	mlt_service_unlock( MLT_FILTER_SERVICE( filter ) );
 
+	/* store the result during an analysis pass */
+	mlt_analysis_filter_put( filter, this, position, rect, sizeof( rect ) );
+
 	return error;
 }
 
@@ -224,6 +244,9 @@ mlt_filter filter_crop_detect_init( mlt_profile profile, mlt_service_type type,
 	{
 		this->process = filter_process;
 
+		/* the bounds are carried over between detections */
+		mlt_properties_set( MLT_FILTER_PROPERTIES(this), "_threading", "ordered" );
+
 		/* defaults */
 		mlt_properties_set_int( MLT_FILTER_PROPERTIES(this), "frequency", 1);
 		mlt_properties_set_int( MLT_FILTER_PROPERTIES(this), "thresh", 5);
@@ -33,11 +33,17 @@
 #include <string.h>
 #include <sys/time.h>
 #include <unistd.h>
+#include <pthread.h>
 
 #ifdef USE_SSE
 #include "sad_sse.h"
 #endif
 
+#if defined(USE_SSE2) && defined(__GNUC__) && ( defined(__x86_64__) || defined(__i386__) )
+#define USE_SAD_SIMD
+#include "sad_simd.h"
+#endif
+
 #define NDEBUG
 #include <assert.h>
 
@@ -48,6 +54,8 @@
 
 #define DIAMOND_SEARCH 0x0
 #define FULL_SEARCH 0x1
+#define HIERARCHICAL_SEARCH 0x2
+#define PYRAMID_LEVELS 2
 #define SHIFT 8
 #define ABS(a) ((a) >= 0 ? (a) : (-(a)))
 
@@ -95,8 +103,14 @@ struct motion_est_context_s
 	motion_vector *former_vectors;
 	motion_vector *current_vectors;
 	motion_vector *denoise_vectors;
+	motion_vector *coarse_vectors;		//<! hierarchical search results in units of the first pyramid level
 	mlt_position former_frame_position, current_frame_position;
 
+	/* image pyramids of planar luma for the hierarchical search, level 1 is half size */
+	int pyramid_levels;
+	uint8_t *former_pyramid[PYRAMID_LEVELS];
+	uint8_t *current_pyramid[PYRAMID_LEVELS];
+
 	/* diagnostic metrics */
 	float predictive_misses;		// How often do the prediction motion vectors fail?
 	int comparison_average;			// How far does the best estimation deviate from a perfect comparison?
@@ -107,6 +121,7 @@ struct motion_est_context_s
 	/* run-time configurable comparison functions */
 	int (*compare_reference)(uint8_t *, uint8_t *, int, int, int, int);
 	int (*compare_optimized)(uint8_t *, uint8_t *, int, int, int, int);
+	int (*compare_planar)(uint8_t *, uint8_t *, int, int, int, int);
 
 };
 
@@ -352,7 +367,6 @@ static inline void diamond_search(
 /* /brief Full (brute) search
 * Operates on a single macroblock
 */
-__attribute__((used))
 static void full_search(
 			uint8_t *ref,				//<! Image data from previous frame
 			uint8_t *candidate_base,		//<! Image data in current frame
@@ -371,8 +385,8 @@ static void full_search(
 			score = block_compare( ref, candidate_base,
 					 	x,
 					 	y,
-					 	x + i,
-					 	y + j,
+					 	i,
+					 	j,
 					 	c);
 
 			if ( score < result->msad ) {
@@ -491,136 +505,312 @@ static inline int median_predictor(int a, int b, int c) {
 }
 
 
-/** /brief Motion search
+#define COARSE(i,j)	( c->coarse_vectors + (j)*c->mv_buffer_width + (i) )
+
+/** /brief Motion search of a single macroblock
 *
-* For each macroblock in the current frame, estimate the block from the last frame that
-* matches best.
+* Estimate the block from the last frame that matches the macroblock at
+* column i and row j of the current frame best.
 *
 * Vocab: Colocated - the pixel in the previous frame at the current position
 *
 * Based on enhanced predictive zonal search. [Tourapis 2002]
 */
-static void motion_search( uint8_t *from,			//<! Image data.
-		   	   uint8_t *to,				//<! Image data. Rigid grid.
-			   struct motion_est_context_s *c)	//<! The context
+static void search_macroblock( uint8_t *from,			//<! Image data.
+			       uint8_t *to,			//<! Image data. Rigid grid.
+			       const int i,			//<! Macroblock column
+			       const int j,			//<! Macroblock row
+			       struct motion_est_context_s *c)	//<! The context
 {
-
-#ifdef COUNT_COMPARES
-	compares = 0;
-#endif
-
-	motion_vector candidates[10];
+	motion_vector candidates[11];
 	motion_vector *here;		// This one gets used alot (about 30 times per macroblock)
 	int n = 0;
 
-	int i, j, count=0;
+	here = CURRENT(i,j);
+	here->valid = 1;
+	here->color = 100;
+	here->msad = MAX_MSAD;
 
-	// For every macroblock, perform motion vector estimation
-	for( i = c->left_mb; i <= c->right_mb; i++ ){
-	 for( j = c->top_mb; j <= c->bottom_mb; j++ ){
+	/* Stack the predictors [i.e. checked in reverse order] */
 
-		here = CURRENT(i,j);
-		here->valid = 1;
-		here->color = 100;
-		here->msad = MAX_MSAD;
-		count++;
-		n = 0;
+	/* Adjacent to collocated */
+	if( c->former_vectors_valid )
+	{
+		// Top of colocated
+		if( j > c->prev_top_mb ){// && COL_TOP->valid ){
+			candidates[n  ].dx = FORMER(i,j-1)->dx;
+			candidates[n++].dy = FORMER(i,j-1)->dy;
+		}
 
+		// Left of colocated
+		if( i > c->prev_left_mb ){// && COL_LEFT->valid ){
+			candidates[n  ].dx = FORMER(i-1,j)->dx;
+			candidates[n++].dy = FORMER(i-1,j)->dy;
+		}
 
-		/* Stack the predictors [i.e. checked in reverse order] */
+		// Right of colocated
+		if( i < c->prev_right_mb ){// && COL_RIGHT->valid ){
+			candidates[n  ].dx = FORMER(i+1,j)->dx;
+			candidates[n++].dy = FORMER(i+1,j)->dy;
+		}
 
-		/* Adjacent to collocated */
-		if( c->former_vectors_valid )
-		{
-			// Top of colocated
-			if( j > c->prev_top_mb ){// && COL_TOP->valid ){
-				candidates[n  ].dx = FORMER(i,j-1)->dx;
-				candidates[n++].dy = FORMER(i,j-1)->dy;
-			}
+		// Bottom of colocated
+		if( j < c->prev_bottom_mb ){// && COL_BOTTOM->valid ){
+			candidates[n  ].dx = FORMER(i,j+1)->dx;
+			candidates[n++].dy = FORMER(i,j+1)->dy;
+		}
 
-			// Left of colocated
-			if( i > c->prev_left_mb ){// && COL_LEFT->valid ){
-				candidates[n  ].dx = FORMER(i-1,j)->dx;
-				candidates[n++].dy = FORMER(i-1,j)->dy;
-			}
+		// And finally, colocated
+		candidates[n  ].dx = FORMER(i,j)->dx;
+		candidates[n++].dy = FORMER(i,j)->dy;
+	}
 
-			// Right of colocated
-			if( i < c->prev_right_mb ){// && COL_RIGHT->valid ){
-				candidates[n  ].dx = FORMER(i+1,j)->dx;
-				candidates[n++].dy = FORMER(i+1,j)->dy;
-			}
+	// For macroblocks not in the top row
+	if ( j > c->top_mb) {
 
-			// Bottom of colocated
-			if( j < c->prev_bottom_mb ){// && COL_BOTTOM->valid ){
-				candidates[n  ].dx = FORMER(i,j+1)->dx;
-				candidates[n++].dy = FORMER(i,j+1)->dy;
-			}
+		// Top if ( TOP->valid ) {
+			candidates[n  ].dx = CURRENT(i,j-1)->dx;
+			candidates[n++].dy = CURRENT(i,j-1)->dy;
+		//}
 
-			// And finally, colocated
-			candidates[n  ].dx = FORMER(i,j)->dx;
-			candidates[n++].dy = FORMER(i,j)->dy;
+		// Top-Right, macroblocks not in the right row
+		if ( i < c->right_mb ){// && TOP_RIGHT->valid ) {
+			candidates[n  ].dx = CURRENT(i+1,j-1)->dx;
+			candidates[n++].dy = CURRENT(i+1,j-1)->dy;
 		}
+	}
 
-		// For macroblocks not in the top row
-		if ( j > c->top_mb) {
+	// Left, Macroblocks not in the left column
+	if ( i > c->left_mb ){// && LEFT->valid ) {
+		candidates[n  ].dx = CURRENT(i-1,j)->dx;
+		candidates[n++].dy = CURRENT(i-1,j)->dy;
+	}
 
-			// Top if ( TOP->valid ) {
-				candidates[n  ].dx = CURRENT(i,j-1)->dx;
-				candidates[n++].dy = CURRENT(i,j-1)->dy;
-			//}
+	/* Median predictor vector (median of left, top, and top right adjacent vectors) */
+	if ( i > c->left_mb && j > c->top_mb && i < c->right_mb
+		 )//&& LEFT->valid && TOP->valid && TOP_RIGHT->valid )
+	{
+		candidates[n  ].dx = median_predictor( CURRENT(i-1,j)->dx, CURRENT(i,j-1)->dx, CURRENT(i+1,j-1)->dx);
+		candidates[n++].dy = median_predictor( CURRENT(i-1,j)->dy, CURRENT(i,j-1)->dy, CURRENT(i+1,j-1)->dy);
+	}
 
-			// Top-Right, macroblocks not in the right row
-			if ( i < c->right_mb ){// && TOP_RIGHT->valid ) {
-				candidates[n  ].dx = CURRENT(i+1,j-1)->dx;
-				candidates[n++].dy = CURRENT(i+1,j-1)->dy;
-			}
-		}
+	// Coarse vector of the hierarchical search
+	if ( c->search_method == HIERARCHICAL_SEARCH && c->pyramid_levels > 0 )
+	{
+		candidates[n  ].dx = COARSE(i,j)->dx * 2;
+		candidates[n++].dy = COARSE(i,j)->dy * 2;
+	}
 
-		// Left, Macroblocks not in the left column
-		if ( i > c->left_mb ){// && LEFT->valid ) {
-			candidates[n  ].dx = CURRENT(i-1,j)->dx;
-			candidates[n++].dy = CURRENT(i-1,j)->dy;
-		}
+	// Zero vector
+	candidates[n  ].dx = 0;
+	candidates[n++].dy = 0;
 
-		/* Median predictor vector (median of left, top, and top right adjacent vectors) */
-		if ( i > c->left_mb && j > c->top_mb && i < c->right_mb
-			 )//&& LEFT->valid && TOP->valid && TOP_RIGHT->valid )
-		{
-			candidates[n  ].dx = median_predictor( CURRENT(i-1,j)->dx, CURRENT(i,j-1)->dx, CURRENT(i+1,j-1)->dx);
-			candidates[n++].dy = median_predictor( CURRENT(i-1,j)->dy, CURRENT(i,j-1)->dy, CURRENT(i+1,j-1)->dy);
-		}
+	int x = i * c->mb_w;
+	int y = j * c->mb_h;
+	check_candidates ( to, from, x, y, candidates, n, 0, here, c );
 
-		// Zero vector
-		candidates[n  ].dx = 0;
-		candidates[n++].dy = 0;
+	if ( c->search_method == FULL_SEARCH )
+		full_search( to, from, x, y, here, c);
+	else
+		diamond_search( to, from, x, y, here, c);
 
-		int x = i * c->mb_w;
-		int y = j * c->mb_h;
-		check_candidates ( to, from, x, y, candidates, n, 0, here, c );
+	assert( x + c->mb_w + here->dx > 0 );	// All macroblocks must have area > 0
+	assert( y + c->mb_h + here->dy > 0 );
+	assert( x + here->dx < c->width );
+	assert( y + here->dy < c->height );
+}
 
+/** /brief Shared state of the slices of a motion search
+*/
+struct motion_search_s
+{
+	struct motion_est_context_s *c;
+	uint8_t *from;
+	uint8_t *to;
+	int level;			//<! pyramid level of a coarse search
+	int jobs;
+	int *progress;			//<! number of macroblocks finished in each row
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+};
 
-#ifndef FULLSEARCH
-		diamond_search( to, from, x, y, here, c);
-#else
-		full_search( to, from, x, y, here, c);
-#endif
+/** /brief Sliced motion search
+*
+* Slices take every jobs-th macroblock row. The predictors of a macroblock
+* include the vectors above it and above right of it, so a row runs as a
+* wavefront behind the row above. This gives the same vectors regardless of
+* the number of slices.
+*/
+static int motion_search_slice( int id, int idx, int jobs, void *cookie )
+{
+	struct motion_search_s *s = cookie;
+	struct motion_est_context_s *c = s->c;
+	int i, j;
+
+	for( j = c->top_mb + idx; j <= c->bottom_mb; j += jobs ){
+	 for( i = c->left_mb; i <= c->right_mb; i++ ){
 
-		assert( x + c->mb_w + here->dx > 0 );	// All macroblocks must have area > 0
-		assert( y + c->mb_h + here->dy > 0 );
-		assert( x + here->dx < c->width );
-		assert( y + here->dy < c->height );
+		if ( jobs > 1 && j > c->top_mb ) {
+			int needed = ( i < c->right_mb ? i + 1 : i ) - c->left_mb + 1;
+			pthread_mutex_lock( &s->mutex );
+			while ( s->progress[j - 1 - c->top_mb] < needed )
+				pthread_cond_wait( &s->cond, &s->mutex );
+			pthread_mutex_unlock( &s->mutex );
+		}
+
+		search_macroblock( s->from, s->to, i, j, c );
 
+		if ( jobs > 1 ) {
+			pthread_mutex_lock( &s->mutex );
+			s->progress[j - c->top_mb] = i - c->left_mb + 1;
+			pthread_cond_broadcast( &s->cond );
+			pthread_mutex_unlock( &s->mutex );
+		}
 	 } /* End column loop */
 	} /* End row loop */
 
 #ifdef USE_SSE
 	asm volatile ( "emms" );
 #endif
+	return 0;
+}
 
-#ifdef COUNT_COMPARES
-	fprintf(stderr, "%d comparisons per block were made", compares/count);
+/** /brief Downscale 4:2:2 luma or planar luma to half size planar luma
+*/
+static void pyramid_downscale( uint8_t *src, int xstride, int ystride, uint8_t *dst, int width, int height )
+{
+	int x, y;
+	for ( y = 0; y < height; y++ ) {
+		uint8_t *s0 = src + 2 * y * ystride;
+		uint8_t *s1 = s0 + ystride;
+		for ( x = 0; x < width; x++ ) {
+			*dst++ = ( s0[0] + s0[xstride] + s1[0] + s1[xstride] + 2 ) >> 2;
+			s0 += 2 * xstride;
+			s1 += 2 * xstride;
+		}
+	}
+}
+
+/** /brief Sliced coarse search of the hierarchical search
+*
+* Each pyramid level compares planar luma of a fraction of the size with
+* macroblocks of the same fraction, so the macroblock grid is the same at
+* every level. The search of a level starts from the vectors of the level
+* above it and the colocated vector of the former frame, and it has no
+* spatial predictors, so the rows are independent.
+*/
+static int coarse_search_slice( int id, int idx, int jobs, void *cookie )
+{
+	struct motion_search_s *s = cookie;
+	struct motion_est_context_s *c = s->c;
+	struct motion_est_context_s level = *c;
+	int L = s->level;
+	int i, j, n;
+	motion_vector candidates[3];
+
+	level.width = c->width >> L;
+	level.height = c->height >> L;
+	level.mb_w = c->mb_w >> L;
+	level.mb_h = c->mb_h >> L;
+	level.limit_x = ( c->limit_x >> L ) + 1;
+	level.limit_y = ( c->limit_y >> L ) + 1;
+	level.xstride = 1;
+	level.ystride = level.width;
+	level.compare_optimized = c->compare_planar;
+
+	for( j = c->top_mb + idx; j <= c->bottom_mb; j += jobs ){
+	 for( i = c->left_mb; i <= c->right_mb; i++ ){
+
+		motion_vector *here = COARSE(i,j);
+		n = 0;
+
+		if ( L < c->pyramid_levels ) {
+			candidates[n  ].dx = here->dx * 2;
+			candidates[n++].dy = here->dy * 2;
+		}
+		if( c->former_vectors_valid ) {
+			candidates[n  ].dx = FORMER(i,j)->dx >> L;
+			candidates[n++].dy = FORMER(i,j)->dy >> L;
+		}
+		candidates[n  ].dx = 0;
+		candidates[n++].dy = 0;
+
+		here->dx = 0;
+		here->dy = 0;
+		here->msad = MAX_MSAD;
+		check_candidates( s->to, s->from, i * level.mb_w, j * level.mb_h, candidates, n, 0, here, &level );
+		diamond_search( s->to, s->from, i * level.mb_w, j * level.mb_h, here, &level );
+	 }
+	}
+
+#ifdef USE_SSE
+	asm volatile ( "emms" );
 #endif
-	return;
+	return 0;
+}
+
+/** /brief Motion search
+*
+* For each macroblock in the current frame, estimate the block from the last frame that
+* matches best. The macroblock rows are searched by slices.
+*/
+static void motion_search( uint8_t *from,			//<! Image data.
+		   	   uint8_t *to,				//<! Image data. Rigid grid.
+			   int threads,				//<! The number of slices or 0 for the slice count
+			   struct motion_est_context_s *c)	//<! The context
+{
+	struct motion_search_s s;
+	int rows = c->bottom_mb - c->top_mb + 1;
+	int L;
+
+	if ( rows <= 0 || c->right_mb < c->left_mb )
+		return;
+
+	threads = CLAMP( threads, 0, mlt_slices_count_normal() );
+	if ( threads == 0 )
+		threads = mlt_slices_count_normal();
+	s.c = c;
+	s.jobs = CLAMP( threads, 1, rows );
+
+	if ( c->search_method == HIERARCHICAL_SEARCH && c->pyramid_levels > 0 )
+	{
+		// Build the pyramids
+		for ( L = 1; L <= c->pyramid_levels; L++ ) {
+			int w = c->width >> L;
+			int h = c->height >> L;
+			pyramid_downscale( L == 1 ? from : c->former_pyramid[L - 2], L == 1 ? c->xstride : 1,
+				L == 1 ? c->ystride : ( c->width >> ( L - 1 ) ), c->former_pyramid[L - 1], w, h );
+			pyramid_downscale( L == 1 ? to : c->current_pyramid[L - 2], L == 1 ? c->xstride : 1,
+				L == 1 ? c->ystride : ( c->width >> ( L - 1 ) ), c->current_pyramid[L - 1], w, h );
+		}
+
+		// Search from the top of the pyramid down to level 1
+		for ( L = c->pyramid_levels; L >= 1; L-- ) {
+			s.from = c->former_pyramid[L - 1];
+			s.to = c->current_pyramid[L - 1];
+			s.level = L;
+			if ( s.jobs == 1 )
+				coarse_search_slice( 0, 0, 1, &s );
+			else
+				mlt_slices_run_normal( s.jobs, coarse_search_slice, &s );
+		}
+	}
+
+	s.from = from;
+	s.to = to;
+	s.level = 0;
+	if ( s.jobs == 1 ) {
+		motion_search_slice( 0, 0, 1, &s );
+	}
+	else {
+		s.progress = calloc( rows, sizeof( int ) );
+		pthread_mutex_init( &s.mutex, NULL );
+		pthread_cond_init( &s.cond, NULL );
+		mlt_slices_run_normal( s.jobs, motion_search_slice, &s );
+		pthread_cond_destroy( &s.cond );
+		pthread_mutex_destroy( &s.mutex );
+		free( s.progress );
+	}
 }
 
 void collect_post_statistics( struct motion_est_context_s *c ) {
@@ -656,6 +846,18 @@ void collect_post_statistics( struct motion_est_context_s *c ) {
 
 static void init_optimizations( struct motion_est_context_s *c )
 {
+	c->compare_planar = sad_reference;
+
+#ifdef USE_SAD_SIMD
+	// These handle any block size and either stride
+	int (*simd)(uint8_t *, uint8_t *, int, int, int, int) = sad_simd_select();
+	if ( simd ) {
+		c->compare_optimized = simd;
+		c->compare_planar = simd;
+		return;
+	}
+#endif
+
 	switch(c->mb_w){
 #ifdef USE_SSE
 		case 4:  if(c->mb_h == 4)	c->compare_optimized = sad_sse_422_luma_4x4;
@@ -881,6 +1083,31 @@ static int filter_get_image( mlt_frame frame, uint8_t **image, mlt_image_format
 		mlt_properties_set_data( properties, "cache_image", (void *)c->cache_image, 0, mlt_pool_release, NULL );
 		mlt_properties_set_data( properties, "former_image", (void *)c->former_image, 0, mlt_pool_release, NULL );
 
+		// Allocate the pyramids and vectors of the hierarchical search
+		c->pyramid_levels = 0;
+		if ( c->search_method == HIERARCHICAL_SEARCH ) {
+			while ( c->pyramid_levels < PYRAMID_LEVELS
+				&& ( c->mb_w >> ( c->pyramid_levels + 1 ) ) >= 4
+				&& ( c->mb_h >> ( c->pyramid_levels + 1 ) ) >= 4 )
+				c->pyramid_levels++;
+
+			c->coarse_vectors = mlt_pool_alloc( c->mv_size );
+			memset( c->coarse_vectors, 0, c->mv_size );
+			mlt_properties_set_data( properties, "coarse_motion_vectors", (void *)c->coarse_vectors, 0, mlt_pool_release, NULL );
+
+			int L;
+			for ( L = 1; L <= c->pyramid_levels; L++ ) {
+				char name[20];
+				int size = ( *width >> L ) * ( *height >> L );
+				c->former_pyramid[L - 1] = mlt_pool_alloc( size );
+				c->current_pyramid[L - 1] = mlt_pool_alloc( size );
+				sprintf( name, "former_pyramid.%d", L );
+				mlt_properties_set_data( properties, name, (void *)c->former_pyramid[L - 1], 0, mlt_pool_release, NULL );
+				sprintf( name, "current_pyramid.%d", L );
+				mlt_properties_set_data( properties, name, (void *)c->current_pyramid[L - 1], 0, mlt_pool_release, NULL );
+			}
+		}
+
 		c->former_frame_position = c->current_frame_position;
 		c->previous_msad = 0;
 
@@ -943,7 +1170,7 @@ static int filter_get_image( mlt_frame frame, uint8_t **image, mlt_image_format
 		memset( c->current_vectors, 0, c->mv_size );
 
 		// Perform the motion search
-		motion_search( c->cache_image, *image, c );
+		motion_search( c->cache_image, *image, mlt_properties_get_int( MLT_FILTER_PROPERTIES( filter ), "threads" ), c );
 
 		collect_post_statistics( c );
 
@@ -1128,7 +1355,7 @@ mlt_filter filter_motion_est_init( mlt_profile profile, mlt_service_type type, c
 		context->skip_prediction = 0;
 		context->limit_x = 64;
 		context->limit_y = 64;
-		context->search_method = DIAMOND_SEARCH;	// FIXME: not used
+		context->search_method = DIAMOND_SEARCH;
 		context->check_chroma = 0;
 		context->denoise = 1;
 		context->show_reconstruction = 0;
@@ -0,0 +1,117 @@
+/*
+ * SSE2 and AVX2 Sum of Absolute Differences with runtime dispatch
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef _SAD_SIMD_H_
+#define _SAD_SIMD_H_
+
+#include <stdint.h>
+#include <immintrin.h>
+
+/* Unlike the MMX versions in sad_sse.h these handle any block size. With an
+ * xstride of 2 the blocks are the luma of packed YUV 4:2:2, and with an
+ * xstride of 1 they are planar 8-bit. Whole vectors are compared while they
+ * fit within the row and the remaining pixels are compared one by one.
+ */
+
+static inline int sad_simd_tail( uint8_t *block1, uint8_t *block2, int xstride, int from, int w )
+{
+	int i, score = 0;
+	for ( i = from; i < w; i++ )
+	{
+		int d = block1[i * xstride] - block2[i * xstride];
+		score += d >= 0 ? d : -d;
+	}
+	return score;
+}
+
+__attribute__((target("sse2")))
+static int sad_sse2( uint8_t *block1, uint8_t *block2, int xstride, int ystride, int w, int h )
+{
+	const __m128i mask = xstride == 2 ? _mm_set1_epi16( 0x00ff ) : _mm_set1_epi8( -1 );
+	const int step = 16 / xstride;
+	__m128i sum = _mm_setzero_si128();
+	int score = 0;
+
+	while ( h-- )
+	{
+		int i;
+		for ( i = 0; i + step <= w; i += step )
+		{
+			__m128i a = _mm_and_si128( _mm_loadu_si128( (__m128i*) ( block1 + i * xstride ) ), mask );
+			__m128i b = _mm_and_si128( _mm_loadu_si128( (__m128i*) ( block2 + i * xstride ) ), mask );
+			sum = _mm_add_epi64( sum, _mm_sad_epu8( a, b ) );
+		}
+		if ( i < w )
+			score += sad_simd_tail( block1, block2, xstride, i, w );
+		block1 += ystride;
+		block2 += ystride;
+	}
+	sum = _mm_add_epi64( sum, _mm_srli_si128( sum, 8 ) );
+	return score + _mm_cvtsi128_si32( sum );
+}
+
+__attribute__((target("avx2")))
+static int sad_avx2( uint8_t *block1, uint8_t *block2, int xstride, int ystride, int w, int h )
+{
+	const __m256i mask = xstride == 2 ? _mm256_set1_epi16( 0x00ff ) : _mm256_set1_epi8( -1 );
+	const int step = 32 / xstride;
+	__m256i sum = _mm256_setzero_si256();
+	__m128i sum128 = _mm_setzero_si128();
+	int score = 0;
+
+	while ( h-- )
+	{
+		int i;
+		for ( i = 0; i + step <= w; i += step )
+		{
+			__m256i a = _mm256_and_si256( _mm256_loadu_si256( (__m256i*) ( block1 + i * xstride ) ), mask );
+			__m256i b = _mm256_and_si256( _mm256_loadu_si256( (__m256i*) ( block2 + i * xstride ) ), mask );
+			sum = _mm256_add_epi64( sum, _mm256_sad_epu8( a, b ) );
+		}
+		// Half a vector covers 8 pixels of 4:2:2 luma, which is common
+		if ( i + step / 2 <= w )
+		{
+			__m128i a = _mm_and_si128( _mm_loadu_si128( (__m128i*) ( block1 + i * xstride ) ), _mm256_castsi256_si128( mask ) );
+			__m128i b = _mm_and_si128( _mm_loadu_si128( (__m128i*) ( block2 + i * xstride ) ), _mm256_castsi256_si128( mask ) );
+			sum128 = _mm_add_epi64( sum128, _mm_sad_epu8( a, b ) );
+			i += step / 2;
+		}
+		if ( i < w )
+			score += sad_simd_tail( block1, block2, xstride, i, w );
+		block1 += ystride;
+		block2 += ystride;
+	}
+	sum128 = _mm_add_epi64( sum128, _mm256_castsi256_si128( sum ) );
+	sum128 = _mm_add_epi64( sum128, _mm256_extracti128_si256( sum, 1 ) );
+	sum128 = _mm_add_epi64( sum128, _mm_srli_si128( sum128, 8 ) );
+	return score + _mm_cvtsi128_si32( sum128 );
+}
+
+/** Choose the fastest comparison supported by the CPU.
+*/
+static inline int (*sad_simd_select( void ))( uint8_t *, uint8_t *, int, int, int, int )
+{
+	__builtin_cpu_init();
+	if ( __builtin_cpu_supports( "avx2" ) )
+		return sad_avx2;
+	if ( __builtin_cpu_supports( "sse2" ) )
+		return sad_sse2;
+	return NULL;
+}
+
+#endif
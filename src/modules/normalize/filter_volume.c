@@ -192,8 +192,12 @@ static int filter_get_audio( mlt_frame frame, void **buffer, mlt_audio_format *f
 	if ( mlt_properties_get( instance_props, "limiter" ) != NULL )
 		limiter_level = mlt_properties_get_double( instance_props, "limiter" );
 	
-	// Get the producer's audio
-	*format = normalise? mlt_audio_s16 : mlt_audio_f32le;
+	// Get the producer's audio, keeping the float layout requested downstream to
+	// avoid converting back and forth; planar float is the default.
+	if ( normalise )
+		*format = mlt_audio_s16;
+	else if ( *format != mlt_audio_f32le )
+		*format = mlt_audio_float;
 	mlt_frame_get_audio( frame, buffer, format, frequency, channels, samples );
 
 	mlt_service_lock( MLT_FILTER_SERVICE( filter ) );
@@ -269,6 +273,15 @@ static int filter_get_audio( mlt_frame frame, void **buffer, mlt_audio_format *f
 			}
 		}
 	}
+	else if ( *format == mlt_audio_float )
+	{
+		for ( j = 0; j < *channels; j++ ) {
+			float *p = (float*) *buffer + j * *samples;
+			float g = gain, step = gain_step;
+			for ( i = 0; i < *samples; i++ )
+				p[i] *= g + step * i;
+		}
+	}
 	else
 	{
 		float *p = *buffer;
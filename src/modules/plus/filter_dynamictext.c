@@ -220,6 +220,21 @@ static void substitute_keywords(mlt_filter filter, char* result, char* value, ml
 	}
 }
 
+/** Set a property on the text producer only when its value differs, so that an
+ * unchanged title does not look modified and keeps its rendered image.
+*/
+static void set_if_changed( mlt_properties properties, const char *name, const char *value )
+{
+	const char *current = mlt_properties_get( properties, name );
+	if ( !value || !current || strcmp( value, current ) )
+		mlt_properties_set( properties, name, value );
+}
+
+static void pass_property( mlt_properties producer_properties, const char *name, mlt_properties my_properties, const char *my_name )
+{
+	set_if_changed( producer_properties, name, mlt_properties_get( my_properties, my_name ) );
+}
+
 static int setup_producer( mlt_filter filter, mlt_producer producer, mlt_frame frame )
 {
 	mlt_properties my_properties = MLT_FILTER_PROPERTIES( filter );
@@ -235,20 +250,20 @@ static int setup_producer( mlt_filter filter, mlt_producer producer, mlt_frame f
 		// Apply keyword substitution before passing the text to the filter.
 		char result[MAX_TEXT_LEN] = "";
 		substitute_keywords( filter, result, dynamic_text, frame );
-		mlt_properties_set( producer_properties, "text", (char*)result );
+		set_if_changed( producer_properties, "text", result );
 	}
 
 	// Pass the properties to the pango producer
-	mlt_properties_set( producer_properties, "family", mlt_properties_get( my_properties, "family" ) );
-	mlt_properties_set( producer_properties, "size", mlt_properties_get( my_properties, "size" ) );
-	mlt_properties_set( producer_properties, "weight", mlt_properties_get( my_properties, "weight" ) );
-	mlt_properties_set( producer_properties, "style", mlt_properties_get( my_properties, "style" ) );
-	mlt_properties_set( producer_properties, "fgcolour", mlt_properties_get( my_properties, "fgcolour" ) );
-	mlt_properties_set( producer_properties, "bgcolour", mlt_properties_get( my_properties, "bgcolour" ) );
-	mlt_properties_set( producer_properties, "olcolour", mlt_properties_get( my_properties, "olcolour" ) );
-	mlt_properties_set( producer_properties, "pad", mlt_properties_get( my_properties, "pad" ) );
-	mlt_properties_set( producer_properties, "outline", mlt_properties_get( my_properties, "outline" ) );
-	mlt_properties_set( producer_properties, "align", mlt_properties_get( my_properties, "halign" ) );
+	pass_property( producer_properties, "family", my_properties, "family" );
+	pass_property( producer_properties, "size", my_properties, "size" );
+	pass_property( producer_properties, "weight", my_properties, "weight" );
+	pass_property( producer_properties, "style", my_properties, "style" );
+	pass_property( producer_properties, "fgcolour", my_properties, "fgcolour" );
+	pass_property( producer_properties, "bgcolour", my_properties, "bgcolour" );
+	pass_property( producer_properties, "olcolour", my_properties, "olcolour" );
+	pass_property( producer_properties, "pad", my_properties, "pad" );
+	pass_property( producer_properties, "outline", my_properties, "outline" );
+	pass_property( producer_properties, "align", my_properties, "halign" );
 
 	return 1;
 }
@@ -40,20 +40,20 @@ static int filter_get_image( mlt_frame frame, uint8_t **image, mlt_image_format
 
 	int mask = mlt_properties_get_int( MLT_FILTER_PROPERTIES( filter ), "alpha" );
 	*format = mlt_image_yuv422;
-	int error = mlt_frame_get_image( frame, image, format, width, height, 1 );
+	int error = mlt_frame_get_image_lut( frame, image, format, width, height );
 
 	// Only process if we have no error and a valid colour space
-	if ( error == 0 )
+	if ( error == 0 && *format == mlt_image_yuv422 )
 	{
-		uint8_t *p = *image;
-		uint8_t *q = *image + *width * *height * 2;
-		uint8_t *r = *image;
+		uint8_t lut[3][256];
+		int i;
 
-		while ( p != q )
+		for ( i = 0; i < 256; i++ )
 		{
-			*p ++ = clamp( 251 - *r ++, 16, 235 );
-			*p ++ = clamp( 256 - *r ++, 16, 240 );
+			lut[0][i] = clamp( 251 - i, 16, 235 );
+			lut[1][i] = lut[2][i] = clamp( 256 - i, 16, 240 );
 		}
+		mlt_frame_add_lut( frame, *format, lut[0] );
 
 		if ( mask )
 		{
@@ -107,54 +107,21 @@ static void refresh_lut( mlt_filter filter, mlt_frame frame )
 	}
 }
 
-static void apply_lut( mlt_filter filter, uint8_t* image, mlt_image_format format, int width, int height )
+static void apply_lut( mlt_filter filter, mlt_frame frame, mlt_image_format format )
 {
 	private_data* self = (private_data*)filter->child;
-	uint8_t* rlut = malloc( sizeof(self->rlut) );
-	uint8_t* glut = malloc( sizeof(self->glut) );
-	uint8_t* blut = malloc( sizeof(self->blut) );
-	int total = width * height + 1;
-	uint8_t* sample = image;
+	uint8_t lut[3][256];
 
 	// Copy the LUT so that we can be frame-thread safe.
 	mlt_service_lock( MLT_FILTER_SERVICE( filter ) );
-	memcpy( rlut, self->rlut, sizeof(self->rlut) );
-	memcpy( glut, self->glut, sizeof(self->glut) );
-	memcpy( blut, self->blut, sizeof(self->blut) );
+	memcpy( lut[0], self->rlut, sizeof(self->rlut) );
+	memcpy( lut[1], self->glut, sizeof(self->glut) );
+	memcpy( lut[2], self->blut, sizeof(self->blut) );
 	mlt_service_unlock( MLT_FILTER_SERVICE( filter ) );
 
-	switch( format )
-	{
-	case mlt_image_rgb24:
-		while( --total )
-		{
-			*sample = rlut[ *sample ];
-			sample++;
-			*sample = glut[ *sample ];
-			sample++;
-			*sample = blut[ *sample ];
-			sample++;
-		}
-		break;
-	case mlt_image_rgb24a:
-		while( --total )
-		{
-			*sample = rlut[ *sample ];
-			sample++;
-			*sample = glut[ *sample ];
-			sample++;
-			*sample = blut[ *sample ];
-			sample++;
-			sample++; // Skip alpha
-		}
-		break;
-	default:
+	// The frame combines it with other point operations and leaves alpha alone.
+	if ( mlt_frame_add_lut( frame, format, lut[0] ) )
 		mlt_log_error( MLT_FILTER_SERVICE( filter ), "Invalid image format: %s\n", mlt_image_format_name( format ) );
-		break;
-	}
-	free( rlut );
-	free( glut );
-	free( blut );
 }
 
 static int filter_get_image( mlt_frame frame, uint8_t **image, mlt_image_format *format, int *width, int *height, int writable )
@@ -175,13 +142,12 @@ static int filter_get_image( mlt_frame frame, uint8_t **image, mlt_image_format
 	}
 
 	// Get the image
-	writable = 1;
-	error = mlt_frame_get_image( frame, image, format, width, height, writable );
+	error = mlt_frame_get_image_lut( frame, image, format, width, height );
 
 	// Apply the LUT
 	if( !error )
 	{
-		apply_lut( filter, *image, *format, *width, *height );
+		apply_lut( filter, frame, *format );
 	}
 
 	return error;
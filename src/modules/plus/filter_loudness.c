@@ -22,6 +22,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <pthread.h>
 #include "ebur128/ebur128.h"
 
 #define MAX_RESULT_SIZE 512
@@ -45,6 +46,17 @@ typedef struct
 	mlt_position last_position;
 } private_data;
 
+typedef struct
+{
+	mlt_producer producer;
+	ebur128_state* state;
+	mlt_position in;
+	mlt_position out;
+	int channels;
+	int frequency;
+	double fps;
+} chunk_data;
+
 static void destroy_analyze_data( mlt_filter filter )
 {
 	private_data* private = (private_data*)filter->child;
@@ -90,6 +102,231 @@ static void init_apply_data( mlt_filter filter )
 	}
 }
 
+static void store_results( mlt_filter filter, mlt_frame frame, ebur128_state** states, int count, int channels )
+{
+	mlt_properties properties = MLT_FILTER_PROPERTIES( filter );
+	double loudness = 0.0;
+	double range = 0.0;
+	double tmpPeak = 0.0;
+	double peak = 0.0;
+	int i = 0, j = 0;
+	char result[MAX_RESULT_SIZE];
+
+	// The gating blocks of all of the states are combined.
+	ebur128_loudness_global_multiple( states, count, &loudness );
+	ebur128_loudness_range_multiple( states, count, &range );
+
+	for ( j = 0; j < count; j++ )
+	{
+		for ( i = 0; i < channels; i++ )
+		{
+			ebur128_sample_peak( states[j], i, &tmpPeak );
+			if( tmpPeak > peak )
+			{
+				peak = tmpPeak;
+			}
+		}
+	}
+
+	snprintf( result, MAX_RESULT_SIZE, "L: %lf\tR: %lf\tP %lf", loudness, range, peak );
+	result[ MAX_RESULT_SIZE - 1 ] = '\0';
+	mlt_log_info( MLT_FILTER_SERVICE( filter ), "Stored results: %s\n", result );
+	mlt_properties_set( properties, "results", result );
+
+	// Also store them in the sidecar of an analysis pass.
+	double record[3] = { loudness, range, peak };
+	mlt_analysis_filter_put( filter, frame, 0, record, sizeof( record ) );
+}
+
+static void load_results( mlt_filter filter )
+{
+	double record[3];
+	if ( mlt_analysis_filter_get( filter, 0, record, sizeof( record ) ) == sizeof( record ) )
+	{
+		char result[MAX_RESULT_SIZE];
+		snprintf( result, MAX_RESULT_SIZE, "L: %lf\tR: %lf\tP %lf", record[0], record[1], record[2] );
+		mlt_properties_set( MLT_FILTER_PROPERTIES( filter ), "results", result );
+	}
+}
+
+static void* analyze_chunk( void* arg )
+{
+	chunk_data* chunk = (chunk_data*)arg;
+	mlt_position position = chunk->in;
+
+	mlt_producer_seek( chunk->producer, chunk->in );
+	while ( position < chunk->out )
+	{
+		mlt_frame frame = NULL;
+		if ( mlt_service_get_frame( MLT_PRODUCER_SERVICE( chunk->producer ), &frame, 0 ) || !frame )
+			break;
+
+		mlt_audio_format format = mlt_audio_f32le;
+		int frequency = chunk->frequency;
+		int channels = chunk->channels;
+		int samples = mlt_sample_calculator( chunk->fps, frequency, position );
+		void* buffer = NULL;
+		if ( !mlt_frame_get_audio( frame, &buffer, &format, &frequency, &channels, &samples ) &&
+		     format == mlt_audio_f32le && channels == chunk->channels )
+		{
+			ebur128_add_frames_float( chunk->state, buffer, samples );
+		}
+		mlt_frame_close( frame );
+		position++;
+	}
+	return NULL;
+}
+
+/** Copy the service that a filter is attached to through XML.
+ *
+ * The service is serialized as it is, so nothing the user can see changes
+ * on its filters.
+ * \return the XML, which the caller must free, or NULL on error
+ */
+
+static char* serialize_service( mlt_service service, mlt_profile profile )
+{
+	mlt_properties properties = MLT_SERVICE_PROPERTIES( service );
+	mlt_consumer consumer = mlt_factory_consumer( profile, "xml", "string" );
+	char* title = mlt_properties_get( properties, "title" );
+	char* root = mlt_properties_get( properties, "root" );
+	char* xml = NULL;
+
+	if ( !consumer )
+		return NULL;
+
+	// The XML consumer sets these, so restore them.
+	title = title ? strdup( title ) : NULL;
+	root = root ? strdup( root ) : NULL;
+	mlt_properties_set_int( MLT_CONSUMER_PROPERTIES( consumer ), "no_meta", 1 );
+	mlt_consumer_connect( consumer, service );
+	mlt_consumer_start( consumer );
+	xml = mlt_properties_get( MLT_CONSUMER_PROPERTIES( consumer ), "string" );
+	xml = xml ? strdup( xml ) : NULL;
+	mlt_consumer_close( consumer );
+	mlt_properties_set( properties, "title", title );
+	mlt_properties_set( properties, "root", root );
+	free( title );
+	free( root );
+	return xml;
+}
+
+/** Make a private copy of the service without the filter and those after it.
+ *
+ * \param xml the serialized service
+ * \param index the index of the filter on the service
+ * \param count the number of filters on the service
+ * \return a producer that is not shared with anything, or NULL on error
+ */
+
+static mlt_producer copy_service( mlt_profile profile, const char* xml, int index, int count )
+{
+	mlt_producer copy = mlt_factory_producer( profile, "xml-string", xml );
+	int i;
+
+	if ( copy && mlt_service_filter_count( MLT_PRODUCER_SERVICE( copy ) ) != count )
+	{
+		mlt_producer_close( copy );
+		return NULL;
+	}
+	for ( i = index; copy && i < count; i++ )
+		mlt_properties_set_int( MLT_FILTER_PROPERTIES( mlt_service_filter( MLT_PRODUCER_SERVICE( copy ), i ) ), "disable", 1 );
+	return copy;
+}
+
+/** Analyze the whole range of the filter in parallel chunks.
+ *
+ * The service the filter is attached to is copied through XML once for each
+ * thread, and this filter and the filters after it are disabled in the
+ * copies. Each copy analyzes a contiguous chunk with its own state. The
+ * states are combined when all of them are done. Gating blocks that would
+ * span the boundaries of the chunks are lost, which is insignificant for
+ * chunks of a minute or more.
+ * \return true if the analysis could not be done in parallel
+ */
+
+static int analyze_parallel( mlt_filter filter, mlt_frame frame, int channels, int frequency )
+{
+	mlt_properties properties = MLT_FILTER_PROPERTIES( filter );
+	mlt_service service = mlt_properties_get_data( properties, "service", NULL );
+	mlt_profile profile = mlt_service_profile( MLT_FILTER_SERVICE( filter ) );
+	int threads = mlt_properties_get_int( properties, "threads" );
+	mlt_position in = mlt_frame_get_position( frame );
+	mlt_position length = mlt_filter_get_length2( filter, frame );
+	double fps = mlt_profile_fps( profile );
+	int i, index = -1, count = 0;
+
+	if ( service && profile && length > 0 )
+	{
+		count = mlt_service_filter_count( service );
+		for ( i = 0; i < count && index < 0; i++ )
+			if ( mlt_service_filter( service, i ) == filter )
+				index = i;
+	}
+	if ( index < 0 )
+	{
+		mlt_log_warning( MLT_FILTER_SERVICE( filter ), "Parallel analysis needs an attached filter\n" );
+		return 1;
+	}
+
+	// Use chunks of at least a minute.
+	threads = MIN( threads, MAX( 1, length / ( fps * 60 ) ) );
+
+	char* xml = serialize_service( service, profile );
+	if ( !xml )
+	{
+		mlt_log_warning( MLT_FILTER_SERVICE( filter ), "Unable to copy the service for parallel analysis\n" );
+		return 1;
+	}
+
+	// Make a copy and a state for each chunk.
+	chunk_data* chunks = calloc( threads, sizeof( chunk_data ) );
+	ebur128_state** states = calloc( threads, sizeof( ebur128_state* ) );
+	pthread_t* thread_ids = calloc( threads, sizeof( pthread_t ) );
+	int* started = calloc( threads, sizeof( int ) );
+	int error = 0;
+	for ( i = 0; i < threads && !error; i++ )
+	{
+		chunks[i].producer = copy_service( profile, xml, index, count );
+		chunks[i].state = states[i] = ebur128_init( (unsigned int)channels, (unsigned long)frequency, EBUR128_MODE_I | EBUR128_MODE_LRA | EBUR128_MODE_SAMPLE_PEAK );
+		chunks[i].in = in + length * i / threads;
+		chunks[i].out = in + length * ( i + 1 ) / threads;
+		chunks[i].channels = channels;
+		chunks[i].frequency = frequency;
+		chunks[i].fps = fps;
+		error = !chunks[i].producer || !chunks[i].state;
+	}
+	free( xml );
+
+	for ( i = 0; i < threads && !error; i++ )
+		started[i] = !pthread_create( &thread_ids[i], NULL, analyze_chunk, &chunks[i] );
+	for ( i = 0; i < threads; i++ )
+	{
+		if ( started[i] )
+			pthread_join( thread_ids[i], NULL );
+		else
+			error = 1;
+	}
+
+	if ( !error )
+	{
+		mlt_log_info( MLT_FILTER_SERVICE( filter ), "Analyzed %d frames in %d chunks\n", (int) length, threads );
+		store_results( filter, frame, states, threads, channels );
+	}
+	for ( i = 0; i < threads; i++ )
+	{
+		mlt_producer_close( chunks[i].producer );
+		if ( states[i] )
+			ebur128_destroy( &states[i] );
+	}
+	free( chunks );
+	free( states );
+	free( thread_ids );
+	free( started );
+
+	return error;
+}
+
 static void analyze( mlt_filter filter, mlt_frame frame, void **buffer, mlt_audio_format *format, int *frequency, int *channels, int *samples )
 {
 	private_data* private = (private_data*)filter->child;
@@ -114,29 +351,7 @@ static void analyze( mlt_filter filter, mlt_frame frame, void **buffer, mlt_audi
 
 		if ( pos + 1 == mlt_filter_get_length2( filter, frame ) )
 		{
-			mlt_properties properties = MLT_FILTER_PROPERTIES( filter );
-			double loudness = 0.0;
-			double range = 0.0;
-			double tmpPeak = 0.0;
-			double peak = 0.0;
-			int i = 0;
-			char result[MAX_RESULT_SIZE];
-			ebur128_loudness_global( private->analyze->state, &loudness );
-			ebur128_loudness_range( private->analyze->state, &range );
-
-			for ( i = 0; i < *channels; i++ )
-			{
-				ebur128_sample_peak( private->analyze->state, i, &tmpPeak );
-				if( tmpPeak > peak )
-				{
-					peak = tmpPeak;
-				}
-			}
-
-			snprintf( result, MAX_RESULT_SIZE, "L: %lf\tR: %lf\tP %lf", loudness, range, peak );
-			result[ MAX_RESULT_SIZE - 1 ] = '\0';
-			mlt_log_info( MLT_FILTER_SERVICE( filter ), "Stored results: %s\n", result );
-			mlt_properties_set( properties, "results", result );
+			store_results( filter, frame, &private->analyze->state, 1, *channels );
 			destroy_analyze_data( filter );
 		}
 
@@ -178,13 +393,25 @@ static int filter_get_audio( mlt_frame frame, void **buffer, mlt_audio_format *f
 	mlt_filter filter = mlt_frame_pop_audio( frame );
 	mlt_properties properties = MLT_FILTER_PROPERTIES( filter );
 
+	// Use the results of an analysis pass if there are any.
+	char* results = mlt_properties_get( properties, "results" );
+	if( !results || !strcmp( results, "" ) )
+		load_results( filter );
+
 	mlt_service_lock( MLT_FILTER_SERVICE( filter ) );
 
 	// Get the producer's audio
 	*format = mlt_audio_f32le;
 	mlt_frame_get_audio( frame, buffer, format, frequency, channels, samples );
 
-	char* results = mlt_properties_get( properties, "results" );
+	results = mlt_properties_get( properties, "results" );
+	if( ( !results || !strcmp( results, "" ) ) && mlt_properties_get_int( properties, "threads" ) > 0 &&
+	    mlt_filter_get_position( filter, frame ) == 0 )
+	{
+		// Analyze the whole range now and then apply the results.
+		analyze_parallel( filter, frame, *channels, *frequency );
+		results = mlt_properties_get( properties, "results" );
+	}
 	if( results && strcmp( results, "" ) )
 	{
 		apply( filter, frame, buffer, format, frequency, channels, samples );
@@ -222,6 +449,7 @@ static void filter_close( mlt_filter filter )
 		{
 			destroy_analyze_data( filter );
 		}
+		destroy_apply_data( filter );
 		free( private );
 	}
 	filter->child = NULL;
@@ -242,6 +470,8 @@ mlt_filter filter_loudness_init( mlt_profile profile, mlt_service_type type, con
 	{
 		mlt_properties properties = MLT_FILTER_PROPERTIES( filter );
 		mlt_properties_set( properties, "program", "-23.0" );
+		// The analysis needs every frame of the range in one instance.
+		mlt_properties_set_int( properties, "_analysis_whole", 1 );
 
 		data->analyze = NULL;
 
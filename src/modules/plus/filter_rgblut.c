@@ -66,10 +66,10 @@ static int filter_get_image( mlt_frame frame, uint8_t **image, mlt_image_format
 	mlt_filter filter = mlt_frame_pop_service( frame );
 
 	*format = mlt_image_rgb24;
-	int error = mlt_frame_get_image( frame, image, format, width, height, 0 );
+	int error = mlt_frame_get_image_lut( frame, image, format, width, height );
 
 	// Only process if we have no error and a valid colour space
-	if ( error == 0 )
+	if ( error == 0 && *format == mlt_image_rgb24 )
 	{
 
 		// Create lut tables from properties for each RGB channel
@@ -85,16 +85,16 @@ static int filter_get_image( mlt_frame frame, uint8_t **image, mlt_image_format
 		int b_lut[256];
 		fill_channel_lut( b_lut, b_str );
 
-		// Apply look-up tables into image
-		int i = *width * *height + 1;
-		uint8_t *p = *image;
-		uint8_t *r = *image;
-		while ( --i )
+		// Queue the look-up tables for the image
+		uint8_t lut[3][256];
+		int i;
+		for ( i = 0; i < 256; i++ )
 		{
-			*p ++ = r_lut[ *r ++ ];
-			*p ++ = g_lut[ *r ++ ];
-			*p ++ = b_lut[ *r ++ ];
+			lut[0][i] = r_lut[i];
+			lut[1][i] = g_lut[i];
+			lut[2][i] = b_lut[i];
 		}
+		mlt_frame_add_lut( frame, *format, lut[0] );
 	}
 
 	return error;
@@ -37,39 +37,25 @@ static int filter_get_image( mlt_frame frame, uint8_t **image, mlt_image_format
 
 	// Get the image
 	*format = mlt_image_yuv422;
-	int error = mlt_frame_get_image( frame, image, format, width, height, 1 );
+	int error = mlt_frame_get_image_lut( frame, image, format, width, height );
 
 	// Only process if we have no error and a valid colour space
-	if ( error == 0 && *image )
+	if ( error == 0 && *image && *format == mlt_image_yuv422 )
 	{
-		// We modify the whole image
-		uint8_t *p = *image;
-		int h = *height;
-		int uneven = *width % 2;
-		int w = ( *width - uneven ) / 2;
-		int t;
-
 		// Get u and v values
 		int u = mlt_properties_anim_get_int( properties, "u", position, length );
 		int v = mlt_properties_anim_get_int( properties, "v", position, length );
 
-		// Loop through image
-		while( h -- )
+		// Keep the luma and replace the chroma of the whole image
+		uint8_t lut[3][256];
+		int i;
+		for ( i = 0; i < 256; i++ )
 		{
-			t = w;
-			while( t -- )
-			{
-				p ++;
-				*p ++ = u;
-				p ++;
-				*p ++ = v;
-			}
-			if ( uneven )
-			{
-				p ++;
-				*p ++ = u;
-			}
+			lut[0][i] = i;
+			lut[1][i] = u;
+			lut[2][i] = v;
 		}
+		mlt_frame_add_lut( frame, *format, lut[0] );
 	}
 
 	return error;
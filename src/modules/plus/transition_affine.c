@@ -28,6 +28,11 @@
 
 #include "interp.h"
 
+#if defined(__GNUC__) && (__GNUC__ > 4 || __GNUC__ == 4 && __GNUC_MINOR__ >= 9) && defined(USE_SSE2) && defined(ARCH_X86_64)
+#define AFFINE_AVX2
+#include <immintrin.h>
+#endif
+
 static float alignment_parse( char* align )
 {
 	int ret = 0.0f;
@@ -374,28 +379,371 @@ struct sliced_desc
 	float x_offset, y_offset;
 	int b_alpha;
 	float minima, xmax, ymax;
+	int avx2;
 };
 
+/** Narrow [*first, *end) to the columns whose source coordinate, start + step * column,
+ * can lie within [lo, hi]. The span is widened by a pixel on each side to absorb
+ * rounding, so the samplers still test every pixel they visit.
+ */
+
+static void clip_span( double start, double step, double lo, double hi, int *first, int *end )
+{
+	double a, b;
+
+	if ( step == 0.0 )
+	{
+		if ( start < lo - 1.0 || start > hi + 1.0 )
+			*end = *first;
+		return;
+	}
+	a = ( lo - start ) / step;
+	b = ( hi - start ) / step;
+	if ( a > b )
+	{
+		double t = a;
+		a = b;
+		b = t;
+	}
+	a = MAX( a - 1.0, *first );
+	b = MIN( b + 2.0, *end );
+	if ( b <= a )
+	{
+		*end = *first;
+		return;
+	}
+	*first = floor( a );
+	*end = ceil( b );
+}
+
+#ifdef AFFINE_AVX2
+
+__attribute__((target("avx2")))
+static inline __m128 bilinear_channel( __m128i p00, __m128i p01, __m128i p10, __m128i p11, int shift, __m128 fx, __m128 fy )
+{
+	const __m128i byte = _mm_set1_epi32( 0xff );
+	__m128 s00 = _mm_cvtepi32_ps( _mm_and_si128( _mm_srli_epi32( p00, shift ), byte ) );
+	__m128 s01 = _mm_cvtepi32_ps( _mm_and_si128( _mm_srli_epi32( p01, shift ), byte ) );
+	__m128 s10 = _mm_cvtepi32_ps( _mm_and_si128( _mm_srli_epi32( p10, shift ), byte ) );
+	__m128 s11 = _mm_cvtepi32_ps( _mm_and_si128( _mm_srli_epi32( p11, shift ), byte ) );
+	__m128 a = _mm_add_ps( s00, _mm_mul_ps( _mm_sub_ps( s01, s00 ), fx ) );
+	__m128 b = _mm_add_ps( s10, _mm_mul_ps( _mm_sub_ps( s11, s10 ), fx ) );
+	return _mm_add_ps( a, _mm_mul_ps( _mm_sub_ps( b, a ), fy ) );
+}
+
+/** Bilinear sampling of four destination pixels at a time with gathered source pixels.
+ * The arithmetic follows interpBL_b32 step for step, including its double precision
+ * blend, so the result is identical to the scalar path. Returns the first column not done.
+ */
+
+__attribute__((target("avx2")))
+static int sample_row_bilinear_avx2( struct sliced_desc *ctx, uint8_t *row, int j, int end, double x, double y, double step_x, double step_y )
+{
+	const int *src = (const int*) ctx->b_image;
+	const __m256d lane = _mm256_setr_pd( 0, 1, 2, 3 );
+	const __m128 minima = _mm_set1_ps( ctx->minima );
+	const __m128 xmax = _mm_set1_ps( ctx->xmax );
+	const __m128 ymax = _mm_set1_ps( ctx->ymax );
+	const __m128i width = _mm_set1_epi32( ctx->b_width );
+	const __m128i last_x = _mm_set1_epi32( ctx->b_width - 1 );
+	const __m128i last_y = _mm_set1_epi32( ctx->b_height - 1 );
+	const __m128i one_i = _mm_set1_epi32( 1 );
+	const __m128i byte = _mm_set1_epi32( 0xff );
+	const __m256d mix = _mm256_set1_pd( ctx->mix );
+	const __m256d one = _mm256_set1_pd( 1.0 );
+	const __m256d full = _mm256_set1_pd( 255.0 );
+
+	for ( ; j + 4 <= end; j += 4 )
+	{
+		__m256d column = _mm256_add_pd( _mm256_set1_pd( j ), lane );
+		__m128 dx = _mm256_cvtpd_ps( _mm256_add_pd( _mm256_set1_pd( x ), _mm256_mul_pd( column, _mm256_set1_pd( step_x ) ) ) );
+		__m128 dy = _mm256_cvtpd_ps( _mm256_add_pd( _mm256_set1_pd( y ), _mm256_mul_pd( column, _mm256_set1_pd( step_y ) ) ) );
+		__m128 inside = _mm_and_ps( _mm_and_ps( _mm_cmpge_ps( dx, minima ), _mm_cmple_ps( dx, xmax ) ),
+		                            _mm_and_ps( _mm_cmpge_ps( dy, minima ), _mm_cmple_ps( dy, ymax ) ) );
+		if ( !_mm_movemask_ps( inside ) )
+			continue;
+
+		__m128i mask = _mm_castps_si128( inside );
+		__m128 fm = _mm_floor_ps( dx );
+		__m128 fn = _mm_floor_ps( dy );
+		__m128 fx = _mm_sub_ps( dx, fm );
+		__m128 fy = _mm_sub_ps( dy, fn );
+		__m128i m = _mm_cvttps_epi32( fm );
+		__m128i n = _mm_cvttps_epi32( fn );
+		// The second column or row only has a weight when it exists, so clamp it to the image.
+		__m128i m1 = _mm_min_epi32( _mm_add_epi32( m, one_i ), last_x );
+		__m128i n1 = _mm_min_epi32( _mm_add_epi32( n, one_i ), last_y );
+		__m128i r0 = _mm_mullo_epi32( n, width );
+		__m128i r1 = _mm_mullo_epi32( n1, width );
+		__m128i zero = _mm_setzero_si128();
+		__m128i p00 = _mm_mask_i32gather_epi32( zero, src, _mm_add_epi32( r0, m ), mask, 4 );
+		__m128i p01 = _mm_mask_i32gather_epi32( zero, src, _mm_add_epi32( r0, m1 ), mask, 4 );
+		__m128i p10 = _mm_mask_i32gather_epi32( zero, src, _mm_add_epi32( r1, m ), mask, 4 );
+		__m128i p11 = _mm_mask_i32gather_epi32( zero, src, _mm_add_epi32( r1, m1 ), mask, 4 );
+		__m128i d = _mm_loadu_si128( (__m128i*) ( row + j * 4 ) );
+		__m128i out;
+		int c;
+
+		__m128 alpha = bilinear_channel( p00, p01, p10, p11, 24, fx, fy );
+		if ( ctx->b_alpha )
+			out = _mm_slli_epi32( _mm_cvttps_epi32( alpha ), 24 );
+		else
+			out = _mm_andnot_si128( _mm_set1_epi32( 0x00ffffff ), d );
+		alpha = _mm256_cvtpd_ps( _mm256_mul_pd( _mm256_div_pd( _mm256_cvtps_pd( alpha ), full ), mix ) );
+		__m256d inv = _mm256_sub_pd( one, _mm256_cvtps_pd( alpha ) );
+
+		for ( c = 0; c < 3; c++ )
+		{
+			__m128 v = bilinear_channel( p00, p01, p10, p11, 8 * c, fx, fy );
+			__m256d dc = _mm256_cvtepi32_pd( _mm_and_si128( _mm_srli_epi32( d, 8 * c ), byte ) );
+			__m256d r = _mm256_add_pd( _mm256_mul_pd( dc, inv ), _mm256_cvtps_pd( _mm_mul_ps( v, alpha ) ) );
+			out = _mm_or_si128( out, _mm_slli_epi32( _mm256_cvttpd_epi32( r ), 8 * c ) );
+		}
+		_mm_storeu_si128( (__m128i*) ( row + j * 4 ), _mm_blendv_epi8( d, out, mask ) );
+	}
+	return j;
+}
+
+#endif
+
+/** Nearest neighbour, bilinear and bicubic sampling for transforms without rotation or
+ * shear. The source row depends only on the destination row and the source column only
+ * on the destination column, so the coordinates are tabulated once per slice and the
+ * bicubic vertical pass is shared by all the destination pixels of a row. The arithmetic
+ * matches the interp.h samplers.
+ */
+
+static void sliced_scale( struct sliced_desc *ctx, int starty, int endy, double x, double step_x )
+{
+	interpp interp = ctx->interp;
+	int w = ctx->b_width;
+	int first = 0, end = ctx->a_width;
+	float *columns;
+	int *cells;
+	float *vertical = NULL;
+	int *used = NULL, count = 0;
+	// The Neville steps of the bicubic sampler use six factors per coordinate.
+	int factors = interp == interpBC_b32 ? 6 : 1;
+	int i, j;
+
+	clip_span( x, step_x, ctx->minima, ctx->xmax, &first, &end );
+	if ( first >= end )
+		return;
+	columns = malloc( ( end - first ) * factors * sizeof( *columns ) );
+	cells = malloc( ( end - first ) * sizeof( *cells ) );
+	if ( interp == interpBC_b32 )
+	{
+		vertical = malloc( w * 4 * sizeof( *vertical ) );
+		used = calloc( w, sizeof( *used ) );
+	}
+	if ( !columns || !cells || ( interp == interpBC_b32 && ( !vertical || !used ) ) )
+	{
+		free( columns );
+		free( cells );
+		free( vertical );
+		free( used );
+		return;
+	}
+
+	// Mark the columns that fall outside with a negative cell.
+	for ( j = first; j < end; j++ )
+	{
+		float dx = x + j * step_x;
+		float *f = columns + ( j - first ) * factors;
+		int m = -1;
+		if ( dx >= ctx->minima && dx <= ctx->xmax )
+		{
+			if ( interp == interpNN_b32 )
+				m = (int) rintf( dx );
+			else if ( interp == interpBL_b32 )
+				m = (int) floorf( dx );
+			else
+			{
+				int l, q;
+				m = (int) ceilf( dx ) - 2;
+				if ( m < 0 ) m = 0;
+				if ( ( m + 5 ) > w ) m = w - 4;
+				for ( q = 1; q < 4; q++ )
+					for ( l = 3; l >= q; l-- )
+						*f++ = ( dx - l - m ) / q;
+			}
+		}
+		if ( factors == 1 )
+			*f = dx;
+		cells[j - first] = m;
+	}
+
+	// List the source columns that the bicubic vertical pass needs, in order.
+	if ( used )
+	{
+		int c;
+		for ( j = 0; j < end - first; j++ )
+			for ( c = cells[j]; c >= 0 && c < cells[j] + 4; c++ )
+				used[c] = 1;
+		for ( c = 0; c < w; c++ )
+			if ( used[c] )
+				used[count++] = c;
+	}
+
+	for ( i = starty; i < endy; i++ )
+	{
+		float y = ctx->lower_y + i;
+		float dy = ( ctx->affine.matrix[1][1] * (double) y + ctx->affine.matrix[1][2] ) / ctx->dz + ctx->y_offset;
+		uint8_t *v = ctx->a_image + ( i * ctx->a_width + first ) * 4;
+		uint8_t *sl = ctx->b_image;
+
+		if ( dy < ctx->minima || dy > ctx->ymax )
+			continue;
+
+		if ( interp == interpNN_b32 )
+		{
+			uint8_t *s = sl + (int) rintf( dy ) * 4 * w;
+			for ( j = 0; j < end - first; j++, v += 4 )
+			{
+				if ( cells[j] < 0 )
+					continue;
+				uint8_t *p = s + cells[j] * 4;
+				float alpha = (float) p[3] / 255.0 * ctx->mix;
+				v[0] = v[0] * ( 1.0 - alpha ) + p[0] * alpha;
+				v[1] = v[1] * ( 1.0 - alpha ) + p[1] * alpha;
+				v[2] = v[2] * ( 1.0 - alpha ) + p[2] * alpha;
+				if ( ctx->b_alpha ) v[3] = p[3];
+			}
+		}
+		else if ( interp == interpBL_b32 )
+		{
+			int n = (int) floorf( dy );
+			float fy = dy - (float) n;
+			uint8_t *s0 = sl + n * 4 * w;
+			// The next row only has a weight when it exists.
+			uint8_t *s1 = n + 1 < ctx->b_height ? s0 + 4 * w : s0;
+			for ( j = 0; j < end - first; j++, v += 4 )
+			{
+				int m = cells[j];
+				if ( m < 0 )
+					continue;
+				float fx = columns[j] - (float) m;
+				int k = m * 4, k1 = m + 1 < w ? k + 4 : k;
+				float a, b, alpha;
+				a = s0[k + 3] + ( s0[k1 + 3] - s0[k + 3] ) * fx;
+				b = s1[k + 3] + ( s1[k1 + 3] - s1[k + 3] ) * fx;
+				alpha = a + ( b - a ) * fy;
+				if ( ctx->b_alpha ) v[3] = alpha;
+				alpha = alpha / 255.0 * ctx->mix;
+				a = s0[k] + ( s0[k1] - s0[k] ) * fx;
+				b = s1[k] + ( s1[k1] - s1[k] ) * fx;
+				v[0] = v[0] * ( 1.0 - alpha ) + ( a + ( b - a ) * fy ) * alpha;
+				a = s0[k + 1] + ( s0[k1 + 1] - s0[k + 1] ) * fx;
+				b = s1[k + 1] + ( s1[k1 + 1] - s1[k + 1] ) * fx;
+				v[1] = v[1] * ( 1.0 - alpha ) + ( a + ( b - a ) * fy ) * alpha;
+				a = s0[k + 2] + ( s0[k1 + 2] - s0[k + 2] ) * fx;
+				b = s1[k + 2] + ( s1[k1 + 2] - s1[k + 2] ) * fx;
+				v[2] = v[2] * ( 1.0 - alpha ) + ( a + ( b - a ) * fy ) * alpha;
+			}
+		}
+		else if ( interp == interpBC_b32 )
+		{
+			int n = (int) ceilf( dy ) - 2;
+			int b, c, l, q;
+			float k[6], *f = k;
+			if ( n < 0 ) n = 0;
+			if ( ( n + 5 ) > ctx->b_height ) n = ctx->b_height - 4;
+			for ( q = 1; q < 4; q++ )
+				for ( l = 3; l >= q; l-- )
+					*f++ = ( dy - l - n ) / q;
+
+			// Vertical pass over the source columns this row uses.
+			for ( j = 0; j < count; j++ )
+			{
+				for ( c = used[j], b = 0; b < 4; b++ )
+				{
+					float p[4];
+					for ( l = 0; l < 4; l++ )
+						p[l] = sl[4 * ( c + ( l + n ) * w ) + b];
+					for ( f = k, q = 1; q < 4; q++ )
+						for ( l = 3; l >= q; l--, f++ )
+							p[l] = p[l] + *f * ( p[l] - p[l - 1] );
+					vertical[4 * c + b] = p[3];
+				}
+			}
+
+			// Horizontal pass for each destination pixel.
+			for ( j = 0; j < end - first; j++, v += 4 )
+			{
+				int m = cells[j];
+				float alpha = 1.0;
+				if ( m < 0 )
+					continue;
+				for ( b = 3; b > -1; b-- )
+				{
+					float p[4];
+					for ( l = 0; l < 4; l++ )
+						p[l] = vertical[4 * ( m + l ) + b];
+					for ( f = columns + j * 6, q = 1; q < 4; q++ )
+						for ( l = 3; l >= q; l--, f++ )
+							p[l] = p[l] + *f * ( p[l] - p[l - 1] );
+					if ( p[3] < 0.0 ) p[3] = 0.0;
+					if ( p[3] > 255.0 ) p[3] = 255.0;
+					if ( b == 3 )
+					{
+						alpha = p[3] / 255.0 * ctx->mix;
+						if ( ctx->b_alpha ) v[3] = p[3];
+					}
+					else
+					{
+						v[b] = v[b] * ( 1.0 - alpha ) + p[3] * alpha;
+					}
+				}
+			}
+		}
+	}
+	free( columns );
+	free( cells );
+	free( vertical );
+	free( used );
+}
+
 static int sliced_proc( int id, int index, int jobs, void* cookie )
 {
 	(void) id; // unused
-	struct sliced_desc ctx = *((struct sliced_desc*) cookie);
-	int height_slice = (ctx.a_height + jobs / 2) / jobs;
-	int starty = height_slice * index;
-	float x, y;
-	float dx, dy;
+	struct sliced_desc *ctx = (struct sliced_desc*) cookie;
+	float (*matrix)[3] = ctx->affine.matrix;
+	int starty = ctx->a_height * index / jobs;
+	int endy = ctx->a_height * ( index + 1 ) / jobs;
+	// The mapping is affine, so the source position moves by a fixed step per column.
+	double step_x = matrix[0][0] / ctx->dz;
+	double step_y = matrix[1][0] / ctx->dz;
 	int i, j;
 
-	ctx.a_image += (index * height_slice) * (ctx.a_width * 4);
-	for (i = 0, y = ctx.lower_y; i < ctx.a_height; i++, y++) {
-		if (i >= starty && i < (starty + height_slice)) {
-			for (j = 0, x = ctx.lower_x; j < ctx.a_width; j++, x++) {
-				dx = MapX( ctx.affine.matrix, x, y ) / ctx.dz + ctx.x_offset;
-				dy = MapY( ctx.affine.matrix, x, y ) / ctx.dz + ctx.y_offset;
-				if (dx >= ctx.minima && dx <= ctx.xmax && dy >= ctx.minima && dy <= ctx.ymax)
-					ctx.interp(ctx.b_image, ctx.b_width, ctx.b_height, dx, dy, ctx.mix, ctx.a_image, ctx.b_alpha);
-				ctx.a_image += 4;
-			}
+	if ( matrix[0][1] == 0 && matrix[1][0] == 0 && !( ctx->avx2 && ctx->interp == interpBL_b32 ) )
+	{
+		double x = ( matrix[0][0] * (double) ctx->lower_x + matrix[0][2] ) / ctx->dz + ctx->x_offset;
+		sliced_scale( ctx, starty, endy, x, step_x );
+		return 0;
+	}
+
+	for ( i = starty; i < endy; i++ )
+	{
+		float y = ctx->lower_y + i;
+		double x0 = ( matrix[0][0] * (double) ctx->lower_x + matrix[0][1] * (double) y + matrix[0][2] ) / ctx->dz + ctx->x_offset;
+		double y0 = ( matrix[1][0] * (double) ctx->lower_x + matrix[1][1] * (double) y + matrix[1][2] ) / ctx->dz + ctx->y_offset;
+		uint8_t *row = ctx->a_image + i * ctx->a_width * 4;
+		int first = 0, end = ctx->a_width;
+
+		// Only visit the part of the row that the source image covers.
+		clip_span( x0, step_x, ctx->minima, ctx->xmax, &first, &end );
+		clip_span( y0, step_y, ctx->minima, ctx->ymax, &first, &end );
+		j = first;
+#ifdef AFFINE_AVX2
+		if ( ctx->avx2 && ctx->interp == interpBL_b32 )
+			j = sample_row_bilinear_avx2( ctx, row, j, end, x0, y0, step_x, step_y );
+#endif
+		for ( ; j < end; j++ )
+		{
+			float dx = x0 + j * step_x;
+			float dy = y0 + j * step_y;
+			if ( dx >= ctx->minima && dx <= ctx->xmax && dy >= ctx->minima && dy <= ctx->ymax )
+				ctx->interp( ctx->b_image, ctx->b_width, ctx->b_height, dx, dy, ctx->mix, row + j * 4, ctx->b_alpha );
 		}
 	}
 	return 0;
@@ -618,6 +966,11 @@ static int transition_get_image( mlt_frame a_frame, uint8_t **image, mlt_image_f
 		}
 		free( interps );
 
+#ifdef AFFINE_AVX2
+		__builtin_cpu_init();
+		desc.avx2 = __builtin_cpu_supports( "avx2" );
+#endif
+
 		// Do the transform with interpolation
 		int threads = mlt_properties_get_int(properties, "threads");
 		threads = CLAMP(threads, 0, mlt_slices_count_normal());
@@ -110,10 +110,10 @@ static int filter_get_image( mlt_frame frame, uint8_t **image, mlt_image_format
 	mlt_position length = mlt_filter_get_length2( filter, frame );
 
 	*format = mlt_image_rgb24;
-	int error = mlt_frame_get_image( frame, image, format, width, height, 0 );
+	int error = mlt_frame_get_image_lut( frame, image, format, width, height );
 
 	// Only process if we have no error and a valid colour space
-	if ( error == 0 )
+	if ( error == 0 && *format == mlt_image_rgb24 )
 	{
 		// Get values and force accepted ranges
 		double lift = mlt_properties_anim_get_double( properties, "lift", position, length );
@@ -127,16 +127,12 @@ static int filter_get_image( mlt_frame frame, uint8_t **image, mlt_image_format
 		int lgg_lut[256];
 		fill_lgg_lut( lgg_lut, lift, gain, gamma);
 
-		// Filter
-		int i = *width * *height + 1;
-		uint8_t *p = *image;
-		uint8_t *r = *image;
-		while ( --i )
-		{
-			*p ++ = lgg_lut[ *r ++ ];
-			*p ++ = lgg_lut[ *r ++ ];
-			*p ++ = lgg_lut[ *r ++ ];
-		}
+		// Filter the three channels alike
+		uint8_t lut[3][256];
+		int i;
+		for ( i = 0; i < 256; i++ )
+			lut[0][i] = lut[1][i] = lut[2][i] = lgg_lut[i];
+		mlt_frame_add_lut( frame, *format, lut[0] );
 	}
 
 	return error;
@@ -24,6 +24,10 @@
 #include <stdlib.h>
 #include <string.h>
 
+#ifdef USE_SSE2
+#include <emmintrin.h>
+#endif
+
 #define MAX_CYCLE 6
 #define BLKSIZE 24
 #define BLKSIZE_TIMES2 (2 * BLKSIZE)
@@ -81,6 +85,7 @@ struct context_s {
 	unsigned int *overrides, *overrides_p;
 	int film, override, inpattern, found;
 	int force;
+	int threads;
 
 	// Used by field matching.
 	unsigned char *fprp, *fcrp, *fcrp_saved, *fnrp;
@@ -389,128 +394,239 @@ static struct PREDICTION *PredictSoftYUY2(context cx, int frame )
 	return cx->pred;
 }
 
-static
-void CalculateMetrics(context cx, int frame, unsigned char *fcrp, unsigned char *fcrpU, unsigned char *fcrpV,
-					unsigned char *fprp, unsigned char *fprpU, unsigned char *fprpV)
+#define T 4
+
+/** The state shared by the slices of CalculateMetrics().
+*/
+
+struct metrics_desc
 {
-	int x, y, p, c, tmp1, tmp2, skip;
-	int vc;
-    unsigned char *currbot0, *currbot2, *prevbot0, *prevbot2;
+	context cx;
+	unsigned char *fcrp, *fprp;
+	int bands;
+	int *p, *c;
+};
+
+#ifdef USE_SSE2
+/** Add the metrics of 16 bytes of a row of blocks.
+ *
+ * The frames are subsampled to the first 4 bytes of every 8, which are
+ * the lanes of mask. Each lane is the same as an iteration of the scalar
+ * loop in metrics_slice().
+ */
+
+static inline void metrics_sse2( const unsigned char *top0, const unsigned char *top2, const unsigned char *top4,
+	const unsigned char *bot0, const unsigned char *bot2, __m128i mask, __m128i nt, int *sum, unsigned int *count )
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i t = _mm_set1_epi16( T );
+	__m128i total = _mm_setzero_si128();
+	__m128i combed = _mm_setzero_si128();
+	int half;
+
+	for ( half = 0; half < 2; half++ )
+	{
+		__m128i t0 = _mm_loadl_epi64( (const __m128i*) ( top0 + 8 * half ) );
+		__m128i t2 = _mm_loadl_epi64( (const __m128i*) ( top2 + 8 * half ) );
+		__m128i t4 = _mm_loadl_epi64( (const __m128i*) ( top4 + 8 * half ) );
+		__m128i b0 = _mm_loadl_epi64( (const __m128i*) ( bot0 + 8 * half ) );
+		__m128i b2 = _mm_loadl_epi64( (const __m128i*) ( bot2 + 8 * half ) );
+		t0 = _mm_unpacklo_epi8( t0, zero );
+		t2 = _mm_unpacklo_epi8( t2, zero );
+		t4 = _mm_unpacklo_epi8( t4, zero );
+		b0 = _mm_unpacklo_epi8( b0, zero );
+		b2 = _mm_unpacklo_epi8( b2, zero );
+
+		// Combination metric
+		__m128i tmp = _mm_add_epi16( b0, b2 );
+		__m128i diff = _mm_sub_epi16( _mm_add_epi16( _mm_add_epi16( t0, t2 ), t4 ),
+			_mm_add_epi16( _mm_srli_epi16( tmp, 1 ), tmp ) );
+		diff = _mm_max_epi16( diff, _mm_sub_epi16( zero, diff ) );
+		diff = _mm_and_si128( diff, _mm_and_si128( mask, _mm_cmpgt_epi16( diff, nt ) ) );
+		total = _mm_add_epi32( total, _mm_madd_epi16( diff, _mm_set1_epi16( 1 ) ) );
+
+		// Vertical combing
+		__m128i hi = _mm_add_epi16( b0, t );
+		__m128i lo = _mm_sub_epi16( b0, t );
+		__m128i vc = _mm_or_si128(
+			_mm_and_si128( _mm_cmplt_epi16( hi, t0 ), _mm_cmplt_epi16( hi, t2 ) ),
+			_mm_and_si128( _mm_cmpgt_epi16( lo, t0 ), _mm_cmpgt_epi16( lo, t2 ) ) );
+		combed = _mm_sub_epi16( combed, _mm_and_si128( vc, mask ) );
+	}
+	total = _mm_add_epi32( total, _mm_srli_si128( total, 8 ) );
+	total = _mm_add_epi32( total, _mm_srli_si128( total, 4 ) );
+	*sum += _mm_cvtsi128_si32( total );
+	combed = _mm_madd_epi16( combed, _mm_set1_epi16( 1 ) );
+	combed = _mm_add_epi32( combed, _mm_srli_si128( combed, 8 ) );
+	combed = _mm_add_epi32( combed, _mm_srli_si128( combed, 4 ) );
+	*count += _mm_cvtsi128_si32( combed );
+}
+#endif
+
+/** Calculate the metrics of a slice of bands of blocks.
+ *
+ * Every row of blocks belongs to one slice, so the block sums are not
+ * shared and the field match sums are added up after all slices finish.
+ */
+
+static int metrics_slice( int id, int idx, int jobs, void *cookie )
+{
+	struct metrics_desc *desc = cookie;
+	context cx = desc->cx;
+	int x, y, band, p = 0, c = 0, tmp1, tmp2;
+	int vc, skip = 1 + ( !cx->chroma );
+	unsigned char *currbot0, *currbot2, *prevbot0, *prevbot2;
 	unsigned char *prevtop0, *prevtop2, *prevtop4, *currtop0, *currtop2, *currtop4;
 	unsigned char *a0, *a2, *b0, *b2, *b4;
 	unsigned int diff, index;
-#	define T 4
+#ifdef USE_SSE2
+	const __m128i mask = skip == 1 ? _mm_set_epi16( 0, 0, 0, 0, -1, -1, -1, -1 ) : _mm_set_epi16( 0, 0, 0, 0, 0, -1, 0, -1 );
+	// The metric is at most 765, and a negative threshold compares unsigned
+	const __m128i nt = _mm_set1_epi16( cx->nt < 0 || cx->nt > 765 ? 765 : cx->nt );
+	const int vector_w = cx->w & ~15;
+#endif
 
-	/* Clear the block sums. */
- 	for (y = 0; y < cx->yblocks; y++)
+	for ( band = idx; band < desc->bands; band += jobs )
 	{
- 		for (x = 0; x < cx->xblocks; x++)
+		/* Clear the block sums. */
+		for ( x = 0; x < cx->xblocks; x++ )
 		{
-#ifdef WINDOWED_MATCH
-			matchp[y*xblocks+x] = 0;
-			matchc[y*xblocks+x] = 0;
-#endif
-			cx->sump[y * cx->xblocks + x] = 0;
-			cx->sumc[y * cx->xblocks + x] = 0;
+			cx->sump[band * cx->xblocks + x] = 0;
+			cx->sumc[band * cx->xblocks + x] = 0;
 		}
-	}
 
-	/* Find the best field match. Subsample the frames for speed. */
-	currbot0  = fcrp + cx->pitch;
-	currbot2  = fcrp + 3 * cx->pitch;
-	currtop0 = fcrp;
-	currtop2 = fcrp + 2 * cx->pitch;
-	currtop4 = fcrp + 4 * cx->pitch;
-	prevbot0  = fprp + cx->pitch;
-	prevbot2  = fprp + 3 * cx->pitch;
-	prevtop0 = fprp;
-	prevtop2 = fprp + 2 * cx->pitch;
-	prevtop4 = fprp + 4 * cx->pitch;
-	if ( cx->tff )
-	{
-		a0 = prevbot0;
-		a2 = prevbot2;
-		b0 = currtop0;
-		b2 = currtop2;
-		b4 = currtop4;
-	}
-	else
-	{
-		a0 = currbot0;
-		a2 = currbot2;
-		b0 = prevtop0;
-		b2 = prevtop2;
-		b4 = prevtop4;
-	}
-	p = c = 0;
+		/* Find the best field match. Subsample the frames for speed. */
+		y = band * BLKSIZE;
+		currtop0 = desc->fcrp + y * cx->pitch;
+		currbot0  = currtop0 + cx->pitch;
+		currtop2 = currtop0 + 2 * cx->pitch;
+		currbot2  = currtop0 + 3 * cx->pitch;
+		currtop4 = currtop0 + 4 * cx->pitch;
+		prevtop0 = desc->fprp + y * cx->pitch;
+		prevbot0  = prevtop0 + cx->pitch;
+		prevtop2 = prevtop0 + 2 * cx->pitch;
+		prevbot2  = prevtop0 + 3 * cx->pitch;
+		prevtop4 = prevtop0 + 4 * cx->pitch;
+		if ( cx->tff )
+		{
+			a0 = prevbot0;
+			a2 = prevbot2;
+			b0 = currtop0;
+			b2 = currtop2;
+			b4 = currtop4;
+		}
+		else
+		{
+			a0 = currbot0;
+			a2 = currbot2;
+			b0 = prevtop0;
+			b2 = prevtop2;
+			b4 = prevtop4;
+		}
 
-	// Calculate the field match and film/video metrics.
-	skip = 1 + ( !cx->chroma );
-	for (y = 0, index = 0; y < cx->h - 4; y+=4)
-	{
-		/* Exclusion band. Good for ignoring subtitles. */
-		if (cx->y0 == cx->y1 || y < cx->y0 || y > cx->y1)
+		// Calculate the field match and film/video metrics.
+		for ( ; y < cx->h - 4 && y < ( band + 1 ) * BLKSIZE; y += 4 )
 		{
-			for (x = 0; x < cx->w;)
+			/* Exclusion band. Good for ignoring subtitles. */
+			if (cx->y0 == cx->y1 || y < cx->y0 || y > cx->y1)
 			{
-				index = (y/BLKSIZE) * cx->xblocks + x/BLKSIZE_TIMES2;
-
-				// Test combination with current frame.
-				tmp1 = ((long)currbot0[x] + (long)currbot2[x]);
-				diff = labs((((long)currtop0[x] + (long)currtop2[x] + (long)currtop4[x])) - (tmp1 >> 1) - tmp1);
-				if (diff > cx->nt)
+				x = 0;
+#ifdef USE_SSE2
+				// A block is 48 bytes wide, so 16 bytes never straddle blocks
+				for ( ; x < vector_w; x += 16 )
 				{
-					c += diff;
-#ifdef WINDOWED_MATCH
-					matchc[index] += diff;
-#endif
+					index = (y/BLKSIZE) * cx->xblocks + x/BLKSIZE_TIMES2;
+					metrics_sse2( currtop0 + x, currtop2 + x, currtop4 + x, currbot0 + x, currbot2 + x, mask, nt, &c, &cx->sumc[index] );
+					metrics_sse2( b0 + x, b2 + x, b4 + x, a0 + x, a2 + x, mask, nt, &p, &cx->sump[index] );
 				}
-
-				tmp1 = currbot0[x] + T;
-				tmp2 = currbot0[x] - T;
-				vc = (tmp1 < currtop0[x] && tmp1 < currtop2[x]) ||
-					 (tmp2 > currtop0[x] && tmp2 > currtop2[x]);
-				if (vc)
+#endif
+				while ( x < cx->w )
 				{
-					cx->sumc[index]++;
-				}
+					index = (y/BLKSIZE) * cx->xblocks + x/BLKSIZE_TIMES2;
 
-				// Test combination with previous frame.
-				tmp1 = ((long)a0[x] + (long)a2[x]);
-				diff = labs((((long)b0[x] + (long)b2[x] + (long)b4[x])) - (tmp1 >> 1) - tmp1);
-				if (diff > cx->nt)
-				{
-					p += diff;
-#ifdef WINDOWED_MATCH
-					matchp[index] += diff;
-#endif
-				}
+					// Test combination with current frame.
+					tmp1 = ((long)currbot0[x] + (long)currbot2[x]);
+					diff = labs((((long)currtop0[x] + (long)currtop2[x] + (long)currtop4[x])) - (tmp1 >> 1) - tmp1);
+					if (diff > cx->nt)
+					{
+						c += diff;
+					}
 
-				tmp1 = a0[x] + T;
-				tmp2 = a0[x] - T;
-				vc = (tmp1 < b0[x] && tmp1 < b2[x]) ||
-					 (tmp2 > b0[x] && tmp2 > b2[x]);
-				if (vc)
-				{
-					cx->sump[index]++;
-				}
+					tmp1 = currbot0[x] + T;
+					tmp2 = currbot0[x] - T;
+					vc = (tmp1 < currtop0[x] && tmp1 < currtop2[x]) ||
+						 (tmp2 > currtop0[x] && tmp2 > currtop2[x]);
+					if (vc)
+					{
+						cx->sumc[index]++;
+					}
 
-				x += skip;
-				if (!(x&3)) x += 4;
+					// Test combination with previous frame.
+					tmp1 = ((long)a0[x] + (long)a2[x]);
+					diff = labs((((long)b0[x] + (long)b2[x] + (long)b4[x])) - (tmp1 >> 1) - tmp1);
+					if (diff > cx->nt)
+					{
+						p += diff;
+					}
+
+					tmp1 = a0[x] + T;
+					tmp2 = a0[x] - T;
+					vc = (tmp1 < b0[x] && tmp1 < b2[x]) ||
+						 (tmp2 > b0[x] && tmp2 > b2[x]);
+					if (vc)
+					{
+						cx->sump[index]++;
+					}
+
+					x += skip;
+					if (!(x&3)) x += 4;
+				}
 			}
+			currbot0 += cx->pitchtimes4;
+			currbot2 += cx->pitchtimes4;
+			currtop0 += cx->pitchtimes4;
+			currtop2 += cx->pitchtimes4;
+			currtop4 += cx->pitchtimes4;
+			a0		 += cx->pitchtimes4;
+			a2		 += cx->pitchtimes4;
+			b0		 += cx->pitchtimes4;
+			b2		 += cx->pitchtimes4;
+			b4		 += cx->pitchtimes4;
 		}
-		currbot0 += cx->pitchtimes4;
-		currbot2 += cx->pitchtimes4;
-		currtop0 += cx->pitchtimes4;
-		currtop2 += cx->pitchtimes4;
-		currtop4 += cx->pitchtimes4;
-		a0		 += cx->pitchtimes4;
-		a2		 += cx->pitchtimes4;
-		b0		 += cx->pitchtimes4;
-		b2		 += cx->pitchtimes4;
-		b4		 += cx->pitchtimes4;
 	}
+	desc->p[idx] = p;
+	desc->c[idx] = c;
+	return 0;
+}
 
+static
+void CalculateMetrics(context cx, int frame, unsigned char *fcrp, unsigned char *fcrpU, unsigned char *fcrpV,
+					unsigned char *fprp, unsigned char *fprpU, unsigned char *fprpV)
+{
+	struct metrics_desc desc;
+	int x, y, i, p, c, jobs;
+
+	desc.cx = cx;
+	desc.fcrp = fcrp;
+	desc.fprp = fprp;
+	desc.bands = cx->yblocks;
+	jobs = CLAMP( cx->threads, 0, mlt_slices_count_normal() );
+	if ( jobs == 0 )
+		jobs = mlt_slices_count_normal();
+	jobs = CLAMP( jobs, 1, desc.bands );
+	desc.p = calloc( 2 * jobs, sizeof( int ) );
+	desc.c = desc.p + jobs;
+	if ( jobs == 1 )
+		metrics_slice( 0, 0, 1, &desc );
+	else
+		mlt_slices_run_normal( jobs, metrics_slice, &desc );
+	p = c = 0;
+	for ( i = 0; i < jobs; i++ )
+	{
+		p += desc.p[i];
+		c += desc.c[i];
+	}
+	free( desc.p );
 
 	if ( cx->post )
 	{
@@ -537,11 +653,90 @@ void CalculateMetrics(context cx, int frame, unsigned char *fcrp, unsigned char
 			}
 		}
 	}
-#ifdef WINDOWED_MATCH
-	CacheInsert(frame, highest_matchp, highest_sump, highest_matchc, highest_sumc);
-#else
 	CacheInsert( cx, frame, p, cx->highest_sump, c, cx->highest_sumc);
-#endif
+}
+
+/** The state shared by the slices of postprocess().
+*/
+
+struct postprocess_desc
+{
+	context cx;
+	unsigned char *image;
+	unsigned char *final;
+	int rows;
+};
+
+/** Deinterlace the combed pixels of a slice of rows.
+ *
+ * With a final image the rows are blended into it, otherwise the odd rows
+ * are interpolated in place from the even rows, which are left unchanged.
+ */
+
+static int postprocess_slice( int id, int idx, int jobs, void *cookie )
+{
+	struct postprocess_desc *desc = cookie;
+	context cx = desc->cx;
+	int step = desc->final ? 1 : 2;
+	int start = desc->rows * idx / jobs;
+	int end = desc->rows * ( idx + 1 ) / jobs;
+	int x, y, v1, v2;
+
+	for ( y = start; y < end; y++ )
+	{
+		unsigned char *dstp = desc->image + ( 1 + y * step ) * cx->dpitch;
+		unsigned char *dstpp = dstp - cx->dpitch;
+		unsigned char *dstpn = dstp + cx->dpitch;
+		unsigned char *finalp = desc->final ? desc->final + ( 1 + y ) * cx->dpitch : dstp;
+
+		for ( x = 0; x < cx->w; x++ )
+		{
+			v1 = (int) dstp[x] - cx->dthresh;
+			if ( v1 < 0 )
+				v1 = 0;
+			v2 = (int) dstp[x] + cx->dthresh;
+			if (v2 > 235) v2 = 235;
+			if ((v1 > dstpp[x] && v1 > dstpn[x]) || (v2 < dstpp[x] && v2 < dstpn[x]))
+			{
+				if ( cx->post == POST_FULL_MAP || cx->post == POST_FULL_NOMATCH_MAP )
+				{
+					if (x & 1) finalp[x] = 128;
+					else finalp[x] = 235;
+				}
+				else if ( desc->final )
+					finalp[x] = ((int)dstpp[x] + (int)dstpn[x] + (int)dstp[x] + (int)dstp[x]) >> 2;
+				else
+					finalp[x] = (dstpp[x] + dstpn[x]) >> 1;
+			}
+			else if ( desc->final )
+				finalp[x] = dstp[x];
+		}
+	}
+	return 0;
+}
+
+/** Deinterlace the combed pixels of the inner rows in slices.
+*/
+
+static void postprocess( context cx, unsigned char *image, unsigned char *final )
+{
+	struct postprocess_desc desc;
+	int jobs;
+
+	desc.cx = cx;
+	desc.image = image;
+	desc.final = final;
+	desc.rows = final ? cx->h - 2 : ( cx->h - 1 ) / 2;
+	if ( desc.rows <= 0 )
+		return;
+	jobs = CLAMP( cx->threads, 0, mlt_slices_count_normal() );
+	if ( jobs == 0 )
+		jobs = mlt_slices_count_normal();
+	jobs = CLAMP( jobs, 1, desc.rows );
+	if ( jobs == 1 )
+		postprocess_slice( 0, 0, 1, &desc );
+	else
+		mlt_slices_run_normal( jobs, postprocess_slice, &desc );
 }
 
 /** Process the image.
@@ -575,6 +770,7 @@ static int get_image( mlt_frame frame, uint8_t **image, mlt_image_format *format
 		cx->debug = mlt_properties_get_int( properties, "debug" );
 		cx->show = mlt_properties_get_int( properties, "show" );
 	}
+	cx->threads = mlt_properties_get_int( properties, "threads" );
 
 	// Get the image
 	int error = mlt_frame_get_image( frame, image, format, width, height, 1 );
@@ -886,7 +1082,6 @@ static int get_image( mlt_frame frame, uint8_t **image, mlt_image_format *format
 				         && (cx->film == 0 && cx->force != '-')))
 			{
 				unsigned char *dstpp, *dstpn;
-				int v1, v2;
 		
 				if ( cx->blend )
 				{
@@ -907,38 +1102,8 @@ static int get_image( mlt_frame frame, uint8_t **image, mlt_image_format *format
 						cx->finalp[cx->x] = (((int)cx->dstp[cx->x] + (int)dstpp[cx->x]) >> 1);
 					}
 					// Now do the rest.
-					cx->dstp = *image + cx->dpitch;
-					dstpp = cx->dstp - cx->dpitch;
-					dstpn = cx->dstp + cx->dpitch;
-					cx->finalp = final + cx->dpitch;
-					for ( cx->y = 1; cx->y < cx->h - 1; cx->y++ )
-					{
-						for ( cx->x = 0; cx->x < cx->w; cx->x++ )
-						{
-							v1 = (int) cx->dstp[cx->x] - cx->dthresh;
-							if ( v1 < 0 )
-								v1 = 0; 
-							v2 = (int) cx->dstp[cx->x] + cx->dthresh;
-							if (v2 > 235) v2 = 235; 
-							if ((v1 > dstpp[cx->x] && v1 > dstpn[cx->x]) || (v2 < dstpp[cx->x] && v2 < dstpn[cx->x]))
-							{
-								if ( cx->post == POST_FULL_MAP || cx->post == POST_FULL_NOMATCH_MAP )
-								{
-									if (cx->x & 1) cx->finalp[cx->x] = 128;
-									else cx->finalp[cx->x] = 235;
-								}
-								else
-									cx->finalp[cx->x] = ((int)dstpp[cx->x] + (int)dstpn[cx->x] + (int)cx->dstp[cx->x] + (int)cx->dstp[cx->x]) >> 2;
-							}
-							else cx->finalp[cx->x] = cx->dstp[cx->x];
-						}
-						cx->finalp += cx->dpitch;
-						cx->dstp += cx->dpitch;
-						dstpp += cx->dpitch;
-						dstpn += cx->dpitch;
-					}
-		
-		
+					postprocess( cx, *image, final );
+
 					if (cx->show ) Show( cx, pos, frame_properties);
 					if (cx->debug) Debug(cx, pos);
 					if (cx->hints) WriteHints(cx->film, cx->inpattern, frame_properties);
@@ -946,32 +1111,7 @@ static int get_image( mlt_frame frame, uint8_t **image, mlt_image_format *format
 				}
 		
 				// Interpolate mode.
-				cx->dstp = *image + cx->dpitch;
-				dstpp = cx->dstp - cx->dpitch;
-				dstpn = cx->dstp + cx->dpitch;
-				for ( cx->y = 1; cx->y < cx->h - 1; cx->y+=2 )
-				{
-					for ( cx->x = 0; cx->x < cx->w; cx->x++ )
-					{
-						v1 = (int) cx->dstp[cx->x] - cx->dthresh;
-						if (v1 < 0) v1 = 0; 
-						v2 = (int) cx->dstp[cx->x] + cx->dthresh;
-						if (v2 > 235) v2 = 235; 
-						if ((v1 > dstpp[cx->x] && v1 > dstpn[cx->x]) || (v2 < dstpp[cx->x] && v2 < dstpn[cx->x]))
-						{
-							if ( cx->post == POST_FULL_MAP || cx->post == POST_FULL_NOMATCH_MAP )
-							{
-								if (cx->x & 1) cx->dstp[cx->x] = 128;
-								else cx->dstp[cx->x] = 235;
-							}
-							else
-								cx->dstp[cx->x] = (dstpp[cx->x] + dstpn[cx->x]) >> 1;
-						}
-					}
-					cx->dstp += 2 * cx->dpitch;
-					dstpp += 2 * cx->dpitch;
-					dstpn += 2 * cx->dpitch;
-				}
+				postprocess( cx, *image, NULL );
 			}
 			if (cx->show ) Show( cx, pos, frame_properties);
 			if (cx->debug) Debug(cx, pos);
@@ -1024,6 +1164,8 @@ mlt_filter filter_telecide_init( mlt_profile profile, mlt_service_type type, con
 		context cx = (context) mlt_pool_alloc( sizeof(struct context_s) );
 		memset( cx, 0, sizeof( struct context_s ) );
 		mlt_properties properties = MLT_FILTER_PROPERTIES( filter );
+		// The field matching cache depends on seeing frames in order
+		mlt_properties_set( properties, "_threading", "ordered" );
 		mlt_properties_set_data( properties, "context", cx, sizeof(struct context_s), (mlt_destructor)mlt_pool_release, NULL );
 
 		// Allocate the metrics cache and set up for garbage collection
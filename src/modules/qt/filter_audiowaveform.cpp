@@ -165,6 +165,79 @@ static void draw_waveforms( mlt_filter filter, mlt_frame frame, QImage* qimg, in
 	p.end();
 }
 
+/** Get the peaks of a frame from the sidecar named by the peaks property.
+ *
+ * The sidecar is mapped on first use and may be replaced by another thread
+ * when the property changes, so the peaks are copied while holding the
+ * service lock. With no columns, this only maps the sidecar.
+ * \return the number of channels or 0 if there is no sidecar with peaks
+ */
+
+static int get_peaks( mlt_filter filter, mlt_frame frame, int columns, QVector<int16_t>& peaks )
+{
+	mlt_properties properties = MLT_FILTER_PROPERTIES( filter );
+	const char* filename = mlt_properties_get( properties, "peaks" );
+	double window = mlt_properties_get_double( properties, "window" );
+	mlt_analysis analysis = NULL;
+	int channels = 0;
+
+	if ( !filename || !strcmp( filename, "" ) )
+		return 0;
+	if ( window <= 0.0 )
+		window = 1.0;
+
+	mlt_service_lock( MLT_FILTER_SERVICE( filter ) );
+	analysis = (mlt_analysis)mlt_properties_get_data( properties, "_peaks", NULL );
+	if ( !mlt_properties_get( properties, "_peaks_file" )
+		 || strcmp( filename, mlt_properties_get( properties, "_peaks_file" ) ) )
+	{
+		analysis = mlt_analysis_load( filename );
+		if ( !analysis )
+			mlt_log_warning( MLT_FILTER_SERVICE( filter ), "failed to load peaks %s\n", filename );
+		mlt_properties_set_data( properties, "_peaks", analysis, 0, (mlt_destructor)mlt_analysis_close, NULL );
+		mlt_properties_set( properties, "_peaks_file", filename );
+	}
+	if ( analysis )
+		channels = mlt_analysis_get_peaks( analysis, 0, 0, 0, 0, NULL );
+	if ( channels > 0 && columns > 0 )
+	{
+		peaks.resize( columns * channels * 3 );
+		mlt_analysis_get_peaks( analysis, mlt_frame_original_position( frame ), window, columns, channels, peaks.data() );
+	}
+	mlt_service_unlock( MLT_FILTER_SERVICE( filter ) );
+
+	return channels;
+}
+
+/** Draw the waveforms from the peaks of a sidecar without getting the audio.
+ *
+ * The minimum and maximum of each column are passed as a pair of samples
+ * so that paint_waveform() draws a line between them.
+ */
+
+static int draw_peaks( mlt_filter filter, mlt_frame frame, QImage* qimg )
+{
+	int columns = qimg->width();
+	QVector<int16_t> peaks;
+	int channels = get_peaks( filter, frame, columns, peaks );
+
+	if ( channels <= 0 || columns <= 0 )
+		return 1;
+
+	// paint_waveform() reads one sample past the end.
+	QVector<int16_t> audio( ( columns * 2 + 1 ) * channels );
+	for ( int x = 0; x < columns; x++ )
+	{
+		for ( int c = 0; c < channels; c++ )
+		{
+			audio[ ( x * 2 ) * channels + c ] = peaks[ ( x * channels + c ) * 3 ];
+			audio[ ( x * 2 + 1 ) * channels + c ] = peaks[ ( x * channels + c ) * 3 + 1 ];
+		}
+	}
+	draw_waveforms( filter, frame, qimg, audio.data(), channels, columns * 2 );
+	return 0;
+}
+
 static int filter_get_image( mlt_frame frame, uint8_t **image, mlt_image_format *image_format, int *width, int *height, int writable )
 {
 	int error = 0;
@@ -175,6 +248,19 @@ static int filter_get_image( mlt_frame frame, uint8_t **image, mlt_image_format
 	int frequency = 0;
 	mlt_audio_format audio_format = mlt_audio_s16;
 	int16_t* audio = (int16_t*)mlt_properties_get_data( frame_properties, "audio", NULL );
+	QVector<int16_t> no_peaks;
+
+	if ( get_peaks( filter, frame, 0, no_peaks ) > 0 ) {
+		*image_format = mlt_image_rgb24a;
+		error = mlt_frame_get_image( frame, image, image_format, width, height, writable );
+		if ( !error ) {
+			QImage qimg( *width, *height, QImage::Format_ARGB32 );
+			convert_mlt_to_qimage_rgba( *image, &qimg, *width, *height );
+			error = draw_peaks( filter, frame, &qimg );
+			convert_qimage_to_mlt_rgba( &qimg, *image, *width, *height );
+		}
+		return error;
+	}
 
 	if ( !audio && !preprocess_warned ) {
 		// This filter depends on the consumer processing the audio before the
@@ -273,6 +359,7 @@ mlt_filter filter_audiowaveform_init( mlt_profile profile, mlt_service_type type
 	mlt_properties_set( filter_properties, "rect", "0 0 100% 100%" );
 	mlt_properties_set( filter_properties, "fill", "0" );
 	mlt_properties_set( filter_properties, "gorient", "v" );
+	mlt_properties_set( filter_properties, "window", "1" );
 
 	return filter;
 }
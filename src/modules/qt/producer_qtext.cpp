@@ -41,7 +41,72 @@ static void close_qpath( void* qpath )
 	delete static_cast<QPainterPath*>( qpath );
 }
 
-static void copy_qimage_to_mlt_image( QImage* qImg, uint8_t* mImg )
+/** Rendered images are shared by all qtext producers, so text that recurs, such as a
+ * repeated subtitle or the same caption on several tracks, is only painted once per
+ * output size. Entries are found by a hash of the path signature and size and keep
+ * the full key to rule out collisions. The cache holds at most RENDERED_CACHE_SIZE
+ * images and RENDERED_CACHE_BYTES of pixels. QImage is implicitly shared, so a hit
+ * costs a reference rather than a copy.
+ */
+
+#define RENDERED_CACHE_SIZE (50)
+#define RENDERED_CACHE_BYTES (64 * 1024 * 1024)
+
+struct qtext_rendered
+{
+	QByteArray key;
+	QImage image;
+};
+
+static void close_rendered( void* rendered )
+{
+	delete static_cast<qtext_rendered*>( rendered );
+}
+
+static mlt_cache create_rendered_cache()
+{
+	mlt_cache cache = mlt_cache_init();
+	mlt_cache_set_size( cache, RENDERED_CACHE_SIZE );
+	mlt_cache_set_max_bytes( cache, RENDERED_CACHE_BYTES );
+	return cache;
+}
+
+static mlt_cache rendered_cache()
+{
+	static mlt_cache cache = create_rendered_cache();
+	return cache;
+}
+
+static void* rendered_hash( const QByteArray& key )
+{
+	// FNV-1a
+	uint64_t hash = 14695981039346656037ULL;
+	for( int i = 0; i < key.size(); i++ )
+		hash = ( hash ^ (unsigned char) key.at( i ) ) * 1099511628211ULL;
+	return reinterpret_cast<void*>( (uintptr_t) ( hash | 1 ) );
+}
+
+static bool get_rendered( const QByteArray& key, QImage* qImg )
+{
+	mlt_cache_item item = mlt_cache_get( rendered_cache(), rendered_hash( key ) );
+	qtext_rendered* rendered = static_cast<qtext_rendered*>( mlt_cache_item_data( item, NULL ) );
+	bool found = rendered && rendered->key == key;
+
+	if( found )
+		*qImg = rendered->image;
+	mlt_cache_item_close( item );
+	return found;
+}
+
+static void put_rendered( const QByteArray& key, const QImage& qImg )
+{
+	qtext_rendered* rendered = new qtext_rendered;
+	rendered->key = key;
+	rendered->image = qImg;
+	mlt_cache_put( rendered_cache(), rendered_hash( key ), rendered, qImg.bytesPerLine() * qImg.height(), close_rendered );
+}
+
+static void copy_qimage_to_mlt_image( const QImage* qImg, uint8_t* mImg )
 {
 	int height = qImg->height();
 	int width = qImg->width();
@@ -51,7 +116,7 @@ static void copy_qimage_to_mlt_image( QImage* qImg, uint8_t* mImg )
 	y = height + 1;
 	while ( --y )
 	{
-		QRgb* src = (QRgb*) qImg->scanLine( height - y );
+		const QRgb* src = (const QRgb*) qImg->constScanLine( height - y );
 		int x = width + 1;
 		while ( --x )
 		{
@@ -92,31 +157,25 @@ static void copy_image_to_alpha( uint8_t* image, uint8_t* alpha, int width, int
 
 static bool check_qpath( mlt_properties producer_properties )
 {
-	#define MAX_SIG 500
-	char new_path_sig[MAX_SIG];
-
-	// Generate a signature that represents the current properties
-	snprintf( new_path_sig, MAX_SIG, "%s%s%s%s%s%s%s%s%s%s%s",
-			mlt_properties_get( producer_properties, "text" ),
-			mlt_properties_get( producer_properties, "fgcolour" ),
-			mlt_properties_get( producer_properties, "bgcolour" ),
-			mlt_properties_get( producer_properties, "olcolour" ),
-			mlt_properties_get( producer_properties, "outline" ),
-			mlt_properties_get( producer_properties, "align" ),
-			mlt_properties_get( producer_properties, "pad" ),
-			mlt_properties_get( producer_properties, "size" ),
-			mlt_properties_get( producer_properties, "style" ),
-			mlt_properties_get( producer_properties, "weight" ),
-			mlt_properties_get( producer_properties, "encoding" ) );
-	new_path_sig[ MAX_SIG - 1 ] = '\0';
+	static const char* names[] = { "text", "fgcolour", "bgcolour", "olcolour", "outline", "align",
+		"pad", "family", "size", "style", "weight", "encoding" };
+	QByteArray new_path_sig;
+
+	// Generate a signature that represents the current properties. The whole text
+	// is included because the signature also keys the shared image cache.
+	for( size_t i = 0; i < sizeof( names ) / sizeof( names[0] ); i++ )
+	{
+		const char* value = mlt_properties_get( producer_properties, names[i] );
+		new_path_sig.append( value ? value : "" ).append( '\x1f' );
+	}
 
 	// Check if the properties have changed by comparing this signature with the
 	// last one.
 	char* last_path_sig = mlt_properties_get( producer_properties, "_path_sig" );
 
-	if( !last_path_sig || strcmp( new_path_sig, last_path_sig ) )
+	if( !last_path_sig || strcmp( new_path_sig.constData(), last_path_sig ) )
 	{
-		mlt_properties_set( producer_properties, "_path_sig", new_path_sig );
+		mlt_properties_set( producer_properties, "_path_sig", new_path_sig.constData() );
 		return true;
 	}
 	return false;
@@ -255,6 +314,15 @@ static void generate_qimage( mlt_properties frame_properties )
 	qreal sx = 1.0;
 	qreal sy = 1.0;
 
+	// Reuse the image if any producer has painted this text at this size
+	QSize output_size = target_size.isEmpty() ? native_size : target_size;
+	QByteArray key( mlt_properties_get( frame_properties, "_path_sig" ) );
+	key.append( QByteArray::number( output_size.width() ) ).append( 'x' ).append( QByteArray::number( output_size.height() ) );
+	if( get_rendered( key, qImg ) )
+	{
+		return;
+	}
+
 	// Create a new image and set up scaling
 	if( !target_size.isEmpty() && target_size != native_size )
 	{
@@ -288,6 +356,9 @@ static void generate_qimage( mlt_properties frame_properties )
 	QBrush brush( QColor( fg_color.r, fg_color.g, fg_color.b, fg_color.a ) );
 	painter.setBrush( brush );
 	painter.drawPath( *qPath );
+	painter.end();
+
+	put_rendered( key, *qImg );
 }
 
 static int producer_get_image( mlt_frame frame, uint8_t** buffer, mlt_image_format* format, int* width, int* height, int writable )
@@ -0,0 +1,2 @@
+USE_INTERNAL_RTAUDIO=1
+CXXFLAGS += -DUSE_INTERNAL_RTAUDIO
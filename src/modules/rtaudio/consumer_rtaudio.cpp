@@ -536,7 +536,7 @@ public:
 		double speed = 0;
 
 		// Get real time flag
-		int real_time = mlt_properties_get_int( properties, "real_time" );
+		int real_time = mlt_consumer_real_time( getConsumer() );
 
 		// Get the current time
 		gettimeofday( &now, NULL );
@@ -702,7 +702,7 @@ static void *video_thread( void *arg )
 	double speed = 0;
 
 	// Get real time flag
-	int real_time = mlt_properties_get_int( self->properties, "real_time" );
+	int real_time = mlt_consumer_real_time( &self->parent );
 
 	// Get the current time
 	gettimeofday( &now, NULL );
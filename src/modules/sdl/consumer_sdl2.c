@@ -660,7 +660,7 @@ static void *video_thread( void *arg )
 	double speed = 0;
 
 	// Get real time flag
-	int real_time = mlt_properties_get_int( self->properties, "real_time" );
+	int real_time = mlt_consumer_real_time( &self->parent );
 
 #if !defined(__APPLE__) && !defined(_WIN32)
 	if ( setup_sdl_video(self) )
@@ -26,8 +26,11 @@
 
 #include <framework/mlt_frame.h>
 
+#include <framework/mlt_slices.h>
+
 #include <string.h>
 #include <stdlib.h>
+#include <math.h>
 
 #define YADIF_MODE_TEMPORAL_SPATIAL (0)
 #define YADIF_MODE_TEMPORAL (2)
@@ -42,6 +45,11 @@ static yadif_filter *init_yadif( int width, int height )
 #endif
 #ifdef USE_SSE2
 	yadif->cpu |= AVS_CPU_SSE2;
+#endif
+#ifdef YADIF_AVX2
+	__builtin_cpu_init();
+	if ( __builtin_cpu_supports( "avx2" ) )
+		yadif->cpu |= AVS_CPU_AVX2;
 #endif
 	// Create intermediate planar planes
 	yadif->yheight = height;
@@ -98,6 +106,112 @@ static void close_yadif(yadif_filter *yadif)
 #endif
 }
 
+struct yadif_slice_desc
+{
+	yadif_filter *yadif;
+	int mode;
+	int parity;
+	int order;
+	int width;
+	int height;
+	uint8_t *image;
+	uint8_t *previous_image;
+	uint8_t *next_image;
+};
+
+static void yadif_slice_rows( int idx, int jobs, int height, int *start, int *end )
+{
+	*start = height * idx / jobs;
+	*end = height * ( idx + 1 ) / jobs;
+}
+
+static int yadif_to_planes_slice( int id, int idx, int jobs, void *cookie )
+{
+	struct yadif_slice_desc *desc = ( struct yadif_slice_desc* ) cookie;
+	yadif_filter *yadif = desc->yadif;
+	const int pitch = desc->width << 1;
+	int start, end;
+
+	yadif_slice_rows( idx, jobs, desc->height, &start, &end );
+	YUY2ToPlanes( desc->image + start * pitch, pitch, desc->width, end - start,
+		yadif->ysrc + start * yadif->ypitch, yadif->ypitch,
+		yadif->usrc + start * yadif->uvpitch, yadif->vsrc + start * yadif->uvpitch, yadif->uvpitch, yadif->cpu );
+	YUY2ToPlanes( desc->previous_image + start * pitch, pitch, desc->width, end - start,
+		yadif->yprev + start * yadif->ypitch, yadif->ypitch,
+		yadif->uprev + start * yadif->uvpitch, yadif->vprev + start * yadif->uvpitch, yadif->uvpitch, yadif->cpu );
+	YUY2ToPlanes( desc->next_image + start * pitch, pitch, desc->width, end - start,
+		yadif->ynext + start * yadif->ypitch, yadif->ypitch,
+		yadif->unext + start * yadif->uvpitch, yadif->vnext + start * yadif->uvpitch, yadif->uvpitch, yadif->cpu );
+	return 0;
+}
+
+static int yadif_filter_slice( int id, int idx, int jobs, void *cookie )
+{
+	struct yadif_slice_desc *desc = ( struct yadif_slice_desc* ) cookie;
+	yadif_filter *yadif = desc->yadif;
+	const int pitch = desc->width << 1;
+	int start, end;
+
+	// Every plane was converted before this runs, so the lines around the band are ready.
+	yadif_slice_rows( idx, jobs, desc->height, &start, &end );
+	filter_plane_slice( desc->mode, yadif->ydest, yadif->ypitch, yadif->yprev, yadif->ysrc,
+		yadif->ynext, yadif->ypitch, desc->width, desc->height, desc->parity, desc->order, yadif->cpu, start, end );
+	filter_plane_slice( desc->mode, yadif->udest, yadif->uvpitch, yadif->uprev, yadif->usrc,
+		yadif->unext, yadif->uvpitch, desc->width >> 1, desc->height, desc->parity, desc->order, yadif->cpu, start, end );
+	filter_plane_slice( desc->mode, yadif->vdest, yadif->uvpitch, yadif->vprev, yadif->vsrc,
+		yadif->vnext, yadif->uvpitch, desc->width >> 1, desc->height, desc->parity, desc->order, yadif->cpu, start, end );
+
+	// Convert planar to packed
+	YUY2FromPlanes( desc->image + start * pitch, pitch, desc->width, end - start,
+		yadif->ydest + start * yadif->ypitch, yadif->ypitch,
+		yadif->udest + start * yadif->uvpitch, yadif->vdest + start * yadif->uvpitch, yadif->uvpitch, yadif->cpu );
+	return 0;
+}
+
+/** Determine whether each frame of the producer is shown for one field only.
+ *
+ * This is the case when the profile has twice the frame rate of the source.
+ * Then the neighbouring source frames are two positions away.
+ * \param[out] source_fps the frame rate of the source, if known
+ * \return the distance to the previous and next source frames
+ */
+
+static int yadif_distance( mlt_filter filter, double *source_fps )
+{
+	mlt_service service = mlt_properties_get_data( MLT_FILTER_PROPERTIES(filter), "service", NULL );
+	mlt_profile profile = mlt_service_profile( MLT_FILTER_SERVICE(filter) );
+
+	*source_fps = 0.0;
+	if ( service && profile && mlt_properties_get_int( MLT_SERVICE_PROPERTIES(service), "meta.media.frame_rate_den" ) )
+		*source_fps = mlt_properties_get_double( MLT_SERVICE_PROPERTIES(service), "meta.media.frame_rate_num" ) /
+			mlt_properties_get_double( MLT_SERVICE_PROPERTIES(service), "meta.media.frame_rate_den" );
+	if ( *source_fps > 0.0 && fabs( mlt_profile_fps( profile ) / *source_fps - 2.0 ) < 0.01 )
+		return 2;
+	return 1;
+}
+
+/** Determine which field of its source frame a frame shows.
+ *
+ * \param[out] field at field rate, which of the two fields of the source frame to show
+ * \return the distance to the previous and next source frames
+ */
+
+static int yadif_field( mlt_filter filter, mlt_frame frame, int *field )
+{
+	double source_fps = 0.0;
+	int distance = yadif_distance( filter, &source_fps );
+
+	*field = 0;
+	if ( distance == 2 )
+	{
+		// The same rounding as producers use to map a position to a source frame
+		double fps = mlt_profile_fps( mlt_service_profile( MLT_FILTER_SERVICE(filter) ) );
+		double source_position = mlt_frame_original_position( frame ) * source_fps / fps + 0.5;
+		*field = source_position - floor( source_position ) > 0.25;
+	}
+	return distance;
+}
+
 static int deinterlace_yadif( mlt_frame frame, mlt_filter filter, uint8_t **image, mlt_image_format *format, int *width, int *height, int mode )
 {
 	mlt_properties properties = MLT_FRAME_PROPERTIES( frame );
@@ -118,6 +232,18 @@ static int deinterlace_yadif( mlt_frame frame, mlt_filter filter, uint8_t **imag
 	if ( !previous_frame || !next_frame )
 		return 1;
 
+	// Make sure the neighbours are the preceding and following source frames
+	int field = 0;
+	int distance = yadif_field( filter, frame, &field );
+	mlt_position position = mlt_frame_original_position( frame );
+	mlt_position measured = MAX( position - mlt_frame_original_position( previous_frame ),
+		mlt_frame_original_position( next_frame ) - position );
+	if ( measured > 0 && measured != distance )
+	{
+		// deinterlace_process() requests the right ones for the following frames
+		return 1;
+	}
+
 	mlt_service_lock( MLT_FILTER_SERVICE(filter) );
 
 	// Get the preceding frame's image
@@ -146,29 +272,34 @@ static int deinterlace_yadif( mlt_frame frame, mlt_filter filter, uint8_t **imag
 				yadif_filter *yadif = init_yadif( *width, *height );
 				if ( yadif )
 				{
-					const int order = mlt_properties_get_int( properties, "top_field_first" );
-					const int pitch = *width << 1;
-					const int parity = 0;
-
-					// Convert packed to planar
-					YUY2ToPlanes( *image, pitch, *width, *height, yadif->ysrc,
-						yadif->ypitch, yadif->usrc, yadif->vsrc, yadif->uvpitch, yadif->cpu );
-					YUY2ToPlanes( previous_image, pitch, *width, *height, yadif->yprev,
-						yadif->ypitch, yadif->uprev, yadif->vprev, yadif->uvpitch, yadif->cpu );
-					YUY2ToPlanes( next_image, pitch, *width, *height, yadif->ynext,
-						yadif->ypitch, yadif->unext, yadif->vnext, yadif->uvpitch, yadif->cpu );
-
-					// Deinterlace each plane
-					filter_plane( mode, yadif->ydest, yadif->ypitch, yadif->yprev, yadif->ysrc,
-						yadif->ynext, yadif->ypitch, *width, *height, parity, order, yadif->cpu);
-					filter_plane( mode, yadif->udest, yadif->uvpitch,yadif->uprev, yadif->usrc,
-						yadif->unext, yadif->uvpitch, *width >> 1, *height, parity, order, yadif->cpu);
-					filter_plane( mode, yadif->vdest, yadif->uvpitch, yadif->vprev, yadif->vsrc,
-						yadif->vnext, yadif->uvpitch, *width >> 1, *height, parity, order, yadif->cpu);
-
-					// Convert planar to packed
-					YUY2FromPlanes( *image, pitch, *width, *height, yadif->ydest,
-						yadif->ypitch, yadif->udest, yadif->vdest, yadif->uvpitch, yadif->cpu);
+					struct yadif_slice_desc desc;
+					int jobs = CLAMP( mlt_properties_get_int( MLT_FILTER_PROPERTIES(filter), "threads" ), 0, mlt_slices_count_normal() );
+
+					desc.yadif = yadif;
+					desc.mode = mode;
+					desc.order = mlt_properties_get_int( properties, "top_field_first" );
+					// At field rate show the earlier field first, otherwise always the top field
+					desc.parity = distance == 2 ? desc.order ^ !field : 0;
+					desc.width = *width;
+					desc.height = *height;
+					desc.image = *image;
+					desc.previous_image = previous_image;
+					desc.next_image = next_image;
+
+					if ( jobs == 0 )
+						jobs = mlt_slices_count_normal();
+					jobs = CLAMP( jobs, 1, *height / 8 );
+					if ( jobs == 1 )
+					{
+						yadif_to_planes_slice( 0, 0, 1, &desc );
+						yadif_filter_slice( 0, 0, 1, &desc );
+					}
+					else
+					{
+						// Convert packed to planar, then deinterlace and convert back in bands
+						mlt_slices_run_normal( jobs, yadif_to_planes_slice, &desc );
+						mlt_slices_run_normal( jobs, yadif_filter_slice, &desc );
+					}
 
 					close_yadif( yadif );
 				}
@@ -245,8 +376,6 @@ static int filter_get_image( mlt_frame frame, uint8_t **image, mlt_image_format
 		}
 		if ( error || ( method > DEINTERLACE_NONE && method < DEINTERLACE_YADIF ) )
 		{
-			mlt_service service = mlt_properties_get_data( MLT_FILTER_PROPERTIES(filter), "service", NULL );
-
 			// Get the current frame's image
 			int error2 = mlt_frame_get_image( frame, image, format, width, height, writable );
 			progressive = mlt_properties_get_int( properties, "progressive" );
@@ -257,12 +386,12 @@ static int filter_get_image( mlt_frame frame, uint8_t **image, mlt_image_format
 				// If YADIF requested, prev/next cancelled because some previous frames were progressive,
 				// but new frames are interlaced, then turn prev/next frames back on.
 				if ( !progressive )
-					mlt_properties_set_int( MLT_SERVICE_PROPERTIES(service), "_need_previous_next", 1 );
+					mlt_properties_set_int( MLT_FILTER_PROPERTIES(filter), "_need_previous_next", 1 );
 			}
 			else
 			{
 				// Signal that we no longer need previous and next frames
-				mlt_properties_set_int( MLT_SERVICE_PROPERTIES(service), "_need_previous_next", 0 );
+				mlt_properties_set_int( MLT_FILTER_PROPERTIES(filter), "_need_previous_next", 0 );
 			}
 			error = error2;
 			
@@ -310,19 +439,36 @@ static int filter_get_image( mlt_frame frame, uint8_t **image, mlt_image_format
 	if ( !deinterlace || progressive )
 	{
 		// Signal that we no longer need previous and next frames
-		mlt_service service = mlt_properties_get_data( MLT_FILTER_PROPERTIES(filter), "service", NULL );
-		if ( service )
-			mlt_properties_set_int( MLT_SERVICE_PROPERTIES(service), "_need_previous_next", 0 );
+		mlt_properties_set_int( MLT_FILTER_PROPERTIES(filter), "_need_previous_next", 0 );
 	}
 
 	return error;
 }
 
 /** Deinterlace filter processing - this should be lazy evaluation here...
+ *
+ * The images only tell whether previous and next frames are needed, so
+ * filter_get_image() leaves that on the filter. It is passed on to the service
+ * here, together with how far away the neighbours are, because this runs in
+ * mlt_service_get_frame() of the service with the service locked, before the
+ * neighbours of the frame are fetched.
 */
 
 static mlt_frame deinterlace_process( mlt_filter filter, mlt_frame frame )
 {
+	mlt_properties properties = MLT_FILTER_PROPERTIES( filter );
+	mlt_service service = mlt_properties_get_data( properties, "service", NULL );
+
+	if ( service )
+	{
+		double source_fps = 0.0;
+		int distance = 0;
+		if ( mlt_properties_get_int( properties, "_need_previous_next" ) )
+			distance = yadif_distance( filter, &source_fps );
+		if ( distance != mlt_properties_get_int( MLT_SERVICE_PROPERTIES(service), "_need_previous_next" ) )
+			mlt_properties_set_int( MLT_SERVICE_PROPERTIES(service), "_need_previous_next", distance );
+	}
+
 	// Push filter on to the service stack
 	mlt_frame_push_service( frame, filter );
 
@@ -335,6 +481,7 @@ static mlt_frame deinterlace_process( mlt_filter filter, mlt_frame frame )
 static void on_service_changed( mlt_service owner, mlt_service filter )
 {
 	mlt_service service = mlt_properties_get_data( MLT_SERVICE_PROPERTIES(filter), "service", NULL );
+	mlt_properties_set_int( MLT_SERVICE_PROPERTIES(filter), "_need_previous_next", 1 );
 	mlt_properties_set_int( MLT_SERVICE_PROPERTIES(service), "_need_previous_next", 1 );
 }
 
@@ -348,6 +495,7 @@ mlt_filter filter_deinterlace_init( mlt_profile profile, mlt_service_type type,
 	{
 		filter->process = deinterlace_process;
 		mlt_properties_set( MLT_FILTER_PROPERTIES( filter ), "method", arg );
+		mlt_properties_set_int( MLT_FILTER_PROPERTIES( filter ), "_need_previous_next", 1 );
 		mlt_events_listen( MLT_FILTER_PROPERTIES( filter ), filter, "service-changed", (mlt_listener) on_service_changed );
 	}
 	return filter;
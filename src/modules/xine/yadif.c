@@ -33,8 +33,6 @@
 #define MIN3(a,b,c) MIN(MIN(a,b),c)
 #define MAX3(a,b,c) MAX(MAX(a,b),c)
 
-static void (*filter_line)(int mode, uint8_t *dst, const uint8_t *prev, const uint8_t *cur, const uint8_t *next, int w, int refs, int parity);
-
 #if defined(__GNUC__) && defined(USE_SSE)
 
 #define LOAD4(mem,dst) \
@@ -347,6 +345,81 @@ static void filter_line_c(int mode, uint8_t *dst, const uint8_t *prev, const uin
     }
 }
 
+#ifdef YADIF_AVX2
+#include <immintrin.h>
+
+#define LOAD16(p) _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(p)))
+#define ABS16(a) _mm256_abs_epi16(a)
+
+// The same as filter_line_c for 16 pixels at a time in 16 bit lanes.
+__attribute__((target("avx2")))
+static void filter_line_avx2(int mode, uint8_t *dst, const uint8_t *prev, const uint8_t *cur, const uint8_t *next, int w, int refs, int parity){
+    int x;
+    const uint8_t *prev2= parity ? prev : cur ;
+    const uint8_t *next2= parity ? cur  : next;
+    const __m256i one = _mm256_set1_epi16(1);
+    for(x=0; x+16<=w; x+=16){
+        __m256i c = LOAD16(cur - refs);
+        __m256i d = _mm256_srli_epi16(_mm256_add_epi16(LOAD16(prev2), LOAD16(next2)), 1);
+        __m256i e = LOAD16(cur + refs);
+        __m256i temporal_diff0 = ABS16(_mm256_sub_epi16(LOAD16(prev2), LOAD16(next2)));
+        __m256i temporal_diff1 = _mm256_srli_epi16(_mm256_add_epi16(
+            ABS16(_mm256_sub_epi16(LOAD16(prev - refs), c)), ABS16(_mm256_sub_epi16(LOAD16(prev + refs), e))), 1);
+        __m256i temporal_diff2 = _mm256_srli_epi16(_mm256_add_epi16(
+            ABS16(_mm256_sub_epi16(LOAD16(next - refs), c)), ABS16(_mm256_sub_epi16(LOAD16(next + refs), e))), 1);
+        __m256i diff = _mm256_max_epi16(_mm256_max_epi16(_mm256_srli_epi16(temporal_diff0, 1), temporal_diff1), temporal_diff2);
+        __m256i spatial_pred = _mm256_srli_epi16(_mm256_add_epi16(c, e), 1);
+        __m256i spatial_score = _mm256_sub_epi16(_mm256_add_epi16(_mm256_add_epi16(
+            ABS16(_mm256_sub_epi16(LOAD16(cur - refs - 1), LOAD16(cur + refs - 1))), ABS16(_mm256_sub_epi16(c, e))),
+            ABS16(_mm256_sub_epi16(LOAD16(cur - refs + 1), LOAD16(cur + refs + 1)))), one);
+        __m256i better = _mm256_set1_epi16(-1);
+        int j;
+
+        // Each direction is only checked further if the nearer one was better
+        for(j=-1; j!=3; j= j==-2 ? 1 : j<0 ? j-1 : j+1){
+            __m256i score = _mm256_add_epi16(_mm256_add_epi16(
+                ABS16(_mm256_sub_epi16(LOAD16(cur - refs - 1 + j), LOAD16(cur + refs - 1 - j))),
+                ABS16(_mm256_sub_epi16(LOAD16(cur - refs + j), LOAD16(cur + refs - j)))),
+                ABS16(_mm256_sub_epi16(LOAD16(cur - refs + 1 + j), LOAD16(cur + refs + 1 - j))));
+            __m256i pred = _mm256_srli_epi16(_mm256_add_epi16(LOAD16(cur - refs + j), LOAD16(cur + refs - j)), 1);
+            if(j==-1 || j==1)
+                better = _mm256_cmpgt_epi16(spatial_score, score);
+            else
+                better = _mm256_and_si256(better, _mm256_cmpgt_epi16(spatial_score, score));
+            spatial_score = _mm256_blendv_epi8(spatial_score, score, better);
+            spatial_pred = _mm256_blendv_epi8(spatial_pred, pred, better);
+        }
+
+        if(mode<2){
+            __m256i b = _mm256_srli_epi16(_mm256_add_epi16(LOAD16(prev2 - 2*refs), LOAD16(next2 - 2*refs)), 1);
+            __m256i f = _mm256_srli_epi16(_mm256_add_epi16(LOAD16(prev2 + 2*refs), LOAD16(next2 + 2*refs)), 1);
+            __m256i dc = _mm256_sub_epi16(d, c);
+            __m256i de = _mm256_sub_epi16(d, e);
+            __m256i bc = _mm256_sub_epi16(b, c);
+            __m256i fe = _mm256_sub_epi16(f, e);
+            __m256i max = _mm256_max_epi16(_mm256_max_epi16(de, dc), _mm256_min_epi16(bc, fe));
+            __m256i min = _mm256_min_epi16(_mm256_min_epi16(de, dc), _mm256_max_epi16(bc, fe));
+            diff = _mm256_max_epi16(_mm256_max_epi16(diff, min), _mm256_sub_epi16(_mm256_setzero_si256(), max));
+        }
+
+        spatial_pred = _mm256_min_epi16(_mm256_max_epi16(spatial_pred, _mm256_sub_epi16(d, diff)), _mm256_add_epi16(d, diff));
+        spatial_pred = _mm256_permute4x64_epi64(_mm256_packus_epi16(spatial_pred, spatial_pred), 0xd8);
+        _mm_storeu_si128((__m128i*) dst, _mm256_castsi256_si128(spatial_pred));
+
+        dst += 16;
+        cur += 16;
+        prev += 16;
+        next += 16;
+        prev2 += 16;
+        next2 += 16;
+    }
+    if(x < w)
+        filter_line_c(mode, dst, prev, cur, next, w - x, refs, parity);
+}
+#undef LOAD16
+#undef ABS16
+#endif // YADIF_AVX2
+
 static void interpolate(uint8_t *dst, const uint8_t *cur0,  const uint8_t *cur2, int w)
 {
     int x;
@@ -356,11 +429,21 @@ static void interpolate(uint8_t *dst, const uint8_t *cur0,  const uint8_t *cur2,
 }
 
 void filter_plane(int mode, uint8_t *dst, int dst_stride, const uint8_t *prev0, const uint8_t *cur0, const uint8_t *next0, int refs, int w, int h, int parity, int tff, int cpu){
+	filter_plane_slice(mode, dst, dst_stride, prev0, cur0, next0, refs, w, h, parity, tff, cpu, 0, h);
+}
+
+// Filter only the rows from y0 up to y1, so slices of a plane can run in parallel.
+void filter_plane_slice(int mode, uint8_t *dst, int dst_stride, const uint8_t *prev0, const uint8_t *cur0, const uint8_t *next0, int refs, int w, int h, int parity, int tff, int cpu, int y0, int y1){
 
 	int y;
-	filter_line = filter_line_c;
+	void (*filter_line)(int mode, uint8_t *dst, const uint8_t *prev, const uint8_t *cur, const uint8_t *next, int w, int refs, int parity) = filter_line_c;
 #ifdef __GNUC__
 #if (__GNUC__ > 4 || __GNUC__ == 4 && __GNUC_MINOR__>1)
+#ifdef YADIF_AVX2
+	if (cpu & AVS_CPU_AVX2)
+		filter_line = filter_line_avx2;
+	else
+#endif
 #ifdef USE_SSE3
 	if (cpu & AVS_CPU_SSSE3)
 		filter_line = filter_line_ssse3;
@@ -377,20 +460,32 @@ void filter_plane(int mode, uint8_t *dst, int dst_stride, const uint8_t *prev0,
 		filter_line = filter_line_mmx2;
 #endif
 #endif // GNUC
-        y=0;
-        if(((y ^ parity) & 1)){
-            memcpy(dst, cur0 + refs, w);// duplicate 1
-        }else{
-            memcpy(dst, cur0, w);
-        }
-        y=1;
-        if(((y ^ parity) & 1)){
-            interpolate(dst + dst_stride, cur0, cur0 + refs*2, w);   // interpolate 0 and 2
-        }else{
-            memcpy(dst + dst_stride, cur0 + refs, w); // copy original
-        }
-        for(y=2; y<h-2; y++){
-            if(((y ^ parity) & 1)){
+        for(y=y0; y<y1; y++){
+            if(y==0){
+                if(((y ^ parity) & 1)){
+                    memcpy(dst, cur0 + refs, w);// duplicate 1
+                }else{
+                    memcpy(dst, cur0, w);
+                }
+            }else if(y==1){
+                if(((y ^ parity) & 1)){
+                    interpolate(dst + dst_stride, cur0, cur0 + refs*2, w);   // interpolate 0 and 2
+                }else{
+                    memcpy(dst + dst_stride, cur0 + refs, w); // copy original
+                }
+            }else if(y==h-2){
+                if(((y ^ parity) & 1)){
+                    interpolate(dst + (h-2)*dst_stride, cur0 + (h-3)*refs, cur0 + (h-1)*refs, w);   // interpolate h-3 and h-1
+                }else{
+                    memcpy(dst + (h-2)*dst_stride, cur0 + (h-2)*refs, w); // copy original
+                }
+            }else if(y==h-1){
+                if(((y ^ parity) & 1)){
+                    memcpy(dst + (h-1)*dst_stride, cur0 + (h-2)*refs, w); // duplicate h-2
+                }else{
+                    memcpy(dst + (h-1)*dst_stride, cur0 + (h-1)*refs, w); // copy original
+                }
+            }else if(((y ^ parity) & 1)){
                 const uint8_t *prev= prev0 + y*refs;
                 const uint8_t *cur = cur0 + y*refs;
                 const uint8_t *next= next0 + y*refs;
@@ -400,18 +495,6 @@ void filter_plane(int mode, uint8_t *dst, int dst_stride, const uint8_t *prev0,
                 memcpy(dst + y*dst_stride, cur0 + y*refs, w); // copy original
             }
         }
-       y=h-2;
-        if(((y ^ parity) & 1)){
-            interpolate(dst + (h-2)*dst_stride, cur0 + (h-3)*refs, cur0 + (h-1)*refs, w);   // interpolate h-3 and h-1
-        }else{
-            memcpy(dst + (h-2)*dst_stride, cur0 + (h-2)*refs, w); // copy original
-        }
-        y=h-1;
-        if(((y ^ parity) & 1)){
-            memcpy(dst + (h-1)*dst_stride, cur0 + (h-2)*refs, w); // duplicate h-2
-        }else{
-            memcpy(dst + (h-1)*dst_stride, cur0 + (h-1)*refs, w); // copy original
-        }
 
 #if defined(__GNUC__) && defined(USE_SSE)
 	if (cpu >= AVS_CPU_INTEGER_SSE)
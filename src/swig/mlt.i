@@ -246,4 +246,254 @@ binary_data frame_get_image( Mlt::Frame &frame, mlt_image_format format, int w,
 binary_data frame_get_waveform(Mlt::Frame&, int, int);
 binary_data frame_get_image(Mlt::Frame&, mlt_image_format, int, int);
 
+/** Zero-copy access to frame memory.
+ *
+ * The *_buffer functions return a memoryview of the image, audio or waveform
+ * owned by the frame rather than a copy. The view holds a reference on the
+ * frame, so the memory stays valid after the Frame wrapper is gone, and it
+ * carries the shape and item format of the data so that, for example,
+ * numpy.asarray( view ) needs no copy either:
+ *   rgb24, rgb24a, opengl  (height, width, 3 or 4) of unsigned bytes
+ *   yuv422                 (height, width, 2) of unsigned bytes
+ *   other images           flat unsigned bytes
+ *   s16, s32le, f32le, u8  (samples, channels), interleaved
+ *   s32, float             (channels, samples), planar
+ *   waveform               (height, width) of unsigned bytes
+ * A view keeps the frame and the memory it exports alive, also when something
+ * later replaces the image or audio of the frame, for example by getting it in
+ * another format. That memory is then released with the frame instead of when
+ * it is replaced. frame_set_image hands the memory of a writable, contiguous Python
+ * buffer to the frame without copying it, and releases it when the frame
+ * does.
+ */
+
+%{
+typedef struct {
+	PyObject_HEAD
+	mlt_frame frame;
+	void *data;
+	const char *format;
+	Py_ssize_t itemsize;
+	Py_ssize_t len;
+	int ndim;
+	Py_ssize_t shape[3];
+	Py_ssize_t strides[3];
+	int readonly;
+} frame_buffer;
+
+static int frame_buffer_getbuffer( PyObject *object, Py_buffer *view, int flags )
+{
+	frame_buffer *self = (frame_buffer*) object;
+
+	if ( ( flags & PyBUF_WRITABLE ) && self->readonly )
+	{
+		PyErr_SetString( PyExc_BufferError, "the frame buffer is read-only" );
+		return -1;
+	}
+	view->obj = object;
+	Py_INCREF( object );
+	view->buf = self->data;
+	view->len = self->len;
+	view->readonly = self->readonly;
+	view->itemsize = self->itemsize;
+	view->format = ( flags & PyBUF_FORMAT ) ? (char*) self->format : NULL;
+	view->ndim = self->ndim;
+	view->shape = ( flags & PyBUF_ND ) == PyBUF_ND ? self->shape : NULL;
+	view->strides = ( flags & PyBUF_STRIDES ) == PyBUF_STRIDES ? self->strides : NULL;
+	view->suboffsets = NULL;
+	view->internal = NULL;
+	return 0;
+}
+
+static void frame_buffer_dealloc( PyObject *object )
+{
+	frame_buffer *self = (frame_buffer*) object;
+	mlt_frame_close( self->frame );
+	PyObject_Del( object );
+}
+
+/* Keep the data of a frame property until the frame is closed, even if the
+ * property is replaced. The property is renamed so that it stays the owner, and
+ * the data is put back under its name without a destructor.
+ */
+static void frame_buffer_pin( mlt_frame frame, const char *name, void *data )
+{
+	mlt_properties properties = MLT_FRAME_PROPERTIES( frame );
+	int size = 0;
+	char key[64];
+
+	if ( !data || mlt_properties_get_data( properties, name, &size ) != data )
+		return;
+	snprintf( key, sizeof( key ), "_python_%s.%p", name, data );
+	if ( mlt_properties_get_data( properties, key, NULL ) == data )
+		return;
+	mlt_properties_rename( properties, name, key );
+	mlt_properties_set_data( properties, name, data, size, NULL, NULL );
+}
+
+static PyBufferProcs frame_buffer_procs;
+
+static PyTypeObject frame_buffer_type = {
+	PyVarObject_HEAD_INIT( NULL, 0 )
+	"mlt.FrameBuffer",
+	sizeof( frame_buffer ),
+};
+
+static PyObject *frame_buffer_new( mlt_frame frame, void *data, const char *format, Py_ssize_t itemsize,
+	int ndim, Py_ssize_t d0, Py_ssize_t d1, Py_ssize_t d2, int readonly )
+{
+	if ( !frame_buffer_type.tp_as_buffer )
+	{
+		frame_buffer_procs.bf_getbuffer = frame_buffer_getbuffer;
+		frame_buffer_type.tp_dealloc = frame_buffer_dealloc;
+		frame_buffer_type.tp_as_buffer = &frame_buffer_procs;
+		frame_buffer_type.tp_flags = Py_TPFLAGS_DEFAULT;
+#if PY_MAJOR_VERSION < 3
+		frame_buffer_type.tp_flags |= Py_TPFLAGS_HAVE_NEWBUFFER;
+#endif
+		frame_buffer_type.tp_doc = "Memory owned by an MLT frame";
+		if ( PyType_Ready( &frame_buffer_type ) < 0 )
+		{
+			frame_buffer_type.tp_as_buffer = NULL;
+			return NULL;
+		}
+	}
+	if ( !data )
+		Py_RETURN_NONE;
+
+	frame_buffer *self = PyObject_New( frame_buffer, &frame_buffer_type );
+	if ( !self )
+		return NULL;
+	mlt_properties_inc_ref( MLT_FRAME_PROPERTIES( frame ) );
+	self->frame = frame;
+	self->data = data;
+	self->format = format;
+	self->itemsize = itemsize;
+	self->ndim = ndim;
+	self->shape[0] = d0;
+	self->shape[1] = d1;
+	self->shape[2] = d2;
+	self->readonly = readonly;
+
+	// C-contiguous strides
+	self->len = itemsize;
+	for ( int i = ndim - 1; i >= 0; i-- )
+	{
+		self->strides[i] = self->len;
+		self->len *= self->shape[i];
+	}
+
+	PyObject *view = PyMemoryView_FromObject( (PyObject*) self );
+	Py_DECREF( self );
+	return view;
+}
+
+PyObject *frame_get_image_buffer( Mlt::Frame &frame, mlt_image_format format, int w, int h, int writable = 0 )
+{
+	uint8_t *image = frame.get_image( format, w, h, writable );
+	int readonly = !writable;
+
+	frame_buffer_pin( frame.get_frame(), "image", image );
+
+	switch ( format )
+	{
+	case mlt_image_rgb24:
+		return frame_buffer_new( frame.get_frame(), image, "B", 1, 3, h, w, 3, readonly );
+	case mlt_image_rgb24a:
+	case mlt_image_opengl:
+		return frame_buffer_new( frame.get_frame(), image, "B", 1, 3, h, w, 4, readonly );
+	case mlt_image_yuv422:
+		return frame_buffer_new( frame.get_frame(), image, "B", 1, 3, h, w, 2, readonly );
+	default:
+		return frame_buffer_new( frame.get_frame(), image, "B", 1, 1, mlt_image_format_size( format, w, h, NULL ), 0, 0, readonly );
+	}
+}
+
+PyObject *frame_get_audio_buffer( Mlt::Frame &frame, mlt_audio_format format, int frequency, int channels, int samples )
+{
+	void *audio = frame.get_audio( format, frequency, channels, samples );
+
+	frame_buffer_pin( frame.get_frame(), "audio", audio );
+
+	switch ( format )
+	{
+	case mlt_audio_s16:
+		return frame_buffer_new( frame.get_frame(), audio, "h", 2, 2, samples, channels, 0, 0 );
+	case mlt_audio_s32le:
+		return frame_buffer_new( frame.get_frame(), audio, "i", 4, 2, samples, channels, 0, 0 );
+	case mlt_audio_f32le:
+		return frame_buffer_new( frame.get_frame(), audio, "f", 4, 2, samples, channels, 0, 0 );
+	case mlt_audio_u8:
+		return frame_buffer_new( frame.get_frame(), audio, "B", 1, 2, samples, channels, 0, 0 );
+	case mlt_audio_s32:
+		return frame_buffer_new( frame.get_frame(), audio, "i", 4, 2, channels, samples, 0, 0 );
+	case mlt_audio_float:
+		return frame_buffer_new( frame.get_frame(), audio, "f", 4, 2, channels, samples, 0, 0 );
+	default:
+		return frame_buffer_new( frame.get_frame(), NULL, "B", 1, 1, 0, 0, 0, 0 );
+	}
+}
+
+PyObject *frame_get_waveform_buffer( Mlt::Frame &frame, int w, int h )
+{
+	void *waveform = frame.get_waveform( w, h );
+
+	frame_buffer_pin( frame.get_frame(), "waveform", waveform );
+	return frame_buffer_new( frame.get_frame(), waveform, "B", 1, 2, h, w, 0, 1 );
+}
+
+static void frame_release_python_buffer( void *view )
+{
+	PyGILState_STATE state = PyGILState_Ensure();
+	PyBuffer_Release( (Py_buffer*) view );
+	PyGILState_Release( state );
+	free( view );
+}
+
+PyObject *frame_set_image( Mlt::Frame &frame, PyObject *buffer, mlt_image_format format, int w, int h )
+{
+	Py_buffer *view = (Py_buffer*) calloc( 1, sizeof( Py_buffer ) );
+	int size = mlt_image_format_size( format, w, h, NULL );
+
+	if ( !view )
+		return PyErr_NoMemory();
+	if ( PyObject_GetBuffer( buffer, view, PyBUF_WRITABLE | PyBUF_C_CONTIGUOUS ) < 0 )
+	{
+		free( view );
+		return NULL;
+	}
+	if ( view->len < size )
+	{
+		PyErr_Format( PyExc_ValueError, "the buffer holds %zd bytes but the image needs %d", view->len, size );
+		PyBuffer_Release( view );
+		free( view );
+		return NULL;
+	}
+
+	// The frame does not own the memory; the view keeps the Python object alive
+	// until the frame releases the property.
+	mlt_properties properties = frame.get_properties();
+	mlt_frame_set_image( frame.get_frame(), (uint8_t*) view->buf, size, NULL );
+	mlt_properties_set_data( properties, "_python_buffer", view, 0, frame_release_python_buffer, NULL );
+	mlt_properties_set_int( properties, "format", format );
+	mlt_properties_set_int( properties, "width", w );
+	mlt_properties_set_int( properties, "height", h );
+	Py_RETURN_NONE;
+}
+%}
+
+PyObject *frame_get_image_buffer(Mlt::Frame&, mlt_image_format, int, int, int writable = 0);
+PyObject *frame_get_audio_buffer(Mlt::Frame&, mlt_audio_format, int, int, int);
+PyObject *frame_get_waveform_buffer(Mlt::Frame&, int, int);
+PyObject *frame_set_image(Mlt::Frame&, PyObject*, mlt_image_format, int, int);
+
+%extend Mlt::Frame {
+%pythoncode %{
+    def get_image_buffer(*args): return _mlt.frame_get_image_buffer(*args)
+    def get_audio_buffer(*args): return _mlt.frame_get_audio_buffer(*args)
+    def get_waveform_buffer(*args): return _mlt.frame_get_waveform_buffer(*args)
+    def set_image_buffer(*args): return _mlt.frame_set_image(*args)
+%}
+}
+
 #endif
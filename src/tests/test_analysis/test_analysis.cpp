@@ -0,0 +1,223 @@
+/*
+ * Copyright (C) 2017 Meltytech, LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <QString>
+#include <QtTest>
+#include <QTemporaryDir>
+
+#include <mlt++/Mlt.h>
+using namespace Mlt;
+
+class TestAnalysis : public QObject
+{
+    Q_OBJECT
+
+public:
+    TestAnalysis()
+    {
+        Factory::init();
+    }
+
+private:
+    // Stores the audio format that the analysis requested for each frame.
+    static int formatGetAudio(mlt_frame frame, void** buffer, mlt_audio_format* format, int* frequency, int* channels, int* samples)
+    {
+        mlt_filter filter = (mlt_filter) mlt_frame_pop_audio(frame);
+        int record[2] = {*frequency, *channels};
+        mlt_analysis_filter_put(filter, frame, mlt_frame_get_position(frame), record, sizeof(record));
+        return mlt_frame_get_audio(frame, buffer, format, frequency, channels, samples);
+    }
+
+    static mlt_frame formatProcess(mlt_filter filter, mlt_frame frame)
+    {
+        mlt_frame_push_audio(frame, filter);
+        mlt_frame_push_audio(frame, (void*) formatGetAudio);
+        return frame;
+    }
+
+    // A peaks sidecar with one channel, two buckets per frame and one
+    // coarser level. Every frame has a peak of 100, and the coarser level
+    // has a peak of 7000, so that the level that was used can be told.
+    static mlt_analysis newPeaks(int frames)
+    {
+        mlt_analysis analysis = mlt_analysis_new();
+        int32_t info[4] = {1, 2, 48000, 1};
+        mlt_analysis_put(analysis, "peaks.info", 0, info, sizeof(info));
+        int16_t frame[2 * 3] = {-100, 100, 50, -100, 100, 50};
+        for (int i = 0; i < frames; i++)
+            mlt_analysis_put(analysis, "peaks", i, frame, sizeof(frame));
+        int16_t coarse[16 * 3];
+        for (int i = 0; i < 16; i++) {
+            coarse[i * 3] = -7000;
+            coarse[i * 3 + 1] = 7000;
+            coarse[i * 3 + 2] = 3000;
+        }
+        for (int i = 0; i < frames / 16; i++)
+            mlt_analysis_put(analysis, "peaks.16", i, coarse, sizeof(coarse));
+        return analysis;
+    }
+
+private Q_SLOTS:
+
+    void PutAndGetRoundTrip()
+    {
+        mlt_analysis analysis = mlt_analysis_new();
+        QVERIFY(analysis != 0);
+        double record[3] = {1.0, 2.0, 3.0};
+        QCOMPARE(mlt_analysis_put(analysis, "a", 5, record, sizeof(record)), 0);
+        record[0] = 4.0;
+        QCOMPARE(mlt_analysis_put(analysis, "a", 2, record, sizeof(record)), 0);
+
+        double out[3] = {0, 0, 0};
+        QCOMPARE(mlt_analysis_get(analysis, "a", 5, out, sizeof(out)), int(sizeof(out)));
+        QCOMPARE(out[0], 1.0);
+        QCOMPARE(out[2], 3.0);
+        QCOMPARE(mlt_analysis_get(analysis, "a", 2, out, sizeof(out)), int(sizeof(out)));
+        QCOMPARE(out[0], 4.0);
+
+        // Positions between and outside of the records have none.
+        QCOMPARE(mlt_analysis_get(analysis, "a", 3, out, sizeof(out)), 0);
+        QCOMPARE(mlt_analysis_get(analysis, "a", 6, out, sizeof(out)), 0);
+        QCOMPARE(mlt_analysis_get(analysis, "a", -1, out, sizeof(out)), 0);
+
+        // A smaller buffer gets the start of the record.
+        double first = 0.0;
+        QCOMPARE(mlt_analysis_get(analysis, "a", 5, &first, sizeof(first)), int(sizeof(out)));
+        QCOMPARE(first, 1.0);
+
+        // All of the records of a track have the same size.
+        QVERIFY(mlt_analysis_put(analysis, "a", 6, record, sizeof(double)) != 0);
+        mlt_analysis_close(analysis);
+    }
+
+    void MissingTrackHasNoRecords()
+    {
+        mlt_analysis analysis = mlt_analysis_new();
+        int value = 1;
+        mlt_analysis_put(analysis, "a", 0, &value, sizeof(value));
+        QCOMPARE(mlt_analysis_get(analysis, "b", 0, &value, sizeof(value)), 0);
+        int16_t peaks[3];
+        QCOMPARE(mlt_analysis_get_peaks(analysis, 0, 1, 1, 1, peaks), 0);
+        mlt_analysis_close(analysis);
+        QVERIFY(mlt_analysis_load("/nonexistent/analysis.mlta") == 0);
+    }
+
+    void SaveAndLoad()
+    {
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+        QByteArray filename = (dir.path() + "/test.mlta").toUtf8();
+        mlt_analysis analysis = mlt_analysis_new();
+        for (int i = 10; i < 20; i++)
+            mlt_analysis_put(analysis, "a", i, &i, sizeof(i));
+        double d = 0.5;
+        mlt_analysis_put(analysis, "b", 0, &d, sizeof(d));
+        QCOMPARE(mlt_analysis_save(analysis, filename.constData()), 0);
+        mlt_analysis_close(analysis);
+
+        analysis = mlt_analysis_load(filename.constData());
+        QVERIFY(analysis != 0);
+        int value = 0;
+        QCOMPARE(mlt_analysis_get(analysis, "a", 15, &value, sizeof(value)), int(sizeof(value)));
+        QCOMPARE(value, 15);
+        QCOMPARE(mlt_analysis_get(analysis, "a", 9, &value, sizeof(value)), 0);
+        QCOMPARE(mlt_analysis_get(analysis, "a", 20, &value, sizeof(value)), 0);
+        d = 0.0;
+        QCOMPARE(mlt_analysis_get(analysis, "b", 0, &d, sizeof(d)), int(sizeof(d)));
+        QCOMPARE(d, 0.5);
+        QCOMPARE(mlt_analysis_get(analysis, "c", 0, &d, sizeof(d)), 0);
+        mlt_analysis_close(analysis);
+    }
+
+    void LoadRejectsInvalidFile()
+    {
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+        QByteArray filename = (dir.path() + "/bad.mlta").toUtf8();
+        FILE* file = fopen(filename.constData(), "wb");
+        QVERIFY(file != 0);
+        fputs("not an analysis", file);
+        fclose(file);
+        QVERIFY(mlt_analysis_load(filename.constData()) == 0);
+    }
+
+    void GetPeaksUsesFinestLevelForNarrowBuckets()
+    {
+        mlt_analysis analysis = newPeaks(32);
+        int16_t peaks[64 * 3];
+        // Two buckets per frame from the frame records
+        QCOMPARE(mlt_analysis_get_peaks(analysis, 0, 32, 64, 1, peaks), 1);
+        QCOMPARE(int(peaks[0]), -100);
+        QCOMPARE(int(peaks[1]), 100);
+        QCOMPARE(int(peaks[63 * 3 + 1]), 100);
+        mlt_analysis_close(analysis);
+    }
+
+    void GetPeaksUsesCoarseLevelForWideBuckets()
+    {
+        mlt_analysis analysis = newPeaks(32);
+        int16_t peaks[2 * 3];
+        // Sixteen frames per bucket from the coarser level
+        QCOMPARE(mlt_analysis_get_peaks(analysis, 0, 32, 2, 1, peaks), 1);
+        QCOMPARE(int(peaks[0]), -7000);
+        QCOMPARE(int(peaks[1]), 7000);
+        QCOMPARE(int(peaks[2]), 3000);
+        QCOMPARE(int(peaks[4]), 7000);
+        mlt_analysis_close(analysis);
+    }
+
+    void GetPeaksOutsideOfRecordsIsSilent()
+    {
+        mlt_analysis analysis = newPeaks(32);
+        int16_t peaks[2 * 3];
+        QCOMPARE(mlt_analysis_get_peaks(analysis, 100, 2, 2, 1, peaks), 1);
+        QCOMPARE(int(peaks[0]), 0);
+        QCOMPARE(int(peaks[1]), 0);
+        mlt_analysis_close(analysis);
+    }
+
+    void RunStoresFilterResults()
+    {
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+        QByteArray filename = (dir.path() + "/tone.mlta").toUtf8();
+        Profile profile("dv_pal");
+        Producer producer(profile, "tone");
+        producer.set_in_and_out(0, 9);
+        mlt_filter f = mlt_filter_new();
+        f->process = formatProcess;
+        Filter filter(f);
+        mlt_filter_close(f);
+        filter.set("analysis_track", "format");
+        filter.set("analysis_frequency", 44100);
+        filter.set("analysis_channels", 1);
+        producer.attach(filter);
+        QCOMPARE(producer.run_analysis(filename.constData()), 0);
+        QCOMPARE(filter.get("analysis"), filename.constData());
+
+        int record[2] = {0, 0};
+        QCOMPARE(mlt_analysis_filter_get(filter.get_filter(), 9, record, sizeof(record)), int(sizeof(record)));
+        QCOMPARE(record[0], 44100);
+        QCOMPARE(record[1], 1);
+        QCOMPARE(mlt_analysis_filter_get(filter.get_filter(), 10, record, sizeof(record)), 0);
+    }
+};
+
+QTEST_APPLESS_MAIN(TestAnalysis)
+
+#include "test_analysis.moc"
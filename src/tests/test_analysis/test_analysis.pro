@@ -0,0 +1,3 @@
+include(../common.pri)
+TARGET = test_analysis
+SOURCES += test_analysis.cpp
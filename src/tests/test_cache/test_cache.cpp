@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2017 Meltytech, LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <QtTest>
+
+#include <framework/mlt.h>
+
+class TestCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    TestCache() {}
+
+private:
+    static int released;
+
+    static void release(void*)
+    {
+        released++;
+    }
+
+    // The objects that own the cached data; only their addresses are used.
+    char objects[5];
+
+    void put(mlt_cache cache, int i, int size)
+    {
+        mlt_cache_put(cache, &objects[i], &objects[i], size, release);
+    }
+
+    bool contains(mlt_cache cache, int i)
+    {
+        mlt_cache_item item = mlt_cache_get(cache, &objects[i]);
+        mlt_cache_item_close(item);
+        return item != NULL;
+    }
+
+private Q_SLOTS:
+
+    void UnlimitedKeepsItemsUpToTheCount()
+    {
+        mlt_cache cache = mlt_cache_init();
+        mlt_cache_set_size(cache, 4);
+        released = 0;
+        for (int i = 0; i < 4; i++)
+            put(cache, i, 1000);
+        QCOMPARE(released, 0);
+        QVERIFY(contains(cache, 0));
+        put(cache, 4, 1000);
+        QCOMPARE(released, 1);
+        QVERIFY(!contains(cache, 1));
+        mlt_cache_close(cache);
+        QCOMPARE(released, 5);
+    }
+
+    void MaxBytesReleasesLeastRecentlyUsed()
+    {
+        mlt_cache cache = mlt_cache_init();
+        mlt_cache_set_size(cache, 5);
+        mlt_cache_set_max_bytes(cache, 300);
+        released = 0;
+        put(cache, 0, 100);
+        put(cache, 1, 100);
+        put(cache, 2, 100);
+        QCOMPARE(released, 0);
+
+        // Using 0 makes 1 the least recently used.
+        QVERIFY(contains(cache, 0));
+        put(cache, 3, 100);
+        QCOMPARE(released, 1);
+        QVERIFY(!contains(cache, 1));
+        QVERIFY(contains(cache, 0));
+        QVERIFY(contains(cache, 2));
+        QVERIFY(contains(cache, 3));
+
+        // A large item releases as many as needed, oldest first.
+        put(cache, 4, 250);
+        QCOMPARE(released, 4);
+        QVERIFY(!contains(cache, 0));
+        QVERIFY(!contains(cache, 2));
+        QVERIFY(!contains(cache, 3));
+        QVERIFY(contains(cache, 4));
+        mlt_cache_close(cache);
+        QCOMPARE(released, 5);
+    }
+
+    void MaxBytesKeepsTheMostRecentItem()
+    {
+        mlt_cache cache = mlt_cache_init();
+        mlt_cache_set_max_bytes(cache, 100);
+        released = 0;
+        put(cache, 0, 50);
+        put(cache, 1, 500);
+        QCOMPARE(released, 1);
+        QVERIFY(!contains(cache, 0));
+        QVERIFY(contains(cache, 1));
+
+        // Replacing an item only counts its new size.
+        put(cache, 1, 60);
+        put(cache, 2, 40);
+        QCOMPARE(released, 2);
+        QVERIFY(contains(cache, 1));
+        QVERIFY(contains(cache, 2));
+        mlt_cache_close(cache);
+        QCOMPARE(released, 4);
+    }
+};
+
+int TestCache::released = 0;
+
+QTEST_APPLESS_MAIN(TestCache)
+
+#include "test_cache.moc"
@@ -0,0 +1,300 @@
+/*
+ * Copyright (C) 2017 Meltytech, LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with consumer library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <QString>
+#include <QtTest>
+#include <QTemporaryDir>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <mlt++/Mlt.h>
+using namespace Mlt;
+
+static QString readHeader(const QString& fileName)
+{
+    char header[32] = "";
+    FILE* file = fopen(fileName.toUtf8().constData(), "rb");
+    if (file) {
+        size_t n = fread(header, 1, sizeof(header) - 1, file);
+        header[n] = 0;
+        fclose(file);
+        char* data = strstr(header, "255\n");
+        if (data)
+            data[4] = 0;
+    }
+    return QString(header);
+}
+
+class TestConsumer : public QObject
+{
+    Q_OBJECT
+    Profile profile;
+
+public:
+    TestConsumer()
+        : profile("dv_pal")
+    {
+        Factory::init();
+    }
+
+private:
+    // Renders slower than the frame rate, or faster when degraded, so that
+    // some frames may be degraded or dropped. How many depends on the
+    // machine, so the tests only check what holds for any timing.
+    static int slowGetImage(mlt_frame frame, uint8_t** image, mlt_image_format* format, int* width, int* height, int writable)
+    {
+        const char* interp = mlt_properties_get(MLT_FRAME_PROPERTIES(frame), "rescale.interp");
+        usleep(interp && !strcmp(interp, "nearest") ? 10000 : 50000);
+        return mlt_frame_get_image(frame, image, format, width, height, writable);
+    }
+
+    static mlt_frame slowProcess(mlt_filter, mlt_frame frame)
+    {
+        mlt_frame_push_get_image(frame, slowGetImage);
+        return frame;
+    }
+
+    static int isStopped(mlt_consumer)
+    {
+        return 1;
+    }
+
+    static void closeConsumer(mlt_consumer consumer)
+    {
+        consumer->close = NULL;
+        mlt_consumer_close(consumer);
+        free(consumer);
+    }
+
+    // Makes a consumer that only reads ahead, like a player would.
+    static mlt_consumer newPacedConsumer(Profile& profile)
+    {
+        mlt_consumer consumer = mlt_consumer_new(profile.get_profile());
+        consumer->is_stopped = isStopped;
+        consumer->close = closeConsumer;
+        return consumer;
+    }
+
+    struct PlayResult
+    {
+        int frames;
+        int rendered;
+        int degraded;
+        int maxSkipped;
+        int firstSkipped;
+        bool inOrder;
+    };
+
+    // Takes frames from a slow graph as fast as the consumer provides them.
+    PlayResult play(Consumer& consumer, int frames)
+    {
+        PlayResult result = {0, 0, 0, 0, -1, true};
+        Producer producer(profile, "colour:red");
+        producer.set("out", 100000);
+        mlt_filter f = mlt_filter_new();
+        f->process = slowProcess;
+        Filter filter(f);
+        mlt_filter_close(f);
+        producer.attach(filter);
+        consumer.set_profile(profile);
+        consumer.set("buffer", 10);
+        consumer.set("drop_max", 2);
+        consumer.connect(producer);
+        consumer.start();
+        int skipped = 0;
+        for (int i = 0; i < frames; i++) {
+            mlt_frame frame = mlt_consumer_rt_frame(consumer.get_consumer());
+            if (!frame)
+                break;
+            mlt_properties properties = MLT_FRAME_PROPERTIES(frame);
+            result.frames++;
+            result.inOrder = result.inOrder && mlt_frame_get_position(frame) == i;
+            if (mlt_properties_get_int(properties, "rendered")) {
+                result.rendered++;
+                skipped = 0;
+                const char* interp = mlt_properties_get(properties, "rescale.interp");
+                if (interp && !strcmp(interp, "nearest"))
+                    result.degraded++;
+            } else {
+                if (result.firstSkipped < 0)
+                    result.firstSkipped = i;
+                result.maxSkipped = qMax(result.maxSkipped, ++skipped);
+            }
+            mlt_frame_close(frame);
+        }
+        consumer.stop();
+        return result;
+    }
+
+    void renderSprites(const QString& target, int frames, int start = 0)
+    {
+        Producer producer(profile, "colour:red");
+        producer.set_in_and_out(0, frames - 1);
+        producer.seek(start);
+        Consumer consumer(profile, "sprites", target.toUtf8().constData());
+        consumer.set("interval", 5);
+        consumer.set("columns", 2);
+        consumer.set("rows", 2);
+        consumer.set("tile_width", 16);
+        consumer.set("tile_height", 9);
+        consumer.connect(producer);
+        consumer.run();
+        consumer.stop();
+    }
+
+private Q_SLOTS:
+
+    void SpritesWritesNumberedSheets()
+    {
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+        renderSprites(dir.path() + "/s-%03d.ppm", 30);
+        // 6 tiles: a full sheet of 2x2 and a second sheet with one row
+        QCOMPARE(readHeader(dir.path() + "/s-000.ppm"), QString("P6\n32 18\n255\n"));
+        QCOMPARE(readHeader(dir.path() + "/s-001.ppm"), QString("P6\n32 9\n255\n"));
+        QCOMPARE(readHeader(dir.path() + "/s-002.ppm"), QString(""));
+    }
+
+    void SpritesNumbersSheetsByPosition()
+    {
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+        // Positions 20 to 29 are tiles 4 and 5, both on the second sheet.
+        renderSprites(dir.path() + "/s-%03d.ppm", 30, 20);
+        QCOMPARE(readHeader(dir.path() + "/s-000.ppm"), QString(""));
+        QCOMPARE(readHeader(dir.path() + "/s-001.ppm"), QString("P6\n32 9\n255\n"));
+    }
+
+    void SpritesAcceptsPlainAndEscapedFormats()
+    {
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+        renderSprites(dir.path() + "/100%%-%d.ppm", 5);
+        QCOMPARE(readHeader(dir.path() + "/100%-0.ppm"), QString("P6\n32 9\n255\n"));
+    }
+
+    void SpritesNumbersTargetWithoutConversion()
+    {
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+        renderSprites(dir.path() + "/sheet.ppm", 5);
+        QCOMPARE(readHeader(dir.path() + "/sheet-0000.ppm"), QString("P6\n32 9\n255\n"));
+    }
+
+    void SpritesIgnoresOtherConversions()
+    {
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+        renderSprites(dir.path() + "/a-%s.ppm", 5);
+        QCOMPARE(readHeader(dir.path() + "/a-%s-0000.ppm"), QString("P6\n32 9\n255\n"));
+        renderSprites(dir.path() + "/b-%d-%d.ppm", 5);
+        QCOMPARE(readHeader(dir.path() + "/b-%d-%d-0000.ppm"), QString("P6\n32 9\n255\n"));
+        renderSprites(dir.path() + "/c-%5d.ppm", 5);
+        QCOMPARE(readHeader(dir.path() + "/c-%5d-0000.ppm"), QString("P6\n32 9\n255\n"));
+    }
+
+    void PeaksWritesSidecar()
+    {
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+        QByteArray target = (dir.path() + "/tone.peaks").toUtf8();
+        Producer producer(profile, "tone");
+        producer.set_in_and_out(0, 24);
+        Consumer consumer(profile, "peaks", target.constData());
+        consumer.set("buckets", 4);
+        consumer.connect(producer);
+        consumer.run();
+        consumer.stop();
+
+        mlt_analysis analysis = mlt_analysis_load(target.constData());
+        QVERIFY(analysis != 0);
+        int32_t info[4];
+        QCOMPARE(mlt_analysis_get(analysis, "peaks.info", 0, info, sizeof(info)), int(sizeof(info)));
+        QCOMPARE(info[0], 2);
+        QCOMPARE(info[1], 4);
+        QVERIFY(info[3] >= 1);
+        int16_t record[4 * 2 * 3];
+        QCOMPARE(mlt_analysis_get(analysis, "peaks", 24, record, sizeof(record)), int(sizeof(record)));
+        QVERIFY(record[1] > 0);
+        QCOMPARE(mlt_analysis_get(analysis, "peaks", 25, record, sizeof(record)), 0);
+        int16_t peaks[10 * 2 * 3];
+        QCOMPARE(mlt_analysis_get_peaks(analysis, 0, 25, 10, 2, peaks), 2);
+        QVERIFY(peaks[0] < 0);
+        QVERIFY(peaks[1] > 0);
+        mlt_analysis_close(analysis);
+    }
+
+    void PacedConsumerBoundsDroppedFrames()
+    {
+        mlt_consumer c = newPacedConsumer(profile);
+        Consumer consumer(c);
+        mlt_consumer_close(c);
+        consumer.set("real_time", 1);
+        PlayResult result = play(consumer, 20);
+        QCOMPARE(result.frames, 20);
+        QVERIFY(result.inOrder);
+        // The frame after drop_max consecutive drops is dropped only if the
+        // one after it is forced, and none are dropped at the start.
+        QVERIFY(result.maxSkipped <= 2 + 1);
+        QVERIFY(result.firstSkipped < 0 || result.firstSkipped > 10 / 5 + 1);
+        QCOMPARE(consumer.get_int("drop_count"), result.frames - result.rendered);
+        // Frames still in the queue may have been degraded too.
+        QVERIFY(consumer.get_int("degrade_count") >= result.degraded);
+        QVERIFY(consumer.get("render_cost") != NULL);
+    }
+
+    void PacedConsumerWithoutDroppingRendersAll()
+    {
+        mlt_consumer c = newPacedConsumer(profile);
+        Consumer consumer(c);
+        mlt_consumer_close(c);
+        consumer.set("real_time", -1);
+        PlayResult result = play(consumer, 10);
+        QCOMPARE(result.frames, 10);
+        QVERIFY(result.inOrder);
+        QCOMPARE(result.rendered, 10);
+        QCOMPARE(result.degraded, 0);
+        QCOMPARE(consumer.get_int("drop_count"), 0);
+        QCOMPARE(consumer.get_int("degrade_count"), 0);
+        QVERIFY(consumer.get("render_cost") != NULL);
+    }
+
+    void RealTimeAutoKeepsProperty()
+    {
+        mlt_consumer c = newPacedConsumer(profile);
+        Consumer consumer(c);
+        mlt_consumer_close(c);
+        consumer.set("real_time", "auto");
+        PlayResult result = play(consumer, 5);
+        QCOMPARE(result.rendered, 5);
+        QCOMPARE(consumer.get("real_time"), "auto");
+        QVERIFY(mlt_consumer_real_time(c) < -1);
+
+        // A restart resolves the property again.
+        consumer.set("real_time", -1);
+        result = play(consumer, 5);
+        QCOMPARE(result.rendered, 5);
+        QCOMPARE(mlt_consumer_real_time(c), -1);
+    }
+};
+
+QTEST_APPLESS_MAIN(TestConsumer)
+
+#include "test_consumer.moc"
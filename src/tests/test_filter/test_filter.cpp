@@ -17,9 +17,18 @@
  */
 
 #include <QtTest>
+#include <string.h>
 #include <mlt++/Mlt.h>
 using namespace Mlt;
 
+static int disableChanges = 0;
+
+static void onPropertyChanged(mlt_properties, void*, char* name)
+{
+    if (!strcmp(name, "disable"))
+        disableChanges++;
+}
+
 class TestFilter: public QObject
 {
     Q_OBJECT
@@ -70,6 +79,47 @@ private Q_SLOTS:
         delete frame;
     }
 
+    void LoudnessParallelAnalysisMatchesSerial()
+    {
+        Profile profile("dv_pal");
+        double results[2][3];
+
+        for (int threads = 0; threads < 2; threads++) {
+            Producer producer(profile, "tone");
+            producer.set("level", -12.0);
+            // Two minutes, so that there are two chunks of a minute.
+            producer.set_in_and_out(0, 2 * 60 * 25 - 1);
+            Filter loudness(profile, "loudness");
+            loudness.set("threads", threads * 2);
+            Filter volume(profile, "volume");
+            producer.attach(loudness);
+            producer.attach(volume);
+            disableChanges = 0;
+            mlt_events_listen(loudness.get_properties(), this, "property-changed", (mlt_listener) onPropertyChanged);
+            mlt_events_listen(volume.get_properties(), this, "property-changed", (mlt_listener) onPropertyChanged);
+
+            int frames = threads ? 1 : producer.get_playtime();
+            for (int i = 0; i < frames; i++) {
+                Frame* frame = producer.get_frame();
+                mlt_audio_format format = mlt_audio_f32le;
+                int frequency = 48000;
+                int channels = 2;
+                int samples = mlt_sample_calculator(25, frequency, i);
+                frame->get_audio(format, frequency, channels, samples);
+                delete frame;
+                producer.seek(i + 1);
+            }
+
+            // The filters the user owns are never disabled for the analysis.
+            QCOMPARE(disableChanges, 0);
+            QVERIFY(!volume.get("disable"));
+            const char* text = loudness.get("results");
+            QVERIFY(text != NULL);
+            QCOMPARE(sscanf(text, "L: %lf\tR: %lf\tP %lf", &results[threads][0], &results[threads][1], &results[threads][2]), 3);
+        }
+        QVERIFY(qAbs(results[1][0] - results[0][0]) < 0.1);
+        QVERIFY(qAbs(results[1][2] - results[0][2]) < 0.01);
+    }
 };
 
 QTEST_APPLESS_MAIN(TestFilter)
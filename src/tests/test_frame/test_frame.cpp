@@ -17,6 +17,8 @@
  */
 
 #include <QtTest>
+#include <stdlib.h>
+#include <string.h>
 #include <mlt++/Mlt.h>
 using namespace Mlt;
 
@@ -27,6 +29,58 @@ class TestFrame: public QObject
 public:
     TestFrame() {}
 
+private:
+    // Makes a frame with a 4x2 rgb24 image of a single value.
+    static mlt_frame newImageFrame(uint8_t value)
+    {
+        mlt_frame frame = mlt_frame_init(NULL);
+        int size = 4 * 2 * 3;
+        uint8_t* image = (uint8_t*) malloc(size);
+        memset(image, value, size);
+        mlt_frame_set_image(frame, image, size, free);
+        mlt_properties properties = MLT_FRAME_PROPERTIES(frame);
+        mlt_properties_set_int(properties, "format", mlt_image_rgb24);
+        mlt_properties_set_int(properties, "width", 4);
+        mlt_properties_set_int(properties, "height", 2);
+        return frame;
+    }
+
+    static void makeLut(uint8_t* lut, int add, int multiply)
+    {
+        for (int i = 0; i < 3 * 256; i++)
+            lut[i] = qMin((i % 256 + add) * multiply, 255);
+    }
+
+    // A point operation that queues the table pushed with it.
+    static int lutGetImage(mlt_frame frame, uint8_t** image, mlt_image_format* format, int* width, int* height, int)
+    {
+        const uint8_t* lut = (const uint8_t*) mlt_frame_pop_service(frame);
+        *format = mlt_image_rgb24;
+        int error = mlt_frame_get_image_lut(frame, image, format, width, height);
+        if (!error && (*image)[0] != 5)
+            error = 1; // The table queued below was applied too early.
+        if (!error)
+            error = mlt_frame_add_lut(frame, *format, lut);
+        return error;
+    }
+
+    // Converts rgb24 to rgb24a without looking at the queued tables.
+    static int convertImage(mlt_frame frame, uint8_t** image, mlt_image_format* input, mlt_image_format output)
+    {
+        if (*input != mlt_image_rgb24 || output != mlt_image_rgb24a)
+            return 1;
+        int pixels = mlt_properties_get_int(MLT_FRAME_PROPERTIES(frame), "width") * mlt_properties_get_int(MLT_FRAME_PROPERTIES(frame), "height");
+        uint8_t* rgba = (uint8_t*) malloc(pixels * 4);
+        for (int i = 0; i < pixels; i++) {
+            memcpy(&rgba[i * 4], &(*image)[i * 3], 3);
+            rgba[i * 4 + 3] = 255;
+        }
+        mlt_frame_set_image(frame, rgba, pixels * 4, free);
+        *image = rgba;
+        *input = output;
+        return 0;
+    }
+
 private Q_SLOTS:
     void FrameConstructorAddsReference()
     {
@@ -93,6 +147,127 @@ private Q_SLOTS:
         QCOMPARE(f1.ref_count(), 2);
         mlt_frame_close(frame);
     }
+
+    void MoveConstructorTransfersReference()
+    {
+        mlt_frame frame = mlt_frame_init(NULL);
+        Frame f1(frame);
+        QCOMPARE(f1.ref_count(), 2);
+        Frame f2(std::move(f1));
+        QVERIFY(f1.get_frame() == NULL);
+        QVERIFY(f2.get_frame() == frame);
+        QCOMPARE(f2.ref_count(), 2);
+        mlt_frame_close(frame);
+    }
+
+    void MoveAssignmentTransfersReference()
+    {
+        mlt_frame frame = mlt_frame_init(NULL);
+        Frame f1(frame);
+        Frame f2(mlt_frame_init(NULL));
+        f2.dec_ref();
+        f2 = std::move(f1);
+        QVERIFY(f1.get_frame() == NULL);
+        QVERIFY(f2.get_frame() == frame);
+        QCOMPARE(f2.ref_count(), 2);
+        mlt_frame_close(frame);
+    }
+
+    void MoveFromViewAddsReference()
+    {
+        mlt_frame frame = mlt_frame_init(NULL);
+        {
+            FrameView view(frame);
+            Frame f1(std::move(view));
+            QCOMPARE(f1.ref_count(), 2);
+            Frame f2;
+            f2 = std::move(view);
+            QCOMPARE(f2.ref_count(), 3);
+        }
+        QCOMPARE(mlt_properties_ref_count(MLT_FRAME_PROPERTIES(frame)), 1);
+        mlt_frame_close(frame);
+    }
+
+    void ViewDoesNotAddReference()
+    {
+        mlt_frame frame = mlt_frame_init(NULL);
+        {
+            FrameView view(frame);
+            QCOMPARE(view.ref_count(), 1);
+            Frame f1(view);
+            QCOMPARE(f1.ref_count(), 2);
+        }
+        QCOMPARE(mlt_properties_ref_count(MLT_FRAME_PROPERTIES(frame)), 1);
+        mlt_frame_close(frame);
+    }
+
+    void QueuedLutsComposeInOrder()
+    {
+        mlt_frame frame = newImageFrame(5);
+        uint8_t add[3 * 256], multiply[3 * 256];
+        makeLut(add, 10, 1);
+        makeLut(multiply, 0, 2);
+        QCOMPARE(mlt_frame_add_lut(frame, mlt_image_rgb24, add), 0);
+        QCOMPARE(mlt_frame_add_lut(frame, mlt_image_rgb24, multiply), 0);
+
+        // Nothing is applied until the image is got.
+        uint8_t* image = (uint8_t*) mlt_properties_get_data(MLT_FRAME_PROPERTIES(frame), "image", NULL);
+        QCOMPARE(int(image[0]), 5);
+
+        mlt_image_format format = mlt_image_rgb24;
+        int width = 4, height = 2;
+        QCOMPARE(mlt_frame_get_image(frame, &image, &format, &width, &height, 0), 0);
+        QCOMPARE(int(image[0]), (5 + 10) * 2);
+        QCOMPARE(int(image[4 * 2 * 3 - 1]), (5 + 10) * 2);
+
+        // The queue is empty afterwards.
+        QCOMPARE(mlt_frame_get_image(frame, &image, &format, &width, &height, 0), 0);
+        QCOMPARE(int(image[0]), (5 + 10) * 2);
+        mlt_frame_close(frame);
+    }
+
+    void DeferredLutIsAppliedAtGetImage()
+    {
+        mlt_frame frame = newImageFrame(5);
+        uint8_t add[3 * 256], multiply[3 * 256];
+        makeLut(add, 10, 1);
+        makeLut(multiply, 0, 2);
+        // The operation pushed first is nearest to the image and queues first.
+        mlt_frame_push_service(frame, multiply);
+        mlt_frame_push_get_image(frame, lutGetImage);
+        mlt_frame_push_service(frame, add);
+        mlt_frame_push_get_image(frame, lutGetImage);
+
+        uint8_t* image = NULL;
+        mlt_image_format format = mlt_image_rgb24;
+        int width = 4, height = 2;
+        QCOMPARE(mlt_frame_get_image(frame, &image, &format, &width, &height, 1), 0);
+        QCOMPARE(int(image[0]), (5 * 2) + 10);
+        QVERIFY(mlt_properties_get_data(MLT_FRAME_PROPERTIES(frame), "_lut", NULL) == NULL);
+        mlt_frame_close(frame);
+    }
+
+    void FormatChangeFlushesLuts()
+    {
+        mlt_frame frame = newImageFrame(5);
+        frame->convert_image = convertImage;
+        uint8_t add[3 * 256];
+        makeLut(add, 10, 1);
+        QCOMPARE(mlt_frame_add_lut(frame, mlt_image_rgb24, add), 0);
+        // A table is only queued for the format of the image.
+        QVERIFY(mlt_frame_add_lut(frame, mlt_image_rgb24a, add) != 0);
+
+        // A point operation in another format gets the tables applied.
+        uint8_t* image = NULL;
+        mlt_image_format format = mlt_image_rgb24a;
+        int width = 4, height = 2;
+        QCOMPARE(mlt_frame_get_image_lut(frame, &image, &format, &width, &height), 0);
+        QCOMPARE(int(format), int(mlt_image_rgb24a));
+        QCOMPARE(int(image[0]), 5 + 10);
+        QCOMPARE(int(image[3]), 255);
+        QVERIFY(mlt_properties_get_data(MLT_FRAME_PROPERTIES(frame), "_lut", NULL) == NULL);
+        mlt_frame_close(frame);
+    }
 };
 
 QTEST_APPLESS_MAIN(TestFrame)
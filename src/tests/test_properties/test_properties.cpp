@@ -71,6 +71,45 @@ private Q_SLOTS:
         QCOMPARE(p.ref_count(), 1);
     }
 
+    void MoveConstructorTransfersReference()
+    {
+        Properties p;
+        p.set("key", "value");
+        Properties q(std::move(p));
+        QVERIFY(!p.is_valid());
+        QCOMPARE(q.ref_count(), 1);
+        QCOMPARE(q.get("key"), "value");
+    }
+
+    void MoveAssignmentReleasesPrevious()
+    {
+        Properties p;
+        Properties q;
+        Properties r(q);
+        QCOMPARE(q.ref_count(), 2);
+        r = std::move(p);
+        QCOMPARE(q.ref_count(), 1);
+        QCOMPARE(r.ref_count(), 1);
+    }
+
+    void MoveSubclassIntoPropertiesAddsReference()
+    {
+        Profile profile("dv_pal");
+        Producer producer(profile, "colour:red");
+        Properties p(std::move(producer));
+        QVERIFY(producer.is_valid());
+        QCOMPARE(p.ref_count(), 2);
+        QCOMPARE(p.get("mlt_service"), "colour");
+    }
+
+    void CopyAssignmentAddsReference()
+    {
+        Properties p;
+        Properties q;
+        q = p;
+        QCOMPARE(p.ref_count(), 2);
+    }
+
     void SetAndGetString()
     {
         Properties p;
@@ -0,0 +1,130 @@
+/*
+ * Copyright (C) 2017 Meltytech, LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with consumer library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <QString>
+#include <QtTest>
+#include <QAtomicInt>
+
+#include <mlt++/Mlt.h>
+using namespace Mlt;
+
+static QAtomicInt callbackCount;
+
+static void countFrames(void* data, int ticket, int position, Frame& frame)
+{
+    Q_UNUSED(data)
+    Q_UNUSED(ticket)
+    Q_UNUSED(position)
+    Q_UNUSED(frame)
+    callbackCount.ref();
+}
+
+class TestRenderer : public QObject
+{
+    Q_OBJECT
+    Profile profile;
+
+public:
+    TestRenderer()
+        : profile("dv_pal")
+    {
+        Factory::init();
+    }
+
+private Q_SLOTS:
+
+    void StartsRequestedThreads()
+    {
+        Producer p(profile, "colour:red");
+        Renderer r(p, 2);
+        QVERIFY(r.is_valid());
+        QCOMPARE(r.threads(), 2);
+    }
+
+    void GetReturnsFramesAtPositions()
+    {
+        Producer p(profile, "colour:red");
+        Renderer r(p, 2);
+        r.set_size(320, 240);
+        r.set_format(mlt_image_rgb24a);
+        int positions[] = { 20, 10, 30 };
+        int ticket = r.render(positions, 3);
+        QVERIFY(ticket >= 0);
+        for (int i = 0; i < 3; i++) {
+            Frame* frame = r.get(ticket + i);
+            QVERIFY(frame != 0);
+            QCOMPARE(frame->get_position(), positions[i]);
+            QCOMPARE(frame->get_int("width"), 320);
+            QCOMPARE(frame->get_int("height"), 240);
+            delete frame;
+        }
+        QCOMPARE(r.pending(), 0);
+    }
+
+    void DoesNotSeekSourceProducer()
+    {
+        Producer p(profile, "colour:red");
+        p.seek(5);
+        Renderer r(p, 2);
+        r.render(50);
+        r.wait();
+        QCOMPARE(p.position(), 5);
+    }
+
+    void TicketIsCollectedOnce()
+    {
+        Producer p(profile, "colour:red");
+        Renderer r(p, 1);
+        int ticket = r.render(3);
+        Frame* frame = r.get(ticket);
+        QVERIFY(frame != 0);
+        delete frame;
+        QVERIFY(r.get(ticket) == 0);
+        QVERIFY(r.get(ticket + 100) == 0);
+    }
+
+    void CallbackReceivesFrames()
+    {
+        Producer p(profile, "colour:red");
+        Renderer r(p, 2);
+        callbackCount = 0;
+        r.set_callback(countFrames);
+        int positions[] = { 1, 2, 3, 4 };
+        int ticket = r.render(positions, 4);
+        r.wait();
+        QCOMPARE(int(callbackCount), 4);
+        QVERIFY(!r.is_ready(ticket));
+        QVERIFY(r.get(ticket) == 0);
+    }
+
+    void CancelDropsFrames()
+    {
+        Producer p(profile, "colour:red");
+        Renderer r(p, 1);
+        int ticket = r.render(7);
+        r.wait();
+        QVERIFY(r.is_ready(ticket));
+        r.cancel();
+        QVERIFY(!r.is_ready(ticket));
+        QCOMPARE(r.pending(), 0);
+    }
+};
+
+QTEST_APPLESS_MAIN(TestRenderer)
+
+#include "test_renderer.moc"
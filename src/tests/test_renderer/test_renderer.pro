@@ -0,0 +1,3 @@
+include(../common.pri)
+TARGET = test_renderer
+SOURCES += test_renderer.cpp
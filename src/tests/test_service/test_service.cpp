@@ -0,0 +1,189 @@
+/*
+ * Copyright (C) 2017 Meltytech, LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with consumer library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <QString>
+#include <QtTest>
+
+#include <mlt++/Mlt.h>
+using namespace Mlt;
+
+class TestService : public QObject
+{
+    Q_OBJECT
+    Profile profile;
+
+public:
+    TestService()
+        : profile("dv_pal")
+    {
+        Factory::init();
+    }
+
+private Q_SLOTS:
+
+    void MoveServiceTransfersReference()
+    {
+        Producer producer(profile, "colour:red");
+        Service s1(producer);
+        QCOMPARE(producer.ref_count(), 2);
+        Service s2(std::move(s1));
+        QVERIFY(s2.get_service() == producer.get_service());
+        QCOMPARE(producer.ref_count(), 2);
+        Service s3;
+        s3 = std::move(s2);
+        QVERIFY(s3.get_service() == producer.get_service());
+        QCOMPARE(producer.ref_count(), 2);
+    }
+
+    void MoveFilterIntoServiceAddsReference()
+    {
+        Filter filter(profile, "brightness");
+        QVERIFY(filter.is_valid());
+        QCOMPARE(filter.ref_count(), 1);
+        {
+            Service service(std::move(filter));
+            QVERIFY(filter.is_valid());
+            QVERIFY(service.get_service() == filter.get_service());
+            QCOMPARE(filter.ref_count(), 2);
+        }
+        QCOMPARE(filter.ref_count(), 1);
+    }
+
+    void MoveProducerTransfersReference()
+    {
+        Producer p1(profile, "colour:red");
+        mlt_producer producer = p1.get_producer();
+        Producer p2(std::move(p1));
+        QVERIFY(!p1.is_valid());
+        QVERIFY(p2.get_producer() == producer);
+        QCOMPARE(p2.ref_count(), 1);
+        Producer p3(profile, "colour:blue");
+        p3 = std::move(p2);
+        QVERIFY(!p2.is_valid());
+        QVERIFY(p3.get_producer() == producer);
+        QCOMPARE(p3.ref_count(), 1);
+    }
+
+    void MoveCutKeepsParent()
+    {
+        Producer clip(profile, "colour:red");
+        Producer* cut = clip.cut(0, 9);
+        Producer& parent = cut->parent();
+        QVERIFY(parent.get_producer() == clip.get_producer());
+        Producer moved(std::move(*cut));
+        QVERIFY(&moved.parent() == &parent);
+        delete cut;
+        QVERIFY(moved.parent().get_producer() == clip.get_producer());
+    }
+
+    void MovePlaylistIntoProducerAddsReference()
+    {
+        Playlist playlist(profile);
+        QCOMPARE(playlist.ref_count(), 1);
+        {
+            Producer producer(std::move(playlist));
+            QVERIFY(producer.is_valid());
+            QVERIFY(producer.get_producer() == playlist.get_producer());
+            QCOMPARE(producer.type(), playlist_type);
+            Producer other;
+            other = std::move(playlist);
+            QVERIFY(other.get_producer() == playlist.get_producer());
+        }
+        QCOMPARE(playlist.ref_count(), 1);
+    }
+
+    void CopyAssignmentReleasesPrevious()
+    {
+        Producer p1(profile, "colour:red");
+        {
+            Producer p2(profile, "colour:blue");
+            mlt_producer blue = p2.get_producer();
+            mlt_properties_inc_ref(MLT_PRODUCER_PROPERTIES(blue));
+            p2 = p1;
+            QVERIFY(p2.get_producer() == p1.get_producer());
+            QCOMPARE(mlt_properties_ref_count(MLT_PRODUCER_PROPERTIES(blue)), 1);
+            mlt_producer_close(blue);
+        }
+        QCOMPARE(p1.ref_count(), 1);
+    }
+
+    void SubclassCopyAssignmentAddsReference()
+    {
+        Filter f1(profile, "brightness");
+        {
+            Filter f2(profile, "brightness");
+            f2 = f1;
+            QVERIFY(f2.get_filter() == f1.get_filter());
+            QVERIFY(f1.ref_count() > 1);
+        }
+        QCOMPARE(f1.ref_count(), 1);
+        Playlist l1(profile);
+        {
+            Playlist l2(profile);
+            l2 = l1;
+            QVERIFY(l2.get_playlist() == l1.get_playlist());
+        }
+        QCOMPARE(l1.ref_count(), 1);
+        Tractor t1(profile);
+        {
+            Tractor t2(profile);
+            t2 = t1;
+            QVERIFY(t2.get_tractor() == t1.get_tractor());
+        }
+        QCOMPARE(t1.ref_count(), 1);
+    }
+
+    void ProducerViewDoesNotAddReference()
+    {
+        Playlist playlist(profile);
+        Producer clip(profile, "colour:red");
+        playlist.append(clip);
+        QCOMPARE(clip.ref_count(), 2);
+        mlt_producer cut = mlt_playlist_get_clip(playlist.get_playlist(), 0);
+        int refs = mlt_properties_ref_count(MLT_PRODUCER_PROPERTIES(cut));
+        {
+            ProducerView view(cut);
+            QCOMPARE(view.ref_count(), refs);
+            QVERIFY(view.is_cut());
+            QVERIFY(view.parent().get_producer() == clip.get_producer());
+            Producer copy(std::move(view));
+            QCOMPARE(copy.ref_count(), refs + 1);
+        }
+        QCOMPARE(mlt_properties_ref_count(MLT_PRODUCER_PROPERTIES(cut)), refs);
+    }
+
+    void GetFrameIntoExistingFrame()
+    {
+        Producer producer(profile, "colour:red");
+        producer.seek(3);
+        Frame frame;
+        QCOMPARE(producer.get_frame(frame), 0);
+        QVERIFY(frame.is_valid());
+        QCOMPARE(frame.ref_count(), 1);
+        QCOMPARE(frame.get_position(), 3);
+        mlt_frame first = frame.get_frame();
+        QCOMPARE(producer.get_frame(frame), 0);
+        QVERIFY(frame.get_frame() != first);
+        QCOMPARE(frame.ref_count(), 1);
+        QCOMPARE(frame.get_position(), 4);
+    }
+};
+
+QTEST_APPLESS_MAIN(TestService)
+
+#include "test_service.moc"
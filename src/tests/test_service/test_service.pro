@@ -0,0 +1,3 @@
+include(../common.pri)
+TARGET = test_service
+SOURCES += test_service.cpp
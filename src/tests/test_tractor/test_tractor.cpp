@@ -34,6 +34,25 @@ public:
         Factory::init();
     }
 
+private:
+    // Gets the first frame of a producer as planar float.
+    static QVector<float> audioSamples(Producer& producer, int& channels, int& samples)
+    {
+        producer.seek(0);
+        Frame* frame = producer.get_frame();
+        mlt_audio_format format = mlt_audio_float;
+        int frequency = 48000;
+        channels = 2;
+        samples = mlt_sample_calculator(25, frequency, 0);
+        float* buffer = (float*) frame->get_audio(format, frequency, channels, samples);
+        QVector<float> result;
+        if (buffer && format == mlt_audio_float)
+            for (int i = 0; i < channels * samples; i++)
+                result.append(buffer[i]);
+        delete frame;
+        return result;
+    }
+
 private Q_SLOTS:
 
     void CreateSingleTrack()
@@ -402,6 +421,44 @@ private Q_SLOTS:
         QCOMPARE(t.count(), 1);
         QCOMPARE(filter.get_track(), 0);
     }
+
+    void AudioBusSumsTracksWithGain()
+    {
+        Producer a(profile, "tone");
+        a.set("frequency", 1000);
+        a.set("level", -6);
+        Producer b(profile, "tone");
+        b.set("frequency", 440);
+        b.set("level", -12);
+        Producer hidden(profile, "tone");
+        hidden.set("frequency", 100);
+        int channels = 0, samples = 0;
+        QVector<float> expectedA = audioSamples(a, channels, samples);
+        QVector<float> expectedB = audioSamples(b, channels, samples);
+        QCOMPARE(expectedA.size(), channels * samples);
+        QCOMPARE(expectedB.size(), channels * samples);
+
+        Tractor t(profile);
+        t.set("mix_audio", 1);
+        b.set("gain", 0.5);
+        hidden.set("hide", 2);
+        t.set_track(a, 0);
+        t.set_track(b, 1);
+        t.set_track(hidden, 2);
+        // A mix transition would add the track a second time.
+        Transition mix(profile, "mix");
+        mix.set("combine", 1);
+        t.plant_transition(mix, 0, 1);
+
+        QVector<float> mixed = audioSamples(t, channels, samples);
+        QCOMPARE(mixed.size(), expectedA.size());
+        float peak = 0.0;
+        for (int i = 0; i < mixed.size(); i++) {
+            QVERIFY(qAbs(mixed[i] - (expectedA[i] + 0.5f * expectedB[i])) < 1e-5f);
+            peak = qMax(peak, qAbs(mixed[i]));
+        }
+        QVERIFY(peak > 0.4f);
+    }
 };
 
 QTEST_APPLESS_MAIN(TestTractor)
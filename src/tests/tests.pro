@@ -4,4 +4,9 @@ SUBDIRS = test_filter \
     test_properties \
     test_repository \
     test_animation \
-    test_tractor
+    test_tractor \
+    test_renderer \
+    test_service \
+    test_consumer \
+    test_analysis \
+    test_cache